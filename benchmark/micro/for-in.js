@@ -0,0 +1,41 @@
+// Measures for-in throughput over objects with a large number of interned
+// property names. Each enumerated key is converted from its interned
+// identifier back to a string.
+
+var NUM_NAMES = 100000;
+var NUM_ROUNDS = 10;
+
+function setup() {
+    var objs = [];
+    var obj = {};
+    for (var i = 0; i < NUM_NAMES; i++) {
+        obj["name" + i] = i;
+
+        // Keep objects small to avoid measuring anything but key lookups.
+        if ((i & 1023) == 1023) {
+            objs.push(obj);
+            obj = {};
+        }
+    }
+    objs.push(obj);
+    return objs;
+}
+
+function run(objs) {
+    var len = 0;
+    for (var i = 0; i < objs.length; i++) {
+        for (var k in objs[i])
+            len += k.length;
+    }
+    return len;
+}
+
+var objs = setup();
+
+var start = new Date().getTime();
+var res = 0;
+for (var round = 0; round < NUM_ROUNDS; round++)
+    res += run(objs);
+var end = new Date().getTime();
+
+print("for-in: " + (end - start) + " ms (" + (NUM_NAMES * NUM_ROUNDS) + " keys, checksum " + res + ")");
@@ -0,0 +1,28 @@
+// Measures allocation throughput of small objects that are kept alive, which
+// is sensitive to the size of the object header. Each object is a small
+// record created from an object literal.
+
+var NUM_OBJECTS = 1000000;
+var NUM_ROUNDS = 5;
+
+function run() {
+    var objs = [];
+    for (var i = 0; i < NUM_OBJECTS; i++)
+        objs.push({ id: i, next: null });
+
+    for (var i = 1; i < objs.length; i++)
+        objs[i - 1].next = objs[i];
+
+    var len = 0;
+    for (var obj = objs[0]; obj !== null; obj = obj.next)
+        len++;
+    return len;
+}
+
+var start = new Date().getTime();
+var res = 0;
+for (var round = 0; round < NUM_ROUNDS; round++)
+    res += run();
+var end = new Date().getTime();
+
+print("object-alloc: " + (end - start) + " ms (" + (NUM_OBJECTS * NUM_ROUNDS) + " objects, checksum " + res + ")");
@@ -0,0 +1,52 @@
+// Measures string to number conversion of CSV-like numeric fields through
+// implicit conversion, the unary plus operator and parseFloat. The fields are
+// short decimal integers and decimals with a few fraction digits.
+
+var NUM_FIELDS = 100000;
+var NUM_ROUNDS = 10;
+
+function setup() {
+    var fields = [];
+    var seed = 1;
+    for (var i = 0; i < NUM_FIELDS; i++) {
+        seed = (seed * 1103515245 + 12345) % 2147483648;
+        switch (i % 4) {
+            case 0:
+                fields.push(String(seed % 10000));
+                break;
+            case 1:
+                fields.push(String((seed % 1000000) / 100));
+                break;
+            case 2:
+                fields.push("-" + (seed % 100000) / 1000);
+                break;
+            default:
+                fields.push(" " + (seed % 1000) + ".5 ");
+                break;
+        }
+    }
+    return fields;
+}
+
+function run(fields) {
+    var sum = 0;
+    for (var i = 0; i < fields.length; i++) {
+        var field = fields[i];
+        sum += +field;
+        sum += field - 1;
+        sum += parseFloat(field);
+        if (field < 5000)
+            sum++;
+    }
+    return sum;
+}
+
+var fields = setup();
+
+var start = new Date().getTime();
+var res = 0;
+for (var round = 0; round < NUM_ROUNDS; round++)
+    res += run(fields);
+var end = new Date().getTime();
+
+print("str-to-num: " + (end - start) + " ms (" + (NUM_FIELDS * NUM_ROUNDS) + " fields, checksum " + res + ")");
@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+
+import fileinput
+import getopt
+import os
+import platform
+import subprocess
+import sys
+
+is_linux = platform.uname()[0] == 'Linux'
+is_darwin = platform.uname()[0] == 'Darwin'
+
+EXT='c'
+
+RCC='../compiler/compiler'
+EVL='../tools/evaluator'
+
+GCC_COMPILE=str.join(' ', [
+    #'/usr/lib/ccache/bin/g++',
+    #'clang++',
+    '/usr/lib/ccache/bin/gcc',
+    '-arch x86_64' if is_darwin else '',
+    #'-std=c++11',
+    '-std=c11',
+    '-Werror=unused-variable',
+    #'-O3',
+    '-g',
+    '-I' + os.path.join(os.getcwd(), '../'),
+    '-I' + os.path.join(os.getcwd(), '../runtime/'),
+    '-DPLATFORM_LINUX' if is_linux else '',
+    '-DPLATFORM_DARWIN' if is_darwin else '',
+    subprocess.check_output('pkg-config --cflags bdw-gc libpcre',
+                            shell=True, universal_newlines=True).strip(),
+    '-c'
+])
+
+GCC_LINK=str.join(' ', [
+    #'/usr/lib/ccache/bin/g++',
+    #'clang++',
+    '/usr/lib/ccache/bin/gcc',
+    '-L' + os.path.join(os.getcwd(), '../common/.libs/'),
+    '-L' + os.path.join(os.getcwd(), '../parser/.libs/'),
+    '-L' + os.path.join(os.getcwd(), '../runtime/.libs/'),
+    '-lcommon', '-lparser', '-lruntime',
+    subprocess.check_output('pkg-config --libs bdw-gc libpcre',
+                            shell=True, universal_newlines=True).strip()
+])
+
+# setup environment variables
+env_paths = [
+    os.path.join(os.getcwd(), '../common/.libs/'),
+    os.path.join(os.getcwd(), '../parser/.libs/'),
+    os.path.join(os.getcwd(), '../runtime/.libs/')
+]
+
+env_vars = [
+    'DYLD_LIBRARY_PATH',
+    'LD_LIBRARY_PATH'
+]
+
+for env in env_vars:
+    env_val_sfx = ''
+    if (env in os.environ):
+        env_val_sfx = ':' + os.environ[env]
+    os.environ[env] = str.join(':', env_paths) + env_val_sfx
+
+# compile single benchmark.
+def bench_compile(path):
+    path_src = os.path.splitext(path)[0] + '.' + EXT
+    path_obj = os.path.splitext(path)[0] + '.o'
+    path_bin = os.path.splitext(path)[0]
+
+    cmdline = RCC + ' ' + path + ' -o ' + path_src
+    if (subprocess.call(cmdline, shell=True) == 1):
+        return 1
+
+    res = subprocess.call(GCC_COMPILE + ' ' + path_src + ' -o ' + path_obj, shell=True)
+    if (res != 0):
+        return res
+
+    return subprocess.call(GCC_LINK + ' ' + path_obj + ' -o ' + path_bin, shell=True)
+
+# runs a single benchmark.
+def run_bench(path):
+    path_bin = os.path.splitext(path)[0]
+
+    # compile benchmark.
+    if (bench_compile(path) != 0):
+        return 1
+
+    # run benchmark.
+    if (subprocess.call(path_bin, shell=True) != 0):
+        return 1
+
+    return 0
+
+# runs all benchmarks.
+def run_benchs():
+    res = 0
+    for line in fileinput.input('run-micro.input'):
+        bench_file = line.strip()
+        if (len(bench_file) == 0 or bench_file[0] == '#'):
+            continue
+
+        if (run_bench(bench_file) != 0):
+            res = 1
+
+    return res
+
+# main entry.
+def main():
+    # parse command line options.
+    try:
+        opts, args = getopt.getopt(sys.argv[1:], 'x', [])
+    except getopt.GetoptError:
+        print('error: invalid usage.')
+        exit(1)
+
+    # test if we should run all benchmarks or a single one.
+    if (len(args) > 0):
+        if (os.path.exists(args[0])):
+            path = os.path.abspath(args[0])
+        else:
+            cmdline = 'find ' + os.path.join(os.getcwd(), 'micro/') + ' -name ' + args[0]
+            path = subprocess.check_output(cmdline, shell=True).decode("utf-8").strip()
+
+        if (not os.path.exists(path)):
+            print('error: no such file')
+            exit(1)
+
+        exit(run_bench(path))
+    else:
+        exit(run_benchs())
+
+if __name__ == "__main__":
+    main()
@@ -16,12 +16,20 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cassert>
+#include <cmath>
+#include <cstring>
 #include "conversion.hh"
 #include "string.hh"
 
 bool es_str_to_index(const String &str, uint32_t &index)
 {
-    if (str.empty())
+    return es_str_to_index(str.data(), str.length(), index);
+}
+
+bool es_str_to_index(const uni_char *str, size_t len, uint32_t &index)
+{
+    if (len == 0)
         return false;
 
     // Check the first character.
@@ -29,11 +37,11 @@ bool es_str_to_index(const String &str, uint32_t &index)
     if (c > 9)
         return false;
 
-    if (!c && str.length() > 1)
+    if (!c && len > 1)
         return false;
 
     index = 0;
-    for (size_t i = 0; i < str.length(); i++)
+    for (size_t i = 0; i < len; i++)
     {
         uint32_t c = str[i] - _U('0');
         if (c > 9)
@@ -50,3 +58,296 @@ bool es_str_to_index(const String &str, uint32_t &index)
     return true;
 }
 
+/**
+ * @brief Floating point number with a 64-bit significand, f * 2^e.
+ */
+struct DiyFp
+{
+    uint64_t f;
+    int e;
+
+    DiyFp(uint64_t f, int e)
+        : f(f), e(e) {}
+};
+
+static DiyFp diy_fp_mul(const DiyFp &x, const DiyFp &y)
+{
+    // Keeps the upper 64 bits of the 128-bit product, rounded.
+    const uint64_t m32 = 0xffffffffULL;
+    uint64_t a = x.f >> 32, b = x.f & m32;
+    uint64_t c = y.f >> 32, d = y.f & m32;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+
+    uint64_t tmp = (bd >> 32) + (ad & m32) + (bc & m32);
+    tmp += 1ULL << 31;
+
+    return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64);
+}
+
+static DiyFp diy_fp_normalize(DiyFp x)
+{
+    while (!(x.f & 0xffc0000000000000ULL))
+    {
+        x.f <<= 10;
+        x.e -= 10;
+    }
+    while (!(x.f & 0x8000000000000000ULL))
+    {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
+}
+
+/**
+ * Normalized powers of ten, 10^k ~ f * 2^e, for every eighth k in the range
+ * [-348, 340].
+ */
+static const struct
+{
+    uint64_t f;
+    int16_t e;
+    int16_t k;
+} cached_powers[] =
+{
+    { 0xfa8fd5a0081c0288ULL, -1220, -348 },
+    { 0xbaaee17fa23ebf76ULL, -1193, -340 },
+    { 0x8b16fb203055ac76ULL, -1166, -332 },
+    { 0xcf42894a5dce35eaULL, -1140, -324 },
+    { 0x9a6bb0aa55653b2dULL, -1113, -316 },
+    { 0xe61acf033d1a45dfULL, -1087, -308 },
+    { 0xab70fe17c79ac6caULL, -1060, -300 },
+    { 0xff77b1fcbebcdc4fULL, -1034, -292 },
+    { 0xbe5691ef416bd60cULL, -1007, -284 },
+    { 0x8dd01fad907ffc3cULL,  -980, -276 },
+    { 0xd3515c2831559a83ULL,  -954, -268 },
+    { 0x9d71ac8fada6c9b5ULL,  -927, -260 },
+    { 0xea9c227723ee8bcbULL,  -901, -252 },
+    { 0xaecc49914078536dULL,  -874, -244 },
+    { 0x823c12795db6ce57ULL,  -847, -236 },
+    { 0xc21094364dfb5637ULL,  -821, -228 },
+    { 0x9096ea6f3848984fULL,  -794, -220 },
+    { 0xd77485cb25823ac7ULL,  -768, -212 },
+    { 0xa086cfcd97bf97f4ULL,  -741, -204 },
+    { 0xef340a98172aace5ULL,  -715, -196 },
+    { 0xb23867fb2a35b28eULL,  -688, -188 },
+    { 0x84c8d4dfd2c63f3bULL,  -661, -180 },
+    { 0xc5dd44271ad3cdbaULL,  -635, -172 },
+    { 0x936b9fcebb25c996ULL,  -608, -164 },
+    { 0xdbac6c247d62a584ULL,  -582, -156 },
+    { 0xa3ab66580d5fdaf6ULL,  -555, -148 },
+    { 0xf3e2f893dec3f126ULL,  -529, -140 },
+    { 0xb5b5ada8aaff80b8ULL,  -502, -132 },
+    { 0x87625f056c7c4a8bULL,  -475, -124 },
+    { 0xc9bcff6034c13053ULL,  -449, -116 },
+    { 0x964e858c91ba2655ULL,  -422, -108 },
+    { 0xdff9772470297ebdULL,  -396, -100 },
+    { 0xa6dfbd9fb8e5b88fULL,  -369,  -92 },
+    { 0xf8a95fcf88747d94ULL,  -343,  -84 },
+    { 0xb94470938fa89bcfULL,  -316,  -76 },
+    { 0x8a08f0f8bf0f156bULL,  -289,  -68 },
+    { 0xcdb02555653131b6ULL,  -263,  -60 },
+    { 0x993fe2c6d07b7facULL,  -236,  -52 },
+    { 0xe45c10c42a2b3b06ULL,  -210,  -44 },
+    { 0xaa242499697392d3ULL,  -183,  -36 },
+    { 0xfd87b5f28300ca0eULL,  -157,  -28 },
+    { 0xbce5086492111aebULL,  -130,  -20 },
+    { 0x8cbccc096f5088ccULL,  -103,  -12 },
+    { 0xd1b71758e219652cULL,   -77,   -4 },
+    { 0x9c40000000000000ULL,   -50,    4 },
+    { 0xe8d4a51000000000ULL,   -24,   12 },
+    { 0xad78ebc5ac620000ULL,     3,   20 },
+    { 0x813f3978f8940984ULL,    30,   28 },
+    { 0xc097ce7bc90715b3ULL,    56,   36 },
+    { 0x8f7e32ce7bea5c70ULL,    83,   44 },
+    { 0xd5d238a4abe98068ULL,   109,   52 },
+    { 0x9f4f2726179a2245ULL,   136,   60 },
+    { 0xed63a231d4c4fb27ULL,   162,   68 },
+    { 0xb0de65388cc8ada8ULL,   189,   76 },
+    { 0x83c7088e1aab65dbULL,   216,   84 },
+    { 0xc45d1df942711d9aULL,   242,   92 },
+    { 0x924d692ca61be758ULL,   269,  100 },
+    { 0xda01ee641a708deaULL,   295,  108 },
+    { 0xa26da3999aef774aULL,   322,  116 },
+    { 0xf209787bb47d6b85ULL,   348,  124 },
+    { 0xb454e4a179dd1877ULL,   375,  132 },
+    { 0x865b86925b9bc5c2ULL,   402,  140 },
+    { 0xc83553c5c8965d3dULL,   428,  148 },
+    { 0x952ab45cfa97a0b3ULL,   455,  156 },
+    { 0xde469fbd99a05fe3ULL,   481,  164 },
+    { 0xa59bc234db398c25ULL,   508,  172 },
+    { 0xf6c69a72a3989f5cULL,   534,  180 },
+    { 0xb7dcbf5354e9beceULL,   561,  188 },
+    { 0x88fcf317f22241e2ULL,   588,  196 },
+    { 0xcc20ce9bd35c78a5ULL,   614,  204 },
+    { 0x98165af37b2153dfULL,   641,  212 },
+    { 0xe2a0b5dc971f303aULL,   667,  220 },
+    { 0xa8d9d1535ce3b396ULL,   694,  228 },
+    { 0xfb9b7cd9a4a7443cULL,   720,  236 },
+    { 0xbb764c4ca7a44410ULL,   747,  244 },
+    { 0x8bab8eefb6409c1aULL,   774,  252 },
+    { 0xd01fef10a657842cULL,   800,  260 },
+    { 0x9b10a4e5e9913129ULL,   827,  268 },
+    { 0xe7109bfba19c0c9dULL,   853,  276 },
+    { 0xac2820d9623bf429ULL,   880,  284 },
+    { 0x80444b5e7aa7cf85ULL,   907,  292 },
+    { 0xbf21e44003acdd2dULL,   933,  300 },
+    { 0x8e679c2f5e44ff8fULL,   960,  308 },
+    { 0xd433179d9c8cb841ULL,   986,  316 },
+    { 0x9e19db92b4e31ba9ULL,  1013,  324 },
+    { 0xeb96bf6ebadf77d9ULL,  1039,  332 },
+    { 0xaf87023b9bf0ee6bULL,  1066,  340 },
+};
+
+static const int CACHED_POWERS_OFFSET = 348;    // -k of the first entry.
+static const int CACHED_POWERS_STEP = 8;
+
+/**
+ * Target range of the binary exponent of the scaled number. Within the range
+ * the integral part of the scaled number fits in 32 bits.
+ */
+static const int GRISU_MIN_EXPONENT = -60;
+static const int GRISU_MAX_EXPONENT = -32;
+
+/**
+ * Moves the last generated digit towards the number as long as that's
+ * possible, and checks that the result is guaranteed to be the closest
+ * shortest representation.
+ */
+static bool grisu_round_weed(char *buffer, int length, uint64_t dist_high_w,
+                             uint64_t unsafe_interval, uint64_t rest,
+                             uint64_t ten_kappa, uint64_t unit)
+{
+    uint64_t small_dist = dist_high_w - unit;
+    uint64_t big_dist = dist_high_w + unit;
+
+    while (rest < small_dist && unsafe_interval - rest >= ten_kappa &&
+           (rest + ten_kappa < small_dist ||
+            small_dist - rest >= rest + ten_kappa - small_dist))
+    {
+        buffer[length - 1]--;
+        rest += ten_kappa;
+    }
+
+    if (rest < big_dist && unsafe_interval - rest >= ten_kappa &&
+        (rest + ten_kappa < big_dist ||
+         big_dist - rest > rest + ten_kappa - big_dist))
+    {
+        return false;
+    }
+
+    return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+}
+
+static bool grisu_digit_gen(const DiyFp &low, const DiyFp &w,
+                            const DiyFp &high, char *buffer, int &length,
+                            int &kappa)
+{
+    uint64_t unit = 1;
+    DiyFp too_low(low.f - unit, low.e);
+    DiyFp too_high(high.f + unit, high.e);
+    uint64_t unsafe_interval = too_high.f - too_low.f;
+
+    int shift = -w.e;
+    uint64_t one = 1ULL << shift;
+    uint32_t integrals = static_cast<uint32_t>(too_high.f >> shift);
+    uint64_t fractionals = too_high.f & (one - 1);
+
+    uint32_t divisor = 1;
+    kappa = 1;
+    while (static_cast<uint64_t>(divisor) * 10 <= integrals)
+    {
+        divisor *= 10;
+        kappa++;
+    }
+
+    length = 0;
+    while (kappa > 0)
+    {
+        buffer[length++] = static_cast<char>('0' + integrals / divisor);
+        integrals %= divisor;
+        kappa--;
+
+        uint64_t rest = (static_cast<uint64_t>(integrals) << shift) + fractionals;
+        if (rest < unsafe_interval)
+        {
+            return grisu_round_weed(buffer, length, too_high.f - w.f,
+                                    unsafe_interval, rest,
+                                    static_cast<uint64_t>(divisor) << shift,
+                                    unit);
+        }
+
+        divisor /= 10;
+    }
+
+    for (;;)
+    {
+        fractionals *= 10;
+        unit *= 10;
+        unsafe_interval *= 10;
+
+        buffer[length++] = static_cast<char>('0' + (fractionals >> shift));
+        fractionals &= one - 1;
+        kappa--;
+
+        if (fractionals < unsafe_interval)
+        {
+            return grisu_round_weed(buffer, length,
+                                    (too_high.f - w.f) * unit,
+                                    unsafe_interval, fractionals, one, unit);
+        }
+    }
+}
+
+bool es_num_to_shortest(double num, char *digits, int &length, int &point)
+{
+    assert(num > 0.0 && std::isfinite(num));
+
+    uint64_t bits = 0;
+    memcpy(&bits, &num, sizeof(bits));
+
+    const uint64_t hidden_bit = 0x0010000000000000ULL;
+    const int denormal_exponent = -1074;
+
+    uint64_t significand = bits & (hidden_bit - 1);
+    int biased_exponent = static_cast<int>((bits >> 52) & 0x7ff);
+
+    DiyFp v(significand, denormal_exponent);
+    if (biased_exponent != 0)
+    {
+        v.f += hidden_bit;
+        v.e = biased_exponent - 1075;
+    }
+
+    // Boundaries halfway to the neighboring numbers. The lower neighbor is
+    // closer when the number is a power of two, unless it's denormal.
+    DiyFp m_plus = diy_fp_normalize(DiyFp((v.f << 1) + 1, v.e - 1));
+    DiyFp m_minus = significand == 0 && biased_exponent > 1
+        ? DiyFp((v.f << 2) - 1, v.e - 2)
+        : DiyFp((v.f << 1) - 1, v.e - 1);
+    m_minus.f <<= m_minus.e - m_plus.e;
+    m_minus.e = m_plus.e;
+
+    DiyFp w = diy_fp_normalize(v);
+
+    // Find a power of ten that brings the exponent into the target range.
+    int min_exponent = GRISU_MIN_EXPONENT - (w.e + 64);
+    int k = static_cast<int>(std::ceil((min_exponent + 63) *
+                                       0.30102999566398114));
+    int index = (CACHED_POWERS_OFFSET + k - 1) / CACHED_POWERS_STEP + 1;
+
+    DiyFp ten_mk(cached_powers[index].f, cached_powers[index].e);
+    int mk = cached_powers[index].k;
+    assert(w.e + ten_mk.e + 64 >= GRISU_MIN_EXPONENT &&
+           w.e + ten_mk.e + 64 <= GRISU_MAX_EXPONENT);
+
+    int kappa = 0;
+    if (!grisu_digit_gen(diy_fp_mul(m_minus, ten_mk), diy_fp_mul(w, ten_mk),
+                         diy_fp_mul(m_plus, ten_mk), digits, length, kappa))
+    {
+        return false;
+    }
+
+    point = length + kappa - mk;
+    return true;
+}
@@ -17,7 +17,9 @@
  */
 
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
+#include "types.hh"
 
 class String;
 
@@ -30,6 +32,32 @@ class String;
  */
 bool es_str_to_index(const String &str, uint32_t &index);
 
+/**
+ * Tries to parse a character sequence as an ECMA-262 array index.
+ * @param [in] str Pointer to first character.
+ * @param [in] len Number of characters in @a str.
+ * @param [out] index Index.
+ * @return true if str was successfully parsed as an index, false if it was
+ *         not.
+ */
+bool es_str_to_index(const uni_char *str, size_t len, uint32_t &index);
+
+/**
+ * Generates the shortest sequence of decimal digits that converts back to
+ * the specified number, using the Grisu3 algorithm. The algorithm rejects
+ * about 0.5% of all numbers, for which the caller has to fall back to a
+ * slower exact algorithm.
+ * @param [in] num Positive finite number to convert.
+ * @param [out] digits Buffer receiving the digits, must have room for at least
+ *                     17 characters. The digits are not null-terminated.
+ * @param [out] length Number of generated digits.
+ * @param [out] point Position of the decimal point relative to the first
+ *                    digit, num = 0.digits * 10^point.
+ * @return true if the digits were generated, false if the result could not
+ *         be guaranteed to be the shortest.
+ */
+bool es_num_to_shortest(double num, char *digits, int &length, int &point);
+
 /**
  * Checks if the double can be represented as an ECMA-262 array index.
  * @param [in] num Number to convert into an index.
@@ -235,6 +235,135 @@ double es_strtou(const uni_char *nptr, const uni_char **endptr, int radix)
     return res;
 }
 
+/**
+ * Parses short decimal numbers without a round trip through strtod. The
+ * number is exact if both the significand and the power of ten can be
+ * represented exactly as doubles, since a single multiplication or division
+ * is correctly rounded (Clinger's fast path).
+ * @param [in] ptr Pointer to the first non-white-space character.
+ * @param [out] endptr Optional pointer that will be updated to point at the
+ *                     character after the last parsed character.
+ * @param [out] res Parsed value.
+ * @return true if the number was parsed, false if the number must be parsed
+ *         by the slow path.
+ */
+static bool es_strtod_fast(const uni_char *ptr, const uni_char **endptr,
+                           double &res)
+{
+    // Powers of ten that are exactly representable as doubles.
+    static const double pow10[] =
+    {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const uint64_t max_exact = static_cast<uint64_t>(1) << 53;
+
+    bool neg = *ptr == '-';
+    if (neg || *ptr == '+')
+        ptr++;
+
+    uint64_t significand = 0;
+    int num_digits = 0;         // Significant digits in significand.
+    int exponent = 0;
+    bool has_digits = false;
+
+    for (; *ptr >= '0' && *ptr <= '9'; ptr++)
+    {
+        has_digits = true;
+        if (significand == 0 && *ptr == '0')
+            continue;
+
+        if (++num_digits > 19)
+            return false;
+
+        significand = significand * 10 + static_cast<uint64_t>(*ptr - '0');
+    }
+
+    if (*ptr == '.')
+    {
+        for (ptr++; *ptr >= '0' && *ptr <= '9'; ptr++)
+        {
+            has_digits = true;
+            exponent--;
+            if (significand == 0 && *ptr == '0')
+                continue;
+
+            if (++num_digits > 19)
+                return false;
+
+            significand = significand * 10 + static_cast<uint64_t>(*ptr - '0');
+        }
+    }
+
+    if (!has_digits)
+        return false;
+
+    if (*ptr == 'e' || *ptr == 'E')
+    {
+        const uni_char *exp_ptr = ptr + 1;
+        bool exp_neg = *exp_ptr == '-';
+        if (exp_neg || *exp_ptr == '+')
+            exp_ptr++;
+
+        // An exponent without digits is not part of the number.
+        if (*exp_ptr >= '0' && *exp_ptr <= '9')
+        {
+            int exp_val = 0;
+            for (; *exp_ptr >= '0' && *exp_ptr <= '9'; exp_ptr++)
+            {
+                exp_val = exp_val * 10 + static_cast<int>(*exp_ptr - '0');
+                if (exp_val > 9999)
+                    return false;
+            }
+
+            exponent += exp_neg ? -exp_val : exp_val;
+            ptr = exp_ptr;
+        }
+    }
+
+    if (significand > max_exact)
+        return false;
+
+    double val = static_cast<double>(significand);
+    if (significand != 0)
+    {
+        if (exponent < 0)
+        {
+            if (exponent < -22)
+                return false;
+
+            val /= pow10[-exponent];
+        }
+        else if (exponent > 22)
+        {
+            // Move some of the exponent into the significand, if it remains
+            // exact.
+            if (exponent > 22 + 15)
+                return false;
+
+            for (; exponent > 22; exponent--)
+            {
+                significand *= 10;
+                if (significand > max_exact)
+                    return false;
+            }
+
+            val = static_cast<double>(significand) * pow10[22];
+        }
+        else
+        {
+            val *= pow10[exponent];
+        }
+    }
+
+    if (endptr)
+        *endptr = ptr;
+
+    res = neg ? -val : val;
+    return true;
+}
+
 double es_strtod(const uni_char *nptr, const uni_char **endptr)
 {
     if (!nptr)
@@ -244,6 +373,10 @@ double es_strtod(const uni_char *nptr, const uni_char **endptr)
     es_str_skip_white_spaces(ustr);
     if (!ustr || !*ustr)
         return 0.0;
+
+    double fast_res = 0.0;
+    if (es_strtod_fast(ustr, endptr, fast_res))
+        return fast_res;
     
     size_t len = uni_strlen(ustr);
     
@@ -406,7 +406,10 @@ bool String::operator==(const String &rhs) const
     // availability.
     if (length() == 0)
         return true;
-    if ((!data() || !rhs.data()) && data() != rhs.data())
+    // Interned strings share data.
+    if (data() == rhs.data())
+        return true;
+    if (!data() || !rhs.data())
         return false;
     
     return !memcmp(data(), rhs.data(), length() * sizeof(uni_char));
@@ -139,6 +139,11 @@ size_t StringBuilder::length() const
     return cur_len_;
 }
 
+const uni_char *StringBuilder::data() const
+{
+    return data_;
+}
+
 String StringBuilder::string() const
 {
     return cur_len_ == 0 ? String() : String(data_, cur_len_);
@@ -109,6 +109,7 @@ public:
 
     size_t allocated() const;
     size_t length() const;
+    const uni_char *data() const;
     String string() const;
 
     static String vsprintf(const char *format, va_list vl);
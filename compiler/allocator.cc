@@ -54,6 +54,14 @@ Allocator::Register *Allocator::RegisterPool::get(const ir::Value *value)
     return reg;
 }
 
+Allocator::Register *Allocator::RegisterPool::reserve(const ir::Type *type)
+{
+    Allocator::Register *reg =
+            new (GC)Allocator::Register(type, next_reg_number_++, true);
+    registers_.push_back(reg);
+    return reg;
+}
+
 const Allocator::RegisterVector &Allocator::RegisterPool::registers() const
 {
     return registers_;
@@ -147,6 +155,15 @@ void Allocator::visit_fun(ir::Function *fun)
         live->set_register(cur_fun_->register_pool_.get(live->value()));
         active_set.insert(live);
     }
+
+    // Unboxed locals live throughout the whole function.
+    ir::Function::LocalTypeMap::const_iterator it_local;
+    for (it_local = fun->local_types().begin();
+        it_local != fun->local_types().end(); ++it_local)
+    {
+        cur_fun_->local_map_[it_local->first] =
+            cur_fun_->register_pool_.reserve(it_local->second);
+    }
 }
 
 void Allocator::visit_block(ir::Block *block)
@@ -657,6 +674,16 @@ void Allocator::visit_instr_es_new_obj(ir::EsNewObjectInstruction *instr)
     cur_fun_->cur_pos_++;
 }
 
+void Allocator::visit_instr_es_new_obj_lit(ir::EsNewObjectLiteralInstruction *instr)
+{
+    touch(instr->values());
+    touch(instr->result());
+    touch(instr);
+
+    assert(cur_fun_);
+    cur_fun_->cur_pos_++;
+}
+
 void Allocator::visit_instr_es_new_rex(ir::EsNewRegexInstruction *instr)
 {
     touch(instr->result());
@@ -695,6 +722,16 @@ int Allocator::lookup(ir::Value *val)
     return it->second->reg()->number();
 }
 
+int Allocator::lookup_local(ir::Function *fun, int index)
+{
+    assert(fun_map_.count(fun) > 0);
+
+    LocalMap::const_iterator it = fun_map_[fun]->local_map_.find(index);
+    assert(it != fun_map_[fun]->local_map_.end());
+
+    return it->second->number();
+}
+
 const Allocator::RegisterVector &Allocator::allocations(ir::Function *fun)
 {
     assert(fun_map_.count(fun) > 0);
@@ -70,6 +70,7 @@ namespace ir {
     class EsNewFunctionDeclarationInstruction;
     class EsNewFunctionExpressionInstruction;
     class EsNewObjectInstruction;
+    class EsNewObjectLiteralInstruction;
     class EsNewRegexInstruction;
     class EsAssignmentInstruction;
     class EsBinaryInstruction;
@@ -136,6 +137,7 @@ private:
     virtual void visit_instr_es_new_fun_decl(ir::EsNewFunctionDeclarationInstruction *instr) override;
     virtual void visit_instr_es_new_fun_expr(ir::EsNewFunctionExpressionInstruction *instr) override;
     virtual void visit_instr_es_new_obj(ir::EsNewObjectInstruction *instr) override;
+    virtual void visit_instr_es_new_obj_lit(ir::EsNewObjectLiteralInstruction *instr) override;
     virtual void visit_instr_es_new_rex(ir::EsNewRegexInstruction *instr) override;
     virtual void visit_instr_es_bin(ir::EsBinaryInstruction *instr) override;
     virtual void visit_instr_es_unary(ir::EsUnaryInstruction *instr) override;
@@ -264,6 +266,14 @@ public:
         void put(Register *reg);
         Register *get(const ir::Value *value);
 
+        /**
+         * Creates a new persistent register that is never shared with any
+         * other value.
+         * @param [in] type Register type.
+         * @return Register.
+         */
+        Register *reserve(const ir::Type *type);
+
         const RegisterVector &registers() const;
     };
 
@@ -276,11 +286,16 @@ private:
     IntervalMap interval_map_;
 
 private:
+    // Maps unboxed value stack slots to registers.
+    typedef std::map<int, Register *, std::less<int>,
+                     gc_allocator<std::pair<const int, Register *> > > LocalMap;
+
     struct Function
     {
         int cur_pos_;
         RegisterPool register_pool_;    ///< Function register pool.
         IntervalMap interval_map_;      ///< Allocations for this function.
+        LocalMap local_map_;            ///< Unboxed locals of this function.
 
         Function()
             : cur_pos_(0) {}
@@ -304,6 +319,13 @@ public:
      */
     int lookup(ir::Value *val);
 
+    /**
+     * @param [in] fun Function owning the local.
+     * @param [in] index Value stack slot index of an unboxed local.
+     * @return Number of register to store the unboxed local in.
+     */
+    int lookup_local(ir::Function *fun, int index);
+
     /**
      * Returns a map of all allocations occurring in a given function.
      * @param [in] fun Function to retrieve allocations for.
@@ -71,6 +71,7 @@ namespace ir {
     class EsNewFunctionDeclarationInstruction;
     class EsNewFunctionExpressionInstruction;
     class EsNewObjectInstruction;
+    class EsNewObjectLiteralInstruction;
     class EsNewRegexInstruction;
     class EsAssignmentInstruction;
     class EsBinaryInstruction;
@@ -95,8 +96,13 @@ private:
     Rope *decl_out_;    ///< Declarations, top of document.
     Rope *main_out_;    ///< Main output, follows the declarative region.
 
+    ir::Function *cur_fun_; ///< Current function that's being processed.
     ir::Block *cur_block_;  ///< Current block that's being processed.
 
+    int num_prp_caches_;    ///< Number of allocated property caches.
+    int num_ctx_caches_;    ///< Number of allocated context caches.
+    int num_obj_templates_; ///< Number of allocated object literal templates.
+
 private:
     /**
      * @return String stream for raw output.
@@ -130,6 +136,114 @@ public:
     static std::string uint64(uint64_t val);
     std::string value(ir::Value *val);
 
+private:
+    /**
+     * Allocates a new property cache for a property access site.
+     * @return Pointer expression referring to the new property cache.
+     */
+    std::string prp_cache();
+
+    /**
+     * Allocates a new context cache for a context access site.
+     * @return Pointer expression referring to the new context cache.
+     */
+    std::string ctx_cache();
+
+    /**
+     * Allocates a new object literal template for an object literal site.
+     * @param [in] keys Raw property keys of the object literal.
+     * @return Pointer expression referring to the new template.
+     */
+    std::string obj_template(const ir::KeyVector &keys);
+
+    /**
+     * @param [in] val Value.
+     * @return Native type if @p val is an unboxed local, NULL otherwise.
+     */
+    const ir::Type *local_type(ir::Value *val);
+
+    /**
+     * @param [in] val Unboxed local.
+     * @return Name of the register holding the local.
+     */
+    std::string local(ir::Value *val);
+
+    /**
+     * @param [in] val Value known to be a number.
+     * @return Expression for the value as a double.
+     */
+    std::string num(ir::Value *val);
+
+    /**
+     * @param [in] val Value known to be a number in the 32-bit integer range.
+     * @return Expression for the value as a 32-bit integer.
+     */
+    std::string i32(ir::Value *val);
+
+    /**
+     * Creates a run-time check that a value is of a given type.
+     * @param [in] val Value to check.
+     * @param [in] val_type Type @p val has been proven to have.
+     * @param [in] guard Required type: double for any number, int32 for
+     *                   numbers in the 32-bit integer range, or boolean.
+     * @return Guard expression, or an empty string if no check is needed.
+     */
+    std::string guard(ir::Value *val, const ir::Type *val_type,
+                      const ir::Type *guard);
+
+    /**
+     * Creates an assignment of a native expression to a value, boxing the
+     * expression unless the value is an unboxed local.
+     * @param [in] res Value to assign.
+     * @param [in] expr Native expression.
+     * @param [in] expr_type Type of @p expr: double, int32 or boolean.
+     * @return Assignment statement without terminating semicolon.
+     */
+    std::string assign(ir::Value *res, const std::string &expr,
+                       const ir::Type *expr_type);
+
+    /**
+     * Creates a call to a runtime function that stores its result through
+     * its last argument.
+     * @param [in] instr Instruction receiving the call status.
+     * @param [in] call Call expression without the result argument and
+     *                  closing parenthesis.
+     * @param [in] res Value to store the result in.
+     * @return Call statement.
+     */
+    std::string slow(ir::Instruction *instr, const std::string &call,
+                     ir::Value *res);
+
+    /**
+     * Writes a binary operation with an inline fast path. The fast path is
+     * taken if both operands satisfy @p guard_type, otherwise the operation
+     * is delegated to the runtime. The check is omitted for operands proven
+     * to satisfy it.
+     * @param [in] instr Binary instruction.
+     * @param [in] fun Runtime function implementing the operation.
+     * @param [in] guard_type Type required for both operands.
+     * @param [in] fast Native expression computing the result on the fast path.
+     * @param [in] fast_type Type of @p fast.
+     */
+    void write_fast_bin(ir::EsBinaryInstruction *instr, const char *fun,
+                        const ir::Type *guard_type, const std::string &fast,
+                        const ir::Type *fast_type);
+
+    /**
+     * Writes a unary operation with an inline fast path. The fast path is
+     * taken if the operand satisfies @p guard_type, otherwise the operation
+     * is delegated to the runtime. The check is omitted if the operand is
+     * proven to satisfy it.
+     * @param [in] instr Unary instruction.
+     * @param [in] fun Runtime function implementing the operation.
+     * @param [in] guard_type Type required for the operand.
+     * @param [in] fast Native expression computing the result on the fast path.
+     * @param [in] fast_type Type of @p fast.
+     */
+    void write_fast_unary(ir::EsUnaryInstruction *instr, const char *fun,
+                          const ir::Type *guard_type, const std::string &fast,
+                          const ir::Type *fast_type);
+
 private:
     virtual void visit_module(ir::Module *module) override;
     virtual void visit_fun(ir::Function *fun) override;
@@ -181,6 +295,7 @@ private:
     virtual void visit_instr_es_new_fun_decl(ir::EsNewFunctionDeclarationInstruction *instr) override;
     virtual void visit_instr_es_new_fun_expr(ir::EsNewFunctionExpressionInstruction *instr) override;
     virtual void visit_instr_es_new_obj(ir::EsNewObjectInstruction *instr) override;
+    virtual void visit_instr_es_new_obj_lit(ir::EsNewObjectLiteralInstruction *instr) override;
     virtual void visit_instr_es_new_rex(ir::EsNewRegexInstruction *instr) override;
     virtual void visit_instr_es_bin(ir::EsBinaryInstruction *instr) override;
     virtual void visit_instr_es_unary(ir::EsUnaryInstruction *instr) override;
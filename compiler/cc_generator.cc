@@ -120,7 +120,11 @@ public:
 CcGenerator::CcGenerator()
     : decl_out_(NULL)
     , main_out_(NULL)
+    , cur_fun_(NULL)
     , cur_block_(NULL)
+    , num_prp_caches_(0)
+    , num_ctx_caches_(0)
+    , num_obj_templates_(0)
 {
 }
 
@@ -162,6 +166,9 @@ std::string CcGenerator::number(double val)
 
 std::string CcGenerator::value(ir::Value *val)
 {
+    if (local_type(val))
+        return "es_value_from_number(" + local(val) + ")";
+
     if (val->is_constant())
     {
         ConstToStringVisitor const_to_str(this);
@@ -173,6 +180,204 @@ std::string CcGenerator::value(ir::Value *val)
     return slot.str();
 }
 
+std::string CcGenerator::prp_cache()
+{
+    int index = num_prp_caches_++;
+
+    std::stringstream name;
+    name << "__pc_" << index;
+
+    std::stringstream site;
+    site << cur_fun_->name() << ":" << index;
+
+    decl_out_->stream() << "static EsPropertyCache " << name.str()
+                        << " = ESA_PRP_CACHE_INIT(\"" << site.str() << "\");\n";
+
+    return "&" + name.str();
+}
+
+std::string CcGenerator::ctx_cache()
+{
+    int index = num_ctx_caches_++;
+
+    std::stringstream name;
+    name << "__cc_" << index;
+
+    std::stringstream site;
+    site << cur_fun_->name() << ":" << index;
+
+    decl_out_->stream() << "static EsContextCache " << name.str()
+                        << " = ESA_CTX_CACHE_INIT(\"" << site.str() << "\");\n";
+
+    return "&" + name.str();
+}
+
+std::string CcGenerator::obj_template(const ir::KeyVector &keys)
+{
+    int index = num_obj_templates_++;
+
+    std::stringstream keys_name;
+    keys_name << "__ok_" << index;
+
+    std::stringstream name;
+    name << "__ot_" << index;
+
+    decl_out_->stream() << "static const uint64_t " << keys_name.str() << "[] = { ";
+    ir::KeyVector::const_iterator it;
+    for (it = keys.begin(); it != keys.end(); ++it)
+    {
+        if (it != keys.begin())
+            decl_out_->stream() << ", ";
+        decl_out_->stream() << uint64(*it);
+    }
+    decl_out_->stream() << " };\n";
+
+    decl_out_->stream() << "static EsObjectTemplate " << name.str()
+                        << " = ESA_OBJ_TEMPLATE_INIT(" << keys_name.str()
+                        << ", " << keys.size() << ");\n";
+
+    return "&" + name.str();
+}
+
+const ir::Type *CcGenerator::local_type(ir::Value *val)
+{
+    int index = ir::local_index(val);
+    return index >= 0 ? cur_fun_->local_type(index) : NULL;
+}
+
+std::string CcGenerator::local(ir::Value *val)
+{
+    std::stringstream reg;
+    reg << "__" << allocator_.lookup_local(cur_fun_, ir::local_index(val));
+    return reg.str();
+}
+
+std::string CcGenerator::num(ir::Value *val)
+{
+    const ir::Type *type = local_type(val);
+    if (type == NULL)
+        return value(val) + ".data.num";
+
+    return type->is_int32() ? "(double)" + local(val) : local(val);
+}
+
+std::string CcGenerator::i32(ir::Value *val)
+{
+    const ir::Type *type = local_type(val);
+    if (type && type->is_int32())
+        return local(val);
+
+    return "(int32_t)" + num(val);
+}
+
+std::string CcGenerator::guard(ir::Value *val, const ir::Type *val_type,
+                              const ir::Type *guard)
+{
+    const ir::Type *type = local_type(val);
+    if (type == NULL)
+        type = val_type;
+
+    if (guard->is_double())
+    {
+        if (type->is_double() || type->is_int32())
+            return std::string();
+        return "es_value_is_number(" + value(val) + ")";
+    }
+    if (guard->is_int32())
+    {
+        if (type->is_int32())
+            return std::string();
+        return "es_value_is_i32_range(" + value(val) + ")";
+    }
+
+    assert(guard->is_boolean());
+    if (type->is_boolean())
+        return std::string();
+    return "es_value_is_boolean(" + value(val) + ")";
+}
+
+std::string CcGenerator::assign(ir::Value *res, const std::string &expr,
+                               const ir::Type *expr_type)
+{
+    if (local_type(res))
+    {
+        assert(!expr_type->is_boolean());
+        return local(res) + " = " + expr;
+    }
+
+    if (expr_type->is_boolean())
+        return value(res) + " = es_value_from_boolean(" + expr + ")";
+
+    return value(res) + " = es_value_from_number(" + expr + ")";
+}
+
+std::string CcGenerator::slow(ir::Instruction *instr, const std::string &call,
+                             ir::Value *res)
+{
+    if (local_type(res) == NULL)
+        return value(instr) + " = " + call + ", &" + value(res) + ");";
+
+    // Unboxed results are only written by operations that always produce
+    // numbers, go through a boxed temporary.
+    return "{ EsValueData __t; " + value(instr) + " = " + call + ", &__t); " +
+           "if (" + value(instr) + ") " + local(res) + " = __t.data.num; }";
+}
+
+void CcGenerator::write_fast_bin(ir::EsBinaryInstruction *instr,
+                                const char *fun, const ir::Type *guard_type,
+                                const std::string &fast,
+                                const ir::Type *fast_type)
+{
+    std::string lg = guard(instr->left(), instr->left_type(), guard_type);
+    std::string rg = guard(instr->right(), instr->right_type(), guard_type);
+
+    // No need for a slow path if both operands are known to be fast.
+    if (lg.empty() && rg.empty())
+    {
+        out() << assign(instr->result(), fast, fast_type) << ";\n";
+        out() << value(instr) << " = true;\n";
+        return;
+    }
+
+    std::string cond = lg.empty() ? rg : (rg.empty() ? lg : lg + " && " + rg);
+
+    out() << "if (" << cond << ")\n";
+    out() << "{\n";
+    out() << "  " << assign(instr->result(), fast, fast_type) << ";\n";
+    out() << "  " << value(instr) << " = true;\n";
+    out() << "}\n";
+    out() << "else\n";
+    out() << "{\n";
+    out() << "  " << slow(instr, std::string(fun) + "(" + value(instr->left()) +
+                          ", " + value(instr->right()), instr->result()) << "\n";
+    out() << "}\n";
+}
+
+void CcGenerator::write_fast_unary(ir::EsUnaryInstruction *instr,
+                                  const char *fun, const ir::Type *guard_type,
+                                  const std::string &fast,
+                                  const ir::Type *fast_type)
+{
+    std::string vg = guard(instr->value(), instr->value_type(), guard_type);
+    if (vg.empty())
+    {
+        out() << assign(instr->result(), fast, fast_type) << ";\n";
+        out() << value(instr) << " = true;\n";
+        return;
+    }
+
+    out() << "if (" << vg << ")\n";
+    out() << "{\n";
+    out() << "  " << assign(instr->result(), fast, fast_type) << ";\n";
+    out() << "  " << value(instr) << " = true;\n";
+    out() << "}\n";
+    out() << "else\n";
+    out() << "{\n";
+    out() << "  " << slow(instr, std::string(fun) + "(" + value(instr->value()),
+                          instr->result()) << "\n";
+    out() << "}\n";
+}
+
 std::string CcGenerator::type(const ir::Type *type)
 {
     std::stringstream str;
@@ -189,6 +394,9 @@ std::string CcGenerator::type(const ir::Type *type)
         case ir::Type::ID_DOUBLE:
             str << "double";
             break;
+        case ir::Type::ID_INT32:
+            str << "int32_t";
+            break;
         case ir::Type::ID_STRING:
             str << "const EsString *";
             break;
@@ -273,6 +481,8 @@ void CcGenerator::visit_module(ir::Module *module)
 
 void CcGenerator::visit_fun(ir::Function *fun)
 {
+    cur_fun_ = fun;
+
     decl_out_->stream() << "bool " << fun->name()
                         << "(EsContext *ctx, uint32_t argc, EsValueData *fp, EsValueData *vp);\n";
 
@@ -419,7 +629,8 @@ void CcGenerator::visit_instr_call_keyed(ir::CallKeyedInstruction *instr)
           << value(instr->object()) << ", "
           << uint64(instr->key()) << ", "
           << instr->argc() << ", &"
-          << value(instr->result()) << ");\n";
+          << value(instr->result()) << ", "
+          << prp_cache() << ");\n";
 }
 
 void CcGenerator::visit_instr_call_keyed_slow(ir::CallKeyedSlowInstruction *instr)
@@ -436,7 +647,7 @@ void CcGenerator::visit_instr_call_named(ir::CallNamedInstruction *instr)
     out() << value(instr) << " = esa_call_named("
           << uint64(instr->key()) << ", "
           << instr->argc() << ", &"
-          << value(instr->result()) << ");\n";
+          << value(instr->result()) << ", " << ctx_cache() << ");\n";
 }
 
 void CcGenerator::visit_instr_val(ir::ValueInstruction *instr)
@@ -445,15 +656,46 @@ void CcGenerator::visit_instr_val(ir::ValueInstruction *instr)
     {
         case ir::ValueInstruction::TO_BOOLEAN:
         {
-            out() << value(instr) << " = esa_val_to_bool("
-                  << value(instr->value()) << ");\n";
+            const ir::Type *type = instr->value_type();
+            if (local_type(instr->value()))
+                type = local_type(instr->value());
+
+            if (type->is_boolean())
+            {
+                out() << value(instr) << " = es_value_as_boolean("
+                      << value(instr->value()) << ");\n";
+            }
+            else if (type->is_double() || type->is_int32())
+            {
+                std::string n = num(instr->value());
+                out() << value(instr) << " = " << n << " != 0.0 && "
+                      << n << " == " << n << ";\n";
+            }
+            else
+            {
+                out() << value(instr) << " = esa_val_to_bool("
+                      << value(instr->value()) << ");\n";
+            }
             break;
         }
         case ir::ValueInstruction::TO_DOUBLE:
         {
-            out() << value(instr) << " = esa_val_to_num("
-                  << value(instr->value()) << ", &" << value(instr->result())
-                  << ");\n";
+            const ir::Type *type = instr->value_type();
+            if (local_type(instr->value()))
+                type = local_type(instr->value());
+
+            if (type->is_double() || type->is_int32())
+            {
+                out() << value(instr->result()) << " = "
+                      << num(instr->value()) << ";\n";
+                out() << value(instr) << " = true;\n";
+            }
+            else
+            {
+                out() << value(instr) << " = esa_val_to_num("
+                      << value(instr->value()) << ", &" << value(instr->result())
+                      << ");\n";
+            }
             break;
         }
 
@@ -462,8 +704,8 @@ void CcGenerator::visit_instr_val(ir::ValueInstruction *instr)
                   << value(instr->value()) << ");\n";
             break;
         case ir::ValueInstruction::FROM_DOUBLE:
-            out() << value(instr->result()) << " = " << "es_value_from_number("
-                  << value(instr->value()) << ");\n";
+            out() << assign(instr->result(), value(instr->value()),
+                            ir::Type::_double()) << ";\n";
             break;
         case ir::ValueInstruction::FROM_STRING:
             out() << value(instr->result()) << " = " << "es_value_from_string("
@@ -537,6 +779,15 @@ void CcGenerator::visit_instr_ret(ir::ReturnInstruction *instr)
 
 void CcGenerator::visit_instr_store(ir::StoreInstruction *instr)
 {
+    const ir::Type *type = local_type(instr->destination());
+    if (type)
+    {
+        out() << local(instr->destination()) << " = "
+              << (type->is_int32() ? i32(instr->source()) : num(instr->source()))
+              << ";\n";
+        return;
+    }
+
     out() << value(instr->destination()) << " = " << value(instr->source()) << ";\n";
 }
 
@@ -590,14 +841,14 @@ void CcGenerator::visit_instr_ctx_get(ir::ContextGetInstruction *instr)
 {
     out() << value(instr) << " = " << "esa_ctx_get(ctx, "
           << uint64(instr->key()) << ", &" << value(instr->result())
-          << ", " << instr->cache_id() << ");\n";
+          << ", " << ctx_cache() << ");\n";
 }
 
 void CcGenerator::visit_instr_ctx_put(ir::ContextPutInstruction *instr)
 {
     out() << value(instr) << " = " << "esa_ctx_put(ctx, "
           << uint64(instr->key()) << ", " << value(instr->value())
-          << ", " << instr->cache_id() << ");\n";
+          << ", " << ctx_cache() << ");\n";
 }
 
 void CcGenerator::visit_instr_ctx_del(ir::ContextDeleteInstruction *instr)
@@ -704,16 +955,6 @@ void CcGenerator::visit_instr_link(ir::Link *instr)
     }
 }
 
-static int cid_counter = 0;
-
-static int next_cid()
-{
-    int cid = cid_counter++;
-    if (cid_counter >= FEATURE_PROPERTY_CACHE_SIZE)
-        cid_counter = 0;
-    return cid;
-}
-
 void CcGenerator::visit_instr_prp_def_data(ir::PropertyDefineDataInstruction *instr)
 {
     out() << value(instr) << " = " << "esa_prp_def_data("
@@ -747,28 +988,28 @@ void CcGenerator::visit_instr_prp_get(ir::PropertyGetInstruction *instr)
 {
     out() << value(instr) << " = " << "esa_prp_get("
           << value(instr->object()) << ", " << uint64(instr->key()) << ", &"
-          << value(instr->result()) << ", " << next_cid() << ");\n";
+          << value(instr->result()) << ", " << prp_cache() << ");\n";
 }
 
 void CcGenerator::visit_instr_prp_get_slow(ir::PropertyGetSlowInstruction *instr)
 {
-    out() << value(instr) << " = " << "esa_prp_get_slow("
+    out() << value(instr) << " = " << "esa_prp_get_elm("
           << value(instr->object()) << ", " << value(instr->key()) << ", &"
-          << value(instr->result()) << ", " << next_cid() << ");\n";
+          << value(instr->result()) << ", " << prp_cache() << ");\n";
 }
 
 void CcGenerator::visit_instr_prp_put(ir::PropertyPutInstruction *instr)
 {
     out() << value(instr) << " = " << "esa_prp_put(ctx, "
           << value(instr->object()) << ", " << uint64(instr->key()) << ", "
-          << value(instr->value()) << ", " << next_cid() << ");\n";
+          << value(instr->value()) << ", " << prp_cache() << ");\n";
 }
 
 void CcGenerator::visit_instr_prp_put_slow(ir::PropertyPutSlowInstruction *instr)
 {
-    out() << value(instr) << " = " << "esa_prp_put_slow(ctx, "
+    out() << value(instr) << " = " << "esa_prp_put_elm(ctx, "
           << value(instr->object()) << ", " << value(instr->key()) << ", "
-          << value(instr->value()) << ", " << next_cid() << ");\n";
+          << value(instr->value()) << ", " << prp_cache() << ");\n";
 }
 
 void CcGenerator::visit_instr_prp_del(ir::PropertyDeleteInstruction *instr)
@@ -797,7 +1038,8 @@ void CcGenerator::visit_instr_es_new_fun_decl(ir::EsNewFunctionDeclarationInstru
     out() << value(instr->result()) << " = " << "esa_new_fun_decl(ctx, "
           << instr->function()->name() << ", "
           << boolean(instr->is_strict()) << ", "
-          << instr->parameter_count() << ");\n";
+          << instr->parameter_count() << ", "
+          << boolean(instr->function()->needs_env()) << ");\n";
 }
 
 void CcGenerator::visit_instr_es_new_fun_expr(ir::EsNewFunctionExpressionInstruction *instr)
@@ -805,7 +1047,8 @@ void CcGenerator::visit_instr_es_new_fun_expr(ir::EsNewFunctionExpressionInstruc
     out() << value(instr->result()) << " = " << "esa_new_fun_expr(ctx, "
           << instr->function()->name() << ", "
           << boolean(instr->is_strict()) << ", "
-          << instr->parameter_count() << ");\n";
+          << instr->parameter_count() << ", "
+          << boolean(instr->function()->needs_env()) << ");\n";
 }
 
 void CcGenerator::visit_instr_es_new_obj(ir::EsNewObjectInstruction *instr)
@@ -814,6 +1057,13 @@ void CcGenerator::visit_instr_es_new_obj(ir::EsNewObjectInstruction *instr)
     out() << value(instr->result()) << " = " << "esa_new_obj();\n";
 }
 
+void CcGenerator::visit_instr_es_new_obj_lit(ir::EsNewObjectLiteralInstruction *instr)
+{
+    out() << value(instr->result()) << " = " << "esa_new_obj_lit("
+          << obj_template(instr->keys()) << ", "
+          << value(instr->values()) << ");\n";
+}
+
 void CcGenerator::visit_instr_es_new_rex(ir::EsNewRegexInstruction *instr)
 {
     out() << value(instr->result()) << " = " << "esa_new_reg_exp("
@@ -823,140 +1073,93 @@ void CcGenerator::visit_instr_es_new_rex(ir::EsNewRegexInstruction *instr)
 
 void CcGenerator::visit_instr_es_bin(ir::EsBinaryInstruction *instr)
 {
+    // Operands as numbers and as 32-bit integers, used by the fast paths.
+    std::string ln = num(instr->left());
+    std::string rn = num(instr->right());
+    std::string li = i32(instr->left());
+    std::string ri = i32(instr->right());
+    std::string rs = "((uint32_t)" + ri + " & 0x1f)";
+
+    std::string l = value(instr->left());
+    std::string r = value(instr->right());
+
+    const ir::Type *num_type = ir::Type::_double();
+    const ir::Type *i32_type = ir::Type::int32();
+    const ir::Type *bool_type = ir::Type::boolean();
+
     switch (instr->operation())
     {
         // Arithmetic.
         case ir::EsBinaryInstruction::MUL:
-            out() << value(instr) << " = " << "esa_b_mul("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            write_fast_bin(instr, "esa_b_mul", num_type, ln + " * " + rn, num_type);
             break;
         case ir::EsBinaryInstruction::DIV:
-            out() << value(instr) << " = " << "esa_b_div("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            write_fast_bin(instr, "esa_b_div", num_type, ln + " / " + rn, num_type);
             break;
         case ir::EsBinaryInstruction::MOD:
-            out() << value(instr) << " = " << "esa_b_mod("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            out() << slow(instr, "esa_b_mod(" + l + ", " + r, instr->result()) << "\n";
             break;
         case ir::EsBinaryInstruction::ADD:
-            out() << value(instr) << " = " << "esa_b_add("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            write_fast_bin(instr, "esa_b_add", num_type, ln + " + " + rn, num_type);
             break;
         case ir::EsBinaryInstruction::SUB:
-            out() << value(instr) << " = " << "esa_b_sub("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            write_fast_bin(instr, "esa_b_sub", num_type, ln + " - " + rn, num_type);
             break;
         case ir::EsBinaryInstruction::LS:
-            out() << value(instr) << " = " << "esa_b_shl("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            write_fast_bin(instr, "esa_b_shl", i32_type,
+                           "(int32_t)((uint32_t)" + li + " << " + rs + ")", i32_type);
             break;
         case ir::EsBinaryInstruction::RSS:
-            out() << value(instr) << " = " << "esa_b_sar("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            write_fast_bin(instr, "esa_b_sar", i32_type, li + " >> " + rs, i32_type);
             break;
         case ir::EsBinaryInstruction::RUS:
-            out() << value(instr) << " = " << "esa_b_shr("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            write_fast_bin(instr, "esa_b_shr", i32_type,
+                           "(uint32_t)" + li + " >> " + rs, num_type);
             break;
 
         // Relational.
         case ir::EsBinaryInstruction::LT:
-            out() << value(instr) << " = " << "esa_c_lt("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            write_fast_bin(instr, "esa_c_lt", num_type, ln + " < " + rn, bool_type);
             break;
         case ir::EsBinaryInstruction::GT:
-            out() << value(instr) << " = " << "esa_c_gt("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            write_fast_bin(instr, "esa_c_gt", num_type, ln + " > " + rn, bool_type);
             break;
         case ir::EsBinaryInstruction::LTE:
-            out() << value(instr) << " = " << "esa_c_lte("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            write_fast_bin(instr, "esa_c_lte", num_type, ln + " <= " + rn, bool_type);
             break;
         case ir::EsBinaryInstruction::GTE:
-            out() << value(instr) << " = " << "esa_c_gte("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            write_fast_bin(instr, "esa_c_gte", num_type, ln + " >= " + rn, bool_type);
             break;
         case ir::EsBinaryInstruction::IN:
-            out() << value(instr) << " = " << "esa_c_in("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            out() << slow(instr, "esa_c_in(" + l + ", " + r, instr->result()) << "\n";
             break;
         case ir::EsBinaryInstruction::INSTANCEOF:
-            out() << value(instr) << " = " << "esa_c_instance_of("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            out() << slow(instr, "esa_c_instance_of(" + l + ", " + r, instr->result()) << "\n";
             break;
 
         // Equality.
         case ir::EsBinaryInstruction::EQ:
-            out() << value(instr) << " = " << "esa_c_eq("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            write_fast_bin(instr, "esa_c_eq", num_type, ln + " == " + rn, bool_type);
             break;
         case ir::EsBinaryInstruction::NEQ:
-            out() << value(instr) << " = " << "esa_c_neq("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            write_fast_bin(instr, "esa_c_neq", num_type, ln + " != " + rn, bool_type);
             break;
         case ir::EsBinaryInstruction::STRICT_EQ:
-            out() << value(instr) << " = " << "esa_c_strict_eq("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            write_fast_bin(instr, "esa_c_strict_eq", num_type, ln + " == " + rn, bool_type);
             break;
         case ir::EsBinaryInstruction::STRICT_NEQ:
-            out() << value(instr) << " = " << "esa_c_strict_neq("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            write_fast_bin(instr, "esa_c_strict_neq", num_type, ln + " != " + rn, bool_type);
             break;
 
         // Bitwise.
         case ir::EsBinaryInstruction::BIT_AND:
-            out() << value(instr) << " = " << "esa_b_and("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            write_fast_bin(instr, "esa_b_and", i32_type, li + " & " + ri, i32_type);
             break;
         case ir::EsBinaryInstruction::BIT_XOR:
-            out() << value(instr) << " = " << "esa_b_xor("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            write_fast_bin(instr, "esa_b_xor", i32_type, li + " ^ " + ri, i32_type);
             break;
         case ir::EsBinaryInstruction::BIT_OR:
-            out() << value(instr) << " = " << "esa_b_or("
-                  << value(instr->left()) << ", "
-                  << value(instr->right()) << ", &"
-                  << value(instr->result()) << ");\n";
+            write_fast_bin(instr, "esa_b_or", i32_type, li + " | " + ri, i32_type);
             break;
 
         default:
@@ -967,28 +1170,42 @@ void CcGenerator::visit_instr_es_bin(ir::EsBinaryInstruction *instr)
 
 void CcGenerator::visit_instr_es_unary(ir::EsUnaryInstruction *instr)
 {
+    std::string v = value(instr->value());
+
     switch (instr->operation())
     {
         case ir::EsUnaryInstruction::TYPEOF:
-            out() << value(instr) << " = " << "esa_u_typeof("
-                  << value(instr->value()) << ", &"
-                  << value(instr->result()) << ");\n";
+            out() << slow(instr, "esa_u_typeof(" + v, instr->result()) << "\n";
             break;
         case ir::EsUnaryInstruction::NEG:
-            out() << value(instr) << " = " << "esa_u_sub("
-                  << value(instr->value()) << ", &"
-                  << value(instr->result()) << ");\n";
+            write_fast_unary(instr, "esa_u_sub", ir::Type::_double(),
+                             "-" + num(instr->value()), ir::Type::_double());
             break;
         case ir::EsUnaryInstruction::BIT_NOT:
-            out() << value(instr) << " = " << "esa_u_bit_not("
-                  << value(instr->value()) << ", &"
-                  << value(instr->result()) << ");\n";
+            write_fast_unary(instr, "esa_u_bit_not", ir::Type::int32(),
+                             "~" + i32(instr->value()), ir::Type::int32());
             break;
         case ir::EsUnaryInstruction::LOG_NOT:
-            out() << value(instr) << " = " << "esa_u_not("
-                  << value(instr->value()) << ", &"
-                  << value(instr->result()) << ");\n";
+        {
+            const ir::Type *type = local_type(instr->value());
+            if (type == NULL)
+                type = instr->value_type();
+
+            // Numbers are false if zero or NaN.
+            if (type->is_double() || type->is_int32())
+            {
+                std::string n = num(instr->value());
+                out() << assign(instr->result(),
+                                "!(" + n + " != 0.0 && " + n + " == " + n + ")",
+                                ir::Type::boolean()) << ";\n";
+                out() << value(instr) << " = true;\n";
+                break;
+            }
+
+            write_fast_unary(instr, "esa_u_not", ir::Type::boolean(),
+                             "!es_value_as_boolean(" + v + ")", ir::Type::boolean());
             break;
+        }
         default:
             assert(false);
             break;
@@ -1007,6 +1224,9 @@ void CcGenerator::generate(ir::Module *module, const std::string &file_path)
     NameGenerator::instance().reset();  // FIXME:
 
     allocator_.run(module);
+    num_prp_caches_ = 0;
+    num_ctx_caches_ = 0;
+    num_obj_templates_ = 0;
 
     // Clear any previous data.
     out_.clear();
@@ -667,6 +667,17 @@ void IrGenerator::visit_instr_es_new_obj(ir::EsNewObjectInstruction *instr)
     out() << value(instr->result()) << " = " << "es.new_obj\n";
 }
 
+void IrGenerator::visit_instr_es_new_obj_lit(ir::EsNewObjectLiteralInstruction *instr)
+{
+    out() << value(instr->result()) << " = " << "es.new_obj_lit";
+
+    ir::KeyVector::const_iterator it;
+    for (it = instr->keys().begin(); it != instr->keys().end(); ++it)
+        out() << " " << uint64(*it);
+
+    out() << " " << value(instr->values()) << "\n";
+}
+
 void IrGenerator::visit_instr_es_new_rex(ir::EsNewRegexInstruction *instr)
 {
     out() << value(instr->result()) << " = " << "es.new_rex "
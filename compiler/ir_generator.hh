@@ -72,6 +72,7 @@ namespace ir {
     class EsNewFunctionDeclarationInstruction;
     class EsNewFunctionExpressionInstruction;
     class EsNewObjectInstruction;
+    class EsNewObjectLiteralInstruction;
     class EsNewRegexInstruction;
     class EsAssignmentInstruction;
     class EsBinaryInstruction;
@@ -172,6 +173,7 @@ private:
     virtual void visit_instr_es_new_fun_decl(ir::EsNewFunctionDeclarationInstruction *instr) override;
     virtual void visit_instr_es_new_fun_expr(ir::EsNewFunctionExpressionInstruction *instr) override;
     virtual void visit_instr_es_new_obj(ir::EsNewObjectInstruction *instr) override;
+    virtual void visit_instr_es_new_obj_lit(ir::EsNewObjectLiteralInstruction *instr) override;
     virtual void visit_instr_es_new_rex(ir::EsNewRegexInstruction *instr) override;
     virtual void visit_instr_es_bin(ir::EsBinaryInstruction *instr) override;
     virtual void visit_instr_es_unary(ir::EsUnaryInstruction *instr) override;
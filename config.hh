@@ -20,16 +20,13 @@
 #define FEATURE_CONTEXT_CACHE
 #endif
 
-#ifndef FEATURE_CONTEXT_CACHE_SIZE
-#define FEATURE_CONTEXT_CACHE_SIZE          256
-#endif
-
 #ifndef FEATURE_PROPERTY_CACHE
 #define FEATURE_PROPERTY_CACHE
 #endif
 
+// Size of the property cache shared by megamorphic access sites.
 #ifndef FEATURE_PROPERTY_CACHE_SIZE
-#define FEATURE_PROPERTY_CACHE_SIZE         256
+#define FEATURE_PROPERTY_CACHE_SIZE         4096
 #endif
 
 #ifndef PROFILE
@@ -458,6 +458,9 @@ void Analyzer::visit_str_lit(parser::StringLiteral *lit)
 
 void Analyzer::visit_fun_lit(parser::FunctionLiteral *lit)
 {
+    assert(!lex_envs_.empty());
+    lookup(lex_envs_.back().function())->set_has_closures();
+
     lex_envs_.push_back(LexicalEnvironment(LexicalEnvironment::TYPE_DECLARATIVE, lit));
 
     visit_fun(lit);
@@ -578,6 +581,7 @@ void Analyzer::visit_with_stmt(parser::WithStatement *stmt)
 {
     assert(!lex_envs_.empty());
     LexicalEnvironment &cur_lex_env = lex_envs_.back();
+    lookup(cur_lex_env.function())->set_has_with();
 
     lex_envs_.push_back(LexicalEnvironment(LexicalEnvironment::TYPE_OBJECT, cur_lex_env.function()));
 
@@ -164,12 +164,20 @@ private:
      * because a call to eval might want to access them dynamicall by name. */
     bool tainted_by_eval_;
 
+    /** true if the function body contains nested function literals. */
+    bool has_closures_;
+
+    /** true if the function body contains with statements. */
+    bool has_with_;
+
     std::set<int> referenced_scopes_;
 
 public:
     AnalyzedFunction(parser::FunctionLiteral *fun)
         : fun_(fun)
-        , tainted_by_eval_(false) {}
+        , tainted_by_eval_(false)
+        , has_closures_(false)
+        , has_with_(false) {}
 
     parser::FunctionLiteral *literal() const
     {
@@ -186,6 +194,47 @@ public:
         tainted_by_eval_ = tainted_by_eval;
     }
 
+    void set_has_closures()
+    {
+        has_closures_ = true;
+    }
+
+    void set_has_with()
+    {
+        has_with_ = true;
+    }
+
+    /**
+     * Checks if calling the function requires a declarative environment of
+     * its own. A function that creates no closures, contains no eval, with
+     * or arguments references and allocates all its variables to the value
+     * stack can run directly in the environment of its caller's scope.
+     * @pre All variables have been allocated.
+     * @return true if the function needs an environment, false if not.
+     */
+    bool needs_env() const
+    {
+        if (tainted_by_eval_ || has_closures_ || has_with_ ||
+            fun_->needs_args_obj())
+            return true;
+
+        AnalyzedVariableSet::const_iterator it_var;
+        for (it_var = vars_.begin(); it_var != vars_.end(); ++it_var)
+        {
+            const AnalyzedVariable *var = *it_var;
+
+            if (var->storage() == AnalyzedVariable::STORAGE_CONTEXT ||
+                var->storage() == AnalyzedVariable::STORAGE_LOCAL_EXTRA)
+                return true;
+
+            // Bindings named "arguments" are linked into the environment.
+            if (var->is_allocated() && var->name() == _USTR("arguments"))
+                return true;
+        }
+
+        return false;
+    }
+
     const std::set<int> &referenced_scopes() const
     {
         return referenced_scopes_;
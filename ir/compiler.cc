@@ -16,6 +16,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <gc_cpp.h>
 #include "common/cast.hh"
 #include "common/conversion.hh"
@@ -294,24 +295,6 @@ Scope *Compiler::unroll_for_return(Function *fun)
     return NULL;
 }
 
-uint16_t Compiler::get_ctx_cid(uint64_t key)
-{
-    ScopeVector::reverse_iterator it;
-    for (it = scopes_.rbegin(); it != scopes_.rend(); ++it)
-    {
-        Scope *scope = *it;
-
-        if (scope->type() == Scope::TYPE_FUNCTION ||
-            scope->type() == Scope::TYPE_WITH)
-        {
-            return scope->get_ctx_cache_id(key);
-        }
-    }
-
-    assert(false);
-    return 0;
-}
-
 uint64_t Compiler::get_prp_key(uint32_t id)
 {
     return static_cast<uint64_t>(id);
@@ -396,8 +379,7 @@ ValueHandle Compiler::expand_ref_get_inplace(ValueHandle &ref,
         Value *_ = NULL;
         Block *done_block = new (GC)Block(NameGenerator::instance().next());
 
-        _ = fun->last_block()->push_ctx_get(ctx_load->key(), dst,
-                                            get_ctx_cid(ctx_load->key()));
+        _ = fun->last_block()->push_ctx_get(ctx_load->key(), dst);
             fun->last_block()->push_trm_br(_, done_block, expt_block);
 
         fun->push_block(done_block);
@@ -438,8 +420,7 @@ ValueHandle Compiler::expand_ref_get_inplace_lazy(ValueHandle &ref,
         Value *_ = NULL;
         Block *done_block = new (GC)Block(NameGenerator::instance().next());
 
-        _ = fun->last_block()->push_ctx_get(ctx_load->key(), dst,
-                                            get_ctx_cid(ctx_load->key()));
+        _ = fun->last_block()->push_ctx_get(ctx_load->key(), dst);
             fun->last_block()->push_trm_br(_, done_block, expt_block);
 
         fun->push_block(done_block);
@@ -488,8 +469,7 @@ ValueHandle Compiler::expand_ref_get(ValueHandle &ref,
     {
         Value *_ = NULL;
 
-        _ = fun->last_block()->push_ctx_get(ctx_load->key(), dst,
-                                            get_ctx_cid(ctx_load->key()));
+        _ = fun->last_block()->push_ctx_get(ctx_load->key(), dst);
             fun->last_block()->push_trm_br(_, done_block, expt_block);
         return dst;
     }
@@ -530,8 +510,7 @@ ValueHandle Compiler::expand_ref_get_lazy(ValueHandle &ref, Function *fun,
     {
         Value *_ = NULL;
 
-        _ = fun->last_block()->push_ctx_get(ctx_load->key(), dst,
-                                            get_ctx_cid(ctx_load->key()));
+        _ = fun->last_block()->push_ctx_get(ctx_load->key(), dst);
             fun->last_block()->push_trm_br(_, done_block, expt_block);
         return dst;
     }
@@ -563,8 +542,7 @@ void Compiler::expand_ref_put_inplace(ValueHandle &ref,
         Value *_ = NULL;
         Block *done_block = new (GC)Block(NameGenerator::instance().next());
 
-        _ = fun->last_block()->push_ctx_put(ctx_load->key(), val,
-                                            get_ctx_cid(ctx_load->key()));
+        _ = fun->last_block()->push_ctx_put(ctx_load->key(), val);
             fun->last_block()->push_trm_br(_, done_block, expt_block);
 
         fun->push_block(done_block);
@@ -597,8 +575,7 @@ void Compiler::expand_ref_put(ValueHandle &ref, ValueHandle &val,
     {
         Value *_ = NULL;
 
-        _ = fun->last_block()->push_ctx_put(ctx_load->key(), val,
-                                            get_ctx_cid(ctx_load->key()));
+        _ = fun->last_block()->push_ctx_put(ctx_load->key(), val);
             fun->last_block()->push_trm_br(_, done_block, expt_block);
     }
     else
@@ -635,6 +612,8 @@ Function *Compiler::parse_fun(const parser::FunctionLiteral *lit,
         analyzer_.lookup(const_cast<parser::FunctionLiteral *>(lit));   // FIXME: const_cast
     assert(analyzed_fun);
 
+    fun->set_needs_env(analyzed_fun->needs_env());
+
     ScopedVectorValue<Scope> scope(
         scopes_, new (GC)Scope(Scope::TYPE_FUNCTION));
     ScopedVectorValue<TemplateBlock> expt_action(
@@ -2279,55 +2258,111 @@ ValueHandle Compiler::parse_obj_lit(parser::ObjectLiteral *lit,
     Block *done_block = new (GC)Block(NameGenerator::instance().next());
     Block *expt_block = new (GC)Block(NameGenerator::instance().next());
 
-    X = ValueHandle::lazy(rva ? rva : &temporaries);
-
-    fun->last_block()->push_es_new_obj(X);
-
-    SingleValueAllocator sva_k(temporaries);
-    SingleValueAllocator sva_v(temporaries);
+    // Literals where all properties are data properties with unique,
+    // constant and non-index keys are created from a template describing the
+    // final shape of the object.
+    KeyVector keys;
+    bool use_template = !lit->properties().empty();
 
     parser::ObjectLiteral::PropertyVector::const_iterator it;
     for (it = lit->properties().begin(); it != lit->properties().end(); ++it)
     {
         const parser::ObjectLiteral::Property *prop = *it;
 
-        if (prop->type() == parser::ObjectLiteral::Property::DATA)
-        {
-            ValueHandle k, v;
+        parser::StringLiteral *key_lit =
+            prop->type() == parser::ObjectLiteral::Property::DATA
+                ? dynamic_cast<parser::StringLiteral *>(prop->key())
+                : NULL;
 
-            Block *done_block = new (GC)Block(NameGenerator::instance().next());
+        uint32_t index = 0;
+        if (!key_lit || key_lit->value().empty() ||
+            es_str_to_index(key_lit->value(), index))
+        {
+            use_template = false;
+            break;
+        }
 
-            R = parse(prop->key(), fun, &sva_k);
-            k = expand_ref_get_inplace_lazy(R, fun, expt_block, temporaries);
+        uint64_t key = get_prp_key(key_lit->value());
+        if (std::find(keys.begin(), keys.end(), key) != keys.end())
+        {
+            use_template = false;
+            break;
+        }
 
-            R = parse(prop->value(), fun, &sva_v);
-            v = expand_ref_get_inplace_lazy(R, fun, expt_block, temporaries);
+        keys.push_back(key);
+    }
 
-            _ = fun->last_block()->push_prp_def_data(X, k, v);
-                fun->last_block()->push_trm_br(_, done_block, expt_block);
+    if (use_template)
+    {
+        // FIXME: Should use stack.
+        ValueHandle a = new (GC)Temporary(new (GC)ArrayType(Type::value(),
+                                                            keys.size()));
 
-            fun->push_block(done_block);
+        int i = 0;
+        for (it = lit->properties().begin(); it != lit->properties().end(); ++it, i++)
+        {
+            ValueHandle v = new (GC)ArrayElementConstant(a, i);
+            FixedValueAllocator fva(v);
 
-            k.release();
-            v.release();
+            R = parse((*it)->value(), fun, &fva);
+            expand_ref_get_inplace(R, v, fun, expt_block);
         }
-        else
+
+        X = ValueHandle::lazy(rva ? rva : &temporaries);
+
+        fun->last_block()->push_es_new_obj_lit(keys, a, X);
+    }
+    else
+    {
+        X = ValueHandle::lazy(rva ? rva : &temporaries);
+
+        fun->last_block()->push_es_new_obj(X);
+
+        SingleValueAllocator sva_k(temporaries);
+        SingleValueAllocator sva_v(temporaries);
+
+        for (it = lit->properties().begin(); it != lit->properties().end(); ++it)
         {
-            ValueHandle v;
+            const parser::ObjectLiteral::Property *prop = *it;
 
-            Block *done_block = new (GC)Block(NameGenerator::instance().next());
+            if (prop->type() == parser::ObjectLiteral::Property::DATA)
+            {
+                ValueHandle k, v;
 
-            R = parse(prop->value(), fun, &sva_v);
-            v = expand_ref_get_inplace_lazy(R, fun, expt_block, temporaries);
+                Block *done_block = new (GC)Block(NameGenerator::instance().next());
 
-            _ = fun->last_block()->push_prp_def_accessor(
-                    X, get_prp_key(prop->accessor_name()),
-                    v, prop->type() == parser::ObjectLiteral::Property::SETTER);
-                fun->last_block()->push_trm_br(_, done_block, expt_block);
+                R = parse(prop->key(), fun, &sva_k);
+                k = expand_ref_get_inplace_lazy(R, fun, expt_block, temporaries);
 
-            fun->push_block(done_block);
+                R = parse(prop->value(), fun, &sva_v);
+                v = expand_ref_get_inplace_lazy(R, fun, expt_block, temporaries);
 
-            v.release();
+                _ = fun->last_block()->push_prp_def_data(X, k, v);
+                    fun->last_block()->push_trm_br(_, done_block, expt_block);
+
+                fun->push_block(done_block);
+
+                k.release();
+                v.release();
+            }
+            else
+            {
+                ValueHandle v;
+
+                Block *done_block = new (GC)Block(NameGenerator::instance().next());
+
+                R = parse(prop->value(), fun, &sva_v);
+                v = expand_ref_get_inplace_lazy(R, fun, expt_block, temporaries);
+
+                _ = fun->last_block()->push_prp_def_accessor(
+                        X, get_prp_key(prop->accessor_name()),
+                        v, prop->type() == parser::ObjectLiteral::Property::SETTER);
+                    fun->last_block()->push_trm_br(_, done_block, expt_block);
+
+                fun->push_block(done_block);
+
+                v.release();
+            }
         }
     }
 
@@ -58,11 +58,6 @@ private:
              std::less<String>,
              gc_allocator<std::pair<String, Value *> > > local_map_;    ///< Local variables declared in scope, mapped to index in locals stack.
 
-    typedef std::map<uint64_t, uint16_t> CacheMap;
-    CacheMap cache_map_;
-
-    uint16_t next_cache_id_;
-
     typedef std::map<int, Value *,
                      std::less<int>,
                      gc_allocator<std::pair<int, Value *> > > StackMap;
@@ -91,7 +86,6 @@ public:
         , cnt_target_(cnt_target)
         , brk_target_(brk_target)
         , epilogue_(NULL)
-        , next_cache_id_(0)
         , max_temporaries_(0) {}
 
     /**
@@ -103,7 +97,6 @@ public:
         , cnt_target_(NULL)
         , brk_target_(brk_target)
         , epilogue_(NULL)
-        , next_cache_id_(0)
         , max_temporaries_(0) {}
 
     /**
@@ -115,7 +108,6 @@ public:
         , cnt_target_(NULL)
         , brk_target_(NULL)
         , epilogue_(NULL)
-        , next_cache_id_(0)
         , max_temporaries_(0) {}
 
     ProxySource<size_t> &call_frame_value_count()
@@ -227,22 +219,6 @@ public:
         used_temporaries_.erase(it);
     }
 
-    uint16_t get_ctx_cache_id(uint64_t key)
-    {
-        CacheMap::iterator it = cache_map_.find(key);
-        if (it == cache_map_.end())
-        {
-            uint16_t cid = next_cache_id_++;
-            if (next_cache_id_ >= FEATURE_CONTEXT_CACHE_SIZE)
-                next_cache_id_ = 0;
-
-            cache_map_.insert(std::make_pair(key, cid));
-            return cid;
-        }
-
-        return it->second;
-    }
-
     void add_scope_stack(int hops, Value *val)
     {
         stack_map_[hops] = val;
@@ -454,13 +430,6 @@ private:
      */
     uint32_t get_str_id(const String &str);
 
-    /**
-     * Returns the cache id for a context access.
-     * @param [in] key Key to access in context.
-     * @return Cache id for a context identifier.
-     */
-    uint16_t get_ctx_cid(uint64_t key);
-
     /**
      * Returns a raw unsigned 64-bit property key identifying an indexed
      * property.
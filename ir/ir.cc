@@ -40,6 +40,12 @@ const Type *Type::_double()
     return type;
 }
 
+const Type *Type::int32()
+{
+    static Type *type = new (GC)Type(ID_INT32);
+    return type;
+}
+
 const Type *Type::string()
 {
     static Type *type = new (GC)Type(ID_STRING);
@@ -74,6 +80,7 @@ void Module::push_resource(Resource *res)
 
 Function::Function(const std::string &name, bool is_global)
     : is_global_(is_global)
+    , needs_env_(true)
     , name_(name)
 {
     // Create initial block.
@@ -113,6 +120,19 @@ Block *Function::last_block() const
     return &blocks_.back();
 }
 
+void Function::set_local_type(int index, const Type *type)
+{
+    assert(index >= 0);
+    assert(type->is_double() || type->is_int32());
+    local_types_[index] = type;
+}
+
+const Type *Function::local_type(int index) const
+{
+    LocalTypeMap::const_iterator it = local_types_.find(index);
+    return it != local_types_.end() ? it->second : NULL;
+}
+
 Instruction *Block::last_instr() const
 {
     assert(!instrs_.empty());
@@ -530,17 +550,17 @@ Value *Block::push_ctx_leave()
     return instr;
 }
 
-Value *Block::push_ctx_get(uint64_t key, Value *res, uint16_t cid)
+Value *Block::push_ctx_get(uint64_t key, Value *res)
 {
     assert(res);
-    Instruction *instr = new (GC)ContextGetInstruction(key, res, cid);
+    Instruction *instr = new (GC)ContextGetInstruction(key, res);
     push_instr(instr);
     return instr;
 }
 
-Value *Block::push_ctx_put(uint64_t key, Value *val, uint16_t cid)
+Value *Block::push_ctx_put(uint64_t key, Value *val)
 {
-    Instruction *instr = new (GC)ContextPutInstruction(key, val, cid);
+    Instruction *instr = new (GC)ContextPutInstruction(key, val);
     push_instr(instr);
     return instr;
 }
@@ -669,6 +689,15 @@ Value *Block::push_es_new_obj(Value *res)
     return instr;
 }
 
+Value *Block::push_es_new_obj_lit(const KeyVector &keys, Value *vals,
+                                  Value *res)
+{
+    Instruction *instr =
+        new (GC)EsNewObjectLiteralInstruction(keys, vals, res);
+    push_instr(instr);
+    return instr;
+}
+
 Value *Block::push_es_new_rex(const String &pattern,
                               const String &flags,
                               Value *res)
@@ -962,6 +991,7 @@ ValueInstruction::ValueInstruction(Operation op, Value *val, Value *res)
     : op_(op)
     , val_(val)
     , res_(res)
+    , val_type_(Type::value())
 {
     assert(op == FROM_BOOLEAN || op == FROM_DOUBLE || op == FROM_STRING ||
            op == TO_DOUBLE);
@@ -982,6 +1012,7 @@ ValueInstruction::ValueInstruction(Operation op, Value *val)
     : op_(op)
     , val_(val)
     , res_(NULL)
+    , val_type_(Type::value())
 {
 #ifdef DEBUG
     if (op == TO_BOOLEAN) { assert(val->type()->is_value()); }
@@ -1119,4 +1150,16 @@ PropertyDeleteSlowInstruction::PropertyDeleteSlowInstruction(Value *obj, Value *
     assert(res->type()->is_value());
 }
 
+int local_index(const Value *val)
+{
+    const ArrayElementConstant *elm =
+        dynamic_cast<const ArrayElementConstant *>(val);
+    if (elm == NULL || dynamic_cast<const ValuePointer *>(elm->array()) == NULL)
+        return -1;
+
+    // Negative indices refer to the this binding and the result slot which
+    // are shared with the caller.
+    return elm->index() >= 0 ? elm->index() : -1;
+}
+
 }
@@ -18,6 +18,7 @@
 
 #pragma once
 #include <cassert>
+#include <map>
 #include <vector>
 #include <gc_cpp.h>
 #include <gc/gc_allocator.h>
@@ -87,6 +88,7 @@ class EsNewArrayInstruction;
 class EsNewFunctionDeclarationInstruction;
 class EsNewFunctionExpressionInstruction;
 class EsNewObjectInstruction;
+class EsNewObjectLiteralInstruction;
 class EsNewRegexInstruction;
 class EsBinaryInstruction;
 class EsUnaryInstruction;
@@ -110,6 +112,7 @@ typedef std::vector<Instruction *,
 typedef std::set<Instruction *, std::less<Instruction *>,
                  gc_allocator<Instruction *> > InstructionSet;
 typedef std::vector<Resource *, gc_allocator<Resource *> > ResourceVector;
+typedef std::vector<uint64_t, gc_allocator<uint64_t> > KeyVector;
 
 /**
  * @brief Node meta data.
@@ -143,6 +146,7 @@ public:
     static const Type *_void();
     static const Type *boolean();
     static const Type *_double();
+    static const Type *int32();
     static const Type *string();
     static const Type *value();
 
@@ -170,6 +174,7 @@ public:
         ID_VOID,
         ID_BOOLEAN,
         ID_DOUBLE,
+        ID_INT32,
         ID_STRING,
 
         // Complex types.
@@ -223,6 +228,11 @@ public:
      */
     bool is_double() const { return id_ == ID_DOUBLE; }
 
+    /**
+     * @return true if this type is a 32-bit integer type.
+     */
+    bool is_int32() const { return id_ == ID_INT32; }
+
     /**
      * @return true if this type is a string type.
      */
@@ -657,10 +667,17 @@ public:
  */
 class Function : public Node
 {
+public:
+    /** Maps value stack slot indices to native storage types. */
+    typedef std::map<int, const Type *, std::less<int>,
+                     gc_allocator<std::pair<const int, const Type *> > > LocalTypeMap;
+
 private:
     bool is_global_;    ///< true if the function represents the program root.
+    bool needs_env_;    ///< true if calls must create a declarative environment.
     std::string name_;
     mutable BlockList blocks_;
+    LocalTypeMap local_types_;  ///< Locals proven to never hold anything but numbers.
 
 public:
     Function(const std::string &name, bool is_global);
@@ -671,6 +688,20 @@ public:
      */
     bool is_global() const { return is_global_; }
 
+    /**
+     * @return true if calling the function requires creating a new
+     *         declarative environment, false if the function can execute in
+     *         the environment it was created in.
+     */
+    bool needs_env() const { return needs_env_; }
+
+    /**
+     * Specifies whether calling the function requires a new declarative
+     * environment.
+     * @param [in] needs_env true if an environment is required.
+     */
+    void set_needs_env(bool needs_env) { needs_env_ = needs_env; }
+
     const std::string &name() const { return name_; }
 
     BlockList &mutable_blocks() { return blocks_; }
@@ -685,6 +716,25 @@ public:
      */
     Block *last_block() const;
 
+    /**
+     * Specifies that a value stack slot should be stored unboxed, in a native
+     * register of the given type.
+     * @param [in] index Value stack slot index.
+     * @param [in] type Native type, double or int32.
+     */
+    void set_local_type(int index, const Type *type);
+
+    /**
+     * @param [in] index Value stack slot index.
+     * @return Native type of the slot, or NULL if the slot is boxed.
+     */
+    const Type *local_type(int index) const;
+
+    /**
+     * @return All unboxed value stack slots.
+     */
+    const LocalTypeMap &local_types() const { return local_types_; }
+
     /**
      * @copydoc Node::accept
      */
@@ -806,8 +856,8 @@ public:
     Value *push_ctx_enter_catch(uint64_t key);
     Value *push_ctx_enter_with(Value *val);
     Value *push_ctx_leave();
-    Value *push_ctx_get(uint64_t key, Value *res, uint16_t cid);
-    Value *push_ctx_put(uint64_t key, Value *val, uint16_t cid);
+    Value *push_ctx_get(uint64_t key, Value *res);
+    Value *push_ctx_put(uint64_t key, Value *val);
     Value *push_ctx_del(uint64_t key, Value *res);
     Value *push_ex_save_state(Value *res);
     Value *push_ex_load_state(Value *state);
@@ -828,6 +878,7 @@ public:
     Value *push_es_new_fun_expr(Function *fun, uint32_t param_count,
                                 bool is_strict, Value *res);
     Value *push_es_new_obj(Value *res);
+    Value *push_es_new_obj_lit(const KeyVector &keys, Value *vals, Value *res);
     Value *push_es_new_rex(const String &pattern, const String &flags,
                            Value *res);
 
@@ -974,6 +1025,7 @@ public:
         virtual void visit_instr_es_new_fun_decl(EsNewFunctionDeclarationInstruction *instr) = 0;
         virtual void visit_instr_es_new_fun_expr(EsNewFunctionExpressionInstruction *instr) = 0;
         virtual void visit_instr_es_new_obj(EsNewObjectInstruction *instr) = 0;
+        virtual void visit_instr_es_new_obj_lit(EsNewObjectLiteralInstruction *instr) = 0;
         virtual void visit_instr_es_new_rex(EsNewRegexInstruction *instr) = 0;
         virtual void visit_instr_es_bin(EsBinaryInstruction *instr) = 0;
         virtual void visit_instr_es_unary(EsUnaryInstruction *instr) = 0;
@@ -1311,6 +1363,7 @@ private:
     Operation op_;
     Value *val_;
     Value *res_;
+    const Type *val_type_;  ///< Inferred type of the value operand.
 
 public:
     ValueInstruction(Operation op, Value *val, Value *res);
@@ -1319,6 +1372,13 @@ public:
     Operation operation() const { return op_; }
     Value *value() const { return val_; }
 
+    /**
+     * @return Type the value operand has been proven to have, or the value
+     *         type if nothing is known about it.
+     */
+    const Type *value_type() const { return val_type_; }
+    void set_value_type(const Type *type) { val_type_ = type; }
+
     /**
      * @return Result operation.
      * @pre Operation requires a value operand.
@@ -1684,17 +1744,14 @@ class ContextGetInstruction : public Instruction
 private:
     uint64_t key_;
     Value *res_;
-    uint16_t cid_;
 
 public:
-    ContextGetInstruction(uint64_t key, Value *res, uint16_t cid)
+    ContextGetInstruction(uint64_t key, Value *res)
         : key_(key)
-        , res_(res)
-        , cid_(cid) {}
+        , res_(res) {}
 
     uint64_t key() const { return key_; }
     Value *result() const { return res_; }
-    uint16_t cache_id() const { return cid_; }
 
     virtual const Type *type() const override { return Type::boolean(); }
     virtual void accept(Visitor *visitor) override
@@ -1711,17 +1768,14 @@ class ContextPutInstruction : public Instruction
 private:
     uint64_t key_;
     Value *val_;
-    uint16_t cid_;
 
 public:
-    ContextPutInstruction(uint64_t key, Value *val, uint16_t cid)
+    ContextPutInstruction(uint64_t key, Value *val)
         : key_(key)
-        , val_(val)
-        , cid_(cid) {}
+        , val_(val) {}
 
     uint64_t key() const { return key_; }
     Value *value() const { return val_; }
-    uint16_t cache_id() const { return cid_; }
 
     virtual const Type *type() const override { return Type::boolean(); }
     virtual void accept(Visitor *visitor) override
@@ -2354,6 +2408,35 @@ public:
     }
 };
 
+/**
+ * @brief Instruction for creating a new object from an object literal where
+ *        all properties are data properties with constant keys.
+ */
+class EsNewObjectLiteralInstruction : public Instruction
+{
+private:
+    KeyVector keys_;
+    Value *vals_;
+    Value *res_;
+
+public:
+    EsNewObjectLiteralInstruction(const KeyVector &keys, Value *vals,
+                                  Value *res)
+        : keys_(keys)
+        , vals_(vals)
+        , res_(res) {}
+
+    const KeyVector &keys() const { return keys_; }
+    Value *values() const { return vals_; }
+    Value *result() const { return res_; }
+
+    virtual const Type *type() const override { return Type::_void(); }
+    virtual void accept(Visitor *visitor) override
+    {
+        visitor->visit_instr_es_new_obj_lit(this);
+    }
+};
+
 /**
  * @brief Loads a regular expression object.
  */
@@ -2425,19 +2508,41 @@ private:
     Value *lval_;
     Value *rval_;
     Value *res_;
+    const Type *ltype_;     ///< Inferred type of the left operand.
+    const Type *rtype_;     ///< Inferred type of the right operand.
 
 public:
     EsBinaryInstruction(Operation op, Value *lval, Value *rval, Value *res)
         : op_(op)
         , lval_(lval)
         , rval_(rval)
-        , res_(res) {}
+        , res_(res)
+        , ltype_(Type::value())
+        , rtype_(Type::value()) {}
 
     Operation operation() const { return op_; }
     Value *left() const { return lval_; }
     Value *right() const { return rval_; }
     Value *result() const { return res_; }
 
+    /**
+     * @return Type the left operand has been proven to have, or the value
+     *         type if nothing is known about it.
+     */
+    const Type *left_type() const { return ltype_; }
+
+    /**
+     * @return Type the right operand has been proven to have, or the value
+     *         type if nothing is known about it.
+     */
+    const Type *right_type() const { return rtype_; }
+
+    void set_operand_types(const Type *ltype, const Type *rtype)
+    {
+        ltype_ = ltype;
+        rtype_ = rtype;
+    }
+
     virtual const Type *type() const override { return Type::boolean(); }
     virtual void accept(Visitor *visitor) override
     {
@@ -2463,17 +2568,26 @@ private:
     Operation op_;
     Value *val_;
     Value *res_;
+    const Type *val_type_;  ///< Inferred type of the operand.
 
 public:
     EsUnaryInstruction(Operation op, Value *val, Value *res)
         : op_(op)
         , val_(val)
-        , res_(res) {}
+        , res_(res)
+        , val_type_(Type::value()) {}
 
     Operation operation() const { return op_; }
     Value *value() const { return val_; }
     Value *result() const { return res_; }
 
+    /**
+     * @return Type the operand has been proven to have, or the value type if
+     *         nothing is known about it.
+     */
+    const Type *value_type() const { return val_type_; }
+    void set_value_type(const Type *type) { val_type_ = type; }
+
     virtual const Type *type() const override { return Type::boolean(); }
     virtual void accept(Visitor *visitor) override
     {
@@ -2737,6 +2851,13 @@ public:
     virtual const Type *type() const override { return type_; }
 };
 
+/**
+ * @param [in] val Value to examine.
+ * @return Index of the local value stack slot referenced by @a val, or -1 if
+ *         @a val is not a local value stack slot.
+ */
+int local_index(const Value *val);
+
 }
 
 template <>
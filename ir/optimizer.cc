@@ -16,15 +16,267 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <cmath>
 #include "ir.hh"
 #include "optimizer.hh"
 
 namespace ir {
 
 Optimizer::Optimizer()
+    : pass_(PASS_ESCAPE)
+    , dead_(false)
+    , escaped_all_(false)
+    , fail_instr_(NULL)
+    , fail_index_(-1)
+    , fail_kind_(KIND_ANY)
 {
 }
 
+Optimizer::Kind Optimizer::join(Kind k1, Kind k2)
+{
+    if (k1 == k2 || k2 == KIND_NONE)
+        return k1;
+    if (k1 == KIND_NONE)
+        return k2;
+    if (is_number(k1) && is_number(k2))
+        return KIND_NUMBER;
+
+    return KIND_ANY;
+}
+
+bool Optimizer::is_number(Kind kind)
+{
+    return kind == KIND_INT32 || kind == KIND_NUMBER;
+}
+
+const Type *Optimizer::kind_type(Kind kind)
+{
+    switch (kind)
+    {
+        case KIND_INT32:
+            return Type::int32();
+        case KIND_NUMBER:
+            return Type::_double();
+        case KIND_BOOLEAN:
+            return Type::boolean();
+        default:
+            return Type::value();
+    }
+}
+
+Optimizer::Local &Optimizer::local(int index)
+{
+    assert(index >= 0);
+    if (static_cast<size_t>(index) >= locals_.size())
+        locals_.resize(index + 1);
+
+    return locals_[index];
+}
+
+Optimizer::Kind Optimizer::kind(Value *val)
+{
+    if (dead_)
+        return KIND_NONE;
+
+    int index = local_index(val);
+    if (index < 0)
+    {
+        if (ValueConstant *cst = dynamic_cast<ValueConstant *>(val))
+        {
+            if (cst->value() == ValueConstant::VALUE_TRUE ||
+                cst->value() == ValueConstant::VALUE_FALSE)
+            {
+                return KIND_BOOLEAN;
+            }
+        }
+
+        return KIND_ANY;
+    }
+
+    if (escaped_all_ || local(index).escaped_)
+        return KIND_ANY;
+
+    return static_cast<size_t>(index) < kinds_.size() ? kinds_[index] : KIND_ANY;
+}
+
+void Optimizer::read(Value *val)
+{
+    int index = local_index(val);
+    if (index < 0 || pass_ != PASS_ANNOTATE)
+        return;
+
+    Kind k = kind(val);
+    Local &loc = local(index);
+    loc.used_ = true;
+    if (k != KIND_NONE)
+    {
+        if (!is_number(k))
+            loc.boxed_ = true;
+        if (k != KIND_INT32)
+            loc.int32_ = false;
+    }
+}
+
+void Optimizer::write(Value *val, Kind kind)
+{
+    int index = local_index(val);
+    if (index < 0 || pass_ == PASS_ESCAPE)
+        return;
+
+    if (pass_ == PASS_ANNOTATE)
+    {
+        // Writes in unreachable code are still emitted by the code generator
+        // so writes of non-numbers must force the local to be boxed even if
+        // they never execute.
+        Local &loc = local(index);
+        loc.used_ = true;
+        if (kind != KIND_NONE)
+        {
+            if (!is_number(kind))
+                loc.boxed_ = true;
+            if (kind != KIND_INT32)
+                loc.int32_ = false;
+        }
+    }
+
+    if (dead_)
+        return;
+
+    if (static_cast<size_t>(index) >= kinds_.size())
+        kinds_.resize(index + 1, KIND_ANY);
+    kinds_[index] = kind;
+}
+
+void Optimizer::escape(Value *arr, int index)
+{
+    if (pass_ != PASS_ESCAPE || dynamic_cast<ValuePointer *>(arr) == NULL)
+        return;
+
+    if (index >= 0)
+        local(index).escaped_ = true;
+}
+
+void Optimizer::flow(Block *block, const KindVector &kinds)
+{
+    if (pass_ != PASS_INFER || dead_)
+        return;
+
+    BlockKindMap::iterator it = entry_kinds_.find(block);
+    if (it == entry_kinds_.end())
+    {
+        entry_kinds_.insert(std::make_pair(block, kinds));
+        work_list_.push_back(block);
+        return;
+    }
+
+    KindVector &entry = it->second;
+
+    bool changed = false;
+    if (kinds.size() < entry.size())
+    {
+        entry.resize(kinds.size());
+        changed = true;
+    }
+
+    for (size_t i = 0; i < entry.size(); i++)
+    {
+        Kind k = join(entry[i], kinds[i]);
+        if (k != entry[i])
+        {
+            entry[i] = k;
+            changed = true;
+        }
+    }
+
+    if (changed &&
+        std::find(work_list_.begin(), work_list_.end(), block) == work_list_.end())
+    {
+        work_list_.push_back(block);
+    }
+}
+
+void Optimizer::infer_types(Function *fun)
+{
+    // Escaping locals have already been collected when visiting the blocks.
+    entry_kinds_.clear();
+    work_list_.clear();
+
+    Block *entry = fun->mutable_blocks().begin().raw_pointer();
+
+    // Compute the kinds of all locals at each block entry. The function entry
+    // state is empty, all locals are undefined and considered to be of any
+    // type.
+    pass_ = PASS_INFER;
+    flow(entry, KindVector());
+
+    while (!work_list_.empty())
+    {
+        Block *block = work_list_.front();
+        work_list_.erase(work_list_.begin());
+
+        kinds_ = entry_kinds_[block];
+        dead_ = false;
+        fail_instr_ = NULL;
+
+        bool terminated = false;
+        for (Instruction *instr : block->instructions())
+        {
+            Instruction::Visitor::visit(instr);
+            if (instr->is_terminating())
+            {
+                terminated = true;
+                break;
+            }
+        }
+
+        // Blocks without a terminating instruction fall through to the next.
+        if (!terminated && block->next())
+            flow(block->next(), kinds_);
+    }
+
+    // Annotate instructions with the inferred operand types and decide which
+    // locals can be unboxed.
+    pass_ = PASS_ANNOTATE;
+
+    BlockList::Iterator it_block;
+    for (it_block = fun->mutable_blocks().begin(); it_block != fun->mutable_blocks().end(); ++it_block)
+    {
+        Block *block = it_block.raw_pointer();
+
+        BlockKindMap::iterator it_kinds = entry_kinds_.find(block);
+        dead_ = it_kinds == entry_kinds_.end();
+        kinds_ = dead_ ? KindVector() : it_kinds->second;
+
+        for (Instruction *instr : block->instructions())
+        {
+            Instruction::Visitor::visit(instr);
+            if (instr->is_terminating())
+                dead_ = true;
+        }
+    }
+
+    if (!escaped_all_)
+    {
+        for (size_t i = 0; i < locals_.size(); i++)
+        {
+            const Local &loc = locals_[i];
+            if (!loc.used_ || loc.escaped_ || loc.boxed_)
+                continue;
+
+            fun->set_local_type(static_cast<int>(i),
+                                loc.int32_ ? Type::int32() : Type::_double());
+        }
+    }
+
+    pass_ = PASS_ESCAPE;
+    dead_ = false;
+    escaped_all_ = false;
+    kinds_.clear();
+    entry_kinds_.clear();
+    locals_.clear();
+}
+
 void Optimizer::visit_module(Module *module)
 {
     for (const Resource *res : module->resources())
@@ -53,6 +305,8 @@ void Optimizer::visit_fun(Function *fun)
 
         Node::Visitor::visit(block);
     }
+
+    infer_types(fun);
 }
 
 void Optimizer::visit_block(Block *block)
@@ -80,6 +334,9 @@ void Optimizer::visit_instr_args_obj_link(ArgumentsObjectLinkInstruction *instr)
 
 void Optimizer::visit_instr_arr(ArrayInstruction *instr)
 {
+    escape(instr->array(), instr->index());
+    if (instr->operation() == ArrayInstruction::PUT)
+        read(instr->value());
 }
 
 void Optimizer::visit_instr_bin(BinaryInstruction *instr)
@@ -96,30 +353,109 @@ void Optimizer::visit_instr_bnd_extra_ptr(BindExtraPtrInstruction *instr)
 
 void Optimizer::visit_instr_call(CallInstruction *instr)
 {
+    read(instr->function());
+    write(instr->result(), KIND_ANY);
 }
 
 void Optimizer::visit_instr_call_keyed(CallKeyedInstruction *instr)
 {
+    read(instr->object());
+    write(instr->result(), KIND_ANY);
 }
 
 void Optimizer::visit_instr_call_keyed_slow(CallKeyedSlowInstruction *instr)
 {
+    read(instr->object());
+    read(instr->key());
+    write(instr->result(), KIND_ANY);
 }
 
 void Optimizer::visit_instr_call_named(CallNamedInstruction *instr)
 {
+    write(instr->result(), KIND_ANY);
 }
 
 void Optimizer::visit_instr_val(ValueInstruction *instr)
 {
+    switch (instr->operation())
+    {
+        case ValueInstruction::TO_BOOLEAN:
+        case ValueInstruction::TO_DOUBLE:
+            if (pass_ == PASS_ANNOTATE && !dead_)
+                instr->set_value_type(kind_type(kind(instr->value())));
+            read(instr->value());
+            break;
+
+        case ValueInstruction::FROM_BOOLEAN:
+            write(instr->result(), KIND_BOOLEAN);
+            break;
+
+        case ValueInstruction::FROM_DOUBLE:
+        {
+            // Integral constants are int32, everything else might not be.
+            Kind k = KIND_NUMBER;
+            if (DoubleConstant *cst = dynamic_cast<DoubleConstant *>(instr->value()))
+            {
+                double val = cst->value();
+                if (val >= -2147483648.0 && val <= 2147483647.0 &&
+                    static_cast<double>(static_cast<int32_t>(val)) == val &&
+                    !(val == 0.0 && std::signbit(val)))
+                {
+                    k = KIND_INT32;
+                }
+            }
+
+            write(instr->result(), k);
+            break;
+        }
+
+        case ValueInstruction::FROM_STRING:
+            write(instr->result(), KIND_ANY);
+            break;
+
+        default:
+            read(instr->value());
+            break;
+    }
 }
 
 void Optimizer::visit_instr_br(BranchInstruction *instr)
 {
+    if (pass_ != PASS_INFER)
+        return;
+
+    flow(instr->true_block(), kinds_);
+
+    // The result of a failed operation is left untouched, so the failure
+    // branch must see the kind the local had before the operation.
+    KindVector fail_kinds = kinds_;
+    int index = -1;
+    Kind k = KIND_ANY;
+    if (instr->condition() == fail_instr_)
+    {
+        index = fail_index_;
+        k = fail_kind_;
+    }
+    else if (EsBinaryInstruction *bin =
+             dynamic_cast<EsBinaryInstruction *>(instr->condition()))
+    {
+        index = local_index(bin->result());
+    }
+    else if (EsUnaryInstruction *unary =
+             dynamic_cast<EsUnaryInstruction *>(instr->condition()))
+    {
+        index = local_index(unary->result());
+    }
+
+    if (index >= 0 && static_cast<size_t>(index) < fail_kinds.size())
+        fail_kinds[index] = join(fail_kinds[index], k);
+
+    flow(instr->false_block(), fail_kinds);
 }
 
 void Optimizer::visit_instr_jmp(JumpInstruction *instr)
 {
+    flow(instr->block(), kinds_);
 }
 
 void Optimizer::visit_instr_ret(ReturnInstruction *instr)
@@ -128,10 +464,14 @@ void Optimizer::visit_instr_ret(ReturnInstruction *instr)
 
 void Optimizer::visit_instr_store(StoreInstruction *instr)
 {
+    Kind k = kind(instr->source());
+    read(instr->source());
+    write(instr->destination(), k);
 }
 
 void Optimizer::visit_instr_get_elm_ptr(GetElementPointerInstruction *instr)
 {
+    escape(instr->value(), static_cast<int>(instr->index()));
 }
 
 void Optimizer::visit_instr_stk_alloc(StackAllocInstruction *instr)
@@ -144,6 +484,7 @@ void Optimizer::visit_instr_stk_free(StackFreeInstruction *instr)
 
 void Optimizer::visit_instr_stk_push(StackPushInstruction *instr)
 {
+    read(instr->value());
 }
 
 void Optimizer::visit_instr_ctx_set_strict(ContextSetStrictInstruction *instr)
@@ -156,6 +497,7 @@ void Optimizer::visit_instr_ctx_enter_catch(ContextEnterCatchInstruction *instr)
 
 void Optimizer::visit_instr_ctx_enter_with(ContextEnterWithInstruction *instr)
 {
+    read(instr->value());
 }
 
 void Optimizer::visit_instr_ctx_leave(ContextLeaveInstruction *instr)
@@ -164,26 +506,32 @@ void Optimizer::visit_instr_ctx_leave(ContextLeaveInstruction *instr)
 
 void Optimizer::visit_instr_ctx_get(ContextGetInstruction *instr)
 {
+    write(instr->result(), KIND_ANY);
 }
 
 void Optimizer::visit_instr_ctx_put(ContextPutInstruction *instr)
 {
+    read(instr->value());
 }
 
 void Optimizer::visit_instr_ctx_del(ContextDeleteInstruction *instr)
 {
+    write(instr->result(), KIND_ANY);
 }
 
 void Optimizer::visit_instr_ex_save_state(ExceptionSaveStateInstruction *instr)
 {
+    write(instr->result(), KIND_ANY);
 }
 
 void Optimizer::visit_instr_ex_load_state(ExceptionLoadStateInstruction *instr)
 {
+    read(instr->state());
 }
 
 void Optimizer::visit_instr_ex_set(ExceptionSetInstruction *instr)
 {
+    read(instr->value());
 }
 
 void Optimizer::visit_instr_ex_clear(ExceptionClearInstruction *instr)
@@ -192,10 +540,27 @@ void Optimizer::visit_instr_ex_clear(ExceptionClearInstruction *instr)
 
 void Optimizer::visit_instr_init_args(InitArgumentsInstruction *instr)
 {
+    if (pass_ == PASS_ESCAPE && dynamic_cast<ValuePointer *>(instr->destination()))
+        escaped_all_ = true;
 }
 
 void Optimizer::visit_instr_decl(Declaration *instr)
 {
+    switch (instr->kind())
+    {
+        case Declaration::FUNCTION:
+            read(instr->value());
+            break;
+        case Declaration::PARAMETER:
+            if (pass_ == PASS_ESCAPE &&
+                dynamic_cast<ValuePointer *>(instr->parameter_array()))
+            {
+                escaped_all_ = true;
+            }
+            break;
+        default:
+            break;
+    }
 }
 
 void Optimizer::visit_instr_link(Link *instr)
@@ -204,70 +569,188 @@ void Optimizer::visit_instr_link(Link *instr)
 
 void Optimizer::visit_instr_prp_def_data(PropertyDefineDataInstruction *instr)
 {
+    read(instr->object());
+    read(instr->value());
 }
 
 void Optimizer::visit_instr_prp_def_accessor(PropertyDefineAccessorInstruction *instr)
 {
+    read(instr->object());
+    read(instr->function());
 }
 
 void Optimizer::visit_instr_prp_it_new(PropertyIteratorNewInstruction *instr)
 {
+    read(instr->object());
 }
 
 void Optimizer::visit_instr_prp_it_next(PropertyIteratorNextInstruction *instr)
 {
+    write(instr->value(), KIND_ANY);
 }
 
 void Optimizer::visit_instr_prp_get(PropertyGetInstruction *instr)
 {
+    read(instr->object());
+    write(instr->result(), KIND_ANY);
 }
 
 void Optimizer::visit_instr_prp_get_slow(PropertyGetSlowInstruction *instr)
 {
+    read(instr->object());
+    read(instr->key());
+    write(instr->result(), KIND_ANY);
 }
 
 void Optimizer::visit_instr_prp_put(PropertyPutInstruction *instr)
 {
+    read(instr->object());
+    read(instr->value());
 }
 
 void Optimizer::visit_instr_prp_put_slow(PropertyPutSlowInstruction *instr)
 {
+    read(instr->object());
+    read(instr->key());
+    read(instr->value());
 }
 
 void Optimizer::visit_instr_prp_del(PropertyDeleteInstruction *instr)
 {
+    read(instr->object());
+    write(instr->result(), KIND_ANY);
 }
 
 void Optimizer::visit_instr_prp_del_slow(PropertyDeleteSlowInstruction *instr)
 {
+    read(instr->object());
+    read(instr->key());
+    write(instr->result(), KIND_ANY);
 }
 
 void Optimizer::visit_instr_es_new_arr(EsNewArrayInstruction *instr)
 {
+    write(instr->result(), KIND_ANY);
 }
 
 void Optimizer::visit_instr_es_new_fun_decl(EsNewFunctionDeclarationInstruction *instr)
 {
+    write(instr->result(), KIND_ANY);
 }
 
 void Optimizer::visit_instr_es_new_fun_expr(EsNewFunctionExpressionInstruction *instr)
 {
+    write(instr->result(), KIND_ANY);
 }
 
 void Optimizer::visit_instr_es_new_obj(EsNewObjectInstruction *instr)
 {
+    write(instr->result(), KIND_ANY);
+}
+
+void Optimizer::visit_instr_es_new_obj_lit(EsNewObjectLiteralInstruction *instr)
+{
+    write(instr->result(), KIND_ANY);
 }
 
 void Optimizer::visit_instr_es_new_rex(EsNewRegexInstruction *instr)
 {
+    write(instr->result(), KIND_ANY);
 }
 
 void Optimizer::visit_instr_es_bin(EsBinaryInstruction *instr)
 {
+    Kind lk = kind(instr->left());
+    Kind rk = kind(instr->right());
+
+    Kind k = KIND_ANY;
+    switch (instr->operation())
+    {
+        case EsBinaryInstruction::MUL:
+        case EsBinaryInstruction::DIV:
+        case EsBinaryInstruction::MOD:
+        case EsBinaryInstruction::SUB:
+        case EsBinaryInstruction::RUS:
+            k = KIND_NUMBER;
+            break;
+        case EsBinaryInstruction::ADD:
+            // Addition of anything but numbers may result in a string.
+            if (lk == KIND_NONE || rk == KIND_NONE)
+                k = KIND_NONE;
+            else if (is_number(lk) && is_number(rk))
+                k = KIND_NUMBER;
+            break;
+        case EsBinaryInstruction::LS:
+        case EsBinaryInstruction::RSS:
+        case EsBinaryInstruction::BIT_AND:
+        case EsBinaryInstruction::BIT_XOR:
+        case EsBinaryInstruction::BIT_OR:
+            k = KIND_INT32;
+            break;
+        case EsBinaryInstruction::LT:
+        case EsBinaryInstruction::GT:
+        case EsBinaryInstruction::LTE:
+        case EsBinaryInstruction::GTE:
+        case EsBinaryInstruction::IN:
+        case EsBinaryInstruction::INSTANCEOF:
+        case EsBinaryInstruction::EQ:
+        case EsBinaryInstruction::NEQ:
+        case EsBinaryInstruction::STRICT_EQ:
+        case EsBinaryInstruction::STRICT_NEQ:
+            k = KIND_BOOLEAN;
+            break;
+        default:
+            assert(false);
+            break;
+    }
+
+    if (pass_ == PASS_ANNOTATE && !dead_)
+        instr->set_operand_types(kind_type(lk), kind_type(rk));
+
+    read(instr->left());
+    read(instr->right());
+
+    fail_instr_ = instr;
+    fail_index_ = local_index(instr->result());
+    fail_kind_ = kind(instr->result());
+
+    write(instr->result(), k);
 }
 
 void Optimizer::visit_instr_es_unary(EsUnaryInstruction *instr)
 {
+    Kind vk = kind(instr->value());
+
+    Kind k = KIND_ANY;
+    switch (instr->operation())
+    {
+        case EsUnaryInstruction::TYPEOF:
+            k = KIND_ANY;
+            break;
+        case EsUnaryInstruction::NEG:
+            k = KIND_NUMBER;
+            break;
+        case EsUnaryInstruction::BIT_NOT:
+            k = KIND_INT32;
+            break;
+        case EsUnaryInstruction::LOG_NOT:
+            k = KIND_BOOLEAN;
+            break;
+        default:
+            assert(false);
+            break;
+    }
+
+    if (pass_ == PASS_ANNOTATE && !dead_)
+        instr->set_value_type(kind_type(vk));
+
+    read(instr->value());
+
+    fail_instr_ = instr;
+    fail_index_ = local_index(instr->result());
+    fail_kind_ = kind(instr->result());
+
+    write(instr->result(), k);
 }
 
 void Optimizer::visit_str_res(StringResource *res)
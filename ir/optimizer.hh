@@ -17,9 +17,20 @@
  */
 
 #pragma once
+#include <map>
+#include <vector>
 
 namespace ir {
 
+/**
+ * @brief IR optimizer.
+ *
+ * Removes unreachable blocks and runs a flow-sensitive type inference over
+ * the local value stack slots of each function. Instructions operating on
+ * values are annotated with the operand types proven by the inference, and
+ * locals that can be proven to only ever hold numbers are marked for
+ * unboxed storage in the function.
+ */
 class Optimizer : public Instruction::Visitor,
                   public Node::Visitor,
                   public Resource::Visitor
@@ -75,12 +86,85 @@ private:
     virtual void visit_instr_es_new_fun_decl(EsNewFunctionDeclarationInstruction *instr) override;
     virtual void visit_instr_es_new_fun_expr(EsNewFunctionExpressionInstruction *instr) override;
     virtual void visit_instr_es_new_obj(EsNewObjectInstruction *instr) override;
+    virtual void visit_instr_es_new_obj_lit(EsNewObjectLiteralInstruction *instr) override;
     virtual void visit_instr_es_new_rex(EsNewRegexInstruction *instr) override;
     virtual void visit_instr_es_bin(EsBinaryInstruction *instr) override;
     virtual void visit_instr_es_unary(EsUnaryInstruction *instr) override;
 
     virtual void visit_str_res(StringResource *res) override;
 
+private:
+    /**
+     * @brief Type lattice of the local type inference.
+     *
+     * KIND_NONE is the bottom element used for unreachable code. KIND_INT32
+     * is a subset of KIND_NUMBER, all other kinds join to KIND_ANY.
+     */
+    enum Kind
+    {
+        KIND_NONE,
+        KIND_INT32,
+        KIND_NUMBER,
+        KIND_BOOLEAN,
+        KIND_ANY
+    };
+
+    /** Kind of each local, missing trailing entries are KIND_ANY. */
+    typedef std::vector<Kind> KindVector;
+
+    typedef std::map<Block *, KindVector, std::less<Block *>,
+                     gc_allocator<std::pair<Block * const, KindVector> > > BlockKindMap;
+
+    /**
+     * @brief Summary of how a local is used throughout a function.
+     */
+    struct Local
+    {
+        bool used_;     ///< Local is read or written.
+        bool escaped_;  ///< Local storage is addressed outside of the function.
+        bool boxed_;    ///< Local may hold a non-number.
+        bool int32_;    ///< Local only ever holds 32-bit integers.
+
+        Local()
+            : used_(false)
+            , escaped_(false)
+            , boxed_(false)
+            , int32_(true) {}
+    };
+
+    typedef std::vector<Local> LocalVector;
+
+    enum Pass
+    {
+        PASS_ESCAPE,    ///< Find locals whose storage escape.
+        PASS_INFER,     ///< Compute kinds at block entries.
+        PASS_ANNOTATE   ///< Annotate instructions and locals.
+    };
+
+    Pass pass_;
+    bool dead_;                 ///< true if the current instruction is unreachable.
+    bool escaped_all_;          ///< true if the whole value stack escapes.
+    KindVector kinds_;          ///< Kinds at the current program point.
+    BlockKindMap entry_kinds_;  ///< Kinds at block entries.
+    LocalVector locals_;
+    std::vector<Block *, gc_allocator<Block *> > work_list_;
+
+    Instruction *fail_instr_;   ///< Last instruction writing a typed local.
+    int fail_index_;            ///< Local written by fail_instr_.
+    Kind fail_kind_;            ///< Kind of the local if fail_instr_ fails.
+
+    static Kind join(Kind k1, Kind k2);
+    static bool is_number(Kind kind);
+    static const Type *kind_type(Kind kind);
+
+    Local &local(int index);
+    Kind kind(Value *val);
+    void read(Value *val);
+    void write(Value *val, Kind kind);
+    void escape(Value *arr, int index);
+    void flow(Block *block, const KindVector &kinds);
+    void infer_types(Function *fun);
+
 public:
     Optimizer();
 
@@ -635,17 +635,63 @@ class IdentifierLiteral : public Expression
 {
 private:
     String value_;
+    int depth_;     ///< Number of function scopes to walk out to reach the binding, -1 if unresolved.
+    int slot_;      ///< Binding slot in the resolved function scope.
+    void *site_;    ///< Access site data attached by the consumer of the AST.
 
 public:
     IdentifierLiteral(Location loc, String value)
         : Expression(loc)
-        , value_(value) {}
+        , value_(value)
+        , depth_(-1)
+        , slot_(-1)
+        , site_(NULL) {}
 
     String value() const
     {
         return value_;
     }
 
+    /**
+     * Statically resolves the identifier to a binding in an enclosing
+     * function scope.
+     * @param [in] depth Number of function scopes to walk out.
+     * @param [in] slot Slot of the binding in the function scope.
+     */
+    void resolve(int depth, int slot)
+    {
+        depth_ = depth;
+        slot_ = slot;
+    }
+
+    /**
+     * @return true if the identifier has been statically resolved.
+     */
+    bool is_resolved() const
+    {
+        return depth_ >= 0;
+    }
+
+    int depth() const
+    {
+        return depth_;
+    }
+
+    int slot() const
+    {
+        return slot_;
+    }
+
+    void *site() const
+    {
+        return site_;
+    }
+
+    void set_site(void *site)
+    {
+        site_ = site;
+    }
+
     /**
      * @copydoc Expression::is_left_hand_expr
      */
@@ -754,7 +800,9 @@ private:
     StringVector params_;
     StatementVector body_;
     DeclarationVector decl_;
+    StringVector slots_;    ///< Names of bindings addressed by slot, in slot order.
     Type type_;
+    void *code_;            ///< Executable code attached by the consumer of the AST.
 
 public:
     FunctionLiteral(Location loc, String name)
@@ -763,7 +811,8 @@ public:
         , strict_mode_(false)
         , needs_args_obj_(false)
         , name_(name)
-        , type_(TYPE_DECLARATION) {}
+        , type_(TYPE_DECLARATION)
+        , code_(NULL) {}
 
     String name() const
     {
@@ -795,6 +844,22 @@ public:
         return decl_;
     }
 
+    const StringVector &slots() const
+    {
+        return slots_;
+    }
+
+    /**
+     * Allocates a slot for a binding in the function scope.
+     * @param [in] name Name of parameter or declaration.
+     * @return Slot index.
+     */
+    int push_slot(const String &name)
+    {
+        slots_.push_back(name);
+        return static_cast<int>(slots_.size() - 1);
+    }
+
     void set_strict_mode(bool strict_mode)
     {
         strict_mode_ = strict_mode;
@@ -805,6 +870,16 @@ public:
         return strict_mode_;
     }
 
+    void *code() const
+    {
+        return code_;
+    }
+
+    void set_code(void *code)
+    {
+        code_ = code;
+    }
+
     void set_needs_args_obj(bool needs_args_obj)
     {
         needs_args_obj_ = needs_args_obj;
@@ -63,8 +63,36 @@ bool es_is_unicode_connector_punctuation(uni_char c)
     return uni_get_category(c) == UC_CONNECTOR_PUNCTUATION;
 }
 
+/** Character class bits of ASCII identifier characters. */
+enum
+{
+    ID_START = 1,   ///< Character is an IdentifierStart character.
+    ID_PART = 2,    ///< Character is an IdentifierPart character.
+};
+
+/** Identifier character classes of all ASCII characters. */
+static const uint8_t ascii_id_chars[128] =
+{
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    // $
+    0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    // 0-9
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0,
+    // A-Z
+    0, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    // \ _
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 0, 0, 3,
+    // a-z
+    0, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 0, 0, 0, 0
+};
+
 bool es_is_identifier_start(uni_char c)
 {
+    if (c < 128)
+        return (ascii_id_chars[c] & ID_START) != 0;
+
     // 7.6
     // IdentifierStart :: UnicodeLetter $ _ \UnicodeEscapeSequence
     return c == '$' || c == '_' || c == '\\' || es_is_unicode_letter(c);
@@ -79,6 +107,9 @@ bool es_is_identifier_part(uni_char c)
     static uni_char zwnj = 0x200c;
     static uni_char zwj = 0x200d;
 
+    if (c < 128)
+        return (ascii_id_chars[c] & ID_PART) != 0;
+
     return es_is_identifier_start(c) || es_is_unicode_combining_mark(c) ||
            es_is_unicode_digit(c) || es_is_unicode_connector_punctuation(c) ||
            c == zwnj || c == zwj;
@@ -194,18 +225,93 @@ int32_t Lexer::read_oct_number(int num_digits)
 }
 #endif
 
-Lexer::ReservedWord *Lexer::find_reserved_word(const char *keyword)
+/** Length of the shortest reserved word. */
+#define MIN_RESERVED_WORD_LEN   2
+/** Length of the longest reserved word. */
+#define MAX_RESERVED_WORD_LEN   10
+
+/**
+ * Perfect hash function for the words in Lexer::reserved_words_. The
+ * constants have been found by exhaustive search, any change to the list of
+ * reserved words must be verified to not cause any collisions.
+ * @pre len >= MIN_RESERVED_WORD_LEN
+ */
+static inline size_t reserved_word_hash(const ::uni_char *str, size_t len,
+                                        size_t table_size)
 {
+    return ((str[0] + str[1]) * 44 + len) & (table_size - 1);
+}
+
+Lexer::ReservedWord **Lexer::create_reserved_word_table()
+{
+    ReservedWord **table = new ReservedWord *[RESERVED_WORD_TABLE_SIZE];
+    memset(table, 0, RESERVED_WORD_TABLE_SIZE * sizeof(ReservedWord *));
+
     size_t num_res_words = sizeof(reserved_words_)/sizeof(ReservedWord);
-    assert(num_res_words == 45);    // FIXME: Remove after confirmation.
+    assert(num_res_words == 45);
 
     for (size_t i = 0; i < num_res_words; i++)
     {
-        if (!strcmp(reserved_words_[i].keyword_, keyword))
-            return &reserved_words_[i];
+        const char *keyword = reserved_words_[i].keyword_;
+
+        size_t len = strlen(keyword);
+        assert(len >= MIN_RESERVED_WORD_LEN && len <= MAX_RESERVED_WORD_LEN);
+
+        ::uni_char str[MAX_RESERVED_WORD_LEN];
+        for (size_t j = 0; j < len; j++)
+            str[j] = static_cast< ::uni_char>(keyword[j]);
+
+        size_t hash = reserved_word_hash(str, len, RESERVED_WORD_TABLE_SIZE);
+        assert(!table[hash]);   // Hash must be perfect.
+        table[hash] = &reserved_words_[i];
+    }
+
+    return table;
+}
+
+Lexer::ReservedWord *Lexer::find_reserved_word(const ::uni_char *str, size_t len)
+{
+    static ReservedWord **table = create_reserved_word_table();
+
+    if (len < MIN_RESERVED_WORD_LEN || len > MAX_RESERVED_WORD_LEN)
+        return NULL;
+
+    ReservedWord *res_word = table[reserved_word_hash(str, len, RESERVED_WORD_TABLE_SIZE)];
+    if (!res_word)
+        return NULL;
+
+    const char *keyword = res_word->keyword_;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (str[i] != static_cast< ::uni_char>(keyword[i]))
+            return NULL;
     }
 
-    return NULL;
+    return keyword[len] == '\0' ? res_word : NULL;
+}
+
+size_t Lexer::IdentifierHash::operator()(const String &str) const
+{
+    // The string data is not necessarily NULL-terminated so String::hash()
+    // cannot be used.
+    size_t hash = 5381;
+
+    const ::uni_char *data = str.data();
+    for (size_t i = 0; i < str.length(); i++)
+        hash = ((hash << 5) + hash) + data[i];  // hash * 33 + c.
+
+    return hash;
+}
+
+String Lexer::intern(const ::uni_char *data, size_t len)
+{
+    IdentifierTable::iterator it = identifiers_.find(String::wrap(data, len));
+    if (it != identifiers_.end())
+        return *it;
+
+    String str(data, len);
+    identifiers_.insert(str);
+    return str;
 }
 
 Token Lexer::skip_line_comment(bool skipped_line_term)
@@ -284,12 +390,14 @@ Token Lexer::lex_identifier_or_reserved_word(bool skipped_line_term)
 
     stream_.push(c);
 
+    String str = intern(sb_.data(), sb_.length());
+
     // Check if reserved word.
-    ReservedWord *res_word = find_reserved_word(sb_.string().utf8().c_str());
+    ReservedWord *res_word = find_reserved_word(str.data(), str.length());
     if (res_word)
-        return Token(res_word->type_, sb_.string(), Location(beg_pos, stream_.position()), skipped_line_term);
+        return Token(res_word->type_, str, Location(beg_pos, stream_.position()), skipped_line_term);
     else
-        return Token(Token::LIT_IDENTIFIER, sb_.string(), Location(beg_pos, stream_.position()), skipped_line_term);
+        return Token(Token::LIT_IDENTIFIER, str, Location(beg_pos, stream_.position()), skipped_line_term);
 }
 
 Token Lexer::lex_numeric_literal(bool skipped_line_term, bool parsed_period)
@@ -17,6 +17,7 @@
  */
 
 #pragma once
+#include <unordered_set>
 #include <vector>
 #include <gc/gc_allocator.h>
 #include "common/stringbuilder.hh"
@@ -43,6 +44,28 @@ private:
 
     static ReservedWord reserved_words_[];  ///< Defines all reserved words.
 
+    /** Number of slots in the reserved word hash table, must be a power of
+     * two. */
+    static const size_t RESERVED_WORD_TABLE_SIZE = 128;
+
+    /**
+     * Creates a hash table of all reserved words.
+     * @see reserved_word_hash
+     * @return Array of RESERVED_WORD_TABLE_SIZE reserved word pointers.
+     */
+    static ReservedWord **create_reserved_word_table();
+
+    /**
+     * @brief Hashes identifiers by their characters.
+     */
+    struct IdentifierHash
+    {
+        size_t operator()(const String &str) const;
+    };
+
+    typedef std::unordered_set<String, IdentifierHash, std::equal_to<String>,
+                               gc_allocator<String> > IdentifierTable;
+
 private:
     UnicodeStream &stream_;     ///< Source input stream.
 
@@ -50,6 +73,19 @@ private:
 
     TokenVector peek_;          ///< Peek stack.
 
+    /** All identifiers and reserved words seen by the lexer. Identical names
+     * share the same string data which allows them to be compared by
+     * pointer. */
+    IdentifierTable identifiers_;
+
+    /**
+     * Interns an identifier name.
+     * @param [in] data Identifier characters.
+     * @param [in] len Number of characters in data.
+     * @return String shared by all identifiers with the same name.
+     */
+    String intern(const ::uni_char *data, size_t len);
+
     /**
      * Reads a hexadecimal number with the specified number of digits from the
      * Unicode input stream.
@@ -74,11 +110,12 @@ private:
 
     /**
      * Looks up a reserved word in the list of reserved words.
-     * @param [in] keyword The keyword to look for.
+     * @param [in] str Characters of the keyword to look for.
+     * @param [in] len Number of characters in str.
      * @return If a matching keyword is found a pointer to it is returned. If
      *         no matching word is find the function returns NULL.
      */
-    ReservedWord *find_reserved_word(const char *keyword);
+    ReservedWord *find_reserved_word(const ::uni_char *str, size_t len);
 
     /**
      * Select a token depending on the next character in the input stream. If
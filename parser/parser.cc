@@ -61,12 +61,10 @@ void Parser::Scope::push_back(Statement *stmt)
     fun_->push_back(stmt);
 }
 
-void Parser::Scope::push_decl(String name, Declaration *decl)
+void Parser::Scope::push_decl(Declaration *decl)
 {
     assert(fun_);
     fun_->push_decl(decl);
-
-    decl_[name] = decl;
 }
 
 Parser::Parser(Lexer &lexer, Code code, bool strict_mode)
@@ -253,7 +251,7 @@ Statement *Parser::parse_fun_decl()
     String name = parse_identifier_str(scope()->is_strict_mode());
 
     Expression *fun = parse_fun_lit(name, beg_pos);
-    scope()->push_decl(name, static_cast<FunctionLiteral *>(fun));     // FIXME: Maybe parse functions should return the appropriate types.
+    scope()->push_decl(static_cast<FunctionLiteral *>(fun));     // FIXME: Maybe parse functions should return the appropriate types.
 
     // FIXME: Reduce to single shared element.
     return new (GC)EmptyStatement();
@@ -431,7 +429,7 @@ Statement *Parser::parse_var_decl(bool no_in, String &var_name)
 
         VariableLiteral *var = new (GC)VariableLiteral(Location(beg_pos, end_pos), name);
 
-        scope()->push_decl(name, var);
+        scope()->push_decl(var);
 
         count++;
     } while (lexer_.peek() == Token::COMMA);
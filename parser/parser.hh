@@ -17,7 +17,6 @@
  */
 
 #pragma once
-#include <map>
 #include <vector>
 #include <gc/gc_allocator.h>
 #include "ast.hh"
@@ -52,10 +51,6 @@ private:
         FunctionLiteral *fun_;
         Code code_;
 
-        std::map<String, Declaration *,
-                 std::less<String>,
-                 gc_allocator<std::pair<String, Declaration *> > > decl_;   ///< Map for defining what's currently in scope.
-
     public:
         Scope(FunctionLiteral *fun, Code code)
             : fun_(fun)
@@ -71,7 +66,7 @@ private:
         bool is_eval_scope() const;
 
         void push_back(Statement *stmt);
-        void push_decl(String name, Declaration *decl);
+        void push_decl(Declaration *decl);
     };
 
     std::vector<Scope *, gc_allocator<Scope *> > scopes_;
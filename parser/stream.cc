@@ -18,6 +18,15 @@
 
 #include <algorithm>
 #include <fstream>
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_DARWIN)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "common/stringbuilder.hh"
 #include "common/unicode.hh"
 #include "exception.hh"
@@ -51,6 +60,80 @@ size_t StringStream::buffer_skip(size_t count)
     return to_skip;
 }
 
+AsciiStream::AsciiStream(const byte *data, size_t len)
+    : data_(NULL)
+{
+    data_ = new uni_char[len + 1];
+    for (size_t i = 0; i < len; i++)
+        data_[i] = data[i];
+    data_[len] = 0;
+
+    beg_ = data_;
+    cur_ = data_;
+    end_ = data_ + len;
+}
+
+AsciiStream::~AsciiStream()
+{
+    delete [] data_;
+}
+
+bool AsciiStream::internal_fetch()
+{
+    // All data is available in the buffer.
+    return false;
+}
+
+size_t AsciiStream::internal_skip(size_t count)
+{
+    size_t to_skip = static_cast<size_t>(end_ - cur_);
+    cur_ = end_;
+    pos_ += to_skip;
+    return to_skip;
+}
+
+void AsciiStream::internal_push(uni_char c)
+{
+    // Everything that has been read is still in the buffer, so we only get
+    // here when putting characters in front of the input. Make room by
+    // moving the data.
+    size_t len = static_cast<size_t>(end_ - data_);
+
+    uni_char *data = new uni_char[len + 2];
+    data[0] = c;
+    std::copy(data_, end_ + 1, data + 1);   // Including the terminator.
+    delete [] data_;
+
+    data_ = data;
+    beg_ = data_;
+    cur_ = data_;
+    end_ = data_ + len + 1;
+
+    if (pos_ > 0)
+        pos_--;
+}
+
+bool AsciiStream::is_ascii(const byte *data, size_t len)
+{
+    size_t i = 0;
+#ifdef __SSE2__
+    // Test the high bit of 16 bytes at a time.
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        if (_mm_movemask_epi8(chunk) != 0)
+            return false;
+    }
+#endif
+    for (; i < len; i++)
+    {
+        if (data[i] & 0x80)
+            return false;
+    }
+
+    return true;
+}
+
 Utf8Stream::Utf8Stream(const std::string &data)
     : data_(data)
     , data_len_(0)
@@ -87,7 +170,13 @@ size_t Utf8Stream::buffer_fill(size_t pos, size_t len)
     size_t to_read = pos + len > data_len_ ? data_len_ - pos : len;
 
     for (size_t i = 0; i < to_read; i++)
-        buf_[i] = utf8_dec(ptr);
+    {
+        // Fast path for ASCII characters.
+        if (*ptr < 0x80)
+            buf_[i] = *ptr++;
+        else
+            buf_[i] = utf8_dec(ptr);
+    }
 
     next_ptr_ = ptr;
     next_pos_ = pos + to_read;
@@ -164,34 +253,111 @@ size_t Utf16Stream::buffer_skip(size_t count)
     return to_skip;
 }
 
-UnicodeStream *StreamFactory::from_file(const char *file_path)
+/**
+ * @brief Read-only view of a file's contents.
+ */
+class SourceFile
 {
-    // Read file contents.
-    std::ifstream file(file_path);
-    if (!file.is_open())
-        THROW(FileException, StringBuilder::sprintf("unable to open source file '%s' for reading.", file_path));
+private:
+    const byte *data_;
+    size_t size_;
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_DARWIN)
+    void *map_;
+#else
+    std::string buf_;
+#endif
+
+public:
+    SourceFile(const char *file_path)
+        : data_(NULL)
+        , size_(0)
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_DARWIN)
+        , map_(MAP_FAILED)
+#endif
+    {
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_DARWIN)
+        int fd = open(file_path, O_RDONLY);
+        if (fd == -1)
+            THROW(FileException, StringBuilder::sprintf("unable to open source file '%s' for reading.", file_path));
+
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            close(fd);
+            THROW(FileException, StringBuilder::sprintf("unable to open source file '%s' for reading.", file_path));
+        }
+
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0)
+        {
+            map_ = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map_ == MAP_FAILED)
+            {
+                close(fd);
+                THROW(FileException, StringBuilder::sprintf("unable to read source file '%s'.", file_path));
+            }
+
+            madvise(map_, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const byte *>(map_);
+        }
+
+        close(fd);
+#else
+        std::ifstream file(file_path);
+        if (!file.is_open())
+            THROW(FileException, StringBuilder::sprintf("unable to open source file '%s' for reading.", file_path));
+
+        file.seekg(0, std::ios::end);
+        buf_.reserve(file.tellg());
+        file.seekg(0, std::ios::beg);
+
+        buf_.assign(std::istreambuf_iterator<char>(file),
+                    std::istreambuf_iterator<char>());
+
+        data_ = reinterpret_cast<const byte *>(buf_.data());
+        size_ = buf_.size();
+#endif
+    }
+
+    ~SourceFile()
+    {
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_DARWIN)
+        if (map_ != MAP_FAILED)
+            munmap(map_, size_);
+#endif
+    }
+
+    const byte *data() const { return data_; }
+    size_t size() const { return size_; }
+};
 
-    file.seekg(0, std::ios::end);   
-    std::string str;
-    str.reserve(file.tellg());
-    file.seekg(0, std::ios::beg);
+UnicodeStream *StreamFactory::from_file(const char *file_path)
+{
+    SourceFile file(file_path);
 
-    str.assign(std::istreambuf_iterator<char>(file),
-               std::istreambuf_iterator<char>());
+    const byte *data = file.data();
+    size_t size = file.size();
 
     byte bom[4] = { 0x00,0x00,0x00,0x00 };
-    for (int i = 0; i < std::min(4, static_cast<int>(str.size())); i++)
-        bom[i] = static_cast<byte>(str[i]);
+    for (size_t i = 0; i < std::min(static_cast<size_t>(4), size); i++)
+        bom[i] = data[i];
 
     // Look for BOM.
     if (bom[0] == 0xfe && bom[1] == 0xff)                           // UTF-16 (BE)
-        return new Utf16Stream(Utf16Stream::ENDIAN_BIG, str.substr(2));
+        return new Utf16Stream(Utf16Stream::ENDIAN_BIG, std::string(reinterpret_cast<const char *>(data + 2), size - 2));
     else if (bom[0] == 0xff && bom[1] == 0xfe)                      // UTF-16 (LE)
-        return new Utf16Stream(Utf16Stream::ENDIAN_LITTLE, str.substr(2));
+        return new Utf16Stream(Utf16Stream::ENDIAN_LITTLE, std::string(reinterpret_cast<const char *>(data + 2), size - 2));
     else if (bom[0] == 0xef && bom[1] == 0xbb && bom[2] == 0xbf)    // UTF-8
-        return new Utf8Stream(str.substr(3));
+    {
+        data += 3;
+        size -= 3;
+    }
+
+    // Plain ASCII doesn't need any decoding.
+    if (AsciiStream::is_ascii(data, size))
+        return new AsciiStream(data, size);
 
-    return new Utf8Stream(str);
+    return new Utf8Stream(std::string(reinterpret_cast<const char *>(data), size));
 }
 
 }
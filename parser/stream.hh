@@ -32,15 +32,18 @@ protected:
 
 protected:
     size_t pos_;
+    uni_char *beg_;     ///< Characters may be pushed back as long as cur_ > beg_.
     uni_char *cur_;
     uni_char *end_;
 
     virtual bool internal_fetch() = 0;
     virtual size_t internal_skip(size_t count) = 0;
+    virtual void internal_push(uni_char c) = 0;
 
 public:
     UnicodeStream()
         : pos_(0)
+        , beg_(NULL)
         , cur_(NULL)
         , end_(NULL) {}
 
@@ -77,7 +80,25 @@ public:
         return internal_skip(count);
     }
 
-    virtual void push(uni_char c) = 0;
+    inline void push(uni_char c)
+    {
+        // Since we allow reading past the buffer we must allow putting
+        // non-existing items back.
+        if (c == EOI)
+        {
+            pos_--;
+            return;
+        }
+
+        if (cur_ > beg_)
+        {
+            *(--cur_) = c;
+            pos_--;
+            return;
+        }
+
+        internal_push(c);
+    }
 };
 
 template <size_t S>
@@ -89,6 +110,7 @@ protected:
 
     virtual bool internal_fetch() override
     {
+        beg_ = buf_;
         cur_ = buf_;
 
         if (push_limit_ != NULL)
@@ -114,24 +136,8 @@ protected:
     virtual size_t buffer_fill(size_t pos, size_t len) = 0;
     virtual size_t buffer_skip(size_t count) = 0;
 
-public:
-    BufferedUnicodeStream()
-        : push_limit_(NULL)
-    {
-        cur_ = buf_;
-        end_ = buf_;
-    }
-
-    virtual void push(uni_char c) override
+    virtual void internal_push(uni_char c) override
     {
-        // Since we allow reading past the buffer we must allow putting
-        // non-existing items back.
-        if (c == EOI)
-        {
-            pos_--;
-            return;
-        }
-
         if (push_limit_ == NULL && cur_ > buf_)
         {
             *(--cur_) = c;
@@ -158,9 +164,57 @@ public:
 
             pos_--;
         }
+
+        // Pushing characters in front of a push limit must go through
+        // internal_push() to update the limit.
+        beg_ = push_limit_ == NULL ? buf_ : buf_ + S;
+    }
+
+public:
+    BufferedUnicodeStream()
+        : push_limit_(NULL)
+    {
+        beg_ = buf_;
+        cur_ = buf_;
+        end_ = buf_;
     }
 };
 
+/**
+ * @brief Stream over ASCII data.
+ *
+ * The complete input is decoded into one contiguous buffer up front, which
+ * means that reading never needs to refill any buffer.
+ */
+class AsciiStream : public UnicodeStream
+{
+private:
+    uni_char *data_;
+
+protected:
+    virtual bool internal_fetch() override;
+    virtual size_t internal_skip(size_t count) override;
+    virtual void internal_push(uni_char c) override;
+
+public:
+    /**
+     * Constructs a new ASCII stream.
+     * @param [in] data Pointer to ASCII data.
+     * @param [in] len Length of data in bytes.
+     * @pre data only contains ASCII characters.
+     */
+    AsciiStream(const byte *data, size_t len);
+    virtual ~AsciiStream();
+
+    /**
+     * Checks if a buffer only contains ASCII characters.
+     * @param [in] data Pointer to data.
+     * @param [in] len Length of data in bytes.
+     * @return true if all characters in data are ASCII characters.
+     */
+    static bool is_ascii(const byte *data, size_t len);
+};
+
 class StringStream : public BufferedUnicodeStream<1024>
 {
 private:
@@ -227,7 +281,8 @@ class StreamFactory
 {
 public:
     /**
-     * Creates a Unicode stream from a file.
+     * Creates a Unicode stream from a file. Files only containing ASCII
+     * characters are read through an AsciiStream.
      * @param [in] file_path Path to source file.
      * @return Pointer to Unicode stream.
      * @throw FileException if unable to open and read the file.
@@ -360,7 +360,7 @@ namespace algorithm
         if (val.is_object())
         {
             EsObject *val_obj = val.as_object();
-            if (val_obj->class_name() == _USTR("Array"))
+            if (val_obj->class_id() == EsObject::CLASS_ARRAY)
             {
                 EsValue len;
                 if (!val_obj->getT(property_keys.length, len))
@@ -369,8 +369,8 @@ namespace algorithm
                 for (uint32_t i = 0; i < len.primitive_to_uint32(); i++)
                 {
                     EsValue new_elem;
-                    if (!json_walkT(EsString::create_from_utf8(
-                            std::to_string(i)), val_obj, reviver, new_elem))
+                    if (!json_walkT(es_uint_to_str(i), val_obj, reviver,
+                                    new_elem))
                         return false;
 
                     if (new_elem.is_undefined())
@@ -393,7 +393,7 @@ namespace algorithm
                     EsPropertyKey key = *it;
 
                     EsPropertyReference prop = val_obj->get_property(key);
-                    if (!prop->is_enumerable())
+                    if (!prop.is_element() && !prop->is_enumerable())
                         continue;
 
                     EsValue new_elem;
@@ -425,26 +425,139 @@ namespace algorithm
         return true;
     }
 
+    /**
+     * Checks if the JSON stack contains the specified object.
+     * @param [in] state Internal state.
+     * @param [in] val Object to look for.
+     * @return true if val is being serialized, false if not.
+     */
+    static bool json_stack_contains(const JsonState &state, const EsObject *val)
+    {
+        EsValueVector::const_iterator it;
+        for (it = state.stack.begin(); it != state.stack.end(); ++it)
+        {
+            const EsValue &cur_val = *it;
+            if (cur_val.is_object() && cur_val.as_object() == val)
+                return true;
+        }
+
+        return false;
+    }
+
+    /**
+     * Writes a line break followed by the specified indentation if a gap has
+     * been specified.
+     * @param [in] state Internal state.
+     * @param [in] indent Indentation to write.
+     * @param [in,out] sb String builder to write to.
+     */
+    static void json_newline(const JsonState &state, const EsString *indent,
+                             EsStringBuilder &sb)
+    {
+        if (!state.gap->empty())
+        {
+            sb.append('\n');
+            sb.append(indent);
+        }
+    }
+
     bool json_strT(const EsString *key, EsObject *holder, JsonState &state,
                   EsValue &result)
     {
+        EsPropertyKey prop_key = EsPropertyKey::from_str(key);
+
         EsValue val;
-        if (!holder->getT(EsPropertyKey::from_str(key), val))
+        if (!holder->getT(prop_key, val))
             return false;
 
-        if (val.is_object())
+        if (!json_prepareT(prop_key, holder, state, val))
+            return false;
+
+        if (!json_is_serializable(val))
+        {
+            result = EsValue::undefined;
+            return true;
+        }
+
+        EsStringBuilder sb;
+        if (!json_serializeT(val, state, sb))
+            return false;
+
+        result = EsValue::from_str(sb.string());
+        return true;
+    }
+
+    /**
+     * @return true if the properties of @a obj are found through its map
+     *         only, which is the case for arrays and plain objects.
+     */
+    static bool json_is_plain(EsObject *obj)
+    {
+        return obj->class_id() == EsObject::CLASS_OBJECT ||
+               obj->class_id() == EsObject::CLASS_ARRAY;
+    }
+
+    /**
+     * @return true if @a obj and its prototypes have the same structure as
+     *         the last object found to have no toJSON property.
+     */
+    static bool json_lacks_to_json(EsObject *obj, const JsonState &state)
+    {
+        size_t i = 0;
+        for (; obj; obj = obj->prototype(), i++)
+        {
+            if (i == state.num_no_to_json_ids || !json_is_plain(obj) ||
+                obj->map().id() != state.no_to_json_ids[i])
+                return false;
+        }
+
+        return i == state.num_no_to_json_ids;
+    }
+
+    /**
+     * Remembers the structure of @a obj and its prototypes after finding that
+     * it has no toJSON property.
+     */
+    static void json_set_lacks_to_json(EsObject *obj, JsonState &state)
+    {
+        size_t i = 0;
+        for (; obj; obj = obj->prototype(), i++)
+        {
+            if (i == JsonState::MAX_NO_TO_JSON_IDS || !json_is_plain(obj))
+            {
+                state.num_no_to_json_ids = 0;
+                return;
+            }
+
+            state.no_to_json_ids[i] = obj->map().id();
+        }
+
+        state.num_no_to_json_ids = i;
+    }
+
+    bool json_prepareT(EsPropertyKey key, EsObject *holder, JsonState &state,
+                       EsValue &val)
+    {
+        if (val.is_object() && !json_lacks_to_json(val.as_object(), state))
         {
             EsObject *val_obj = val.as_object();
 
+            EsPropertyReference to_json_prop;
+            if (!val_obj->getT(property_keys.to_json, to_json_prop))
+                return false;
+
+            if (!to_json_prop)
+                json_set_lacks_to_json(val_obj, state);
+
             EsValue to_json;
-            if (!val_obj->getT(property_keys.to_json, to_json))
+            if (!val_obj->get_resolveT(to_json_prop, to_json))
                 return false;
 
             if (to_json.is_callable())
             {
                 EsCallFrame frame = EsCallFrame::push_function(
                     1, to_json.as_function(), val);
-                frame.fp()[0].set_str(key);
+                frame.fp()[0].set_str(key.to_string());
 
                 if (!to_json.as_function()->callT(frame))
                     return false;
@@ -457,7 +570,7 @@ namespace algorithm
         {
             EsCallFrame frame = EsCallFrame::push_function(
                 2, state.replacer_fun, EsValue::from_obj(holder));
-            frame.fp()[0].set_str(key);
+            frame.fp()[0].set_str(key.to_string());
             frame.fp()[1] = val;
 
             if (!state.replacer_fun->callT(frame))
@@ -470,157 +583,144 @@ namespace algorithm
         {
             EsObject *val_obj = val.as_object();
 
-            // Note: this code has been optimized to return early compared to
-            //       what the specification states.
-            if (val_obj->class_name() == _USTR("Number"))
+            if (val_obj->class_id() == EsObject::CLASS_NUMBER)
             {
                 double num = 0.0;
                 if (!val.to_numberT(num))
                     return false;
 
-                result = EsValue::from_str(std::isfinite(num)
-                    ? es_num_to_str(num)
-                    : _ESTR("null"));
-                return true;
+                val = EsValue::from_num(num);
             }
-            if (val_obj->class_name() == _USTR("String"))
+            else if (val_obj->class_id() == EsObject::CLASS_STRING)
             {
                 const EsString *str = val.to_stringT();
                 if (!str)
                     return false;
 
-                result = EsValue::from_str(json_quote(str));
-                return true;
+                val = EsValue::from_str(str);
             }
-            if (EsBooleanObject *bool_obj = dynamic_cast<EsBooleanObject *>(val_obj))
+            else if (EsBooleanObject *bool_obj = dynamic_cast<EsBooleanObject *>(val_obj))
             {
-                result = EsValue::from_str(bool_obj->primitive_value()
-                    ? _ESTR("true")
-                    : _ESTR("false"));
-                return true;
+                val = EsValue::from_bool(bool_obj->primitive_value());
             }
         }
 
+        return true;
+    }
+
+    bool json_is_serializable(const EsValue &val)
+    {
+        return !val.is_undefined() && !val.is_callable();
+    }
+
+    bool json_serializeT(const EsValue &val, JsonState &state,
+                         EsStringBuilder &sb)
+    {
+        assert(json_is_serializable(val));
+
         if (val.is_null())
         {
-            result = EsValue::from_str(_ESTR("null"));
+            sb.append("null");
             return true;
         }
 
         if (val.is_boolean())
         {
-            result = EsValue::from_str(val.as_boolean()
-                ? _ESTR("true")
-                : _ESTR("false"));
+            sb.append(val.as_boolean() ? "true" : "false");
             return true;
         }
         else if (val.is_string())
         {
-            result = EsValue::from_str(json_quote(val.as_string()));
+            json_quote(val.as_string(), sb);
             return true;
         }
         else if (val.is_number())
         {
-            result = EsValue::from_str(std::isfinite(val.as_number())
-                ? es_num_to_str(val.as_number())
-                : _ESTR("null"));
+            if (std::isfinite(val.as_number()))
+                sb.append(es_num_to_str(val.as_number()));
+            else
+                sb.append("null");
             return true;
         }
 
-        if (val.is_object())
-        {
-            EsObject *val_obj = val.as_object();
-
-            if (!val.is_callable())
-            {
-                if (val_obj->class_name() == _USTR("Array"))
-                    return json_jaT(val_obj, state, result);
-                else
-                    return json_joT(val_obj, state, result);
-            }
-        }
+        assert(val.is_object());
+        EsObject *val_obj = val.as_object();
 
-        result = EsValue::undefined;
-        return true;
+        if (val_obj->class_id() == EsObject::CLASS_ARRAY)
+            return json_jaT(val_obj, state, sb);
+        else
+            return json_joT(val_obj, state, sb);
     }
 
-    const EsString *json_quote(const EsString *val)
+    /**
+     * Table of characters that must be escaped in JSON strings. Zero means
+     * that the character can be copied as is, other values are the character
+     * to write after the escaping backslash, or 'u' for unicode escapes.
+     */
+    static const char json_escape_table[128] =
     {
-        EsStringBuilder product;
-        product.append('"');
+        'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+        'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+        'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+        'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+        0,   0,   '"', 0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   '\\', 0,  0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0,
+    };
+
+    void json_quote(const EsString *val, EsStringBuilder &sb)
+    {
+        static const char hex_digits[] = "0123456789abcdef";
+
+        sb.append('"');
 
-        for (size_t i = 0; i < val->length(); i++)
+        const uni_char *ptr = val->data();
+        const uni_char *end = ptr + val->length();
+        while (ptr < end)
         {
-            uni_char c = val->at(i);
-            switch (c)
+            // Copy the longest run of characters that don't need escaping in
+            // one go.
+            const uni_char *run = ptr;
+            while (ptr < end && (*ptr >= 128 || !json_escape_table[*ptr]))
+                ptr++;
+
+            if (ptr > run)
+                sb.append(run, ptr - run);
+
+            if (ptr == end)
+                break;
+
+            uni_char c = *ptr++;
+            char esc = json_escape_table[c];
+
+            sb.append('\\');
+            sb.append(static_cast<uni_char>(esc));
+            if (esc == 'u')
             {
-                case '"':
-                case '\\':
-                    product.append('\\');
-                    product.append(c);
-                    break;
-
-                case '\b':
-                    product.append("\\b");
-                    break;
-
-                case '\f':
-                    product.append("\\f");
-                    break;
-
-                case '\n':
-                    product.append("\\n");
-                    break;
-
-                case '\r':
-                    product.append("\\r");
-                    break;
-
-                case '\t':
-                    product.append("\\t");
-                    break;
-
-                default:
-                    if (c < ' ')
-                    {
-                        product.append('\\');
-                        product.append('u');
-                        product.append(
-                                EsStringBuilder::sprintf("%.4x",
-                                        static_cast<int>(c)));
-                    }
-                    else
-                    {
-                        product.append(c);
-                    }
-                    break;
+                sb.append("00");
+                sb.append(static_cast<uni_char>(hex_digits[c >> 4]));
+                sb.append(static_cast<uni_char>(hex_digits[c & 0xf]));
             }
         }
 
-        product.append('"');
-        return product.string();
+        sb.append('"');
     }
 
-    bool json_jaT(EsObject *val, JsonState &state, EsValue &result)
+    bool json_jaT(EsObject *val, JsonState &state, EsStringBuilder &sb)
     {
-        // FIXME: Why doesn't the following work?
-        /*if (std::find(stack.begin(), stack.end(), val) != stack.end())
+        if (json_stack_contains(state, val))
         {
-            ES_THROW(EsTypeError, "FIXME: cannot serialize json object, the structure is cyclical.");
+            ES_THROW(EsTypeError, _ESTR("FIXME: cannot serialize json object, the structure is cyclical."));
             return false;
-        }*/
-        {
-            EsValueVector::iterator it;
-            for (it = state.stack.begin(); it != state.stack.end(); ++it)
-            {
-                EsValue &cur_val = *it;
-
-                if (cur_val.is_object() && cur_val.as_object() == val)
-                {
-                    ES_THROW(EsTypeError, _ESTR("FIXME: cannot serialize json object, the structure is cyclical."));
-                    return false;
-                }
-            }
         }
 
         state.stack.push_back(EsValue::from_obj(val));
@@ -628,91 +728,56 @@ namespace algorithm
         const EsString *stepback = state.indent;
         state.indent = state.indent->concat(state.gap);
 
-        EsStringVector partial;
-
-        EsValue len;
-        if (!val->getT(property_keys.length, len))
+        EsValue len_val;
+        if (!val->getT(property_keys.length, len_val))
             return false;
 
-        for (uint32_t i = 0; i < len.primitive_to_uint32(); i++)
-        {
-            EsValue str_p;
-            if (!json_strT(EsString::create_from_utf8(
-                    std::to_string(i)), val, state, str_p))
-                return false;
-
-            if (str_p.is_undefined())
-            {
-                partial.push_back(_ESTR("null"));
-            }
-            else
-            {
-                const EsString *str = str_p.to_stringT();
-                if (!str)
-                    return false;
+        uint32_t len = len_val.primitive_to_uint32();
 
-                partial.push_back(str); // CUSTOM: to_stringL.
-            }
-        }
+        // Elements in packed storage can be read without looking them up.
+        EsArray *arr = val->class_id() == EsObject::CLASS_ARRAY
+            ? safe_cast<EsArray *>(val) : NULL;
 
-        EsStringBuilder final;
-        if (partial.empty())
+        sb.append('[');
+        for (uint32_t i = 0; i < len; i++)
         {
-            final.append("[]");
-        }
-        else
-        {
-            const EsString *separator = NULL;
-            if (state.gap->empty())
-            {
-                separator = _ESTR(",");
-            }
-            else
-            {
-                separator = _ESTR(",\n");
-                separator = separator->concat(state.indent);
-            }
+            if (i > 0)
+                sb.append(',');
+            json_newline(state, state.indent, sb);
 
-            final.append('[');
+            EsPropertyKey key = EsPropertyKey::from_u32(i);
 
-            EsStringVector::const_iterator it;
-            for (it = partial.begin(); it != partial.end(); ++it)
+            EsValue elem;
+            if (!arr || !arr->get_element(i, elem))
             {
-                if (it != partial.begin())
-                    final.append(separator);
-
-                final.append(*it);
+                if (!val->getT(key, elem))
+                    return false;
             }
 
-            final.append(']');
+            if (!json_prepareT(key, val, state, elem))
+                return false;
+
+            if (!json_is_serializable(elem))
+                sb.append("null");
+            else if (!json_serializeT(elem, state, sb))
+                return false;
         }
 
+        if (len > 0)
+            json_newline(state, stepback, sb);
+        sb.append(']');
+
         state.stack.pop_back();
         state.indent = stepback;
-        result = EsValue::from_str(final.string());
         return true;
     }
 
-    bool json_joT(EsObject *val, JsonState &state, EsValue &result)
+    bool json_joT(EsObject *val, JsonState &state, EsStringBuilder &sb)
     {
-        // FIXME: Why doesn't the following work?
-        /*if (std::find(stack.begin(), stack.end(), val) != stack.end())
+        if (json_stack_contains(state, val))
         {
-            ES_THROW(EsTypeError, "FIXME: cannot serialize json object, the structure is cyclical.");
+            ES_THROW(EsTypeError, _ESTR("FIXME: cannot serialize json object, the structure is cyclical."));
             return false;
-        }*/
-        {
-            EsValueVector::iterator it;
-            for (it = state.stack.begin(); it != state.stack.end(); ++it)
-            {
-                EsValue &cur_val = *it;
-
-                if (cur_val.is_object() && cur_val.as_object() == val)
-                {
-                    ES_THROW(EsTypeError, _ESTR("FIXME: cannot serialize json object, the structure is cyclical."));
-                    return false;
-                }
-            }
         }
 
         state.stack.push_back(EsValue::from_obj(val));
@@ -720,10 +785,12 @@ namespace algorithm
         const EsString *stepback = state.indent;
         state.indent = state.indent->concat(state.gap);
 
-        EsStringVector k;
+        std::vector<EsPropertyKey> k;
         if (!state.prop_list.empty())   // NOTE: Emptiness used to test undefinedness.
         {
-            k = state.prop_list;
+            EsStringVector::const_iterator it;
+            for (it = state.prop_list.begin(); it != state.prop_list.end(); ++it)
+                k.push_back(EsPropertyKey::from_str(*it));
         }
         else
         {
@@ -733,76 +800,50 @@ namespace algorithm
                 EsPropertyKey key = *it;
 
                 EsPropertyReference prop = val->get_property(key);
-                if (!prop->is_enumerable())
+                if (!prop.is_element() && !prop->is_enumerable())
                     continue;
 
-                k.push_back(key.to_string());
+                k.push_back(key);
             }
         }
 
-        EsStringBuilder member;
+        bool empty = true;
 
-        EsStringVector partial;
-        for (EsStringVector::const_iterator it = k.begin(); it != k.end(); ++it)
+        sb.append('{');
+        for (std::vector<EsPropertyKey>::const_iterator it = k.begin(); it != k.end(); ++it)
         {
-            const EsString *p = *it;
+            EsPropertyKey key = *it;
 
-            EsValue str_p;
-            if (!json_strT(p, val, state, str_p))
+            EsValue prop_val;
+            if (!val->getT(key, prop_val))
                 return false;
 
-            if (!str_p.is_undefined())
-            {
-                member.clear();
-                member.append(json_quote(p));
-                member.append(':');
-                if (!state.gap->empty())
-                    member.append(' ');
+            if (!json_prepareT(key, val, state, prop_val))
+                return false;
 
-                const EsString *str = str_p.to_stringT();
-                if (!str)
-                    return false;
+            if (!json_is_serializable(prop_val))
+                continue;
 
-                member.append(str); // CUSTOM: to_stringL.
+            if (!empty)
+                sb.append(',');
+            json_newline(state, state.indent, sb);
+            empty = false;
 
-                partial.push_back(member.string());
-            }
-        }
+            json_quote(key.to_string(), sb);
+            sb.append(':');
+            if (!state.gap->empty())
+                sb.append(' ');
 
-        EsStringBuilder final;
-        if (partial.empty())
-        {
-            final.append("{}");
+            if (!json_serializeT(prop_val, state, sb))
+                return false;
         }
-        else
-        {
-            const EsString *separator = NULL;
-            if (state.gap->empty())
-            {
-                separator = _ESTR(",");
-            }
-            else
-            {
-                separator = _ESTR(",\n");
-                separator = separator->concat(state.indent);
-            }
 
-            final.append('{');
-
-            for (EsStringVector::const_iterator it = partial.begin(); it != partial.end(); ++it)
-            {
-                if (it != partial.begin())
-                    final.append(separator);
-
-                final.append(*it);
-            }
-
-            final.append('}');
-        }
+        if (!empty)
+            json_newline(state, stepback, sb);
+        sb.append('}');
 
         state.stack.pop_back();
         state.indent = stepback;
-        result = EsValue::from_str(final.string());
         return true;
     }
 }
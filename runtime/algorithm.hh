@@ -26,7 +26,9 @@
 
 class EsFunction;
 class EsObject;
+class EsPropertyKey;
 class EsRegExp;
+class EsStringBuilder;
 
 namespace algorithm
 {
@@ -42,7 +44,8 @@ namespace algorithm
 
     /**
      * @brief Keeps track of the state for the JSON stringify routine.
-     * @see json_str, json_quote, json_ja and json_jo.
+     * @see json_str, json_prepare, json_serialize, json_quote, json_ja and
+     *      json_jo.
      */
     struct JsonState
     {
@@ -52,10 +55,22 @@ namespace algorithm
         EsFunction *replacer_fun;   ///< Replacer function, NULL means undefined.
         EsValueVector stack;
 
+        /** Maximum length of prototype chains in no_to_json_ids, enough for
+         * arrays and plain objects. */
+        static const size_t MAX_NO_TO_JSON_IDS = 3;
+
+        /** Map identifiers of the last object found to have no toJSON
+         * property, followed by the identifiers of its prototypes. Objects
+         * with the same structure along the prototype chain can't have a
+         * toJSON property either. */
+        uintptr_t no_to_json_ids[MAX_NO_TO_JSON_IDS];
+        size_t num_no_to_json_ids;
+
         JsonState()
             : indent(EsString::create())
             , gap(EsString::create())
-            , replacer_fun(NULL) {}
+            , replacer_fun(NULL)
+            , num_no_to_json_ids(0) {}
     };
 
     /**
@@ -157,29 +172,63 @@ namespace algorithm
     bool json_strT(const EsString *key, EsObject *holder, JsonState &state,
                    EsValue &result);
 
+    /**
+     * Applies the toJSON and replacer function transformations, and unwraps
+     * Number, String and Boolean objects, according to steps 2-4 of the JSON
+     * string conversion algorithm in 15.12.3.
+     * @param [in] key Key property name.
+     * @param [in] holder Holder object.
+     * @param [in,out] state Internal state, must be initialized by caller.
+     * @param [in,out] val Value of the key property in holder, will be
+     *                     replaced by the value to serialize.
+     * @return true on normal return, false if an exception was thrown.
+     */
+    bool json_prepareT(EsPropertyKey key, EsObject *holder, JsonState &state,
+                       EsValue &val);
+
+    /**
+     * Checks if a value returned from json_prepareT() has a JSON
+     * representation.
+     * @param [in] val Prepared value.
+     * @return true if val can be serialized, false if the JSON string
+     *         conversion algorithm would result in undefined.
+     */
+    bool json_is_serializable(const EsValue &val);
+
+    /**
+     * Implements steps 5-11 of the JSON string conversion algorithm according
+     * to 15.12.3.
+     * @param [in] val Prepared value, must be serializable.
+     * @param [in,out] state Internal state, must be initialized by caller.
+     * @param [in,out] sb String builder to append the JSON expression to.
+     * @return true on normal return, false if an exception was thrown.
+     */
+    bool json_serializeT(const EsValue &val, JsonState &state,
+                         EsStringBuilder &sb);
+
     /**
      * Implements the JSON string quote wrapping algorithm according to
      * 15.12.3.
      * @param [in] val String to wrap and escape.
-     * @return val with escaped content wrapped in quotes.
+     * @param [in,out] sb String builder to append the quoted string to.
      */
-    const EsString *json_quote(const EsString *val);
+    void json_quote(const EsString *val, EsStringBuilder &sb);
 
     /**
      * Implements the JSON array serialization algorithm according to 15.12.3.
      * @param [in] val Array object to serialize.
      * @param [in,out] state Internal state, must be initialized by caller.
-     * @param [out] result val serialized to a string.
+     * @param [in,out] sb String builder to append the serialized array to.
      * @return true on normal return, false if an exception was thrown.
      */
-    bool json_jaT(EsObject *val, JsonState &state, EsValue &result);
+    bool json_jaT(EsObject *val, JsonState &state, EsStringBuilder &sb);
 
     /**
      * Implements the JSON object serialization algorithm according to 15.12.3.
      * @param [in] val Object to serialize.
      * @param [in,out] state Internal state, must be initialized by caller.
-     * @param [out] result val serialized to a string.
+     * @param [in,out] sb String builder to append the serialized object to.
      * @return true on normal return, false if an exception was thrown.
      */
-    bool json_joT(EsObject *val, JsonState &state, EsValue &result);
+    bool json_joT(EsObject *val, JsonState &state, EsStringBuilder &sb);
 }
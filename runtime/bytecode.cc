@@ -0,0 +1,1581 @@
+/*
+ * descripten - ECMAScript to native compiler
+ * Copyright (C) 2011-2014 Christian Kindahl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <gc_cpp.h>
+#include "common/conversion.hh"
+#include "bytecode.hh"
+#include "conversion.hh"
+#include "property_key.hh"
+#include "resolver.hh"
+#include "string.hh"
+
+using parser::ArrayLiteral;
+using parser::AssignmentExpression;
+using parser::BinaryExpression;
+using parser::BlockStatement;
+using parser::BoolLiteral;
+using parser::BreakStatement;
+using parser::CallExpression;
+using parser::CallNewExpression;
+using parser::ConditionalExpression;
+using parser::ContinueStatement;
+using parser::DebuggerStatement;
+using parser::Declaration;
+using parser::DeclarationVector;
+using parser::DoWhileStatement;
+using parser::EmptyStatement;
+using parser::Expression;
+using parser::ExpressionStatement;
+using parser::ExpressionVector;
+using parser::ForInStatement;
+using parser::ForStatement;
+using parser::FunctionExpression;
+using parser::FunctionLiteral;
+using parser::IdentifierLiteral;
+using parser::IfStatement;
+using parser::LabeledStatement;
+using parser::NothingLiteral;
+using parser::NullLiteral;
+using parser::NumberLiteral;
+using parser::ObjectLiteral;
+using parser::PropertyExpression;
+using parser::RegularExpression;
+using parser::ReturnStatement;
+using parser::Statement;
+using parser::StatementVector;
+using parser::StringLiteral;
+using parser::SwitchStatement;
+using parser::ThisLiteral;
+using parser::ThrowStatement;
+using parser::TryStatement;
+using parser::UnaryExpression;
+using parser::VariableLiteral;
+using parser::WhileStatement;
+using parser::WithStatement;
+
+EsBytecode::EsBytecode()
+    : num_temps_(0)
+    , caches_(NULL)
+    , num_caches_(0)
+{
+}
+
+uint32_t EsBytecode::num_operands(Opcode op)
+{
+    static const uint32_t num_operands[] =
+    {
+#define ES_OPCODE_NUM_OPERANDS(name, num_operands) num_operands,
+        ES_OPCODES(ES_OPCODE_NUM_OPERANDS)
+#undef ES_OPCODE_NUM_OPERANDS
+    };
+
+    assert(op < NUM_OPCODES);
+    return num_operands[op];
+}
+
+const char *EsBytecode::name(Opcode op)
+{
+    static const char *names[] =
+    {
+#define ES_OPCODE_NAME(name, num_operands) #name,
+        ES_OPCODES(ES_OPCODE_NAME)
+#undef ES_OPCODE_NAME
+    };
+
+    assert(op < NUM_OPCODES);
+    return names[op];
+}
+
+int64_t EsBytecode::handler(uint32_t pc) const
+{
+    // Handler ranges are emitted in code order and never overlap.
+    HandlerVector::const_iterator it = std::upper_bound(
+        handlers_.begin(), handlers_.end(), pc,
+        [](uint32_t pc, const Handler &handler)
+        {
+            return pc < handler.begin;
+        });
+
+    if (it == handlers_.begin())
+        return -1;
+
+    --it;
+    return pc < it->end ? static_cast<int64_t>(it->target) : -1;
+}
+
+BytecodeCompiler::BytecodeCompiler()
+    : code_(NULL)
+    , next_reg_(0)
+    , max_reg_(0)
+    , completion_(-1)
+    , range_handler_(-1)
+    , range_begin_(0)
+{
+}
+
+int BytecodeCompiler::alloc_reg()
+{
+    int reg = next_reg_++;
+    max_reg_ = std::max(max_reg_, next_reg_);
+    return reg;
+}
+
+int BytecodeCompiler::target(int dst)
+{
+    return dst < 0 ? alloc_reg() : dst;
+}
+
+int BytecodeCompiler::move(int dst, int src)
+{
+    if (dst < 0 || dst == src)
+        return src;
+
+    emit(EsBytecode::OP_MOV, dst, src);
+    return dst;
+}
+
+int BytecodeCompiler::constant(EsValueData val)
+{
+    IndexMap::const_iterator it = num_consts_.find(val.data.bits);
+    if (it != num_consts_.end())
+        return REG_CONSTANT | it->second;
+
+    int index = static_cast<int>(code_->constants_.size());
+    code_->constants_.push_back(val);
+    num_consts_.insert(std::make_pair(val.data.bits, index));
+    return REG_CONSTANT | index;
+}
+
+int BytecodeCompiler::constant(const String &str)
+{
+    StringIndexMap::const_iterator it = str_consts_.find(str);
+    if (it != str_consts_.end())
+        return REG_CONSTANT | it->second;
+
+    int index = static_cast<int>(code_->constants_.size());
+    code_->constants_.push_back(es_value_from_string(EsString::create(str)));
+    str_consts_.insert(std::make_pair(str, index));
+    return REG_CONSTANT | index;
+}
+
+uint32_t BytecodeCompiler::key(const EsString *str)
+{
+    uint64_t raw_key = EsPropertyKey::from_str(str).as_raw();
+
+    IndexMap::const_iterator it = keys_.find(raw_key);
+    if (it != keys_.end())
+        return static_cast<uint32_t>(it->second);
+
+    int index = static_cast<int>(code_->keys_.size());
+    code_->keys_.push_back(raw_key);
+    keys_.insert(std::make_pair(raw_key, index));
+    return static_cast<uint32_t>(index);
+}
+
+uint32_t BytecodeCompiler::cache()
+{
+    return code_->num_caches_++;
+}
+
+uint32_t BytecodeCompiler::site(IdentifierLiteral *lit)
+{
+    assert(lit->site());
+
+    code_->sites_.push_back(static_cast<EsIdentifierSite *>(lit->site()));
+    return static_cast<uint32_t>(code_->sites_.size() - 1);
+}
+
+int BytecodeCompiler::new_label()
+{
+    labels_.push_back(-1);
+    return static_cast<int>(labels_.size() - 1);
+}
+
+void BytecodeCompiler::bind(int label)
+{
+    assert(labels_[label] == -1);
+    labels_[label] = static_cast<int>(code_->code_.size());
+}
+
+void BytecodeCompiler::update_handler_range()
+{
+    int handler = handlers_.empty() ? -1 : handlers_.back();
+    if (handler == range_handler_)
+        return;
+
+    uint32_t pc = static_cast<uint32_t>(code_->code_.size());
+    if (range_handler_ != -1 && pc > range_begin_)
+    {
+        // The target is resolved once all labels have been bound.
+        EsBytecode::Handler range = { range_begin_, pc,
+                                      static_cast<uint32_t>(range_handler_) };
+        code_->handlers_.push_back(range);
+    }
+
+    range_handler_ = handler;
+    range_begin_ = pc;
+}
+
+void BytecodeCompiler::emit_op(EsBytecode::Opcode op)
+{
+    update_handler_range();
+    code_->code_.push_back(op);
+}
+
+void BytecodeCompiler::emit_reg(int reg)
+{
+    assert(reg >= 0);
+    if (reg & REG_CONSTANT)
+    {
+        const_fixups_.push_back(static_cast<int>(code_->code_.size()));
+        reg &= ~REG_CONSTANT;
+    }
+
+    code_->code_.push_back(static_cast<uint32_t>(reg));
+}
+
+void BytecodeCompiler::emit_imm(uint32_t imm)
+{
+    code_->code_.push_back(imm);
+}
+
+void BytecodeCompiler::emit_label(int label)
+{
+    label_fixups_.push_back(std::make_pair(
+        static_cast<uint32_t>(code_->code_.size()), label));
+    code_->code_.push_back(0);
+}
+
+void BytecodeCompiler::emit(EsBytecode::Opcode op)
+{
+    assert(EsBytecode::num_operands(op) == 0);
+    emit_op(op);
+}
+
+void BytecodeCompiler::emit(EsBytecode::Opcode op, int r0)
+{
+    assert(EsBytecode::num_operands(op) == 1);
+    emit_op(op);
+    emit_reg(r0);
+}
+
+void BytecodeCompiler::emit(EsBytecode::Opcode op, int r0, int r1)
+{
+    assert(EsBytecode::num_operands(op) == 2);
+    emit_op(op);
+    emit_reg(r0);
+    emit_reg(r1);
+}
+
+void BytecodeCompiler::emit(EsBytecode::Opcode op, int r0, int r1, int r2)
+{
+    assert(EsBytecode::num_operands(op) == 3);
+    emit_op(op);
+    emit_reg(r0);
+    emit_reg(r1);
+    emit_reg(r2);
+}
+
+void BytecodeCompiler::emit_jump(EsBytecode::Opcode op, int label)
+{
+    assert(EsBytecode::num_operands(op) == 1);
+    emit_op(op);
+    emit_label(label);
+}
+
+void BytecodeCompiler::emit_jump(EsBytecode::Opcode op, int cond, int label)
+{
+    assert(EsBytecode::num_operands(op) == 2);
+    emit_op(op);
+    emit_reg(cond);
+    emit_label(label);
+}
+
+void BytecodeCompiler::emit_load(IdentifierLiteral *lit, int dst)
+{
+    if (lit->is_resolved())
+    {
+        emit_op(EsBytecode::OP_LD_SLOT);
+        emit_reg(dst);
+        emit_imm(static_cast<uint32_t>(lit->depth()));
+        emit_imm(static_cast<uint32_t>(lit->slot()));
+        emit_imm(site(lit));
+    }
+    else
+    {
+        emit_op(EsBytecode::OP_LD_NAME);
+        emit_reg(dst);
+        emit_imm(site(lit));
+    }
+}
+
+void BytecodeCompiler::emit_store(IdentifierLiteral *lit, int src)
+{
+    if (lit->is_resolved())
+    {
+        emit_op(EsBytecode::OP_ST_SLOT);
+        emit_imm(static_cast<uint32_t>(lit->depth()));
+        emit_imm(static_cast<uint32_t>(lit->slot()));
+        emit_reg(src);
+        emit_imm(site(lit));
+    }
+    else
+    {
+        emit_op(EsBytecode::OP_ST_NAME);
+        emit_imm(site(lit));
+        emit_reg(src);
+    }
+}
+
+void BytecodeCompiler::emit_epilogue(size_t index)
+{
+    // Copy, the scope vector is modified while inlining finally blocks.
+    Scope scope = scopes_[index];
+
+    switch (scope.kind_)
+    {
+        case Scope::KIND_LEAVE:
+            emit(EsBytecode::OP_LEAVE);
+            break;
+
+        case Scope::KIND_FINALLY:
+        {
+            // The finally block is executed in the scope of the try statement,
+            // exceptions thrown by it are handled outside of the statement.
+            ScopeVector scopes(scopes_);
+            scopes_.erase(scopes_.begin() + index, scopes_.end());
+            handlers_.push_back(scope.handler_);
+
+            compile_finally(scope.finally_);
+
+            handlers_.pop_back();
+            scopes_ = scopes;
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+int BytecodeCompiler::unroll_for_continue(const LabeledStatement *target)
+{
+    for (size_t i = scopes_.size(); i-- > 0; )
+    {
+        const Scope &scope = scopes_[i];
+        if (scope.kind_ == Scope::KIND_ITERATION &&
+            (!target || scope.stmt_ == target))
+        {
+            return scope.cnt_;
+        }
+
+        emit_epilogue(i);
+    }
+
+    assert(false);
+    return -1;
+}
+
+int BytecodeCompiler::unroll_for_break(const LabeledStatement *target)
+{
+    for (size_t i = scopes_.size(); i-- > 0; )
+    {
+        const Scope &scope = scopes_[i];
+        if (target ? scope.stmt_ == target
+                   : (scope.kind_ == Scope::KIND_ITERATION ||
+                      scope.kind_ == Scope::KIND_SWITCH))
+        {
+            return scope.brk_;
+        }
+
+        emit_epilogue(i);
+    }
+
+    assert(false);
+    return -1;
+}
+
+void BytecodeCompiler::unroll_for_return()
+{
+    for (size_t i = scopes_.size(); i-- > 0; )
+        emit_epilogue(i);
+}
+
+const EsString *BytecodeCompiler::constant_key(Expression *expr)
+{
+    if (StringLiteral *str = dynamic_cast<StringLiteral *>(expr))
+        return EsString::create(str->value());
+
+    // The property name of a number is its canonical string representation,
+    // not its source text.
+    if (NumberLiteral *num = dynamic_cast<NumberLiteral *>(expr))
+        return es_num_to_str(es_str_to_num(EsString::create(num->as_string())));
+
+    return NULL;
+}
+
+BytecodeCompiler::Reference BytecodeCompiler::parse_ref(Expression *expr)
+{
+    if (IdentifierLiteral *ident = dynamic_cast<IdentifierLiteral *>(expr))
+        return Reference(ident);
+
+    PropertyExpression *prop = dynamic_cast<PropertyExpression *>(expr);
+    assert(prop);
+
+    int obj = parse(prop->object(), -1);
+    if (const EsString *str = constant_key(prop->key()))
+        return Reference(obj, static_cast<int>(key(str)), -1);
+
+    return Reference(obj, -1, parse(prop->key(), -1));
+}
+
+void BytecodeCompiler::expand_ref_get(const Reference &ref, int dst)
+{
+    if (ref.ident_)
+    {
+        emit_load(ref.ident_, dst);
+        return;
+    }
+
+    emit_op(ref.key_ != -1 ? EsBytecode::OP_GET : EsBytecode::OP_GET_ELM);
+    emit_reg(dst);
+    emit_reg(ref.obj_);
+    if (ref.key_ != -1)
+        emit_imm(static_cast<uint32_t>(ref.key_));
+    else
+        emit_reg(ref.key_reg_);
+    emit_imm(cache());
+}
+
+void BytecodeCompiler::expand_ref_put(const Reference &ref, int src)
+{
+    if (ref.ident_)
+    {
+        emit_store(ref.ident_, src);
+        return;
+    }
+
+    emit_op(ref.key_ != -1 ? EsBytecode::OP_PUT : EsBytecode::OP_PUT_ELM);
+    emit_reg(ref.obj_);
+    if (ref.key_ != -1)
+        emit_imm(static_cast<uint32_t>(ref.key_));
+    else
+        emit_reg(ref.key_reg_);
+    emit_reg(src);
+    emit_imm(cache());
+}
+
+void BytecodeCompiler::compile_branch(Expression *expr, int label, bool jump_if)
+{
+    if (UnaryExpression *unary = dynamic_cast<UnaryExpression *>(expr))
+    {
+        if (unary->operation() == UnaryExpression::LOG_NOT)
+        {
+            compile_branch(unary->expression(), label, !jump_if);
+            return;
+        }
+    }
+    else if (BinaryExpression *binary = dynamic_cast<BinaryExpression *>(expr))
+    {
+        if (binary->operation() == BinaryExpression::LOG_AND ||
+            binary->operation() == BinaryExpression::LOG_OR)
+        {
+            // Short-circuit evaluation straight into the branch targets.
+            bool is_and = binary->operation() == BinaryExpression::LOG_AND;
+            if (is_and != jump_if)
+            {
+                compile_branch(binary->left(), label, jump_if);
+                compile_branch(binary->right(), label, jump_if);
+            }
+            else
+            {
+                int skip = new_label();
+                compile_branch(binary->left(), skip, !jump_if);
+                compile_branch(binary->right(), label, jump_if);
+                bind(skip);
+            }
+            return;
+        }
+    }
+    else if (BoolLiteral *lit = dynamic_cast<BoolLiteral *>(expr))
+    {
+        if (lit->value() == jump_if)
+            emit_jump(EsBytecode::OP_JMP, label);
+        return;
+    }
+
+    TemporaryScope temporaries(this);
+
+    int cond = parse(expr, -1);
+    emit_jump(jump_if ? EsBytecode::OP_JT : EsBytecode::OP_JF, cond, label);
+}
+
+void BytecodeCompiler::compile_body(const StatementVector &body)
+{
+    StatementVector::const_iterator it;
+    for (it = body.begin(); it != body.end(); ++it)
+    {
+        TemporaryScope temporaries(this);
+        parse(*it, -1);
+    }
+}
+
+void BytecodeCompiler::compile_finally(Statement *stmt)
+{
+    // The value of a finally block never becomes the completion value.
+    int completion = completion_;
+    completion_ = -1;
+
+    TemporaryScope temporaries(this);
+    parse(stmt, -1);
+
+    completion_ = completion;
+}
+
+void BytecodeCompiler::compile_try_catch(TryStatement *stmt)
+{
+    if (!stmt->has_catch_block())
+    {
+        parse(stmt->try_block(), -1);
+        return;
+    }
+
+    int catch_label = new_label();
+    int fail_label = new_label();
+    int done_label = new_label();
+
+    handlers_.push_back(catch_label);
+    parse(stmt->try_block(), -1);
+    handlers_.pop_back();
+    emit_jump(EsBytecode::OP_JMP, done_label);
+
+    bind(catch_label);
+    emit_op(EsBytecode::OP_ENTER_CATCH);
+    emit_imm(key(EsString::create(stmt->catch_identifier())));
+
+    scopes_.push_back(Scope(Scope::KIND_LEAVE, NULL, -1, -1));
+    handlers_.push_back(fail_label);
+    parse(stmt->catch_block(), -1);
+    handlers_.pop_back();
+    scopes_.pop_back();
+
+    emit(EsBytecode::OP_LEAVE);
+    emit_jump(EsBytecode::OP_JMP, done_label);
+
+    // Exception thrown in the catch block.
+    bind(fail_label);
+    emit(EsBytecode::OP_LEAVE);
+    emit(EsBytecode::OP_RETHROW);
+
+    bind(done_label);
+}
+
+int BytecodeCompiler::parse_binary_expr(BinaryExpression *expr, int dst)
+{
+    switch (expr->operation())
+    {
+        case BinaryExpression::COMMA:
+        {
+            {
+                TemporaryScope temporaries(this);
+                parse(expr->left(), -1);
+            }
+
+            return parse(expr->right(), dst);
+        }
+
+        case BinaryExpression::LOG_AND:
+        case BinaryExpression::LOG_OR:
+        {
+            int d = target(dst);
+            int done_label = new_label();
+
+            parse(expr->left(), d);
+            emit_jump(expr->operation() == BinaryExpression::LOG_AND
+                          ? EsBytecode::OP_JF : EsBytecode::OP_JT,
+                      d, done_label);
+            parse(expr->right(), d);
+
+            bind(done_label);
+            return d;
+        }
+
+        default:
+            break;
+    }
+
+    EsBytecode::Opcode op = EsBytecode::OP_ADD;
+    switch (expr->operation())
+    {
+        // Arithmetic.
+        case BinaryExpression::MUL: op = EsBytecode::OP_MUL; break;
+        case BinaryExpression::DIV: op = EsBytecode::OP_DIV; break;
+        case BinaryExpression::MOD: op = EsBytecode::OP_MOD; break;
+        case BinaryExpression::ADD: op = EsBytecode::OP_ADD; break;
+        case BinaryExpression::SUB: op = EsBytecode::OP_SUB; break;
+        case BinaryExpression::LS:  op = EsBytecode::OP_SHL; break;
+        case BinaryExpression::RSS: op = EsBytecode::OP_SAR; break;
+        case BinaryExpression::RUS: op = EsBytecode::OP_SHR; break;
+
+        // Relational.
+        case BinaryExpression::LT:  op = EsBytecode::OP_LT; break;
+        case BinaryExpression::GT:  op = EsBytecode::OP_GT; break;
+        case BinaryExpression::LTE: op = EsBytecode::OP_LTE; break;
+        case BinaryExpression::GTE: op = EsBytecode::OP_GTE; break;
+        case BinaryExpression::IN:  op = EsBytecode::OP_IN; break;
+        case BinaryExpression::INSTANCEOF: op = EsBytecode::OP_INSTANCEOF; break;
+
+        // Equality.
+        case BinaryExpression::EQ:  op = EsBytecode::OP_EQ; break;
+        case BinaryExpression::NEQ: op = EsBytecode::OP_NEQ; break;
+        case BinaryExpression::STRICT_EQ:  op = EsBytecode::OP_STRICT_EQ; break;
+        case BinaryExpression::STRICT_NEQ: op = EsBytecode::OP_STRICT_NEQ; break;
+
+        // Bitwise.
+        case BinaryExpression::BIT_AND: op = EsBytecode::OP_AND; break;
+        case BinaryExpression::BIT_XOR: op = EsBytecode::OP_XOR; break;
+        case BinaryExpression::BIT_OR:  op = EsBytecode::OP_OR; break;
+
+        default:
+            assert(false);
+            break;
+    }
+
+    int d = target(dst);
+
+    TemporaryScope temporaries(this);
+    int l = parse(expr->left(), -1);
+    int r = parse(expr->right(), -1);
+    emit(op, d, l, r);
+    return d;
+}
+
+int BytecodeCompiler::parse_unary_expr(UnaryExpression *expr, int dst)
+{
+    switch (expr->operation())
+    {
+        case UnaryExpression::DELETE:
+        {
+            int d = target(dst);
+
+            TemporaryScope temporaries(this);
+            if (PropertyExpression *prop =
+                dynamic_cast<PropertyExpression *>(expr->expression()))
+            {
+                Reference ref = parse_ref(prop);
+
+                emit_op(ref.key_ != -1 ? EsBytecode::OP_DEL : EsBytecode::OP_DEL_ELM);
+                emit_reg(d);
+                emit_reg(ref.obj_);
+                if (ref.key_ != -1)
+                    emit_imm(static_cast<uint32_t>(ref.key_));
+                else
+                    emit_reg(ref.key_reg_);
+                return d;
+            }
+            else if (IdentifierLiteral *ident =
+                dynamic_cast<IdentifierLiteral *>(expr->expression()))
+            {
+                emit_op(EsBytecode::OP_DEL_NAME);
+                emit_reg(d);
+                emit_imm(site(ident));
+                return d;
+            }
+
+            parse(expr->expression(), -1);
+            return move(d, constant(es_value_true()));
+        }
+
+        case UnaryExpression::VOID:
+        {
+            {
+                TemporaryScope temporaries(this);
+                parse(expr->expression(), -1);
+            }
+
+            return move(dst, constant(es_value_undefined()));
+        }
+
+        case UnaryExpression::TYPEOF:
+        {
+            int d = target(dst);
+
+            // typeof must not throw on unresolvable references.
+            IdentifierLiteral *ident =
+                dynamic_cast<IdentifierLiteral *>(expr->expression());
+            if (ident && !ident->is_resolved())
+            {
+                emit_op(EsBytecode::OP_TYPEOF_NAME);
+                emit_reg(d);
+                emit_imm(site(ident));
+                return d;
+            }
+
+            TemporaryScope temporaries(this);
+            emit(EsBytecode::OP_TYPEOF, d, parse(expr->expression(), -1));
+            return d;
+        }
+
+        case UnaryExpression::PRE_INC:
+        case UnaryExpression::PRE_DEC:
+        case UnaryExpression::POST_INC:
+        case UnaryExpression::POST_DEC:
+        {
+            int d = target(dst);
+
+            TemporaryScope temporaries(this);
+            Reference ref = parse_ref(expr->expression());
+
+            int old_val = alloc_reg();
+            expand_ref_get(ref, old_val);
+
+            bool is_inc = expr->operation() == UnaryExpression::PRE_INC ||
+                          expr->operation() == UnaryExpression::POST_INC;
+            bool is_post = expr->operation() == UnaryExpression::POST_INC ||
+                           expr->operation() == UnaryExpression::POST_DEC;
+
+            // The old value is converted to a number, which is the result of
+            // postfix expressions.
+            int num = is_post ? d : old_val;
+            int new_val = is_post ? old_val : d;
+            emit(EsBytecode::OP_POS, num, old_val);
+            emit(is_inc ? EsBytecode::OP_INC : EsBytecode::OP_DEC, new_val, num);
+            expand_ref_put(ref, new_val);
+            return d;
+        }
+
+        default:
+            break;
+    }
+
+    EsBytecode::Opcode op = EsBytecode::OP_NOT;
+    switch (expr->operation())
+    {
+        case UnaryExpression::PLUS:     op = EsBytecode::OP_POS; break;
+        case UnaryExpression::MINUS:    op = EsBytecode::OP_NEG; break;
+        case UnaryExpression::BIT_NOT:  op = EsBytecode::OP_BIT_NOT; break;
+        case UnaryExpression::LOG_NOT:  op = EsBytecode::OP_NOT; break;
+        default:
+            assert(false);
+            break;
+    }
+
+    int d = target(dst);
+
+    TemporaryScope temporaries(this);
+    emit(op, d, parse(expr->expression(), -1));
+    return d;
+}
+
+int BytecodeCompiler::parse_assign_expr(AssignmentExpression *expr, int dst)
+{
+    int d = target(dst);
+
+    TemporaryScope temporaries(this);
+    Reference ref = parse_ref(expr->lhs());
+
+    if (expr->operation() == AssignmentExpression::ASSIGN)
+    {
+        parse(expr->rhs(), d);
+        expand_ref_put(ref, d);
+        return d;
+    }
+
+    EsBytecode::Opcode op = EsBytecode::OP_ADD;
+    switch (expr->operation())
+    {
+        case AssignmentExpression::ASSIGN_ADD:      op = EsBytecode::OP_ADD; break;
+        case AssignmentExpression::ASSIGN_SUB:      op = EsBytecode::OP_SUB; break;
+        case AssignmentExpression::ASSIGN_MUL:      op = EsBytecode::OP_MUL; break;
+        case AssignmentExpression::ASSIGN_MOD:      op = EsBytecode::OP_MOD; break;
+        case AssignmentExpression::ASSIGN_LS:       op = EsBytecode::OP_SHL; break;
+        case AssignmentExpression::ASSIGN_RSS:      op = EsBytecode::OP_SAR; break;
+        case AssignmentExpression::ASSIGN_RUS:      op = EsBytecode::OP_SHR; break;
+        case AssignmentExpression::ASSIGN_BIT_AND:  op = EsBytecode::OP_AND; break;
+        case AssignmentExpression::ASSIGN_BIT_OR:   op = EsBytecode::OP_OR; break;
+        case AssignmentExpression::ASSIGN_BIT_XOR:  op = EsBytecode::OP_XOR; break;
+        case AssignmentExpression::ASSIGN_DIV:      op = EsBytecode::OP_DIV; break;
+        default:
+            assert(false);
+            break;
+    }
+
+    int l = alloc_reg();
+    expand_ref_get(ref, l);
+    int r = parse(expr->rhs(), -1);
+    emit(op, d, l, r);
+    expand_ref_put(ref, d);
+    return d;
+}
+
+int BytecodeCompiler::parse_cond_expr(ConditionalExpression *expr, int dst)
+{
+    int d = target(dst);
+    int else_label = new_label();
+    int done_label = new_label();
+
+    compile_branch(expr->condition(), else_label, false);
+    parse(expr->left(), d);
+    emit_jump(EsBytecode::OP_JMP, done_label);
+
+    bind(else_label);
+    parse(expr->right(), d);
+
+    bind(done_label);
+    return d;
+}
+
+int BytecodeCompiler::parse_prop_expr(PropertyExpression *expr, int dst)
+{
+    int d = target(dst);
+
+    TemporaryScope temporaries(this);
+    expand_ref_get(parse_ref(expr), d);
+    return d;
+}
+
+int BytecodeCompiler::parse_call_expr(CallExpression *expr, int dst)
+{
+    int d = target(dst);
+
+    TemporaryScope temporaries(this);
+
+    // The callee is evaluated before the arguments.
+    Reference ref(NULL);
+    int fun = -1;
+
+    IdentifierLiteral *ident =
+        dynamic_cast<IdentifierLiteral *>(expr->expression());
+    if (PropertyExpression *prop =
+        dynamic_cast<PropertyExpression *>(expr->expression()))
+    {
+        ref = parse_ref(prop);
+    }
+    else if (ident && ident->is_resolved())
+    {
+        // Statically resolved functions live in declarative environments,
+        // which provide undefined as this value.
+        fun = alloc_reg();
+        emit_load(ident, fun);
+        ident = NULL;
+    }
+    else if (!ident)
+    {
+        fun = parse(expr->expression(), -1);
+    }
+
+    const ExpressionVector &args = expr->arguments();
+    uint32_t argc = static_cast<uint32_t>(args.size());
+
+    int argv = next_reg_;
+    for (uint32_t i = 0; i < argc; i++)
+        alloc_reg();
+    for (uint32_t i = 0; i < argc; i++)
+        parse(args[i], argv + static_cast<int>(i));
+
+    if (ref.obj_ != -1)
+    {
+        if (ref.key_ != -1)
+        {
+            emit_op(EsBytecode::OP_CALL_KEYED);
+            emit_reg(d);
+            emit_reg(ref.obj_);
+            emit_imm(static_cast<uint32_t>(ref.key_));
+            emit_reg(argv);
+            emit_imm(argc);
+            emit_imm(cache());
+        }
+        else
+        {
+            emit_op(EsBytecode::OP_CALL_ELM);
+            emit_reg(d);
+            emit_reg(ref.obj_);
+            emit_reg(ref.key_reg_);
+            emit_reg(argv);
+            emit_imm(argc);
+        }
+    }
+    else if (ident)
+    {
+        // Named calls resolve the this value and recognize direct calls to
+        // eval.
+        emit_op(EsBytecode::OP_CALL_NAME);
+        emit_reg(d);
+        emit_imm(site(ident));
+        emit_reg(argv);
+        emit_imm(argc);
+    }
+    else
+    {
+        emit_op(EsBytecode::OP_CALL);
+        emit_reg(d);
+        emit_reg(fun);
+        emit_reg(argv);
+        emit_imm(argc);
+    }
+
+    return d;
+}
+
+int BytecodeCompiler::parse_call_new_expr(CallNewExpression *expr, int dst)
+{
+    int d = target(dst);
+
+    TemporaryScope temporaries(this);
+    int fun = parse(expr->expression(), -1);
+
+    const ExpressionVector &args = expr->arguments();
+    uint32_t argc = static_cast<uint32_t>(args.size());
+
+    int argv = next_reg_;
+    for (uint32_t i = 0; i < argc; i++)
+        alloc_reg();
+    for (uint32_t i = 0; i < argc; i++)
+        parse(args[i], argv + static_cast<int>(i));
+
+    emit_op(EsBytecode::OP_NEW);
+    emit_reg(d);
+    emit_reg(fun);
+    emit_reg(argv);
+    emit_imm(argc);
+    return d;
+}
+
+int BytecodeCompiler::parse_regular_expr(RegularExpression *expr, int dst)
+{
+    int d = target(dst);
+    emit(EsBytecode::OP_NEW_REG_EXP, d,
+         constant(expr->pattern()), constant(expr->flags()));
+    return d;
+}
+
+int BytecodeCompiler::parse_fun_expr(FunctionExpression *expr, int dst)
+{
+    return parse(const_cast<FunctionLiteral *>(expr->function()), dst);
+}
+
+int BytecodeCompiler::parse_this_lit(ThisLiteral *lit, int dst)
+{
+    int d = target(dst);
+    emit(EsBytecode::OP_LD_THIS, d);
+    return d;
+}
+
+int BytecodeCompiler::parse_ident_lit(IdentifierLiteral *lit, int dst)
+{
+    int d = target(dst);
+    emit_load(lit, d);
+    return d;
+}
+
+int BytecodeCompiler::parse_null_lit(NullLiteral *lit, int dst)
+{
+    return move(dst, constant(es_value_null()));
+}
+
+int BytecodeCompiler::parse_bool_lit(BoolLiteral *lit, int dst)
+{
+    return move(dst, constant(es_value_from_boolean(lit->value())));
+}
+
+int BytecodeCompiler::parse_num_lit(NumberLiteral *lit, int dst)
+{
+    return move(dst, constant(es_value_from_number(
+        es_str_to_num(EsString::create(lit->as_string())))));
+}
+
+int BytecodeCompiler::parse_str_lit(StringLiteral *lit, int dst)
+{
+    return move(dst, constant(lit->value()));
+}
+
+int BytecodeCompiler::parse_fun_lit(FunctionLiteral *lit, int dst)
+{
+    int d = target(dst);
+
+    code_->functions_.push_back(lit);
+
+    emit_op(EsBytecode::OP_NEW_FUN);
+    emit_reg(d);
+    emit_imm(static_cast<uint32_t>(code_->functions_.size() - 1));
+    return d;
+}
+
+int BytecodeCompiler::parse_var_lit(VariableLiteral *lit, int dst)
+{
+    // Declared in the function prologue.
+    return move(dst, constant(es_value_undefined()));
+}
+
+int BytecodeCompiler::parse_array_lit(ArrayLiteral *lit, int dst)
+{
+    int d = target(dst);
+
+    TemporaryScope temporaries(this);
+
+    const ExpressionVector &vals = lit->values();
+    uint32_t count = static_cast<uint32_t>(vals.size());
+
+    int items = next_reg_;
+    for (uint32_t i = 0; i < count; i++)
+        alloc_reg();
+    for (uint32_t i = 0; i < count; i++)
+        parse(vals[i], items + static_cast<int>(i));
+
+    emit_op(EsBytecode::OP_NEW_ARR);
+    emit_reg(d);
+    emit_reg(count > 0 ? items : d);
+    emit_imm(count);
+    return d;
+}
+
+int BytecodeCompiler::parse_obj_lit(ObjectLiteral *lit, int dst)
+{
+    int d = target(dst);
+
+    TemporaryScope temporaries(this);
+
+    // Literals where all properties are data properties with unique,
+    // constant and non-index keys are created from a template describing the
+    // final shape of the object, see ir::Compiler::parse_obj_lit().
+    std::vector<uint64_t> keys;
+    bool use_template = !lit->properties().empty();
+
+    ObjectLiteral::PropertyVector::const_iterator it;
+    for (it = lit->properties().begin(); it != lit->properties().end(); ++it)
+    {
+        const ObjectLiteral::Property *prop = *it;
+
+        StringLiteral *key_lit = prop->type() == ObjectLiteral::Property::DATA
+            ? dynamic_cast<StringLiteral *>(prop->key())
+            : NULL;
+
+        uint32_t index = 0;
+        if (!key_lit || key_lit->value().empty() ||
+            es_str_to_index(key_lit->value(), index))
+        {
+            use_template = false;
+            break;
+        }
+
+        uint64_t key = EsPropertyKey::from_str(
+            EsString::create(key_lit->value())).as_raw();
+        if (std::find(keys.begin(), keys.end(), key) != keys.end())
+        {
+            use_template = false;
+            break;
+        }
+
+        keys.push_back(key);
+    }
+
+    if (use_template)
+    {
+        uint64_t *tmpl_keys = new (GC) uint64_t[keys.size()];
+        std::copy(keys.begin(), keys.end(), tmpl_keys);
+
+        EsObjectTemplate *tmpl = new (GC) EsObjectTemplate;
+        tmpl->keys = tmpl_keys;
+        tmpl->num_keys = static_cast<uint32_t>(keys.size());
+        tmpl->shape = NULL;
+
+        // Nested literals add templates of their own while the values are
+        // parsed.
+        uint32_t tmpl_index = static_cast<uint32_t>(code_->templates_.size());
+        code_->templates_.push_back(tmpl);
+
+        int vals = next_reg_;
+        for (size_t i = 0; i < keys.size(); i++)
+            alloc_reg();
+
+        int i = 0;
+        for (it = lit->properties().begin(); it != lit->properties().end(); ++it, i++)
+            parse((*it)->value(), vals + i);
+
+        emit_op(EsBytecode::OP_NEW_OBJ_LIT);
+        emit_reg(d);
+        emit_imm(tmpl_index);
+        emit_reg(vals);
+        return d;
+    }
+
+    emit(EsBytecode::OP_NEW_OBJ, d);
+
+    for (it = lit->properties().begin(); it != lit->properties().end(); ++it)
+    {
+        const ObjectLiteral::Property *prop = *it;
+
+        TemporaryScope prop_temporaries(this);
+        if (prop->type() == ObjectLiteral::Property::DATA)
+        {
+            int k = parse(prop->key(), -1);
+            int v = parse(prop->value(), -1);
+            emit(EsBytecode::OP_DEF_DATA, d, k, v);
+        }
+        else
+        {
+            int f = parse(prop->value(), -1);
+
+            emit_op(EsBytecode::OP_DEF_ACCESSOR);
+            emit_reg(d);
+            emit_imm(key(EsString::create(prop->accessor_name())));
+            emit_reg(f);
+            emit_imm(prop->type() == ObjectLiteral::Property::SETTER ? 1 : 0);
+        }
+    }
+
+    return d;
+}
+
+int BytecodeCompiler::parse_nothing_lit(NothingLiteral *lit, int dst)
+{
+    return move(dst, constant(es_value_nothing()));
+}
+
+int BytecodeCompiler::parse_empty_stmt(EmptyStatement *stmt, int dst)
+{
+    return -1;
+}
+
+int BytecodeCompiler::parse_expr_stmt(ExpressionStatement *stmt, int dst)
+{
+    TemporaryScope temporaries(this);
+
+    int r = parse(stmt->expression(), -1);
+    if (completion_ != -1)
+        move(completion_, r);
+
+    return -1;
+}
+
+int BytecodeCompiler::parse_block_stmt(BlockStatement *stmt, int dst)
+{
+    // Hidden blocks hold the initializers of variable declarations, which
+    // don't produce a completion value.
+    int completion = completion_;
+    if (stmt->is_hidden())
+        completion_ = -1;
+
+    if (!stmt->labels().empty())
+    {
+        int done_label = new_label();
+
+        scopes_.push_back(Scope(Scope::KIND_DEFAULT, stmt, done_label, -1));
+        compile_body(stmt->body());
+        scopes_.pop_back();
+
+        bind(done_label);
+    }
+    else
+    {
+        compile_body(stmt->body());
+    }
+
+    completion_ = completion;
+    return -1;
+}
+
+int BytecodeCompiler::parse_if_stmt(IfStatement *stmt, int dst)
+{
+    int else_label = new_label();
+
+    compile_branch(stmt->condition(), else_label, false);
+    parse(stmt->if_statement(), -1);
+
+    if (stmt->has_else())
+    {
+        int done_label = new_label();
+        emit_jump(EsBytecode::OP_JMP, done_label);
+
+        bind(else_label);
+        parse(stmt->else_statement(), -1);
+
+        bind(done_label);
+    }
+    else
+    {
+        bind(else_label);
+    }
+
+    return -1;
+}
+
+int BytecodeCompiler::parse_do_while_stmt(DoWhileStatement *stmt, int dst)
+{
+    int body_label = new_label();
+    int cond_label = new_label();
+    int done_label = new_label();
+
+    scopes_.push_back(Scope(Scope::KIND_ITERATION, stmt, done_label, cond_label));
+
+    bind(body_label);
+    parse(stmt->body(), -1);
+
+    bind(cond_label);
+    if (stmt->has_condition())
+        compile_branch(stmt->condition(), body_label, true);
+    else
+        emit_jump(EsBytecode::OP_JMP, body_label);
+
+    scopes_.pop_back();
+
+    bind(done_label);
+    return -1;
+}
+
+int BytecodeCompiler::parse_while_stmt(WhileStatement *stmt, int dst)
+{
+    int body_label = new_label();
+    int cond_label = new_label();
+    int done_label = new_label();
+
+    scopes_.push_back(Scope(Scope::KIND_ITERATION, stmt, done_label, cond_label));
+
+    // The condition is placed after the body to get a single branch per
+    // iteration.
+    emit_jump(EsBytecode::OP_JMP, cond_label);
+
+    bind(body_label);
+    parse(stmt->body(), -1);
+
+    bind(cond_label);
+    compile_branch(stmt->condition(), body_label, true);
+
+    scopes_.pop_back();
+
+    bind(done_label);
+    return -1;
+}
+
+int BytecodeCompiler::parse_for_in_stmt(ForInStatement *stmt, int dst)
+{
+    TemporaryScope temporaries(this);
+
+    int next_label = new_label();
+    int done_label = new_label();
+
+    int e = parse(stmt->enumerable(), -1);
+    emit_jump(EsBytecode::OP_JNU, e, done_label);
+
+    int it = alloc_reg();
+    int p = alloc_reg();
+    emit(EsBytecode::OP_IT_NEW, it, e);
+
+    scopes_.push_back(Scope(Scope::KIND_ITERATION, stmt, done_label, next_label));
+
+    bind(next_label);
+    emit_op(EsBytecode::OP_IT_NEXT);
+    emit_reg(p);
+    emit_reg(it);
+    emit_label(done_label);
+
+    {
+        TemporaryScope decl_temporaries(this);
+        expand_ref_put(parse_ref(stmt->declaration()), p);
+    }
+
+    parse(stmt->body(), -1);
+    emit_jump(EsBytecode::OP_JMP, next_label);
+
+    scopes_.pop_back();
+
+    bind(done_label);
+    return -1;
+}
+
+int BytecodeCompiler::parse_for_stmt(ForStatement *stmt, int dst)
+{
+    int body_label = new_label();
+    int next_label = new_label();
+    int cond_label = new_label();
+    int done_label = new_label();
+
+    if (stmt->has_initializer())
+    {
+        // The initializer doesn't produce a completion value.
+        int completion = completion_;
+        completion_ = -1;
+
+        TemporaryScope temporaries(this);
+        parse(stmt->initializer(), -1);
+
+        completion_ = completion;
+    }
+
+    scopes_.push_back(Scope(Scope::KIND_ITERATION, stmt, done_label, next_label));
+
+    emit_jump(EsBytecode::OP_JMP, cond_label);
+
+    bind(body_label);
+    parse(stmt->body(), -1);
+
+    bind(next_label);
+    if (stmt->has_next())
+    {
+        TemporaryScope temporaries(this);
+        parse(stmt->next(), -1);
+    }
+
+    bind(cond_label);
+    if (stmt->has_condition())
+        compile_branch(stmt->condition(), body_label, true);
+    else
+        emit_jump(EsBytecode::OP_JMP, body_label);
+
+    scopes_.pop_back();
+
+    bind(done_label);
+    return -1;
+}
+
+int BytecodeCompiler::parse_cont_stmt(ContinueStatement *stmt, int dst)
+{
+    emit_jump(EsBytecode::OP_JMP, unroll_for_continue(stmt->target()));
+    return -1;
+}
+
+int BytecodeCompiler::parse_break_stmt(BreakStatement *stmt, int dst)
+{
+    emit_jump(EsBytecode::OP_JMP, unroll_for_break(stmt->target()));
+    return -1;
+}
+
+int BytecodeCompiler::parse_ret_stmt(ReturnStatement *stmt, int dst)
+{
+    TemporaryScope temporaries(this);
+
+    int r = stmt->has_expression()
+        ? parse(stmt->expression(), -1)
+        : constant(es_value_undefined());
+
+    unroll_for_return();
+    emit(EsBytecode::OP_RET, r);
+    return -1;
+}
+
+int BytecodeCompiler::parse_with_stmt(WithStatement *stmt, int dst)
+{
+    int fail_label = new_label();
+    int done_label = new_label();
+
+    {
+        TemporaryScope temporaries(this);
+        emit(EsBytecode::OP_ENTER_WITH, parse(stmt->expression(), -1));
+    }
+
+    scopes_.push_back(Scope(Scope::KIND_LEAVE, NULL, -1, -1));
+    handlers_.push_back(fail_label);
+    parse(stmt->body(), -1);
+    handlers_.pop_back();
+    scopes_.pop_back();
+
+    emit(EsBytecode::OP_LEAVE);
+    emit_jump(EsBytecode::OP_JMP, done_label);
+
+    // Exception thrown in the body.
+    bind(fail_label);
+    emit(EsBytecode::OP_LEAVE);
+    emit(EsBytecode::OP_RETHROW);
+
+    bind(done_label);
+    return -1;
+}
+
+int BytecodeCompiler::parse_switch_stmt(SwitchStatement *stmt, int dst)
+{
+    TemporaryScope temporaries(this);
+
+    int done_label = new_label();
+    int default_label = -1;
+
+    int v = parse(stmt->expression(), -1);
+    int t = alloc_reg();
+
+    // Case labels are compared in source order, the bodies are laid out in
+    // source order as well so that control falls through.
+    const SwitchStatement::CaseClauseVector &cases = stmt->cases();
+
+    IntVector case_labels;
+    SwitchStatement::CaseClauseVector::const_iterator it;
+    for (it = cases.begin(); it != cases.end(); ++it)
+    {
+        int case_label = new_label();
+        case_labels.push_back(case_label);
+
+        if ((*it)->is_default())
+        {
+            default_label = case_label;
+            continue;
+        }
+
+        TemporaryScope label_temporaries(this);
+        emit(EsBytecode::OP_STRICT_EQ, t, parse((*it)->label(), -1), v);
+        emit_jump(EsBytecode::OP_JT, t, case_label);
+    }
+
+    emit_jump(EsBytecode::OP_JMP, default_label != -1 ? default_label : done_label);
+
+    scopes_.push_back(Scope(Scope::KIND_SWITCH, stmt, done_label, -1));
+
+    IntVector::const_iterator it_label = case_labels.begin();
+    for (it = cases.begin(); it != cases.end(); ++it, ++it_label)
+    {
+        bind(*it_label);
+        compile_body((*it)->body());
+    }
+
+    scopes_.pop_back();
+
+    bind(done_label);
+    return -1;
+}
+
+int BytecodeCompiler::parse_throw_stmt(ThrowStatement *stmt, int dst)
+{
+    TemporaryScope temporaries(this);
+    emit(EsBytecode::OP_THROW, parse(stmt->expression(), -1));
+    return -1;
+}
+
+int BytecodeCompiler::parse_try_stmt(TryStatement *stmt, int dst)
+{
+    int done_label = new_label();
+
+    if (!stmt->labels().empty())
+        scopes_.push_back(Scope(Scope::KIND_DEFAULT, stmt, done_label, -1));
+
+    if (stmt->has_finally_block())
+    {
+        int fail_label = new_label();
+
+        Scope scope(Scope::KIND_FINALLY, NULL, -1, -1);
+        scope.finally_ = stmt->finally_block();
+        scope.handler_ = handlers_.empty() ? -1 : handlers_.back();
+
+        scopes_.push_back(scope);
+        handlers_.push_back(fail_label);
+        compile_try_catch(stmt);
+        handlers_.pop_back();
+        scopes_.pop_back();
+
+        compile_finally(stmt->finally_block());
+        emit_jump(EsBytecode::OP_JMP, done_label);
+
+        // Exception thrown in the try or catch block. The exception is
+        // stashed while the finally block executes.
+        bind(fail_label);
+        {
+            TemporaryScope temporaries(this);
+
+            int ex_state = alloc_reg();
+            emit(EsBytecode::OP_EX_SAVE, ex_state);
+            compile_finally(stmt->finally_block());
+            emit(EsBytecode::OP_EX_LOAD, ex_state);
+            emit(EsBytecode::OP_RETHROW);
+        }
+    }
+    else
+    {
+        compile_try_catch(stmt);
+    }
+
+    if (!stmt->labels().empty())
+        scopes_.pop_back();
+
+    bind(done_label);
+    return -1;
+}
+
+int BytecodeCompiler::parse_dbg_stmt(DebuggerStatement *stmt, int dst)
+{
+    return -1;
+}
+
+EsBytecode *BytecodeCompiler::compile(FunctionLiteral *fun, bool eval)
+{
+    code_ = new (GC) EsBytecode();
+
+    next_reg_ = 0;
+    max_reg_ = 0;
+    completion_ = eval ? alloc_reg() : -1;
+
+    compile_body(fun->body());
+    emit(EsBytecode::OP_RET, eval ? completion_ : constant(es_value_undefined()));
+
+    assert(scopes_.empty());
+    assert(handlers_.empty());
+    update_handler_range();
+
+    // Resolve labels.
+    FixupVector::const_iterator it_label;
+    for (it_label = label_fixups_.begin(); it_label != label_fixups_.end(); ++it_label)
+    {
+        assert(labels_[it_label->second] != -1);
+        code_->code_[it_label->first] =
+            static_cast<uint32_t>(labels_[it_label->second]);
+    }
+
+    EsBytecode::HandlerVector::iterator it_handler;
+    for (it_handler = code_->handlers_.begin();
+         it_handler != code_->handlers_.end(); ++it_handler)
+    {
+        assert(labels_[it_handler->target] != -1);
+        it_handler->target = static_cast<uint32_t>(labels_[it_handler->target]);
+    }
+
+    // Constant registers follow the temporaries.
+    code_->num_temps_ = static_cast<uint32_t>(max_reg_);
+
+    IntVector::const_iterator it_const;
+    for (it_const = const_fixups_.begin(); it_const != const_fixups_.end(); ++it_const)
+        code_->code_[*it_const] += code_->num_temps_;
+
+    if (code_->num_caches_ > 0)
+        code_->caches_ = new (GC) EsPropertyCache[code_->num_caches_]();
+
+    // Keys of the prologue bindings, created once rather than on every call.
+    StringVector::const_iterator it_prm;
+    for (it_prm = fun->parameters().begin();
+         it_prm != fun->parameters().end(); ++it_prm)
+    {
+        code_->prm_keys_.push_back(
+            EsPropertyKey::from_str(EsString::create(*it_prm)).as_raw());
+    }
+
+    DeclarationVector::const_iterator it_decl;
+    for (it_decl = fun->declarations().begin();
+         it_decl != fun->declarations().end(); ++it_decl)
+    {
+        const Declaration *decl = *it_decl;
+        const String &name = decl->is_function() ?
+            decl->as_function()->name() : decl->as_variable()->name();
+        code_->decl_keys_.push_back(
+            EsPropertyKey::from_str(EsString::create(name)).as_raw());
+    }
+
+    StringVector::const_iterator it_slot;
+    for (it_slot = fun->slots().begin(); it_slot != fun->slots().end(); ++it_slot)
+    {
+        code_->slot_keys_.push_back(
+            EsPropertyKey::from_str(EsString::create(*it_slot)).as_raw());
+    }
+
+    return code_;
+}
@@ -0,0 +1,447 @@
+/*
+ * descripten - ECMAScript to native compiler
+ * Copyright (C) 2011-2014 Christian Kindahl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <map>
+#include <vector>
+#include <gc_cpp.h>
+#include <gc/gc_allocator.h>    // NOTE: 3rd party.
+#include "common/string.hh"
+#include "parser/ast.hh"
+#include "parser/visitor.hh"
+#include "operation.h"
+#include "value_data.h"
+
+struct EsIdentifierSite;
+
+/*
+ * Instruction set of the bytecode interpreter. Every instruction is an opcode
+ * word followed by a fixed number of operand words. Operands are register
+ * indices, indices into one of the side tables of the code object, immediate
+ * counts or absolute jump targets.
+ *
+ * X(name, number of operands)
+ */
+#define ES_OPCODES(X)                                                          \
+    /* Moves and loads. */                                                     \
+    X(MOV, 2)               /* dst, src */                                     \
+    X(LD_THIS, 1)           /* dst */                                          \
+    X(LD_SLOT, 4)           /* dst, depth, slot, site */                       \
+    X(ST_SLOT, 4)           /* depth, slot, src, site */                       \
+    X(LD_NAME, 2)           /* dst, site */                                    \
+    X(ST_NAME, 2)           /* site, src */                                    \
+    X(DEL_NAME, 2)          /* dst, site */                                    \
+    X(TYPEOF_NAME, 2)       /* dst, site */                                    \
+    /* Properties. */                                                          \
+    X(GET, 4)               /* dst, obj, key, cache */                         \
+    X(GET_ELM, 4)           /* dst, obj, key reg, cache */                     \
+    X(PUT, 4)               /* obj, key, src, cache */                         \
+    X(PUT_ELM, 4)           /* obj, key reg, src, cache */                     \
+    X(DEL, 3)               /* dst, obj, key */                                \
+    X(DEL_ELM, 3)           /* dst, obj, key reg */                            \
+    /* Calls, arguments are passed in consecutive registers. */                \
+    X(CALL, 4)              /* dst, fun, argv, argc */                         \
+    X(CALL_NAME, 4)         /* dst, site, argv, argc */                        \
+    X(CALL_KEYED, 6)        /* dst, obj, key, argv, argc, cache */             \
+    X(CALL_ELM, 5)          /* dst, obj, key reg, argv, argc */                \
+    X(NEW, 4)               /* dst, fun, argv, argc */                         \
+    /* Binary operators: dst, lhs, rhs. */                                     \
+    X(ADD, 3)                                                                  \
+    X(SUB, 3)                                                                  \
+    X(MUL, 3)                                                                  \
+    X(DIV, 3)                                                                  \
+    X(MOD, 3)                                                                  \
+    X(SHL, 3)                                                                  \
+    X(SAR, 3)                                                                  \
+    X(SHR, 3)                                                                  \
+    X(AND, 3)                                                                  \
+    X(OR, 3)                                                                   \
+    X(XOR, 3)                                                                  \
+    X(LT, 3)                                                                   \
+    X(GT, 3)                                                                   \
+    X(LTE, 3)                                                                  \
+    X(GTE, 3)                                                                  \
+    X(IN, 3)                                                                   \
+    X(INSTANCEOF, 3)                                                           \
+    X(EQ, 3)                                                                   \
+    X(NEQ, 3)                                                                  \
+    X(STRICT_EQ, 3)                                                            \
+    X(STRICT_NEQ, 3)                                                           \
+    /* Unary operators: dst, src. INC and DEC require a number operand. */     \
+    X(NOT, 2)                                                                  \
+    X(BIT_NOT, 2)                                                              \
+    X(POS, 2)                                                                  \
+    X(NEG, 2)                                                                  \
+    X(TYPEOF, 2)                                                               \
+    X(INC, 2)                                                                  \
+    X(DEC, 2)                                                                  \
+    /* Control flow. */                                                        \
+    X(JMP, 1)               /* target */                                       \
+    X(JT, 2)                /* cond, target */                                 \
+    X(JF, 2)                /* cond, target */                                 \
+    X(JNU, 2)               /* src, target, taken on null and undefined */     \
+    X(RET, 1)               /* src */                                          \
+    X(THROW, 1)             /* src */                                          \
+    X(RETHROW, 0)                                                              \
+    /* Contexts and exception state. */                                        \
+    X(ENTER_WITH, 1)        /* src */                                          \
+    X(ENTER_CATCH, 1)       /* key */                                          \
+    X(LEAVE, 0)                                                                \
+    X(EX_SAVE, 1)           /* dst */                                          \
+    X(EX_LOAD, 1)           /* src */                                          \
+    /* Literals. */                                                            \
+    X(NEW_ARR, 3)           /* dst, items, count */                            \
+    X(NEW_OBJ, 1)           /* dst */                                          \
+    X(NEW_OBJ_LIT, 3)       /* dst, template, values */                        \
+    X(DEF_DATA, 3)          /* obj, key reg, src */                            \
+    X(DEF_ACCESSOR, 4)      /* obj, key, fun, is setter */                     \
+    X(NEW_REG_EXP, 3)       /* dst, pattern, flags */                          \
+    X(NEW_FUN, 2)           /* dst, function */                                \
+    /* Property enumeration. */                                                \
+    X(IT_NEW, 2)            /* dst, src */                                     \
+    X(IT_NEXT, 3)           /* dst, iterator, target when done */
+
+/**
+ * @brief Compiled form of a function literal executed by the interpreter.
+ *
+ * The function body is lowered into instructions operating on a register
+ * file which is allocated on the call stack when the function is entered.
+ * Registers [0, num_temporaries()) hold temporary values and the following
+ * registers are initialized with constants().
+ *
+ * Property keys, inline caches, identifier sites, object literal templates
+ * and nested function literals are kept in side tables indexed by the
+ * instruction operands.
+ */
+class EsBytecode : public gc
+{
+public:
+    friend class BytecodeCompiler;
+
+    /**
+     * @brief Instruction opcodes.
+     */
+    enum Opcode
+    {
+#define ES_OPCODE_ENUM(name, num_operands) OP_##name,
+        ES_OPCODES(ES_OPCODE_ENUM)
+#undef ES_OPCODE_ENUM
+        NUM_OPCODES
+    };
+
+    /**
+     * @brief Exception handler covering a range of instructions.
+     */
+    struct Handler
+    {
+        uint32_t begin;     ///< First instruction covered by the handler.
+        uint32_t end;       ///< End of covered instructions, exclusive.
+        uint32_t target;    ///< First instruction of the handler.
+    };
+
+    typedef std::vector<uint32_t, gc_allocator<uint32_t> > CodeVector;
+    typedef std::vector<EsValueData, gc_allocator<EsValueData> > ConstantVector;
+    typedef std::vector<uint64_t, gc_allocator<uint64_t> > KeyVector;
+    typedef std::vector<EsIdentifierSite *,
+                        gc_allocator<EsIdentifierSite *> > SiteVector;
+    typedef std::vector<EsObjectTemplate *,
+                        gc_allocator<EsObjectTemplate *> > TemplateVector;
+    typedef std::vector<parser::FunctionLiteral *,
+                        gc_allocator<parser::FunctionLiteral *> > FunctionVector;
+    typedef std::vector<Handler, gc_allocator<Handler> > HandlerVector;
+
+private:
+    CodeVector code_;
+    uint32_t num_temps_;        ///< Number of temporary registers.
+    ConstantVector constants_;  ///< Values of the constant registers.
+    KeyVector keys_;            ///< Raw property keys.
+    EsPropertyCache *caches_;   ///< Property caches of the access sites.
+    uint32_t num_caches_;
+    SiteVector sites_;          ///< Identifier sites.
+    TemplateVector templates_;  ///< Object literal templates.
+    FunctionVector functions_;  ///< Nested function literals.
+    HandlerVector handlers_;    ///< Exception handlers ordered by range.
+    KeyVector prm_keys_;        ///< Raw property keys of the parameters.
+    KeyVector decl_keys_;       ///< Raw property keys of the declarations.
+    KeyVector slot_keys_;       ///< Raw property keys of the resolved bindings.
+
+    EsBytecode();
+
+public:
+    /**
+     * @return Number of operands of instructions with opcode @a op.
+     */
+    static uint32_t num_operands(Opcode op);
+
+    /**
+     * @return Name of opcode @a op.
+     */
+    static const char *name(Opcode op);
+
+    const CodeVector &code() const { return code_; }
+    uint32_t num_temporaries() const { return num_temps_; }
+    const ConstantVector &constants() const { return constants_; }
+
+    /**
+     * @return Total number of registers used by the code.
+     */
+    uint32_t num_registers() const
+    {
+        return num_temps_ + static_cast<uint32_t>(constants_.size());
+    }
+
+    uint64_t key(uint32_t i) const { return keys_[i]; }
+    EsPropertyCache *cache(uint32_t i) const { return &caches_[i]; }
+    EsIdentifierSite *site(uint32_t i) const { return sites_[i]; }
+    EsObjectTemplate *object_template(uint32_t i) const { return templates_[i]; }
+    parser::FunctionLiteral *function(uint32_t i) const { return functions_[i]; }
+
+    /**
+     * Property keys used by the function prologue, in the order of the
+     * parameters, declarations and slots of the function literal.
+     */
+    const KeyVector &parameter_keys() const { return prm_keys_; }
+    const KeyVector &declaration_keys() const { return decl_keys_; }
+    const KeyVector &slot_keys() const { return slot_keys_; }
+
+    /**
+     * Finds the exception handler of an instruction.
+     * @param [in] pc Offset of the instruction that failed.
+     * @return Offset of the handler, or -1 if exceptions thrown by the
+     *         instruction propagate to the caller.
+     */
+    int64_t handler(uint32_t pc) const;
+};
+
+/**
+ * @brief Lowers function literals into bytecode.
+ *
+ * The lowering follows the structure of ir::Compiler: break, continue and
+ * return statements unroll the enclosing scopes, inlining finally blocks and
+ * leaving with and catch contexts on the way. Expressions are evaluated into
+ * registers; parse() returns the register holding the result, which is the
+ * requested destination register when one was given.
+ */
+class BytecodeCompiler : public parser::ValueVisitor1<int, int>
+{
+private:
+    /** Registers with this bit set refer to constants until the code has
+     * been compiled. */
+    static const int REG_CONSTANT = 1 << 30;
+
+    /**
+     * @brief Scope that break, continue and return statements may unroll.
+     */
+    struct Scope
+    {
+        enum Kind
+        {
+            KIND_DEFAULT,   ///< Labeled statement.
+            KIND_ITERATION, ///< Iteration statement.
+            KIND_SWITCH,    ///< Switch statement.
+            KIND_LEAVE,     ///< With statement or catch clause, leaves context.
+            KIND_FINALLY    ///< Try statement with finally block.
+        };
+
+        Kind kind_;
+        const parser::LabeledStatement *stmt_;  ///< Statement targeted by break and continue.
+        int brk_;           ///< Break label.
+        int cnt_;           ///< Continue label.
+        parser::Statement *finally_;    ///< Finally block.
+        int handler_;       ///< Exception handler in effect outside of the try statement.
+
+        Scope(Kind kind, const parser::LabeledStatement *stmt, int brk, int cnt)
+            : kind_(kind)
+            , stmt_(stmt)
+            , brk_(brk)
+            , cnt_(cnt)
+            , finally_(NULL)
+            , handler_(-1) {}
+    };
+
+    typedef std::vector<Scope, gc_allocator<Scope> > ScopeVector;
+
+    /**
+     * @brief Releases temporary registers allocated during its life time.
+     */
+    class TemporaryScope
+    {
+    private:
+        BytecodeCompiler *compiler_;
+        int mark_;
+
+    public:
+        TemporaryScope(BytecodeCompiler *compiler)
+            : compiler_(compiler)
+            , mark_(compiler->next_reg_) {}
+
+        ~TemporaryScope()
+        {
+            compiler_->next_reg_ = mark_;
+        }
+    };
+
+    /**
+     * @brief Reference to an identifier or a property whose object and key
+     *        have been evaluated.
+     */
+    struct Reference
+    {
+        parser::IdentifierLiteral *ident_;  ///< Identifier, NULL for property references.
+        int obj_;           ///< Object register.
+        int key_;           ///< Property key index, -1 if the key is in key_reg_.
+        int key_reg_;       ///< Property key register.
+
+        Reference(parser::IdentifierLiteral *ident)
+            : ident_(ident)
+            , obj_(-1)
+            , key_(-1)
+            , key_reg_(-1) {}
+
+        Reference(int obj, int key, int key_reg)
+            : ident_(NULL)
+            , obj_(obj)
+            , key_(key)
+            , key_reg_(key_reg) {}
+    };
+
+    typedef std::vector<int, gc_allocator<int> > IntVector;
+    typedef std::vector<std::pair<uint32_t, int>,
+                        gc_allocator<std::pair<uint32_t, int> > > FixupVector;
+    typedef std::map<uint64_t, int, std::less<uint64_t>,
+                     gc_allocator<std::pair<const uint64_t, int> > > IndexMap;
+    typedef std::map<String, int, std::less<String>,
+                     gc_allocator<std::pair<const String, int> > > StringIndexMap;
+
+    EsBytecode *code_;
+
+    int next_reg_;          ///< Next free temporary register.
+    int max_reg_;           ///< Number of temporary registers used.
+    int completion_;        ///< Register holding the completion value of eval code, -1 if not tracked.
+
+    IntVector labels_;      ///< Label offsets, -1 for unbound labels.
+    FixupVector label_fixups_;  ///< Code offsets referring to labels.
+    IntVector const_fixups_;    ///< Code offsets referring to constants.
+
+    IndexMap num_consts_;       ///< Constants by bit pattern.
+    StringIndexMap str_consts_; ///< String constants by value.
+    IndexMap keys_;             ///< Property keys by raw key.
+
+    ScopeVector scopes_;
+    IntVector handlers_;    ///< Stack of exception handler labels.
+    int range_handler_;     ///< Handler label of the open handler range, -1 if none.
+    uint32_t range_begin_;  ///< Start of the open handler range.
+
+    int alloc_reg();
+    int target(int dst);
+    int move(int dst, int src);
+
+    int constant(EsValueData val);
+    int constant(const String &str);
+    uint32_t key(const EsString *str);
+    uint32_t cache();
+    uint32_t site(parser::IdentifierLiteral *lit);
+
+    int new_label();
+    void bind(int label);
+
+    void update_handler_range();
+    void emit_op(EsBytecode::Opcode op);
+    void emit_reg(int reg);
+    void emit_imm(uint32_t imm);
+    void emit_label(int label);
+
+    void emit(EsBytecode::Opcode op);
+    void emit(EsBytecode::Opcode op, int r0);
+    void emit(EsBytecode::Opcode op, int r0, int r1);
+    void emit(EsBytecode::Opcode op, int r0, int r1, int r2);
+
+    void emit_jump(EsBytecode::Opcode op, int label);
+    void emit_jump(EsBytecode::Opcode op, int cond, int label);
+    void emit_load(parser::IdentifierLiteral *lit, int dst);
+    void emit_store(parser::IdentifierLiteral *lit, int src);
+    void emit_epilogue(size_t scope);
+
+    int unroll_for_continue(const parser::LabeledStatement *target);
+    int unroll_for_break(const parser::LabeledStatement *target);
+    void unroll_for_return();
+
+    const EsString *constant_key(parser::Expression *expr);
+
+    Reference parse_ref(parser::Expression *expr);
+    void expand_ref_get(const Reference &ref, int dst);
+    void expand_ref_put(const Reference &ref, int src);
+
+    void compile_branch(parser::Expression *expr, int label, bool jump_if);
+    void compile_body(const parser::StatementVector &body);
+    void compile_finally(parser::Statement *stmt);
+    void compile_try_catch(parser::TryStatement *stmt);
+
+private:
+    virtual int parse_binary_expr(parser::BinaryExpression *expr, int dst) override;
+    virtual int parse_unary_expr(parser::UnaryExpression *expr, int dst) override;
+    virtual int parse_assign_expr(parser::AssignmentExpression *expr, int dst) override;
+    virtual int parse_cond_expr(parser::ConditionalExpression *expr, int dst) override;
+    virtual int parse_prop_expr(parser::PropertyExpression *expr, int dst) override;
+    virtual int parse_call_expr(parser::CallExpression *expr, int dst) override;
+    virtual int parse_call_new_expr(parser::CallNewExpression *expr, int dst) override;
+    virtual int parse_regular_expr(parser::RegularExpression *expr, int dst) override;
+    virtual int parse_fun_expr(parser::FunctionExpression *expr, int dst) override;
+
+    virtual int parse_this_lit(parser::ThisLiteral *lit, int dst) override;
+    virtual int parse_ident_lit(parser::IdentifierLiteral *lit, int dst) override;
+    virtual int parse_null_lit(parser::NullLiteral *lit, int dst) override;
+    virtual int parse_bool_lit(parser::BoolLiteral *lit, int dst) override;
+    virtual int parse_num_lit(parser::NumberLiteral *lit, int dst) override;
+    virtual int parse_str_lit(parser::StringLiteral *lit, int dst) override;
+    virtual int parse_fun_lit(parser::FunctionLiteral *lit, int dst) override;
+    virtual int parse_var_lit(parser::VariableLiteral *lit, int dst) override;
+    virtual int parse_array_lit(parser::ArrayLiteral *lit, int dst) override;
+    virtual int parse_obj_lit(parser::ObjectLiteral *lit, int dst) override;
+    virtual int parse_nothing_lit(parser::NothingLiteral *lit, int dst) override;
+
+    virtual int parse_empty_stmt(parser::EmptyStatement *stmt, int dst) override;
+    virtual int parse_expr_stmt(parser::ExpressionStatement *stmt, int dst) override;
+    virtual int parse_block_stmt(parser::BlockStatement *stmt, int dst) override;
+    virtual int parse_if_stmt(parser::IfStatement *stmt, int dst) override;
+    virtual int parse_do_while_stmt(parser::DoWhileStatement *stmt, int dst) override;
+    virtual int parse_while_stmt(parser::WhileStatement *stmt, int dst) override;
+    virtual int parse_for_in_stmt(parser::ForInStatement *stmt, int dst) override;
+    virtual int parse_for_stmt(parser::ForStatement *stmt, int dst) override;
+    virtual int parse_cont_stmt(parser::ContinueStatement *stmt, int dst) override;
+    virtual int parse_break_stmt(parser::BreakStatement *stmt, int dst) override;
+    virtual int parse_ret_stmt(parser::ReturnStatement *stmt, int dst) override;
+    virtual int parse_with_stmt(parser::WithStatement *stmt, int dst) override;
+    virtual int parse_switch_stmt(parser::SwitchStatement *stmt, int dst) override;
+    virtual int parse_throw_stmt(parser::ThrowStatement *stmt, int dst) override;
+    virtual int parse_try_stmt(parser::TryStatement *stmt, int dst) override;
+    virtual int parse_dbg_stmt(parser::DebuggerStatement *stmt, int dst) override;
+
+public:
+    BytecodeCompiler();
+
+    /**
+     * Compiles the body of a function literal. Declarations and parameters
+     * are instantiated by the caller before the code is executed.
+     * @param [in] fun Function literal to compile.
+     * @param [in] eval true if @a fun is eval code, in which case the code
+     *                  returns the completion value of the last statement.
+     * @return Compiled code.
+     */
+    EsBytecode *compile(parser::FunctionLiteral *fun, bool eval);
+};
@@ -142,10 +142,19 @@ EsEvalContext::operator EsContext *()
     return EsContextStack::instance().top();
 }
 
+EsFunctionContext::EsFunctionContext(EsLexicalEnvironment *local_env,
+                                     bool strict)
+    : ctx_(EsContextStack::instance().top(), EsContext::ES_FUNCTION, strict,
+           local_env, local_env)
+{
+    EsContextStack::instance().push_fun(&ctx_);
+}
+
 EsFunctionContext::EsFunctionContext(bool strict,
-                                     EsLexicalEnvironment *scope)
+                                     EsLexicalEnvironment *scope,
+                                     bool needs_env)
+    : EsFunctionContext(needs_env ? es_new_decl_env(scope) : scope, strict)    // 10.4.3
 {
-    EsContextStack::instance().push_fun(strict, scope);
 }
 
 EsFunctionContext::~EsFunctionContext()
@@ -155,7 +164,7 @@ EsFunctionContext::~EsFunctionContext()
 
 EsFunctionContext::operator EsContext *()
 {
-    return EsContextStack::instance().top();
+    return &ctx_;
 }
 
 EsContextStack::EsContextStack()
@@ -198,13 +207,10 @@ void EsContextStack::push_eval(bool strict)
     }
 }
 
-void EsContextStack::push_fun(bool strict, EsLexicalEnvironment *scope)
+void EsContextStack::push_fun(EsContext *ctx)
 {
-    // 10.4.3
-    EsLexicalEnvironment *local_env = es_new_decl_env(scope);
-
-    stack_.push_back(new (GC)EsContext(top(), EsContext::ES_FUNCTION, strict,
-                                       local_env, local_env));
+    assert(ctx->outer() == top());
+    stack_.push_back(ctx);
 }
 
 void EsContextStack::push_catch(EsPropertyKey key, const EsValue &c)
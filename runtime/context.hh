@@ -135,10 +135,33 @@ public:
     operator EsContext *();
 };
 
+/**
+ * @brief Function execution context.
+ *
+ * The context lives in the native stack frame of the caller so entering a
+ * function never allocates a context object. If the function has no need
+ * for a declarative environment of its own it will execute directly in its
+ * [[Scope]], making the function entry entirely allocation free.
+ */
 class EsFunctionContext
 {
+private:
+    EsContext ctx_;
+
+    EsFunctionContext(EsLexicalEnvironment *local_env, bool strict);
+    EsFunctionContext(const EsFunctionContext &rhs);
+    EsFunctionContext &operator=(const EsFunctionContext &rhs);
+
 public:
-    EsFunctionContext(bool strict, EsLexicalEnvironment *scope);
+    /**
+     * Enters a function context.
+     * @param [in] strict true if the function is strict mode code.
+     * @param [in] scope [[Scope]] of the function.
+     * @param [in] needs_env true if the function needs a declarative
+     *                       environment of its own.
+     */
+    EsFunctionContext(bool strict, EsLexicalEnvironment *scope,
+                      bool needs_env = true);
     ~EsFunctionContext();
 
     operator EsContext *();
@@ -162,7 +185,11 @@ public:
 
     void push_global(bool strict);
     void push_eval(bool strict);
-    void push_fun(bool strict, EsLexicalEnvironment *scope);
+    /**
+     * Pushes a function context owned by the caller.
+     * @param [in] ctx Function context, must outlive its time on the stack.
+     */
+    void push_fun(EsContext *ctx);
     void push_catch(EsPropertyKey key, const EsValue &c);
     bool push_withT(const EsValue &val);
 
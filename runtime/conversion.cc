@@ -22,6 +22,7 @@
 #include <sstream>
 #include <gc_cpp.h>
 #include "common/cast.hh"
+#include "common/conversion.hh"
 #include "common/exception.hh"
 #include "common/lexical.hh"
 #include "conversion.hh"
@@ -51,7 +52,7 @@ double es_str_to_num(const EsString *str)
         return std::numeric_limits<double>::quiet_NaN();
     }
 
-    const uni_char *ptr = str->data();
+    const uni_char *ptr = str->c_str();
     const uni_char *end = ptr + str->length();
 
     es_str_skip_white_spaces(ptr);
@@ -83,6 +84,71 @@ double es_str_to_num(const EsString *str)
 extern "C" char *dtoa(double d, int mode, int ndigits,
                       int *decpt, int *sign, char **rve);
 
+/** Decimal representations of the numbers 00 to 99. */
+static const char digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/**
+ * Writes the decimal digits of a number backwards, two digits at a time.
+ * @param [in] num Number to convert.
+ * @param [in] end Pointer past the last digit.
+ * @return Pointer to the first digit.
+ */
+static uni_char *es_uint_to_digits(uint64_t num, uni_char *end)
+{
+    while (num >= 100)
+    {
+        size_t i = static_cast<size_t>(num % 100) * 2;
+        num /= 100;
+
+        *--end = static_cast<uni_char>(digit_pairs[i + 1]);
+        *--end = static_cast<uni_char>(digit_pairs[i]);
+    }
+
+    if (num >= 10)
+    {
+        size_t i = static_cast<size_t>(num) * 2;
+        *--end = static_cast<uni_char>(digit_pairs[i + 1]);
+        *--end = static_cast<uni_char>(digit_pairs[i]);
+    }
+    else
+    {
+        *--end = static_cast<uni_char>('0' + num);
+    }
+
+    return end;
+}
+
+/**
+ * Strings of the smallest non-negative integers, created on first use.
+ */
+static const EsString *uint_strs[ES_UINT_STR_CACHE_SIZE];
+
+const EsString *es_uint_to_str(uint32_t num)
+{
+    if (num < ES_UINT_STR_CACHE_SIZE && uint_strs[num])
+        return uint_strs[num];
+
+    uni_char buf[10];
+    uni_char *end = buf + 10;
+    uni_char *beg = es_uint_to_digits(num, end);
+
+    const EsString *str = EsString::create(beg, static_cast<size_t>(end - beg));
+    if (num < ES_UINT_STR_CACHE_SIZE)
+        uint_strs[num] = str;
+
+    return str;
+}
+
 const EsString *es_num_to_str(double m, int num_digits)
 {
     // 9.8.1
@@ -92,25 +158,54 @@ const EsString *es_num_to_str(double m, int num_digits)
     if (m == 0.0 || m == -0.0)
         return _ESTR("0");
     
-    if (m < 0.0)
-        return _ESTR("-")->concat(es_num_to_str(-m, num_digits));
-    
     if (std::isinf(m))
-        return _ESTR("Infinity");
+        return m < 0.0 ? _ESTR("-Infinity") : _ESTR("Infinity");
 
     bool fixed = num_digits != INT_MIN;
 
-    int point = 0, sign = 0;
-    char *end_ptr = NULL;
-    char *beg_ptr = dtoa(m,
-                         fixed ? 3 : 0,
-                         fixed ? num_digits : 0,
-                         &point, &sign, &end_ptr);
-    
-    int length = static_cast<int>(end_ptr - beg_ptr);
+    // Integers below 2^53 are printed exactly by 9.8.1:6.
+    if (!fixed && m >= -9007199254740992.0 && m <= 9007199254740992.0)
+    {
+        int64_t i = static_cast<int64_t>(m);
+        if (static_cast<double>(i) == m)
+        {
+            if (i > 0 && i <= static_cast<int64_t>(UINT32_MAX))
+                return es_uint_to_str(static_cast<uint32_t>(i));
+
+            uni_char buf[20];
+            uni_char *end = buf + 20;
+            uni_char *beg = es_uint_to_digits(
+                static_cast<uint64_t>(i < 0 ? -i : i), end);
+            if (i < 0)
+                *--beg = '-';
+
+            return EsString::create(beg, static_cast<size_t>(end - beg));
+        }
+    }
 
     EsStringBuilder sb;
-    
+
+    if (m < 0.0)
+    {
+        sb.append(_U('-'));
+        m = -m;
+    }
+
+    // Try the fast shortest representation first, dtoa is exact but slow.
+    char shortest[32];
+    const char *beg_ptr = shortest;
+    int length = 0, point = 0;
+    if (fixed || !es_num_to_shortest(m, shortest, length, point))
+    {
+        int sign = 0;
+        char *end_ptr = NULL;
+        beg_ptr = dtoa(m,
+                       fixed ? 3 : 0,
+                       fixed ? num_digits : 0,
+                       &point, &sign, &end_ptr);
+        length = static_cast<int>(end_ptr - beg_ptr);
+    }
+
     // 9.8.1:6
     if (length <= point && point <= 21)
     {
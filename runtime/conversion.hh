@@ -32,6 +32,19 @@ class EsString;
  */
 double es_str_to_num(const EsString *str);
 
+/**
+ * Number of integer strings that are cached by es_uint_to_str().
+ */
+#define ES_UINT_STR_CACHE_SIZE  1024
+
+/**
+ * Converts an unsigned integer to a string value. Strings of integers below
+ * ES_UINT_STR_CACHE_SIZE are shared.
+ * @param [in] num Value to convert.
+ * @return num converted to a string value.
+ */
+const EsString *es_uint_to_str(uint32_t num);
+
 /**
  * Converts a double value to a string value.
  * @param [in] m Value to convert.
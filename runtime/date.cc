@@ -60,7 +60,7 @@ double es_date_parse(const EsString *str)
     if (rem < 4)
         return std::numeric_limits<double>::quiet_NaN();
 
-    const uni_char *ptr = str->data();
+    const uni_char *ptr = str->c_str();
     if (!es_is_dec_number(ptr, 4))
         return std::numeric_limits<double>::quiet_NaN();
 
@@ -26,8 +26,11 @@
 #include "property.hh"
 #include "utility.hh"
 
+uint32_t EsDeclarativeEnvironmentRecord::removable_epoch_ = 0;
+
 EsDeclarativeEnvironmentRecord::EsDeclarativeEnvironmentRecord()
     : storage_(NULL)
+    , slots_(NULL)
 {
 }
 
@@ -41,6 +44,9 @@ void EsDeclarativeEnvironmentRecord::link_mutable_binding(const EsPropertyKey &n
             *v = *it->second.val_;
     }
 
+    if (d)
+        removable_epoch_++;
+
     variables_.insert(std::make_pair(n, Value(v, true, d)));
 }
 
@@ -58,9 +64,27 @@ bool EsDeclarativeEnvironmentRecord::has_binding(const EsPropertyKey &n)
     return variables_.count(n) > 0;
 }
 
+bool EsDeclarativeEnvironmentRecord::has_removable_binding(const EsPropertyKey &n)
+{
+    VariableMap::iterator it = variables_.find(n);
+    return it != variables_.end() && it->second.removable_;
+}
+
+EsValue *EsDeclarativeEnvironmentRecord::mutable_binding_value(const EsPropertyKey &n)
+{
+    VariableMap::iterator it = variables_.find(n);
+    if (it == variables_.end() || !it->second.mutable_)
+        return NULL;
+
+    return it->second.val_;
+}
+
 void EsDeclarativeEnvironmentRecord::create_mutable_binding(const EsPropertyKey &n, bool d)
 {
     assert(variables_.count(n) == 0);
+    if (d)
+        removable_epoch_++;
+
     variables_.insert(std::make_pair(n, Value(new (GC)EsValue(EsValue::undefined), true, d)));  // FIXME: HEAP
 }
 
@@ -134,6 +158,7 @@ bool EsDeclarativeEnvironmentRecord::delete_bindingT(const EsPropertyKey &n, boo
     }
 
     variables_.erase(n);
+    removable_epoch_++;
 
     deleted = true;
     return true;
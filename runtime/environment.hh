@@ -69,8 +69,11 @@ private:
                      gc_allocator<std::pair<EsPropertyKey, Value> > > VariableMap;  // FIXME: unordered_map?
 
     EsValue *storage_;      ///< Memory for storing values.
+    EsValue **slots_;       ///< Binding values in slot order, used by the evaluator.
     VariableMap variables_;
 
+    static uint32_t removable_epoch_;   ///< Removable binding epoch.
+
 public:
     EsDeclarativeEnvironmentRecord();
     virtual ~EsDeclarativeEnvironmentRecord() {}
@@ -85,6 +88,33 @@ public:
         return storage_;
     }
 
+    void set_slots(EsValue **slots)
+    {
+        slots_ = slots;
+    }
+
+    /**
+     * @return Binding values of statically resolved identifiers, indexed by
+     *         slot, or NULL if the record has no slots.
+     */
+    EsValue **slots()
+    {
+        return slots_;
+    }
+
+    /**
+     * Returns the current removable binding epoch. The epoch is advanced
+     * every time a removable binding, which can only be introduced by eval
+     * code, is created or deleted in any declarative environment record. It
+     * allows context caches to detect when a record that was skipped during a
+     * cached lookup might have started shadowing the cached binding.
+     * @return Removable binding epoch.
+     */
+    static uint32_t removable_epoch()
+    {
+        return removable_epoch_;
+    }
+
     virtual bool is_decl_env() override
     {
         return true;
@@ -105,6 +135,22 @@ public:
      */
     virtual EsValue implicit_this_value() const override;
 
+    /**
+     * Determines if an environment record has a binding that may be deleted.
+     * @param [in] n Bound name.
+     * @return true if a removable binding exists for the identifier and false
+     *         otherwise.
+     */
+    bool has_removable_binding(const EsPropertyKey &n);
+
+    /**
+     * Returns the location of the value of a mutable binding.
+     * @param [in] n Bound name.
+     * @return Pointer to value storage, or NULL if no mutable binding exists
+     *         for the identifier.
+     */
+    EsValue *mutable_binding_value(const EsPropertyKey &n);
+
     /**
      * Creates a new mutable binding in an environment record, linked to a pre-
      * allocated value in memory. If a binding already exist, the value of the
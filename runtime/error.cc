@@ -58,7 +58,7 @@ EsError::~EsError()
 void EsError::make_proto()
 {
     prototype_ = es_proto_obj();    // VERIFIED: 15.11.4
-    class_ = _USTR("Error");        // VERIFIED: 15.11.4
+    class_ = CLASS_ERROR;           // VERIFIED: 15.11.4
     extensible_ = true;
     
     // 15.11.4
@@ -87,7 +87,7 @@ EsError *EsError::create_inst(const EsString *message)
     EsError *e = new (GC)EsError(message);
     
     e->prototype_ = es_proto_err(); // VERIFIED: 15.11.5
-    e->class_ = _USTR("Error");     // VERIFIED: 15.11.5
+    e->class_ = CLASS_ERROR;        // VERIFIED: 15.11.5
     e->extensible_ = true;
     
     if (!message->empty())
@@ -126,7 +126,7 @@ template <typename T>
 void EsNativeError<T>::make_proto()
 {
     prototype_ = es_proto_err();    // VERIFIED: 15.11.7.7
-    class_ = _USTR("Error");        // VERIFIED: 15.11.7.7
+    class_ = CLASS_ERROR;           // VERIFIED: 15.11.7.7
     extensible_ = true;
     
     // 15.11.7
@@ -153,7 +153,7 @@ T *EsNativeError<T>::create_inst(const EsString *message)
     T *e = new (GC)T(message);
     
     e->prototype_ = T::prototype(); // VERIFIED: 15.11.7.2
-    e->class_ = _USTR("Error");     // VERIFIED: 15.11.7.2
+    e->class_ = CLASS_ERROR;        // VERIFIED: 15.11.7.2
     e->extensible_ = true;          // VERIFIED: 15.11.7.2
 
     if (!message->empty())
@@ -188,7 +188,7 @@ EsFunction *EsErrorConstructor<T>::create_inst()
     EsErrorConstructor *f = new (GC)EsErrorConstructor(es_global_env(), T::default_fun_, 1, false);
 
     f->prototype_ = es_proto_fun();     // VERIFIED: 15.11.7.5
-    f->class_ = _USTR("Function");
+    f->class_ = CLASS_FUNCTION;
     f->extensible_ = true;
     
     // 15.11.7
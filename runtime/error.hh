@@ -40,7 +40,7 @@ template <typename T>
 void es_throw(const char *file, int line, const EsString *orig_message)
 {
     const EsString *message = EsStringBuilder::sprintf(
-            "[%s:%d] %S", file, line, orig_message->data());
+            "[%s:%d] %S", file, line, orig_message->c_str());
 #else
 inline void es_throw(const EsString *message)
 {
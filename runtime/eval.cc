@@ -16,10 +16,10 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <memory>
 #include <string.h>
 #include <gc_cpp.h>
 #include "common/cast.hh"
+#include "bytecode.hh"
 #include "context.hh"
 #include "conversion.hh"
 #include "error.hh"
@@ -27,1577 +27,657 @@
 #include "frame.hh"
 #include "operation.h"
 #include "property.hh"
+#include "resolver.hh"
 #include "utility.hh"
 
 using parser::Declaration;
-using parser::ExpressionVector;
-using parser::StatementVector;
-
-// NOTE: Copied from header to satisfy Eclipse CDT.
-using parser::ArrayLiteral;
-using parser::AssignmentExpression;
-using parser::BinaryExpression;
-using parser::BlockStatement;
-using parser::BoolLiteral;
-using parser::BreakStatement;
-using parser::CallExpression;
-using parser::CallNewExpression;
-using parser::ConditionalExpression;
-using parser::ContinueStatement;
-using parser::DebuggerStatement;
 using parser::DeclarationVector;
-using parser::DoWhileStatement;
-using parser::EmptyStatement;
-using parser::ExpressionStatement;
-using parser::ForInStatement;
-using parser::ForStatement;
-using parser::FunctionExpression;
 using parser::FunctionLiteral;
-using parser::IdentifierLiteral;
-using parser::IfStatement;
-using parser::LabeledStatement;
-using parser::LabeledStatementVector;
-using parser::ObjectLiteral;
-using parser::NothingLiteral;
-using parser::NullLiteral;
-using parser::NumberLiteral;
-using parser::PropertyExpression;
-using parser::RegularExpression;
-using parser::ReturnStatement;
-using parser::StringLiteral;
-using parser::SwitchStatement;
-using parser::ThisLiteral;
-using parser::ThrowStatement;
-using parser::TryStatement;
-using parser::UnaryExpression;
-using parser::VariableLiteral;
-using parser::WhileStatement;
-using parser::WithStatement;
-
-using parser::ValueVisitor;
-
-#ifndef RETHROW_IF
-#define RETHROW_IF(expr)\
-if (expr)\
-    return Completion(Completion::TYPE_THROW,\
-                      esa_ex_get(EsContextStack::instance().top()));
+
+/*
+ * The interpreter uses computed gotos where available, which gives every
+ * instruction its own indirect branch. Other compilers dispatch through a
+ * switch statement.
+ */
+#if defined(__GNUC__)
+#define ES_BYTECODE_THREADED
 #endif
 
 Evaluator::Evaluator(FunctionLiteral *code, Type type, EsCallFrame &frame)
     : code_(code)
     , type_(type)
     , frame_(frame)
+    , slots_(NULL)
+    , scope_(NULL)
 {
     assert(code_);
 }
 
-bool Evaluator::is_in_iteration() const
+EsValue **Evaluator::outer_slots(uint32_t depth)
 {
-    std::vector<Scope>::const_reverse_iterator it;
-    for (it = scopes_.rbegin(); it != scopes_.rend(); ++it)
-    {
-        if (*it == SCOPE_ITERATION)
-            return true;
-    }
+    assert(depth > 0);
+
+    // Outer function scopes are found through the scope of the callee,
+    // see esa_bnd_extra_ptr().
+    EsLexicalEnvironment *env = frame_.callee().as_function()->scope();
+    for (uint32_t i = 1; i < depth; i++)
+        env = env->outer();
 
-    return false;
+    assert(env);
+    assert(env->env_rec()->is_decl_env());
+    return static_cast<EsDeclarativeEnvironmentRecord *>(
+        env->env_rec())->slots();
 }
 
-bool Evaluator::is_in_switch() const
+EsContextCache *Evaluator::site_cache(EsIdentifierSite *site)
 {
-    std::vector<Scope>::const_reverse_iterator it;
-    for (it = scopes_.rbegin(); it != scopes_.rend(); ++it)
+    // The environments between the current one and the scope are created by
+    // this code and look the same every time the site is reached. Past the
+    // scope, the cached lookup is only valid for the scope it was made in.
+    if (site->scope != scope_)
     {
-        if (*it == SCOPE_SWITCH)
-            return true;
+        site->cache.state = ESA_CTX_CACHE_EMPTY;
+        site->scope = scope_;
     }
 
-    return false;
+    return &site->cache;
 }
 
-bool Evaluator::expand_ref_get(const EsReferenceOrValue &any, EsValueData &value)
+EsFunction *Evaluator::new_function(EsContext *ctx, FunctionLiteral *lit)
 {
-    if (any.is_value())
-    {
-        value = any.value();
-        return true;
-    }
+    if (lit->type() == FunctionLiteral::TYPE_DECLARATION)
+        return EsFunction::create_inst(ctx->var_env(), lit);
 
-    const EsReference &ref = any.reference();
-    if (ref.get_base())
-    {
-        return esa_prp_get(es_value_from_object(ref.get_base()),
-                          EsPropertyKey::from_str(ref.get_referenced_name()).as_raw(),
-                          &value, 0);
-    }
-    else
-    {
-        return esa_ctx_get(EsContextStack::instance().top(),
-                  EsPropertyKey::from_str(ref.get_referenced_name()).as_raw(), &value, 0);
-    }
-}
+    if (lit->name().empty())
+        return EsFunction::create_inst(ctx->lex_env(), lit);
 
-bool Evaluator::expand_ref_put(const EsReferenceOrValue &any, const EsValueData &value)
-{
-    assert(any.is_reference());
+    EsLexicalEnvironment *fun_env = es_new_decl_env(ctx->lex_env());
 
-    const EsReference &ref = any.reference();
-    if (ref.get_base())
-    {
-        // If we have a base object it must be a property reference.
-        return esa_prp_put(EsContextStack::instance().top(),
-                          es_value_from_object(ref.get_base()),
-                          EsPropertyKey::from_str(ref.get_referenced_name()).as_raw(),
-                          value, 0);
-    }
-    else
-    {
-        return esa_ctx_put(EsContextStack::instance().top(),
-                          EsPropertyKey::from_str(ref.get_referenced_name()).as_raw(), value, 0);
-    }
-}
+    EsFunction *fun = EsFunction::create_inst(fun_env, lit);
 
-Completion Evaluator::parse_binary_expr(BinaryExpression *expr)
-{
-    EsValueData r = es_value_undefined();
+    assert(fun_env->env_rec()->is_decl_env());
+    EsDeclarativeEnvironmentRecord *env =
+        static_cast<EsDeclarativeEnvironmentRecord *>(fun_env->env_rec());
 
-    Completion lhs_res = parse(expr->left());
-    if (lhs_res.is_abrupt())
-        return lhs_res;
+    env->create_immutable_binding(
+            EsPropertyKey::from_str(EsString::create(lit->name())),
+            EsValue::from_obj(fun));
+    return fun;
+}
 
-    EsValueData lval;
-    RETHROW_IF(!expand_ref_get(lhs_res.value(), lval));
+void Evaluator::declare(EsContext *ctx, const EsBytecode *code)
+{
+    const DeclarationVector &decls = code_->declarations();
+    const EsBytecode::KeyVector &keys = code->declaration_keys();
+    assert(decls.size() == keys.size());
 
-    switch (expr->operation())
+    // Visit functions first to comply with Declaration Binding instantiation (10.5).
+    for (size_t i = 0; i < decls.size(); i++)
     {
-        case BinaryExpression::COMMA:
-        {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            r = rval;
-            break;
-        }
-
-        // Arithmetic.
-        case BinaryExpression::MUL:
-        {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_b_mul(lval, rval, &r));
-            break;
-        }
-        case BinaryExpression::DIV:
-        {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_b_div(lval, rval, &r));
-            break;
-        }
-        case BinaryExpression::MOD:
-        {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_b_mod(lval, rval, &r));
-            break;
-        }
-        case BinaryExpression::ADD:
-        {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_b_add(lval, rval, &r));
-            break;
-        }
-        case BinaryExpression::SUB:
-        {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_b_sub(lval, rval, &r));
-            break;
-        }
-        case BinaryExpression::LS:  // <<
-        {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_b_shl(lval, rval, &r));
-            break;
-        }
-        case BinaryExpression::RSS: // >>
-        {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_b_sar(lval, rval, &r));
-            break;
-        }
-        case BinaryExpression::RUS: // >>>
+        const Declaration *decl = decls[i];
+        if (decl->is_function())
         {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_b_shr(lval, rval, &r));
-            break;
+            esa_ctx_decl_fun(
+                    ctx,
+                    type_ == TYPE_EVAL,
+                    code_->is_strict_mode(),
+                    keys[i],
+                    es_value_from_object(new_function(ctx, decl->as_function())));
         }
+    }
 
-        // Relational.
-        case BinaryExpression::LT:
-        {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_c_lt(lval, rval, &r));
-            break;
-        }
-        case BinaryExpression::GT:
-        {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_c_gt(lval, rval, &r));
-            break;
-        }
-        case BinaryExpression::LTE:
-        {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_c_lte(lval, rval, &r));
-            break;
-        }
-        case BinaryExpression::GTE:
-        {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_c_gte(lval, rval, &r));
-            break;
-        }
-        case BinaryExpression::IN:
-        {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_c_in(lval, rval, &r));
-            break;
-        }
-        case BinaryExpression::INSTANCEOF:
+    for (size_t i = 0; i < decls.size(); i++)
+    {
+        if (decls[i]->is_variable())
         {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_c_instance_of(lval, rval, &r));
-            break;
+            esa_ctx_decl_var(
+                    ctx,
+                    type_ == TYPE_EVAL,
+                    code_->is_strict_mode(),
+                    keys[i]);
         }
+    }
+}
 
-        // Equality.
-        case BinaryExpression::EQ:
-        {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_c_eq(lval, rval, &r));
-            break;
-        }
-        case BinaryExpression::NEQ:
-        {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_c_neq(lval, rval, &r));
-            break;
-        }
-        case BinaryExpression::STRICT_EQ:
-        {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_c_strict_eq(lval, rval, &r));
-            break;
-        }
-        case BinaryExpression::STRICT_NEQ:
-        {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_c_strict_neq(lval, rval, &r));
-            break;
-        }
+bool Evaluator::run(EsContext *ctx, const EsBytecode *code)
+{
+    // Register file: temporaries followed by constants.
+    uint32_t num_regs = code->num_registers();
 
-        // Bitwise.
-        case BinaryExpression::BIT_AND:
-        {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_b_and(lval, rval, &r));
-            break;
-        }
-        case BinaryExpression::BIT_XOR:
-        {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_b_xor(lval, rval, &r));
-            break;
-        }
-        case BinaryExpression::BIT_OR:
-        {
-            Completion rhs_res = parse(expr->right());
-            if (rhs_res.is_abrupt())
-                return rhs_res;
-
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-            RETHROW_IF(!esa_b_or(lval, rval, &r));
-            break;
-        }
+    EsValueData *regs = g_call_stack.next();
+    if (!g_call_stack.allocT(num_regs))
+        return false;
 
-        // Logical.
-        case BinaryExpression::LOG_AND:
-        {
-            // Short-circuit evaluation.
-            if (!esa_val_to_bool(lval))
-            {
-                r = lval;
-            }
-            else
-            {
-                Completion rhs_res = parse(expr->right());
-                if (rhs_res.is_abrupt())
-                    return rhs_res;
-
-                // FIXME: rval necessary?
-                EsValueData rval;
-                RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-                r = rval;
-            }
-            break;
-        }
-        case BinaryExpression::LOG_OR:
-        {
-            // Short-circuit evaluation.
-            if (esa_val_to_bool(lval))
-            {
-                r = lval;
-            }
-            else
-            {
-                Completion rhs_res = parse(expr->right());
-                if (rhs_res.is_abrupt())
-                    return rhs_res;
-
-                // FIXME: rval necessary?
-                EsValueData rval;
-                RETHROW_IF(!expand_ref_get(rhs_res.value(), rval));
-                r = rval;
-            }
-            break;
-        }
+    EsCallStackGuard guard(num_regs);
 
-        default:
-            assert(false);
-            break;
+    if (!code->constants().empty())
+    {
+        memcpy(regs + code->num_temporaries(), &code->constants()[0],
+               sizeof(EsValueData) * code->constants().size());
     }
 
-    return Completion(Completion::TYPE_NORMAL, r);
-}
+    const uint32_t *base = &code->code()[0];
+    const uint32_t *ip = base;
 
-Completion Evaluator::parse_unary_expr(UnaryExpression *expr)
-{
-    EsValueData t;
+#define REG(i)      regs[ip[i]]
+#define NUM(i)      es_value_as_number(REG(i))
+#define I32(i)      static_cast<int32_t>(es_value_as_number(REG(i)))
+#define SHIFT(i)    (static_cast<uint32_t>(I32(i)) & 0x1f)
 
-    if (expr->operation() == UnaryExpression::DELETE)
+#ifdef ES_BYTECODE_THREADED
+    static const void *const ops[] =
     {
-        if (PropertyExpression *prop =
-            dynamic_cast<PropertyExpression *>(expr->expression()))
-        {
-            Completion key_res = parse(prop->key());
-            if (key_res.is_abrupt())
-                return key_res;
-            EsReferenceOrValue key = key_res.value();
-
-            Completion obj_res = parse(prop->object());
-            if (obj_res.is_abrupt())
-                return obj_res;
-            EsReferenceOrValue obj = obj_res.value();
+#define ES_OPCODE_LABEL(name, num_operands) &&op_##name,
+        ES_OPCODES(ES_OPCODE_LABEL)
+#undef ES_OPCODE_LABEL
+    };
 
-            EsValueData key_val;
-            RETHROW_IF(!expand_ref_get(key, key_val));
-
-            EsValueData obj_val;
-            RETHROW_IF(!expand_ref_get(obj, obj_val));
+#define DISPATCH()  goto *ops[*ip]
+#define CASE(name)  op_##name:
+#else
+#define DISPATCH()  goto dispatch
+#define CASE(name)  case EsBytecode::OP_##name:
+#endif
 
-            RETHROW_IF(!esa_val_chk_coerc(obj_val));
+#define NEXT(num_operands)              \
+    ip += (num_operands) + 1;           \
+    DISPATCH();
+
+#define JUMP(target)                    \
+    ip = base + (target);               \
+    DISPATCH();
+
+    // Binary operators with a fast path for number operands, see
+    // Cgenerator::write_fast_bin().
+#define BINARY_NUM(name, fun, op)                                       \
+    CASE(name)                                                          \
+    {                                                                   \
+        if (es_value_is_number(REG(2)) && es_value_is_number(REG(3)))   \
+            REG(1) = es_value_from_number(NUM(2) op NUM(3));            \
+        else if (!fun(REG(2), REG(3), &REG(1)))                         \
+            goto fail;                                                  \
+        NEXT(3);                                                        \
+    }
+
+#define BINARY_CMP(name, fun, op)                                       \
+    CASE(name)                                                          \
+    {                                                                   \
+        if (es_value_is_number(REG(2)) && es_value_is_number(REG(3)))   \
+            REG(1) = es_value_from_boolean(NUM(2) op NUM(3));           \
+        else if (!fun(REG(2), REG(3), &REG(1)))                         \
+            goto fail;                                                  \
+        NEXT(3);                                                        \
+    }
+
+#define BINARY_I32(name, fun, expr)                                     \
+    CASE(name)                                                          \
+    {                                                                   \
+        if (es_value_is_i32_range(REG(2)) && es_value_is_i32_range(REG(3))) \
+            REG(1) = es_value_from_number(expr);                        \
+        else if (!fun(REG(2), REG(3), &REG(1)))                         \
+            goto fail;                                                  \
+        NEXT(3);                                                        \
+    }
+
+#define BINARY_SLOW(name, fun)                                          \
+    CASE(name)                                                          \
+    {                                                                   \
+        if (!fun(REG(2), REG(3), &REG(1)))                              \
+            goto fail;                                                  \
+        NEXT(3);                                                        \
+    }
+
+#ifdef ES_BYTECODE_THREADED
+    DISPATCH();
+#else
+dispatch:
+    switch (*ip)
+    {
+#endif
 
-            RETHROW_IF(!esa_prp_del_slow(EsContextStack::instance().top(),
-                                        obj_val, key_val, &t));
-        }
-        else if (IdentifierLiteral * ident =
-            dynamic_cast<IdentifierLiteral *>(expr->expression()))
+    // Moves and loads.
+    CASE(MOV)
+    {
+        REG(1) = REG(2);
+        NEXT(2);
+    }
+    CASE(LD_THIS)
+    {
+        REG(1) = frame_.this_value();
+        NEXT(1);
+    }
+    CASE(LD_SLOT)
+    {
+        // Bindings without a value location, such as immutable ones, are
+        // accessed by name.
+        EsValue **slots = ip[2] == 0 ? slots_ : outer_slots(ip[2]);
+        if (slots && slots[ip[3]])
         {
-            RETHROW_IF(!esa_ctx_del(EsContextStack::instance().top(),
-                    EsPropertyKey::from_str(
-                            EsString::create(ident->value())).as_raw(), &t));
+            REG(1) = *slots[ip[3]];
         }
         else
         {
-            t = es_value_from_boolean(true);
+            EsIdentifierSite *site = code->site(ip[4]);
+            if (!esa_ctx_get(ctx, site->key, &REG(1), site_cache(site)))
+                goto fail;
         }
-
-        return Completion(Completion::TYPE_NORMAL, t);
+        NEXT(4);
     }
-
-    Completion expr_res = parse(expr->expression());
-    if (expr_res.is_abrupt())
-        return expr_res;
-
-    switch (expr->operation())
+    CASE(ST_SLOT)
     {
-        case UnaryExpression::VOID:
-        {
-            EsValueData tmp;
-            RETHROW_IF(!expand_ref_get(expr_res.value(), tmp));
-            t = es_value_undefined();
-            break;
-        }
-        case UnaryExpression::TYPEOF:
-        {
-            EsValueData v;
-            if (expr_res.value().is_reference())
-            {
-                if (!expand_ref_get(expr_res.value(), v))
-                {
-                    esa_ex_clear(EsContextStack::instance().top());
-                    v = es_value_undefined();
-                }
-            }
-            else
-            {
-                v = expr_res.value().value();
-            }
-
-            RETHROW_IF(!esa_u_typeof(v, &t));
-            break;
-        }
-        case UnaryExpression::PRE_INC:
-        {
-            EsValueData rval;
-            double old_val = 0.0;
-            RETHROW_IF(!expand_ref_get(expr_res.value(), rval) ||
-                       !esa_val_to_num(rval, &old_val));
-
-            double new_val = old_val + 1.0f;
-
-            t = es_value_from_number(new_val);
-            RETHROW_IF(!expand_ref_put(expr_res.value(), t));
-            break;
-        }
-        case UnaryExpression::PRE_DEC:
+        EsValue **slots = ip[1] == 0 ? slots_ : outer_slots(ip[1]);
+        if (slots && slots[ip[2]])
         {
-            EsValueData rval;
-            double old_val = 0.0;
-            RETHROW_IF(!expand_ref_get(expr_res.value(), rval) ||
-                       !esa_val_to_num(rval, &old_val));
-
-            double new_val = old_val - 1.0f;
-
-            t = es_value_from_number(new_val);
-            RETHROW_IF(!expand_ref_put(expr_res.value(), t));
-            break;
+            *slots[ip[2]] = static_cast<const EsValue &>(REG(3));
         }
-        case UnaryExpression::POST_INC:
+        else
         {
-            EsValueData rval;
-            double old_val = 0.0;
-            RETHROW_IF(!expand_ref_get(expr_res.value(), rval) ||
-                       !esa_val_to_num(rval, &old_val));
-
-            double new_val = old_val + 1.0f;
-
-            RETHROW_IF(!expand_ref_put(expr_res.value(),
-                                       es_value_from_number(new_val)));
-
-            t = es_value_from_number(old_val);
-            break;
+            EsIdentifierSite *site = code->site(ip[4]);
+            if (!esa_ctx_put(ctx, site->key, REG(3), site_cache(site)))
+                goto fail;
         }
-        case UnaryExpression::POST_DEC:
-        {
-            EsValueData rval;
-            double old_val = 0.0;
-            RETHROW_IF(!expand_ref_get(expr_res.value(), rval) ||
-                       !esa_val_to_num(rval, &old_val));
-
-            double new_val = old_val - 1.0f;
-
-            RETHROW_IF(!expand_ref_put(expr_res.value(),
-                                       es_value_from_number(new_val)));
+        NEXT(4);
+    }
+    CASE(LD_NAME)
+    {
+        EsIdentifierSite *site = code->site(ip[2]);
+        if (!esa_ctx_get(ctx, site->key, &REG(1), site_cache(site)))
+            goto fail;
+        NEXT(2);
+    }
+    CASE(ST_NAME)
+    {
+        EsIdentifierSite *site = code->site(ip[1]);
+        if (!esa_ctx_put(ctx, site->key, REG(2), site_cache(site)))
+            goto fail;
+        NEXT(2);
+    }
+    CASE(DEL_NAME)
+    {
+        if (!esa_ctx_del(ctx, code->site(ip[2])->key, &REG(1)))
+            goto fail;
+        NEXT(2);
+    }
+    CASE(TYPEOF_NAME)
+    {
+        // Unresolvable references have the type undefined.
+        EsIdentifierSite *site = code->site(ip[2]);
 
-            t = es_value_from_number(old_val);
-            break;
-        }
-        case UnaryExpression::PLUS:
-        {
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(expr_res.value(), rval) ||
-                       !esa_u_add(rval, &t));
-            break;
-        }
-        case UnaryExpression::MINUS:
-        {
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(expr_res.value(), rval) ||
-                       !esa_u_sub(rval, &t));
-            break;
-        }
-        case UnaryExpression::BIT_NOT:
-        {
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(expr_res.value(), rval) ||
-                       !esa_u_bit_not(rval, &t));
-            break;
-        }
-        case UnaryExpression::LOG_NOT:
+        EsValueData val;
+        if (!esa_ctx_get(ctx, site->key, &val, site_cache(site)))
         {
-            EsValueData rval;
-            RETHROW_IF(!expand_ref_get(expr_res.value(), rval) ||
-                       !esa_u_not(rval, &t));
-            break;
+            esa_ex_clear(ctx);
+            val = es_value_undefined();
         }
 
-        default:
-            assert(false);
-            break;
+        if (!esa_u_typeof(val, &REG(1)))
+            goto fail;
+        NEXT(2);
     }
 
-    return Completion(Completion::TYPE_NORMAL, t);
-}
-
-Completion Evaluator::parse_assign_expr(AssignmentExpression *expr)
-{
-    EsValueData t;
-
-    Completion lhs_res = parse(expr->lhs());
-    if (lhs_res.is_abrupt())
-        return lhs_res;
-    EsReferenceOrValue l = lhs_res.value();
-
-    Completion rhs_res = parse(expr->rhs());
-    if (rhs_res.is_abrupt())
-        return rhs_res;
-    EsReferenceOrValue r = rhs_res.value();
-
-    if (expr->operation() == AssignmentExpression::ASSIGN)
+    // Properties.
+    CASE(GET)
     {
-        RETHROW_IF(!expand_ref_get(r, t) || !expand_ref_put(l, t));
+        if (!esa_prp_get(REG(2), code->key(ip[3]), &REG(1), code->cache(ip[4])))
+            goto fail;
+        NEXT(4);
     }
-    else
+    CASE(GET_ELM)
     {
-        EsValueData lval, rval;
-        RETHROW_IF(!expand_ref_get(l, lval) || !expand_ref_get(r, rval));
-
-        switch (expr->operation())
-        {
-            case AssignmentExpression::ASSIGN_ADD:
-                RETHROW_IF(!esa_b_add(lval, rval, &t) || !expand_ref_put(l, t));
-                break;
-            case AssignmentExpression::ASSIGN_SUB:
-                RETHROW_IF(!esa_b_sub(lval, rval, &t) || !expand_ref_put(l, t));
-                break;
-            case AssignmentExpression::ASSIGN_MUL:
-                RETHROW_IF(!esa_b_mul(lval, rval, &t) || !expand_ref_put(l, t));
-                break;
-            case AssignmentExpression::ASSIGN_MOD:
-                RETHROW_IF(!esa_b_mod(lval, rval, &t) || !expand_ref_put(l, t));
-                break;
-            case AssignmentExpression::ASSIGN_LS:
-                RETHROW_IF(!esa_b_shl(lval, rval, &t) || !expand_ref_put(l, t));
-                break;
-            case AssignmentExpression::ASSIGN_RSS:
-                RETHROW_IF(!esa_b_sar(lval, rval, &t) || !expand_ref_put(l, t));
-                break;
-            case AssignmentExpression::ASSIGN_RUS:
-                RETHROW_IF(!esa_b_shr(lval, rval, &t) || !expand_ref_put(l, t));
-                break;
-            case AssignmentExpression::ASSIGN_BIT_AND:
-                RETHROW_IF(!esa_b_and(lval, rval, &t) || !expand_ref_put(l, t));
-                break;
-            case AssignmentExpression::ASSIGN_BIT_OR:
-                RETHROW_IF(!esa_b_or(lval, rval, &t) || !expand_ref_put(l, t));
-                break;
-            case AssignmentExpression::ASSIGN_BIT_XOR:
-                RETHROW_IF(!esa_b_xor(lval, rval, &t) || !expand_ref_put(l, t));
-                break;
-            case AssignmentExpression::ASSIGN_DIV:
-                RETHROW_IF(!esa_b_div(lval, rval, &t) || !expand_ref_put(l, t));
-                break;
-
-            default:
-                assert(false);
-                break;
-        }
+        if (!esa_prp_get_elm(REG(2), REG(3), &REG(1), code->cache(ip[4])))
+            goto fail;
+        NEXT(4);
     }
-
-    return Completion(Completion::TYPE_NORMAL, t);
-}
-
-Completion Evaluator::parse_cond_expr(ConditionalExpression *expr)
-{
-    Completion cond_res = parse(expr->condition());
-    if (cond_res.is_abrupt())
-        return cond_res;
-
-    EsValueData cond;
-    RETHROW_IF(!expand_ref_get(cond_res.value(), cond));
-
-    if (esa_val_to_bool(cond))
-        return parse(expr->left());
-    else
-        return parse(expr->right());
-}
-
-Completion Evaluator::parse_prop_expr(PropertyExpression *expr)
-{
-    Completion key_res = parse(expr->key());
-    if (key_res.is_abrupt())
-        return key_res;
-    EsReferenceOrValue key = key_res.value();
-
-    Completion obj_res = parse(expr->object());
-    if (obj_res.is_abrupt())
-        return obj_res;
-    EsReferenceOrValue obj_ref = obj_res.value();
-
-    EsValueData key_val;
-    RETHROW_IF(!expand_ref_get(key, key_val));
-
-    EsValueData obj_val;
-    RETHROW_IF(!expand_ref_get(obj_ref, obj_val));
-
-    EsObject *obj = esa_val_to_obj(obj_val);
-    RETHROW_IF(!obj);
-
-    const EsString *key_str = esa_val_to_str(key_val);
-    RETHROW_IF(!key_str);
-
-    EsReference t(key_str, EsContextStack::instance().top()->is_strict(), obj);
-    return Completion(Completion::TYPE_NORMAL, t);
-}
-
-Completion Evaluator::parse_call_expr(CallExpression *expr)
-{
-    ExpressionVector::const_iterator it;
-    for (it = expr->arguments().begin(); it != expr->arguments().end(); ++it)
+    CASE(PUT)
     {
-        Completion arg_res = parse(*it);
-        if (arg_res.is_abrupt())
-            return arg_res;
-
-        EsValueData val;
-        RETHROW_IF(!expand_ref_get(arg_res.value(), val));
-
-        // FIXME: Handle exceptions properly.
-        esa_stk_push(val);
+        if (!esa_prp_put(ctx, REG(1), code->key(ip[2]), REG(3), code->cache(ip[4])))
+            goto fail;
+        NEXT(4);
     }
-
-    uint32_t argc = static_cast<uint32_t>(expr->arguments().size());
-
-    EsValueData r;
-    bool success = false;
-
-    if (PropertyExpression *prop =
-        dynamic_cast<PropertyExpression *>(expr->expression()))
+    CASE(PUT_ELM)
     {
-        Completion key_res = parse(prop->key());
-        if (key_res.is_abrupt())
-            return key_res;
-        EsReferenceOrValue key = key_res.value();
-
-        Completion obj_res = parse(prop->object());
-        if (obj_res.is_abrupt())
-            return obj_res;
-        EsReferenceOrValue obj = obj_res.value();
-
-        EsValueData key_val;
-        RETHROW_IF(!expand_ref_get(key, key_val));
-
-        EsValueData obj_val;
-        RETHROW_IF(!expand_ref_get(obj, obj_val));
-
-        RETHROW_IF(!esa_val_chk_coerc(obj_val));
-
-        success = esa_call_keyed_slow(obj_val, key_val, argc, &r);
+        if (!esa_prp_put_elm(ctx, REG(1), REG(2), REG(3), code->cache(ip[4])))
+            goto fail;
+        NEXT(4);
     }
-    else if (IdentifierLiteral * ident =
-        dynamic_cast<IdentifierLiteral *>(expr->expression()))
+    CASE(DEL)
     {
-        success = esa_call_named(
-                EsPropertyKey::from_str(EsString::create(ident->value())).as_raw(),
-                        argc, &r);
+        if (!esa_prp_del(ctx, REG(2), code->key(ip[3]), &REG(1)))
+            goto fail;
+        NEXT(3);
     }
-    else
+    CASE(DEL_ELM)
     {
-        Completion expr_res = parse(expr->expression());
-        if (expr_res.is_abrupt())
-            return expr_res;
-
-        EsReferenceOrValue fun = expr_res.value();
-
-        assert(!fun.is_reference());
-        success = esa_call(fun.value(), argc, &r);
+        if (!esa_prp_del_slow(ctx, REG(2), REG(3), &REG(1)))
+            goto fail;
+        NEXT(3);
     }
 
-    RETHROW_IF(!success);
-    return Completion(Completion::TYPE_NORMAL, r);
-}
-
-Completion Evaluator::parse_call_new_expr(CallNewExpression *expr)
-{
-    Completion expr_res = parse(expr->expression());
-    if (expr_res.is_abrupt())
-        return expr_res;
-
-    EsReferenceOrValue fun_ref = expr_res.value();
-
-    ExpressionVector::const_iterator it;
-    for (it = expr->arguments().begin(); it != expr->arguments().end(); ++it)
+    // Calls. The arguments are pushed right before the call, which consumes
+    // them whether it succeeds or not.
+    CASE(CALL)
     {
-        Completion arg_res = parse(*it);
-        if (arg_res.is_abrupt())
-            return arg_res;
-
-        EsValueData val;
-        RETHROW_IF(!expand_ref_get(arg_res.value(), val));
+        for (uint32_t i = 0; i < ip[4]; i++)
+            esa_stk_push(regs[ip[3] + i]);
 
-        // FIXME: Handle exceptions properly.
-        esa_stk_push(val);
+        if (!esa_call(REG(2), ip[4], &REG(1)))
+            goto fail;
+        NEXT(4);
     }
+    CASE(CALL_NAME)
+    {
+        for (uint32_t i = 0; i < ip[4]; i++)
+            esa_stk_push(regs[ip[3] + i]);
 
-    EsValueData fun;
-    RETHROW_IF(!expand_ref_get(fun_ref, fun));
-
-    uint32_t argc = static_cast<uint32_t>(expr->arguments().size());
-
-    EsValueData r;
-    RETHROW_IF(!esa_call_new(fun, argc, &r));
-
-    return Completion(Completion::TYPE_NORMAL, r);
-}
-
-Completion Evaluator::parse_regular_expr(RegularExpression *expr)
-{
-    EsValueData r = esa_new_reg_exp(EsString::create(expr->pattern()),
-                               EsString::create(expr->flags()));
-    return Completion(Completion::TYPE_NORMAL, r);
-}
-
-Completion Evaluator::parse_fun_expr(FunctionExpression *expr)
-{
-    const FunctionLiteral *lit = expr->function();
-
-    return parse(const_cast<FunctionLiteral *>(lit));
-}
-
-Completion Evaluator::parse_this_lit(ThisLiteral *lit)
-{
-    return Completion(Completion::TYPE_NORMAL,
-            reinterpret_cast<const EsValueData &>(frame_.this_value()));
-}
-
-Completion Evaluator::parse_ident_lit(IdentifierLiteral *lit)
-{
-    EsContext *ctx = EsContextStack::instance().top();
-
-    EsReference t(EsString::create(lit->value()), ctx->is_strict());
-    return Completion(Completion::TYPE_NORMAL, t);
-}
-
-Completion Evaluator::parse_null_lit(NullLiteral *lit)
-{
-    return Completion(Completion::TYPE_NORMAL, es_value_null());
-}
+        EsIdentifierSite *site = code->site(ip[2]);
+        if (!esa_call_named(site->key, ip[4], &REG(1), site_cache(site)))
+            goto fail;
+        NEXT(4);
+    }
+    CASE(CALL_KEYED)
+    {
+        for (uint32_t i = 0; i < ip[5]; i++)
+            esa_stk_push(regs[ip[4] + i]);
 
-Completion Evaluator::parse_bool_lit(BoolLiteral *lit)
-{
-    return Completion(Completion::TYPE_NORMAL,
-            es_value_from_boolean(lit->value()));
-}
+        if (!esa_call_keyed(REG(2), code->key(ip[3]), ip[5], &REG(1),
+                            code->cache(ip[6])))
+            goto fail;
+        NEXT(6);
+    }
+    CASE(CALL_ELM)
+    {
+        if (!esa_val_chk_coerc(REG(2)))
+            goto fail;
 
-Completion Evaluator::parse_num_lit(NumberLiteral *lit)
-{
-    // FIXME: Performance hit when creating new string.
-    return Completion(Completion::TYPE_NORMAL,
-            es_value_from_number(
-                    es_str_to_num(EsString::create(lit->as_string()))));
-}
+        for (uint32_t i = 0; i < ip[5]; i++)
+            esa_stk_push(regs[ip[4] + i]);
 
-Completion Evaluator::parse_str_lit(StringLiteral *lit)
-{
-    return Completion(Completion::TYPE_NORMAL,
-            es_value_from_string(EsString::create(lit->value())));
-}
+        if (!esa_call_keyed_slow(REG(2), REG(3), ip[5], &REG(1)))
+            goto fail;
+        NEXT(5);
+    }
+    CASE(NEW)
+    {
+        for (uint32_t i = 0; i < ip[4]; i++)
+            esa_stk_push(regs[ip[3] + i]);
 
-Completion Evaluator::parse_fun_lit(FunctionLiteral *lit)
-{
-    AutoScope scope(this, SCOPE_FUNCTION);
+        if (!esa_call_new(REG(2), ip[4], &REG(1)))
+            goto fail;
+        NEXT(4);
+    }
 
-    EsFunction *fun = NULL;
+    // Binary operators.
+    BINARY_NUM(ADD, esa_b_add, +)
+    BINARY_NUM(SUB, esa_b_sub, -)
+    BINARY_NUM(MUL, esa_b_mul, *)
+    BINARY_NUM(DIV, esa_b_div, /)
+    BINARY_SLOW(MOD, esa_b_mod)
+    BINARY_I32(SHL, esa_b_shl,
+               static_cast<int32_t>(static_cast<uint32_t>(I32(2)) << SHIFT(3)))
+    BINARY_I32(SAR, esa_b_sar, I32(2) >> SHIFT(3))
+    BINARY_I32(SHR, esa_b_shr, static_cast<uint32_t>(I32(2)) >> SHIFT(3))
+    BINARY_I32(AND, esa_b_and, I32(2) & I32(3))
+    BINARY_I32(OR, esa_b_or, I32(2) | I32(3))
+    BINARY_I32(XOR, esa_b_xor, I32(2) ^ I32(3))
+    BINARY_CMP(LT, esa_c_lt, <)
+    BINARY_CMP(GT, esa_c_gt, >)
+    BINARY_CMP(LTE, esa_c_lte, <=)
+    BINARY_CMP(GTE, esa_c_gte, >=)
+    BINARY_SLOW(IN, esa_c_in)
+    BINARY_SLOW(INSTANCEOF, esa_c_instance_of)
+    BINARY_CMP(EQ, esa_c_eq, ==)
+    BINARY_CMP(NEQ, esa_c_neq, !=)
+    BINARY_CMP(STRICT_EQ, esa_c_strict_eq, ==)
+    BINARY_CMP(STRICT_NEQ, esa_c_strict_neq, !=)
 
-    if (lit->type() == FunctionLiteral::TYPE_DECLARATION)
+    // Unary operators.
+    CASE(NOT)
     {
-        fun = EsFunction::create_inst(EsContextStack::instance().top()->var_env(), lit);
+        if (es_value_is_boolean(REG(2)))
+            REG(1) = es_value_from_boolean(!es_value_as_boolean(REG(2)));
+        else if (!esa_u_not(REG(2), &REG(1)))
+            goto fail;
+        NEXT(2);
     }
-    else
+    CASE(BIT_NOT)
     {
-        if (!lit->name().empty())
-        {
-            EsLexicalEnvironment *fun_env = es_new_decl_env(EsContextStack::instance().top()->lex_env());
-
-            fun = EsFunction::create_inst(fun_env, lit);
-
-            assert(fun_env->env_rec()->is_decl_env());
-            EsDeclarativeEnvironmentRecord *env =
-                static_cast<EsDeclarativeEnvironmentRecord *>(fun_env->env_rec());
-
-            env->create_immutable_binding(
-                    EsPropertyKey::from_str(EsString::create(lit->name())),
-                    EsValue::from_obj(fun));
-        }
-        else
-        {
-            fun = EsFunction::create_inst(EsContextStack::instance().top()->lex_env(), lit);
-        }
+        if (es_value_is_i32_range(REG(2)))
+            REG(1) = es_value_from_number(~I32(2));
+        else if (!esa_u_bit_not(REG(2), &REG(1)))
+            goto fail;
+        NEXT(2);
     }
-
-    assert(fun);
-    return Completion(Completion::TYPE_NORMAL, es_value_from_object(fun));
-}
-
-Completion Evaluator::parse_var_lit(VariableLiteral *lit)
-{
-    // Dealt with in parse_fun_decls().
-    return Completion(Completion::TYPE_NORMAL, es_value_nothing());
-}
-
-Completion Evaluator::parse_array_lit(ArrayLiteral *lit)
-{
-    std::unique_ptr<EsValueData[]> items(new EsValueData[lit->values().size()]);
-
-    for (size_t i = 0; i < lit->values().size(); i++)
+    CASE(POS)
     {
-        Completion val_res = parse(lit->values()[i]);
-        if (val_res.is_abrupt())
-            return val_res;
-
-        EsValueData val;
-        RETHROW_IF(!expand_ref_get(val_res.value(), val));
-
-        items[i] = val;
+        if (es_value_is_number(REG(2)))
+            REG(1) = REG(2);
+        else if (!esa_u_add(REG(2), &REG(1)))
+            goto fail;
+        NEXT(2);
     }
-    
-    return Completion(Completion::TYPE_NORMAL,
-            esa_new_arr(static_cast<uint32_t>(lit->values().size()),
-                       &items[0]));
-}
-
-Completion Evaluator::parse_obj_lit(ObjectLiteral *lit)
-{
-    EsValueData new_obj = esa_new_obj();
-
-    ObjectLiteral::PropertyVector::const_iterator it;
-    for (it = lit->properties().begin(); it != lit->properties().end(); ++it)
+    CASE(NEG)
     {
-        const ObjectLiteral::Property *prop = *it;
-
-        if (prop->type() == ObjectLiteral::Property::DATA)
-        {
-            Completion key_res = parse(prop->key());
-            if (key_res.is_abrupt())
-                return key_res;
-
-            EsValueData key;
-            RETHROW_IF(!expand_ref_get(key_res.value(), key));
-
-            Completion val_res = parse(prop->value());
-            if (val_res.is_abrupt())
-                return val_res;
-
-            EsValueData val;
-            RETHROW_IF(!expand_ref_get(val_res.value(), val));
-
-            RETHROW_IF(!esa_prp_def_data(new_obj, key, val));
-        }
-        else
-        {
-            Completion val_res = parse(prop->value());
-            if (val_res.is_abrupt())
-                return val_res;
-
-            EsValueData val;
-            RETHROW_IF(!expand_ref_get(val_res.value(), val));
-
-            RETHROW_IF(!esa_prp_def_accessor(new_obj,
-                    EsPropertyKey::from_str(EsString::create(prop->accessor_name())).as_raw(),
-                            val, prop->type() == ObjectLiteral::Property::SETTER));
-        }
+        if (es_value_is_number(REG(2)))
+            REG(1) = es_value_from_number(-NUM(2));
+        else if (!esa_u_sub(REG(2), &REG(1)))
+            goto fail;
+        NEXT(2);
     }
-
-    return Completion(Completion::TYPE_NORMAL, new_obj);
-}
-
-Completion Evaluator::parse_nothing_lit(NothingLiteral *lit)
-{
-    return Completion(Completion::TYPE_NORMAL, es_value_nothing());
-}
-
-Completion Evaluator::parse_empty_stmt(EmptyStatement *stmt)
-{
-    // 12.3.
-    return Completion(Completion::TYPE_NORMAL, es_value_nothing());
-}
-
-Completion Evaluator::parse_expr_stmt(ExpressionStatement *stmt)
-{
-    // 12.4.
-    Completion expr_res = parse(stmt->expression());
-    if (expr_res.is_abrupt())
-        return expr_res;
-
-    EsValueData val;
-    RETHROW_IF(!expand_ref_get(expr_res.value(), val));
-
-    return Completion(Completion::TYPE_NORMAL, val);
-}
-
-Completion Evaluator::parse_block_stmt(BlockStatement *stmt)
-{
-    AutoScope scope(this, SCOPE_DEFAULT);
-
-    // 12.1.
-    EsReferenceOrValue v;
-
-    Completion stmt_res(Completion::TYPE_THROW, EsReferenceOrValue());
-
-    StatementVector::const_iterator it_stmt;
-    for (it_stmt = stmt->body().begin(); it_stmt != stmt->body().end(); ++it_stmt)
+    CASE(TYPEOF)
     {
-        // FIXME: Catch exception and return according to 12.1:4?
-        stmt_res = parse(*it_stmt);
-        if (stmt_res.type() == Completion::TYPE_THROW)
-            return stmt_res;
-        if (!stmt_res.value().empty())
-            v = stmt_res.value();
-
-        if (stmt_res.is_abrupt())
-            return Completion(stmt_res.type(), v, stmt_res.target());
+        if (!esa_u_typeof(REG(2), &REG(1)))
+            goto fail;
+        NEXT(2);
     }
-
-    if (stmt->is_hidden())
-        return Completion(Completion::TYPE_NORMAL, es_value_nothing());
-
-    if (stmt->body().empty())
-        return Completion(Completion::TYPE_NORMAL, es_value_nothing());
-    else
-        return Completion(stmt_res.type(), v, stmt_res.target());
-}
-
-Completion Evaluator::parse_if_stmt(IfStatement *stmt)
-{
-    // 12.5.
-    Completion cond_res = parse(stmt->condition());
-    if (cond_res.is_abrupt())
-        return cond_res;
-
-    EsValueData cond;
-    RETHROW_IF(!expand_ref_get(cond_res.value(), cond));
-
-    if (esa_val_to_bool(cond))
-        return parse(stmt->if_statement());
-    else if (stmt->has_else())
-        return parse(stmt->else_statement());
-    else
-        return Completion(Completion::TYPE_NORMAL, es_value_nothing());
-}
-
-Completion Evaluator::parse_do_while_stmt(DoWhileStatement *stmt)
-{
-    AutoScope scope(this, SCOPE_ITERATION);
-
-    // 12.6.1.
-    EsReferenceOrValue v;
-
-    bool iterating = true;
-    while (iterating)
+    CASE(INC)
     {
-        Completion body_res = parse(stmt->body());
-
-        if (!body_res.value().empty())
-            v = body_res.value();
-
-        if (body_res.type() != Completion::TYPE_CONTINUE ||
-            !(body_res.target().empty() || stmt->labels().contains(body_res.target())))
-        {
-            if (body_res.type() == Completion::TYPE_BREAK &&
-                (body_res.target().empty() || stmt->labels().contains(body_res.target())))
-            {
-                return Completion(Completion::TYPE_NORMAL, v);
-            }
-            if (body_res.is_abrupt())
-                return body_res;
-        }
-
-        if (stmt->has_condition())
-        {
-            Completion cond_res = parse(stmt->condition());
-            if (cond_res.is_abrupt())
-                return cond_res;
-
-            EsValueData cond;
-            RETHROW_IF(!expand_ref_get(cond_res.value(), cond));
-
-            if (!esa_val_to_bool(cond))
-                iterating = false;
-        }
+        assert(es_value_is_number(REG(2)));
+        REG(1) = es_value_from_number(NUM(2) + 1.0);
+        NEXT(2);
     }
-
-    return Completion(Completion::TYPE_NORMAL, v);
-}
-
-Completion Evaluator::parse_while_stmt(WhileStatement *stmt)
-{
-    AutoScope scope(this, SCOPE_ITERATION);
-
-    // 12.6.2.
-    EsReferenceOrValue v;
-
-    while (true)
+    CASE(DEC)
     {
-        Completion cond_res = parse(stmt->condition());
-        if (cond_res.is_abrupt())
-            return cond_res;
-
-        EsValueData cond;
-        RETHROW_IF(!expand_ref_get(cond_res.value(), cond));
-
-        if (!esa_val_to_bool(cond))
-            return Completion(Completion::TYPE_NORMAL, v);
-
-        Completion body_res = parse(stmt->body());
-
-        if (!body_res.value().empty())
-            v = body_res.value();
-
-        if (body_res.type() != Completion::TYPE_CONTINUE ||
-            !(body_res.target().empty() || stmt->labels().contains(body_res.target())))
-        {
-            if (body_res.type() == Completion::TYPE_BREAK &&
-                (body_res.target().empty() || stmt->labels().contains(body_res.target())))
-            {
-                return Completion(Completion::TYPE_NORMAL, v);
-            }
-            if (body_res.is_abrupt())
-                return body_res;
-        }
+        assert(es_value_is_number(REG(2)));
+        REG(1) = es_value_from_number(NUM(2) - 1.0);
+        NEXT(2);
     }
 
-    assert(false);
-}
-
-Completion Evaluator::parse_for_in_stmt(ForInStatement *stmt)
-{
-    AutoScope scope(this, SCOPE_ITERATION);
-
-    // 12.6.4.
-    Completion enum_res = parse(stmt->enumerable());
-    if (enum_res.is_abrupt())
-        return enum_res;
-
-    EsValueData expr_val;
-    RETHROW_IF(!expand_ref_get(enum_res.value(), expr_val));
-
-    if (es_value_is_null(expr_val) || es_value_is_undefined(expr_val))
-        return Completion(Completion::TYPE_NORMAL, es_value_nothing());
-
-    EsObject *obj = esa_val_to_obj(expr_val);
-    RETHROW_IF(!obj)
-
-    EsReferenceOrValue v;
-
-    EsObject::Iterator it = obj->begin_recursive();
-    EsObject::Iterator it_end = obj->end_recursive();
-
-    while (true)
+    // Control flow.
+    CASE(JMP)
     {
-        EsValueData p;
-        bool found_p = false;
-
-        // Find the next enumerable property.
-        for (; it != it_end && !found_p; ++it)
+        JUMP(ip[1]);
+    }
+    CASE(JT)
+    {
+        bool cond = es_value_is_boolean(REG(1))
+            ? es_value_as_boolean(REG(1)) != 0 : esa_val_to_bool(REG(1));
+        if (cond)
         {
-            EsPropertyKey key = *it;
-
-            EsPropertyReference prop = obj->get_property(key);
-            if (!prop || !prop->is_enumerable())    // The property might have been deleted.
-                continue;
-
-            p = es_value_from_string(key.to_string());
-            found_p = true;
+            JUMP(ip[2]);
         }
-
-        if (!found_p)
-            return Completion(Completion::TYPE_NORMAL, v);
-
-        Completion decl_res = parse(stmt->declaration());
-        if (decl_res.is_abrupt())
-            return decl_res;
-
-        RETHROW_IF(!expand_ref_put(decl_res.value(), p));
-
-        Completion body_res = parse(stmt->body());
-
-        if (!body_res.value().empty())
-            v = body_res.value();
-
-        if (body_res.type() == Completion::TYPE_BREAK &&
-            (body_res.target().empty() || stmt->labels().contains(body_res.target())))
+        NEXT(2);
+    }
+    CASE(JF)
+    {
+        bool cond = es_value_is_boolean(REG(1))
+            ? es_value_as_boolean(REG(1)) != 0 : esa_val_to_bool(REG(1));
+        if (!cond)
         {
-            return Completion(Completion::TYPE_NORMAL, v);
+            JUMP(ip[2]);
         }
-        if (body_res.type() != Completion::TYPE_CONTINUE ||
-            !(body_res.target().empty() || stmt->labels().contains(body_res.target())))
+        NEXT(2);
+    }
+    CASE(JNU)
+    {
+        if (es_value_is_null(REG(1)) || es_value_is_undefined(REG(1)))
         {
-            if (body_res.is_abrupt())
-                return body_res;
+            JUMP(ip[2]);
         }
+        NEXT(2);
     }
-
-    assert(false);
-}
-
-Completion Evaluator::parse_for_stmt(ForStatement *stmt)
-{
-    AutoScope scope(this, SCOPE_ITERATION);
-
-    // 12.6.3
-    if (stmt->has_initializer())
+    CASE(RET)
     {
-        Completion init_res = parse(stmt->initializer());
-        if (init_res.is_abrupt())
-            return init_res;
-
-        EsValueData initializer;
-        RETHROW_IF(!expand_ref_get(init_res.value(), initializer));
+        frame_.set_result(static_cast<const EsValue &>(REG(1)));
+        return true;
     }
-
-    EsReferenceOrValue v;
-
-    while (true)
+    CASE(THROW)
     {
-        if (stmt->has_condition())
-        {
-            Completion cond_res = parse(stmt->condition());
-            if (cond_res.is_abrupt())
-                return cond_res;
-
-            EsValueData cond;
-            RETHROW_IF(!expand_ref_get(cond_res.value(), cond));
-
-            if (!esa_val_to_bool(cond))
-                return Completion(Completion::TYPE_NORMAL, v);
-        }
-
-        Completion body_res = parse(stmt->body());
-
-        if (!body_res.value().empty())
-            v = body_res.value();
-
-        if (body_res.type() == Completion::TYPE_BREAK &&
-            (body_res.target().empty() || stmt->labels().contains(body_res.target())))
-        {
-            return Completion(Completion::TYPE_NORMAL, v);
-        }
-
-        if (body_res.type() != Completion::TYPE_CONTINUE ||
-            !(body_res.target().empty() || stmt->labels().contains(body_res.target())))
-        {
-            if (body_res.is_abrupt())
-                return body_res;
-        }
+        esa_ex_set(ctx, REG(1));
+        goto fail;
+    }
+    CASE(RETHROW)
+    {
+        goto fail;
+    }
 
-        if (stmt->has_next())
-        {
-            Completion next_res = parse(stmt->next());
-            if (next_res.is_abrupt())
-                return next_res;
+    // Contexts and exception state.
+    CASE(ENTER_WITH)
+    {
+        if (!esa_ctx_enter_with(ctx, REG(1)))
+            goto fail;
 
-            EsValueData next;
-            RETHROW_IF(!expand_ref_get(next_res.value(), next));
-        }
+        ctx = EsContextStack::instance().top();
+        NEXT(1);
     }
+    CASE(ENTER_CATCH)
+    {
+        esa_ctx_enter_catch(ctx, code->key(ip[1]));
 
-    assert(false);
-}
-
-Completion Evaluator::parse_cont_stmt(ContinueStatement *stmt)
-{
-    // 12.7.
-    String target;
+        ctx = EsContextStack::instance().top();
+        NEXT(1);
+    }
+    CASE(LEAVE)
+    {
+        esa_ctx_leave();
 
-    if (stmt->has_target())
+        ctx = EsContextStack::instance().top();
+        NEXT(0);
+    }
+    CASE(EX_SAVE)
     {
-        target = stmt->target()->labels().first();  // Any label from the list is fine.
+        // The finally block executes without the pending exception.
+        REG(1) = esa_ex_save_state(ctx);
+        esa_ex_clear(ctx);
+        NEXT(1);
     }
-    else
+    CASE(EX_LOAD)
     {
-        if (!is_in_iteration())
-        {
-            ES_THROW(EsError, _ESTR("error: non-labeled continue statements are only allowed in loops."));
-            RETHROW_IF(true);
-        }
+        esa_ex_load_state(ctx, REG(1));
+        NEXT(1);
     }
 
-    return Completion(Completion::TYPE_CONTINUE, es_value_nothing(), target);
-}
-
-Completion Evaluator::parse_break_stmt(BreakStatement *stmt)
-{
-    // 12.8.
-    String target;
-
-    if (stmt->has_target())
+    // Literals.
+    CASE(NEW_ARR)
     {
-        target = stmt->target()->labels().first();  // Any label from the list is fine.
+        REG(1) = esa_new_arr(ip[3], &REG(2));
+        NEXT(3);
     }
-    else
+    CASE(NEW_OBJ)
     {
-        if (!is_in_iteration() && !is_in_switch())
-        {
-            ES_THROW(EsError, _ESTR("error: non-labeled break statements are only allowed in loops and switch statements."));
-            RETHROW_IF(true);
-        }
+        REG(1) = esa_new_obj();
+        NEXT(1);
     }
-
-    return Completion(Completion::TYPE_BREAK, es_value_nothing(), target);
-}
-
-Completion Evaluator::parse_ret_stmt(ReturnStatement *stmt)
-{
-    // 12.9.
-    if (!stmt->has_expression())
-        return Completion(Completion::TYPE_RETURN, es_value_undefined());
-
-    Completion expr_res = parse(stmt->expression());
-    if (expr_res.is_abrupt())
-        return expr_res;
-
-    EsValueData expr;
-    RETHROW_IF(!expand_ref_get(expr_res.value(), expr));
-
-    return Completion(Completion::TYPE_RETURN, expr);
-}
-
-Completion Evaluator::parse_with_stmt(WithStatement *stmt)
-{
-    AutoScope scope(this, SCOPE_WITH);
-
-    // 12.10.
-    Completion expr_res = parse(stmt->expression());
-    if (expr_res.is_abrupt())
-        return expr_res;
-
-    EsValueData expr;
-    RETHROW_IF(!expand_ref_get(expr_res.value(), expr));
-
-    RETHROW_IF(!esa_ctx_enter_with(EsContextStack::instance().top(), expr));
-
-    Completion body_res = parse(stmt->body());
-    esa_ctx_leave();
-    return body_res;
-}
-
-Completion Evaluator::parse_switch_stmt(SwitchStatement *stmt)
-{
-    AutoScope scope(this, SCOPE_SWITCH);
-
-    // 12.11.
-    EsReferenceOrValue v;
-
-    Completion expr_res = parse(stmt->expression());
-    if (expr_res.is_abrupt())
-        return expr_res;
-
-    EsValueData expr_val;
-    RETHROW_IF(!expand_ref_get(expr_res.value(), expr_val));
-
-    bool found_case = false;
-
-    // First, process all the non-default clauses.
-    SwitchStatement::CaseClauseVector::const_iterator it;
-    for (it = stmt->cases().begin(); it != stmt->cases().end(); ++it)
+    CASE(NEW_OBJ_LIT)
     {
-        const SwitchStatement::CaseClause *clause = *it;
-
-        if (!clause->is_default() && !found_case)
-        {
-            Completion clause_res = parse(clause->label());
-            if (clause_res.is_abrupt())
-                return clause_res;
-
-            EsValueData label;
-            RETHROW_IF(!expand_ref_get(clause_res.value(), label));
-
-            EsValueData val;
-            RETHROW_IF(!esa_c_strict_eq(label, expr_val, &val));
-
-            found_case = esa_val_to_bool(val);
-        }
-
-        if (found_case)
-        {
-            StatementVector::const_iterator it_stmt;
-            for (it_stmt = clause->body().begin(); it_stmt != clause->body().end(); ++it_stmt)
-            {
-                Completion body_res = parse(*it_stmt);
-                if (!body_res.value().empty())
-                    v = body_res.value();
-
-                if (body_res.type() == Completion::TYPE_BREAK &&
-                    (body_res.target().empty() || stmt->labels().contains(body_res.target())))
-                {
-                    return Completion(Completion::TYPE_NORMAL, body_res.value());
-                }
-
-                if (body_res.is_abrupt())
-                    return Completion(body_res.type(), v , body_res.target());
-            }
-        }
+        REG(1) = esa_new_obj_lit(code->object_template(ip[2]), &REG(3));
+        NEXT(3);
     }
-
-    // Lastly, process the default clause, if present.
-    if (!found_case)
+    CASE(DEF_DATA)
     {
-        for (it = stmt->cases().begin(); it != stmt->cases().end(); ++it)
-        {
-            const SwitchStatement::CaseClause *clause = *it;
-
-            if (clause->is_default())
-            {
-                StatementVector::const_iterator it_stmt;
-                for (it_stmt = clause->body().begin(); it_stmt != clause->body().end(); ++it_stmt)
-                {
-                    Completion body_res = parse(*it_stmt);
-                    if (!body_res.value().empty())
-                        v = body_res.value();
-
-                    if (body_res.type() == Completion::TYPE_BREAK &&
-                        (body_res.target().empty() || stmt->labels().contains(body_res.target())))
-                    {
-                        return Completion(Completion::TYPE_NORMAL, body_res.value());
-                    }
-
-                    if (body_res.is_abrupt())
-                        return Completion(body_res.type(), v , body_res.target());
-                }
-            }
-        }
+        if (!esa_prp_def_data(REG(1), REG(2), REG(3)))
+            goto fail;
+        NEXT(3);
     }
-
-    return Completion(Completion::TYPE_NORMAL, v);
-}
-
-Completion Evaluator::parse_throw_stmt(ThrowStatement *stmt)
-{
-    Completion expr_res = parse(stmt->expression());
-    if (expr_res.is_abrupt())
-        return expr_res;
-
-    EsValueData expr_val;
-    RETHROW_IF(!expand_ref_get(expr_res.value(), expr_val));
-
-    esa_ex_set(EsContextStack::instance().top(), expr_val);
-
-    return Completion(Completion::TYPE_THROW, expr_val);
-}
-
-Completion Evaluator::parse_try_stmt(TryStatement *stmt)
-{
-    AutoScope scope(this, SCOPE_DEFAULT);
-
-    if (stmt->has_catch_block() && stmt->has_finally_block())
+    CASE(DEF_ACCESSOR)
     {
-        Completion b = parse(stmt->try_block());
-        Completion c = b;
-        if (b.type() == Completion::TYPE_THROW)
-        {
-            esa_ctx_enter_catch(EsContextStack::instance().top(),
-                    EsPropertyKey::from_str(
-                            EsString::create(
-                                    stmt->catch_identifier())).as_raw());
-
-            c = parse(stmt->catch_block());
-            esa_ctx_leave();
-        }
-
-        Completion fin_res = parse(stmt->finally_block());
-        if (fin_res.type() == Completion::TYPE_NORMAL)
-            return c;
-        else
-            return fin_res;
+        if (!esa_prp_def_accessor(REG(1), code->key(ip[2]), REG(3), ip[4] != 0))
+            goto fail;
+        NEXT(4);
     }
-    else if (stmt->has_catch_block())
+    CASE(NEW_REG_EXP)
     {
-        Completion try_res = parse(stmt->try_block());
-        if (try_res.type() != Completion::TYPE_THROW)
-            return try_res;
-
-        esa_ctx_enter_catch(EsContextStack::instance().top(),
-                EsPropertyKey::from_str(
-                        EsString::create(stmt->catch_identifier())).as_raw());
-
-        Completion catch_res = parse(stmt->catch_block());
-        esa_ctx_leave();
-        return catch_res;
+        REG(1) = esa_new_reg_exp(es_value_as_string(REG(2)),
+                                 es_value_as_string(REG(3)));
+        NEXT(3);
     }
-    else if (stmt->has_finally_block())
+    CASE(NEW_FUN)
     {
-        Completion b = parse(stmt->try_block());
-        EsValueData b_ex_state = esa_ex_save_state(EsContextStack::instance().top());
-
-        Completion fin_res = parse(stmt->finally_block());
-        if (fin_res.type() == Completion::TYPE_NORMAL)
-        {
-            esa_ex_load_state(EsContextStack::instance().top(), b_ex_state);
-            return b;
-        }
-        else
-        {
-            return fin_res;
-        }
+        REG(1) = es_value_from_object(new_function(ctx, code->function(ip[2])));
+        NEXT(2);
     }
 
-    assert(false);
-    return Completion(Completion::TYPE_THROW, es_value_nothing());
-}
-
-Completion Evaluator::parse_dbg_stmt(DebuggerStatement *stmt)
-{
-    return Completion(Completion::TYPE_NORMAL, EsReferenceOrValue());
-}
+    // Property enumeration. The iterator is kept in a register as a raw
+    // pointer, the register file is scanned by the garbage collector.
+    CASE(IT_NEW)
+    {
+        EsPropertyIterator *it = esa_prp_it_new(REG(2));
+        if (!it)
+            goto fail;
 
-void Evaluator::parse_fun_decls(const DeclarationVector &decls)
-{
-    // Visit functions first to comply with Declaration Binding instantiation (10.5).
-    DeclarationVector::const_iterator it_decl;
-    for (it_decl = decls.begin(); it_decl != decls.end(); ++it_decl)
+        REG(1).data.bits = reinterpret_cast<uintptr_t>(it);
+        NEXT(2);
+    }
+    CASE(IT_NEXT)
     {
-        const Declaration *decl = *it_decl;
-        if (decl->is_function())
+        EsPropertyIterator *it =
+            reinterpret_cast<EsPropertyIterator *>(REG(2).data.bits);
+        if (!esa_prp_it_next(it, &REG(1)))
         {
-            FunctionLiteral *lit = decl->as_function();
-            EsFunction *fun = safe_cast<EsFunction *>(
-                    es_value_as_object(parse(lit).value().value()));
-
-            esa_ctx_decl_fun(
-                    EsContextStack::instance().top(),
-                    type_ == TYPE_EVAL,
-                    code_->is_strict_mode(),
-                    EsPropertyKey::from_str(EsString::create(lit->name())).as_raw(),
-                    es_value_from_object(fun));
+            JUMP(ip[3]);
         }
+        NEXT(3);
+    }
+
+#ifndef ES_BYTECODE_THREADED
+        default:
+            assert(false);
+            return false;
     }
+#endif
 
-    for (it_decl = decls.begin(); it_decl != decls.end(); ++it_decl)
+fail:
     {
-        const Declaration *decl = *it_decl;
-        if (decl->is_variable())
-        {
-            VariableLiteral *var = decl->as_variable();
-            parse(var);
+        // ip still points at the instruction that failed.
+        int64_t handler = code->handler(static_cast<uint32_t>(ip - base));
+        if (handler < 0)
+            return false;
 
-            esa_ctx_decl_var(
-                    EsContextStack::instance().top(),
-                    type_ == TYPE_EVAL,
-                    code_->is_strict_mode(),
-                    EsPropertyKey::from_str(EsString::create(var->name())).as_raw());
-        }
+        ctx = EsContextStack::instance().top();
+        JUMP(static_cast<uint32_t>(handler));
     }
+
+#undef BINARY_SLOW
+#undef BINARY_I32
+#undef BINARY_CMP
+#undef BINARY_NUM
+#undef JUMP
+#undef NEXT
+#undef CASE
+#undef DISPATCH
+#undef SHIFT
+#undef I32
+#undef NUM
+#undef REG
 }
 
 bool Evaluator::exec(EsContext *ctx)
 {
-    AutoScope scope(this, SCOPE_FUNCTION);
+    EsBytecode *code = static_cast<EsBytecode *>(code_->code());
+    if (!code)
+    {
+        code = BytecodeCompiler().compile(code_, type_ == TYPE_EVAL);
+        code_->set_code(code);
+    }
+
+    // Function code is entered from the scope of the callee, other code from
+    // the environment of the calling context.
+    scope_ = type_ == TYPE_FUNCTION ?
+        frame_.callee().as_function()->scope() : ctx->lex_env();
+
+    const EsBytecode::KeyVector &prm_keys = code->parameter_keys();
 
     uint32_t argc = frame_.argc();
     EsValueData *argv = reinterpret_cast<EsValueData *>(frame_.fp());
-
     // Function prologue: arguments object and parameters.
     if (type_ == TYPE_FUNCTION && code_->needs_args_obj())
     {
@@ -1637,8 +717,7 @@ bool Evaluator::exec(EsContext *ctx)
                 // should reflect in the parameter and vice versa.
                 esa_ctx_link_var(
                         EsContextStack::instance().top(),
-                        EsPropertyKey::from_str(
-                                EsString::create(code_->parameters()[i])).as_raw(),
+                        prm_keys[i],
                         &argv_heap[i]);
             }
             else
@@ -1646,8 +725,7 @@ bool Evaluator::exec(EsContext *ctx)
                 esa_ctx_decl_prm(
                         EsContextStack::instance().top(),
                         code_->is_strict_mode(),
-                        EsPropertyKey::from_str(
-                                EsString::create(code_->parameters()[i])).as_raw(),
+                        prm_keys[i],
                         es_value_undefined());
             }
         }
@@ -1655,60 +733,40 @@ bool Evaluator::exec(EsContext *ctx)
     else
     {
         // Function prologue: parameters.
-        for (uint32_t i = 0; i < static_cast<uint32_t>(
-                code_->parameters().size()); i++)
+        for (uint32_t i = 0; i < static_cast<uint32_t>(prm_keys.size()); i++)
         {
             esa_ctx_decl_prm(
                     EsContextStack::instance().top(),
                     code_->is_strict_mode(),
-                    EsPropertyKey::from_str(
-                            EsString::create(code_->parameters()[i])).as_raw(),
+                    prm_keys[i],
                     i < argc ? argv[i] : es_value_undefined());
         }
     }
 
     // Function prologue: declarations.
-    parse_fun_decls(code_->declarations());
-    
-    // Only used for eval.
-    EsValueData v = es_value_undefined();
+    declare(ctx, code);
 
-    // Function body, 13.2.1
-    StatementVector::const_iterator it_stmt;
-    for (it_stmt = code_->body().begin(); it_stmt != code_->body().end(); ++it_stmt)
+    // Function prologue: statically resolved bindings. The bindings have all
+    // been created at this point and none of them can be removed, so their
+    // value locations remain valid throughout the life of the environment.
+    if (type_ == TYPE_FUNCTION && !code_->slots().empty())
     {
-        Completion stmt_res = parse(*it_stmt);
-        switch (stmt_res.type())
-        {
-            case Completion::TYPE_NORMAL:
-                break;
-            case Completion::TYPE_BREAK:
-                break;
-            case Completion::TYPE_CONTINUE:
-                break;
-            case Completion::TYPE_RETURN:
-                frame_.set_result(reinterpret_cast<const EsValue &>(
-                        stmt_res.value().value()));
-                return true;
-            case Completion::TYPE_THROW:
-                assert(EsContextStack::instance().top()->has_pending_exception());
-                return false;
-
-            default:
-                assert(false);
-                break;
-        }
+        assert(ctx->var_env()->env_rec()->is_decl_env());
+        EsDeclarativeEnvironmentRecord *env =
+            static_cast<EsDeclarativeEnvironmentRecord *>(
+                ctx->var_env()->env_rec());
 
-        // Only used for eval.
-        if (type_ == TYPE_EVAL)
+        size_t num_slots = code_->slots().size();
+        slots_ = new (GC)EsValue *[num_slots];
+        for (size_t i = 0; i < num_slots; i++)
         {
-            if (!stmt_res.value().empty())
-                v = stmt_res.value().value();
+            slots_[i] = env->mutable_binding_value(
+                EsPropertyKey::from_raw(code->slot_keys()[i]));
         }
+
+        env->set_slots(slots_);
     }
 
-    frame_.set_result(type_ == TYPE_EVAL
-        ? reinterpret_cast<const EsValue &>(v)
-        : EsValue::undefined);
-    return true;
+    // Function body, 13.2.1
+    return run(ctx, code);
 }
@@ -16,10 +16,21 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <limits>
 #include <stdint.h>
+#include <stdlib.h>
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_DARWIN)
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#include <gc.h>         // NOTE: 3rd party.
+#include "common/exception.hh"
+#include "error.hh"
 #include "frame.hh"
 #include "global.hh"
+#include "messages.hh"
 #include "object.hh"
 
 EsCallStack g_call_stack;
@@ -192,12 +203,75 @@ EsCallFrame::~EsCallFrame()
 }
 
 EsCallStack::EsCallStack()
+    : base_(NULL)
+    , top_(NULL)
+    , roots_end_(NULL)
+    , end_(NULL)
+    , native_limit_(0)
 {
 }
 
 void EsCallStack::init()
 {
-    stack_.reserve(8192);
+    assert(!base_);
+
+    size_t size = ES_CALL_STACK_SIZE * sizeof(EsValue);
+    size_t native_size = 1024 * 1024;
+
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_DARWIN)
+    // Reserve the full stack, followed by a guard page catching any write
+    // past the end of the stack.
+    size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    void *mem = mmap(NULL, size + page_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem == MAP_FAILED)
+        THROW(MemoryException);
+
+    if (mprotect(static_cast<byte *>(mem) + size, page_size, PROT_NONE) != 0)
+        THROW(MemoryException);
+
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_STACK, &limit) == 0)
+    {
+        native_size = limit.rlim_cur == RLIM_INFINITY
+            ? 8 * 1024 * 1024 : static_cast<size_t>(limit.rlim_cur);
+    }
+#else
+    void *mem = malloc(size);
+    if (!mem)
+        THROW(MemoryException);
+#endif
+
+    base_ = top_ = roots_end_ = static_cast<EsValue *>(mem);
+    end_ = base_ + ES_CALL_STACK_SIZE;
+
+    grow(base_ + 2 * ES_CALL_STACK_RED_ZONE);
+
+    // Refuse calls when less than a quarter of the native stack remains, that
+    // part is left for native code running between calls. The native stack
+    // is assumed to grow downwards from about here.
+    char probe = 0;
+    native_limit_ = reinterpret_cast<uintptr_t>(&probe) - native_size +
+                    native_size / 4;
+}
+
+void EsCallStack::grow(EsValue *end)
+{
+    if (end > end_)
+        THROW(MemoryException);
+
+    // Register twice the amount of memory needed to not have to do this too
+    // often. Registering a root with an existing start extends it.
+    size_t size = std::min(static_cast<size_t>(end - base_) * 2,
+                           static_cast<size_t>(end_ - base_));
+    roots_end_ = base_ + size;
+    GC_add_roots(base_, roots_end_);
+}
+
+bool EsCallStack::overflowT()
+{
+    ES_THROW(EsRangeError, es_fmt_msg(ES_MSG_RANGE_CALL_STACK));
+    return false;
 }
 
 EsCallStackGuard::~EsCallStackGuard()
@@ -17,7 +17,7 @@
  */
 
 #pragma once
-#include <vector>
+#include <stdint.h>
 #include "value.hh"
 
 class EsFunction;
@@ -151,10 +151,41 @@ public:
     inline void set_result(const EsValue &val) { vp_[RESULT] = val; }
 };
 
+/**
+ * Maximum number of values on the call stack. The memory is reserved up front
+ * but is only committed as the stack grows.
+ */
+#define ES_CALL_STACK_SIZE      (4 * 1024 * 1024)
+
+/**
+ * Number of values that must remain available on the call stack for a
+ * function call to be accepted.
+ */
+#define ES_CALL_STACK_RED_ZONE  16384
+
+/**
+ * @brief ECMAScript call stack.
+ *
+ * The stack is a single contiguous memory region followed by a guard page.
+ * Allocating and freeing values only moves the stack pointer. Since the memory
+ * is not allocated by the garbage collector, the part of the stack that has
+ * been in use is registered as a garbage collection root.
+ */
 class EsCallStack
 {
 private:
-    std::vector<EsValue, gc_allocator<EsValue>> stack_;
+    EsValue *base_;         ///< Bottom of stack.
+    EsValue *top_;          ///< Pointer to the next value that will be pushed.
+    EsValue *roots_end_;    ///< End of the region registered as GC root.
+    EsValue *end_;          ///< End of reserved memory.
+    uintptr_t native_limit_;///< Native stack address calls may not go below.
+
+    /**
+     * Registers more of the stack as garbage collection root.
+     * @param [in] end End of stack region that must be registered.
+     * @throw MemoryException if @a end is beyond the reserved memory.
+     */
+    void grow(EsValue *end);
 
 public:
     EsCallStack();
@@ -162,55 +193,90 @@ public:
     void init();
 
     /**
-     * @return Top value in stack or NULL if stack is empty.
+     * Checks that there is room for a new function call on the ECMAScript
+     * call stack as well as on the native call stack.
+     * @return true if there is room, false if a RangeError was thrown.
      */
-    /*inline EsValue *top()
+    inline bool checkT()
     {
-        return stack_.empty() ? NULL : &stack_.back();
-    }*/
+        char probe = 0;
+        if (top_ + ES_CALL_STACK_RED_ZONE <= end_ &&
+            reinterpret_cast<uintptr_t>(&probe) > native_limit_)
+            return true;
+
+        return overflowT();
+    }
+
+    /**
+     * Throws a RangeError reporting that the call stack is exhausted.
+     * @return Always false.
+     */
+    bool overflowT();
 
     /**
      * @return Pointer to the next value that will be pushed to the stack.
      */
     inline EsValue *next()
     {
-        return stack_.empty() ? stack_.data() : &stack_.back() + 1;
+        return top_;
     }
 
     inline size_t size() const
     {
-        return stack_.size();
+        return static_cast<size_t>(top_ - base_);
     }
 
     inline void resize(size_t size)
     {
-        stack_.resize(size, EsValue::undefined);
+        if (size > this->size())
+            alloc(size - this->size());
+        else
+            top_ = base_ + size;
     }
 
     inline void alloc(size_t count)
     {
-        assert(stack_.size() + count < stack_.capacity());
-        stack_.resize(stack_.size() + count, EsValue::undefined);
+        EsValue *end = top_ + count;
+        if (end > roots_end_)
+            grow(end);
+
+        for (; top_ != end; top_++)
+            *top_ = EsValue::undefined;
+    }
+
+    /**
+     * Allocates values on the stack, leaving the red zone intact for the
+     * function calls that follow.
+     * @param [in] count Number of values to allocate.
+     * @return true on success, false if a RangeError was thrown.
+     */
+    inline bool allocT(size_t count)
+    {
+        if (top_ + count + ES_CALL_STACK_RED_ZONE > end_)
+            return overflowT();
+
+        alloc(count);
+        return true;
     }
 
     inline void free(size_t count)
     {
-        assert(stack_.size() >= count);
-        stack_.resize(stack_.size() - count, EsValue::undefined);
+        assert(size() >= count);
+        top_ -= count;
     }
 
     inline void push(const EsValue &val)
     {
-        assert(stack_.size() < stack_.capacity());
-        stack_.push_back(val);
+        if (top_ + 1 > roots_end_)
+            grow(top_ + 1);
+
+        *top_++ = val;
     }
 
     inline EsValue pop()
     {
-        assert(stack_.size() > 0);
-        EsValue res = stack_.back();
-        stack_.pop_back();
-        return res;
+        assert(size() > 0);
+        return *--top_;
     }
 };
 
@@ -143,7 +143,7 @@ void es_global_init()
             EsPropertyKey::from_str(_ESTR("Function")), EsValue::from_obj(fun));
     
     // Add math object.
-    EsObject *math = EsObject::create_inst_with_class(_USTR("Math"));
+    EsObject *math = EsObject::create_inst_with_class(EsObject::CLASS_MATH);
     ES_DEF_GLOBAL_PROPERTY(global_obj,
             EsPropertyKey::from_str(_ESTR("Math")), EsValue::from_obj(math));
     ES_DEF_GLOBAL_PROPERTY_RD_ONLY(math, property_keys.e, EsValue::from_num(ES_MATH_E));
@@ -174,7 +174,7 @@ void es_global_init()
     ES_DEF_GLOBAL_PROPERTY_FUN(math, property_keys.tan, es_std_math_tan, 1);
 
     // Add JSON object.
-    EsObject *json = EsObject::create_inst_with_class(_USTR("JSON"));
+    EsObject *json = EsObject::create_inst_with_class(EsObject::CLASS_JSON);
     ES_DEF_GLOBAL_PROPERTY(global_obj,
             EsPropertyKey::from_str(_ESTR("JSON")), EsValue::from_obj(json));
     ES_DEF_GLOBAL_PROPERTY_FUN(json, property_keys.parse, es_std_json_parse, 2);
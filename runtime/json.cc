@@ -16,37 +16,40 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "common/lexical.hh"
 #include "conversion.hh"
 #include "error.hh"
 #include "json.hh"
+#include "object.hh"
 #include "property.hh"
+#include "string.hh"
 #include "utility.hh"
 
 bool json_is_white_space(uni_char c)
 {
     // 15.12.1.1
     // WhiteSpace :: <TAB> <CR> <LF> <SP>
-
-    static uni_char ws[] =
-    {
-        0x0009, /* TAB */
-        0x000a, /* LF */
-        0x000d, /* CR */
-        0x0020, /* SP */
-    };
-
-    for (size_t i = 0; i < sizeof(ws)/sizeof(uni_char); i++)
+    switch (c)
     {
-        if (c == ws[i])
+        case 0x0009:    /* TAB */
+        case 0x000a:    /* LF */
+        case 0x000d:    /* CR */
+        case 0x0020:    /* SP */
             return true;
     }
 
     return false;
 }
 
-JsonParser::JsonParser(UnicodeStream &stream)
-    : stream_(stream)
+JsonParser::JsonParser(const EsString *text)
+    : text_(text)
+    , begin_(text->data())
+    , ptr_(begin_)
+    , end_(begin_ + text->length())
 {
 }
 
@@ -55,7 +58,7 @@ bool JsonParser::expect(const char *text)
     const char *ptr = text;
     while (*ptr)
     {
-        uni_char c = stream_.next();
+        uni_char c = next();
 
         if (c != static_cast<uni_char>(*ptr))
         {
@@ -73,59 +76,128 @@ bool JsonParser::expect(const char *text)
 
 void JsonParser::skip_white_space()
 {
-    uni_char c0 = stream_.next();
-    while (c0 != static_cast<uni_char>(-1) && json_is_white_space(c0))
+#ifdef __SSE2__
+    const __m128i tab = _mm_set1_epi32(0x0009);
+    const __m128i lf = _mm_set1_epi32(0x000a);
+    const __m128i cr = _mm_set1_epi32(0x000d);
+    const __m128i sp = _mm_set1_epi32(0x0020);
+
+    for (; ptr_ + 4 <= end_; ptr_ += 4)
+    {
+        __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr_));
+        __m128i ws = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi32(chars, tab), _mm_cmpeq_epi32(chars, lf)),
+                _mm_or_si128(_mm_cmpeq_epi32(chars, cr), _mm_cmpeq_epi32(chars, sp)));
+
+        int mask = _mm_movemask_epi8(ws);
+        if (mask != 0xffff)
+        {
+            // Each character occupies four bits in the mask.
+            ptr_ += __builtin_ctz(~mask) >> 2;
+            return;
+        }
+    }
+#endif
+
+    while (ptr_ < end_ && json_is_white_space(*ptr_))
+        ptr_++;
+}
+
+const uni_char *JsonParser::scan_string_body() const
+{
+    const uni_char *ptr = ptr_;
+
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi32('"');
+    const __m128i backslash = _mm_set1_epi32('\\');
+    const __m128i space = _mm_set1_epi32(0x20);
+
+    for (; ptr + 4 <= end_; ptr += 4)
+    {
+        __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+        __m128i special = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi32(chars, quote),
+                             _mm_cmpeq_epi32(chars, backslash)),
+                _mm_cmplt_epi32(chars, space));
+
+        int mask = _mm_movemask_epi8(special);
+        if (mask != 0)
+            return ptr + (__builtin_ctz(mask) >> 2);
+    }
+#endif
+
+    for (; ptr < end_; ptr++)
     {
-        c0 = stream_.next();
+        uni_char c = *ptr;
+        if (c == '"' || c == '\\' || c <= static_cast<uni_char>(0x1f))
+            return ptr;
     }
 
-    stream_.push(c0);
+    return end_;
 }
 
 int32_t JsonParser::read_hex_number(int num_digits)
 {
-    uni_char digits[4];
     assert(num_digits <= 4);    // Assert to detect when debugging.
-    if (num_digits > 4)
+    if (num_digits > 4 || end_ - ptr_ < num_digits)
         return -1;
 
     int32_t res = 0;
     for (int i = 0; i < num_digits; i++)
     {
-        uni_char c = stream_.next();
-        digits[i] = c;
-
+        uni_char c = ptr_[i];
         if (!es_is_hex_digit(c))
-        {
-            for (int j = i; j >= 0; j--)
-                stream_.push(digits[j]);
-
             return -1;
-        }
 
         res = res * 16 + es_as_hex_digit(c);
     }
 
+    ptr_ += num_digits;
     return res;
 }
 
-bool JsonParser::parse_object(EsValue &result)
+EsPropertyKey JsonParser::lookup_key(const uni_char *start, size_t len)
+{
+    if (len > MAX_CACHED_KEY_LEN)
+        return EsPropertyKey::from_str(EsString::create(start, len));
+
+    size_t hash = len;
+    for (size_t i = 0; i < len; i++)
+        hash = hash * 31 + start[i];
+
+    KeyCacheEntry &entry = key_cache_[hash & (KEY_CACHE_SIZE - 1)];
+    if (entry.str_ && entry.str_->length() == len &&
+        std::equal(start, start + len, entry.str_->data()))
+    {
+        return entry.key_;
+    }
+
+    entry.str_ = EsString::create(start, len);
+    entry.key_ = EsPropertyKey::from_str(entry.str_);
+    return entry.key_;
+}
+
+bool JsonParser::parse_object(EsValue &result, size_t num_props_hint)
 {
     EsObject *obj = EsObject::create_inst();
 
+    // Objects in the same array usually share the same members, allocate
+    // room for all of them up front.
+    if (num_props_hint > 0)
+        obj->map().reserve(num_props_hint);
+
 #ifdef DEBUG
-    uni_char c0 = stream_.next();
+    uni_char c0 = next();
     assert(c0 == '{');
 #else
-    stream_.next();
+    next();
 #endif
 
     skip_white_space();
 
-    uni_char c1 = stream_.next();
+    uni_char c1 = next();
     while (c1 != static_cast<uni_char>(-1) && c1 != '}')
     {
-        stream_.push(c1);
         if (c1 != '"')
         {
             ES_THROW(EsSyntaxError, EsStringBuilder::sprintf(
@@ -133,8 +205,11 @@ bool JsonParser::parse_object(EsValue &result)
             return false;
         }
 
-        EsValue member_name;
-        if (!parse_string(member_name))
+        // Return the quote.
+        ptr_--;
+
+        EsPropertyKey member_key;
+        if (!parse_key(member_key))
             return false;
 
         skip_white_space();
@@ -148,16 +223,25 @@ bool JsonParser::parse_object(EsValue &result)
 
         skip_white_space();
 
-        if (!obj->define_own_propertyT(EsPropertyKey::from_str(member_name.as_string()),
-                                       EsPropertyDescriptor(true, true, true,
-                                                            member_value), true))
+        // Only duplicate member names need the full [[DefineOwnProperty]].
+        if (!obj->get_own_property(member_key))
+        {
+            obj->define_new_own_property(member_key,
+                                         EsPropertyDescriptor(true, true, true,
+                                                              member_value));
+        }
+        else if (!obj->define_own_propertyT(member_key,
+                                            EsPropertyDescriptor(true, true, true,
+                                                                 member_value), true))
+        {
             return false;
+        }
 
-        c1 = stream_.next();
+        c1 = next();
         if (c1 == ',')
         {
             skip_white_space();
-            c1 = stream_.next();
+            c1 = next();
         }
         else if (c1 != '}')
         {
@@ -182,31 +266,40 @@ bool JsonParser::parse_object(EsValue &result)
 bool JsonParser::parse_array(EsValue &result)
 {
 #ifdef DEBUG
-    uni_char c0 = stream_.next();
+    uni_char c0 = next();
     assert(c0 == '[');
 #else
-    stream_.next();
+    next();
 #endif
 
     EsValueVector items;
 
-    uni_char c1 = stream_.next();
+    // Number of members of the previous object element.
+    size_t num_props_hint = 0;
+
+    skip_white_space();
+
+    uni_char c1 = next();
     while (c1 != static_cast<uni_char>(-1) && c1 != ']')
     {
-        stream_.push(c1);
+        // Return the first character of the value.
+        ptr_--;
 
         EsValue val;
-        if (!parse_value(val))
+        if (!parse_value(val, num_props_hint))
             return false;
 
+        if (val.is_object())
+            num_props_hint = val.as_object()->map().size();
+
         items.push_back(val);
         skip_white_space();
 
-        c1 = stream_.next();
+        c1 = next();
         if (c1 == ',')
         {
             skip_white_space();
-            c1 = stream_.next();
+            c1 = next();
         }
         else if (c1 != ']')
         {
@@ -225,79 +318,118 @@ bool JsonParser::parse_array(EsValue &result)
     }
 
     result = EsValue::from_obj(EsArray::create_inst_from_lit(
-            static_cast<uint32_t>(items.size()), &items[0]));
+            static_cast<uint32_t>(items.size()), items.empty() ? NULL : &items[0]));
     return true;
 }
 
-bool JsonParser::parse_string(EsValue &result)
+bool JsonParser::parse_key(EsPropertyKey &result)
 {
-    sb_.clear();
+#ifdef DEBUG
+    uni_char c0 = next();
+    assert(c0 == '"');
+#else
+    next();
+#endif
+
+    const uni_char *start = ptr_;
+    const uni_char *stop = scan_string_body();
+    if (stop < end_ && *stop == '"')
+    {
+        ptr_ = stop + 1;
+        result = lookup_key(start, stop - start);
+        return true;
+    }
+
+    EsValue key_str;
+    if (!parse_string_body(key_str))
+        return false;
 
+    result = EsPropertyKey::from_str(key_str.as_string());
+    return true;
+}
+
+bool JsonParser::parse_string(EsValue &result)
+{
 #ifdef DEBUG
-    uni_char c0 = stream_.next();
+    uni_char c0 = next();
     assert(c0 == '"');
 #else
-    stream_.next();
+    next();
 #endif
 
-    uni_char c1 = stream_.next();
-    while (c1 != static_cast<uni_char>(-1) &&
-           c1 > static_cast<uni_char>(0x1f) && c1 != '"')
+    // Strings without escape sequences are taken directly from the source.
+    const uni_char *start = ptr_;
+    const uni_char *stop = scan_string_body();
+    if (stop < end_ && *stop == '"')
+    {
+        ptr_ = stop + 1;
+        result = EsValue::from_str(text_->substr(start - begin_, stop - start));
+        return true;
+    }
+
+    return parse_string_body(result);
+}
+
+bool JsonParser::parse_string_body(EsValue &result)
+{
+    sb_.clear();
+
+    uni_char c1 = 0;
+    while (true)
     {
-        if (c1 == '\\')
+        const uni_char *stop = scan_string_body();
+        sb_.append(ptr_, stop - ptr_);
+        ptr_ = stop;
+
+        c1 = next();
+        if (c1 != '\\')
+            break;
+
+        uni_char c2 = next();
+        switch (c2)
         {
-            uni_char c2 = stream_.next();
-            switch (c2)
+            // Single escape character.
+            case '"':
+            case '/':
+            case '\\':
+                sb_.append(c2);
+                break;
+            case 'b':
+                sb_.append('\b');
+                break;
+            case 'f':
+                sb_.append('\f');
+                break;
+            case 'n':
+                sb_.append('\n');
+                break;
+            case 'r':
+                sb_.append('\r');
+                break;
+            case 't':
+                sb_.append('\t');
+                break;
+            // Unicode escape sequence.
+            case 'u':
             {
-                // Single escape character.
-                case '"':
-                case '/':
-                case '\\':
-                    sb_.append(c2);
-                    break;
-                case 'b':
-                    sb_.append('\b');
-                    break;
-                case 'f':
-                    sb_.append('\f');
-                    break;
-                case 'n':
-                    sb_.append('\n');
-                    break;
-                case 'r':
-                    sb_.append('\r');
-                    break;
-                case 't':
-                    sb_.append('\t');
-                    break;
-                // Unicode escape sequence.
-                case 'u':
+                int32_t val = read_hex_number(4);
+                if (val == -1)
                 {
-                    int32_t val = read_hex_number(4);
-                    if (val == -1)
-                    {
-                        ES_THROW(EsSyntaxError, EsStringBuilder::sprintf(
-                                "illegal character in unicode escape sequence."));
-                        return false;
-                    }
-                    else
-                    {
-                        sb_.append(static_cast<uni_char>(val));
-                    }
-                    break;
-                }
-                default:
                     ES_THROW(EsSyntaxError, EsStringBuilder::sprintf(
-                            "illegal character in escape sequence."));
+                            "illegal character in unicode escape sequence."));
                     return false;
+                }
+                else
+                {
+                    sb_.append(static_cast<uni_char>(val));
+                }
+                break;
             }
+            default:
+                ES_THROW(EsSyntaxError, EsStringBuilder::sprintf(
+                        "illegal character in escape sequence."));
+                return false;
         }
-        else
-        {
-            sb_.append(c1);
-        }
-
-        c1 = stream_.next();
     }
 
     if (c1 != '"')
@@ -313,54 +445,46 @@ bool JsonParser::parse_string(EsValue &result)
 
 bool JsonParser::parse_number(EsValue &result)
 {
-    sb_.clear();
+    /** Maximum number of digits that are guaranteed to fit in a double. */
+    static const size_t MAX_EXACT_DIGITS = 15;
 
-    uni_char c = stream_.next();
-    if (c == '-')
-    {
-        sb_.append(c);
-        c = stream_.next();
-    }
+    const uni_char *start = ptr_;
 
-    while (es_is_dec_digit(c))
+    bool negative = false;
+    if (peek() == '-')
     {
-        sb_.append(c);
-        c = stream_.next();
+        negative = true;
+        ptr_++;
     }
 
-    if (c == '.')
-    {
-        sb_.append(c);
+    const uni_char *digits = ptr_;
+    while (ptr_ < end_ && es_is_dec_digit(*ptr_))
+        ptr_++;
 
-        c = stream_.next();
-        while (es_is_dec_digit(c))
-        {
-            sb_.append(c);
-            c = stream_.next();
-        }
+    size_t num_digits = ptr_ - digits;
+    bool is_integer = true;
 
-        // Return the non-digit.
-        stream_.push(c);
-    }
-    else
+    if (peek() == '.')
     {
-        // Return the non-dot.
-        stream_.push(c);
+        is_integer = false;
+
+        ptr_++;
+        while (ptr_ < end_ && es_is_dec_digit(*ptr_))
+            ptr_++;
     }
 
     // Scan exponent.
-    c = stream_.next();
+    uni_char c = peek();
     if (c == 'e' || c == 'E')
     {
-        sb_.append(c);
+        is_integer = false;
 
-        c = stream_.next();
+        ptr_++;
+        c = peek();
         if (c == '+' || c == '-')
-        {
-            sb_.append(c);
-            c = stream_.next();
-        }
+            ptr_++;
 
+        c = next();
         if (!es_is_dec_digit(c))
         {
             ES_THROW(EsSyntaxError, EsStringBuilder::sprintf(
@@ -368,33 +492,32 @@ bool JsonParser::parse_number(EsValue &result)
             return false;
         }
 
-        while (es_is_dec_digit(c))
-        {
-            sb_.append(c);
-            c = stream_.next();
-        }
-
-        // Return the non-digit.
-        stream_.push(c);
+        while (ptr_ < end_ && es_is_dec_digit(*ptr_))
+            ptr_++;
     }
-    else
+
+    // Integers small enough to be represented exactly can be computed
+    // directly from the digits.
+    if (is_integer && num_digits > 0 && num_digits <= MAX_EXACT_DIGITS)
     {
-        // Return non 'e' or 'E' letter.
-        stream_.push(c);
+        double num = 0.0;
+        for (const uni_char *d = digits; d < ptr_; d++)
+            num = num * 10.0 + static_cast<double>(*d - '0');
+
+        result = EsValue::from_num(negative ? -num : num);
+        return true;
     }
 
-    result = EsValue::from_num(es_str_to_num(sb_.string()));
+    result = EsValue::from_num(es_str_to_num(
+            EsString::create(start, ptr_ - start)));
     return true;
 }
 
-bool JsonParser::parse_value(EsValue &result)
+bool JsonParser::parse_value(EsValue &result, size_t num_props_hint)
 {
     skip_white_space();
 
-    uni_char c0 = stream_.next();
-    stream_.push(c0);
-
-    switch (c0)
+    switch (peek())
     {
         case 'n':
             if (!expect("null"))
@@ -412,7 +535,7 @@ bool JsonParser::parse_value(EsValue &result)
             result = EsValue::from_bool(false);
             return true;
         case '{':
-            return parse_object(result);
+            return parse_object(result, num_props_hint);
         case '[':
             return parse_array(result);
         case '"':
@@ -432,7 +555,7 @@ bool JsonParser::parse_value(EsValue &result)
         //case -1:
         default:
             ES_THROW(EsSyntaxError, EsStringBuilder::sprintf(
-                    "unexpected token '%C' in json value.", c0));
+                    "unexpected token '%C' in json value.", peek()));
             return false;
     }
 
@@ -446,7 +569,9 @@ bool JsonParser::parse(EsValue &result)
     if (!parse_value(result))
         return false;
 
-    uni_char c0 = stream_.next();
+    skip_white_space();
+
+    uni_char c0 = next();
     if (c0 != static_cast<uni_char>(-1))
     {
         ES_THROW(EsSyntaxError, EsStringBuilder::sprintf(
@@ -18,42 +18,107 @@
 
 #pragma once
 #include <gc/gc_allocator.h>
-#include "parser/stream.hh"
+#include "property_key.hh"
 #include "stringbuilder.hh"
 
-bool json_is_white_space(uni_char c);
+class EsString;
+class EsValue;
 
-using parser::UnicodeStream;
+bool json_is_white_space(uni_char c);
 
 /**
  * @brief JSON parser.
+ *
+ * The parser reads directly from the character data of the source string.
+ * Property keys are interned through a small cache so that keys repeated
+ * throughout the text, such as the member names of objects in an array,
+ * are only interned once per parse.
  */
 class JsonParser
 {
 private:
-    UnicodeStream &stream_;     ///< Source input stream.
+    /** Number of entries in the property key cache, must be a power of 2. */
+    static const size_t KEY_CACHE_SIZE = 128;
+
+    /** Maximum length of property keys to store in the key cache. */
+    static const size_t MAX_CACHED_KEY_LEN = 32;
+
+    /**
+     * @brief Property key cache entry.
+     */
+    struct KeyCacheEntry
+    {
+        const EsString *str_;   ///< Key string, NULL if the entry is unused.
+        EsPropertyKey key_;     ///< Property key of str_.
+
+        KeyCacheEntry()
+            : str_(NULL) {}
+    };
+
+private:
+    const EsString *text_;      ///< Source text.
+    const uni_char *begin_;     ///< Beginning of source text characters.
+    const uni_char *ptr_;       ///< Current read position.
+    const uni_char *end_;       ///< End of source text characters.
 
     EsStringBuilder sb_;        ///< Stateless string builder shared by many routines.
 
+    KeyCacheEntry key_cache_[KEY_CACHE_SIZE];   ///< Property key cache.
+
+    /**
+     * @return Next character without consuming it, or -1 at end of input.
+     */
+    inline uni_char peek() const
+    {
+        return ptr_ < end_ ? *ptr_ : static_cast<uni_char>(-1);
+    }
+
+    /**
+     * @return Next character, or -1 at end of input.
+     */
+    inline uni_char next()
+    {
+        return ptr_ < end_ ? *ptr_++ : static_cast<uni_char>(-1);
+    }
+
     bool expect(const char *text);
 
     void skip_white_space();
 
-    // FIXME: Copied from lexer.
+    /**
+     * Finds the first character in the current string body that needs
+     * special attention, that is a quote, a backslash or a control
+     * character.
+     * @return Pointer to the first special character, or end_ if there are
+     *         no more special characters.
+     */
+    const uni_char *scan_string_body() const;
+
     int32_t read_hex_number(int num_digits);
 
-    bool parse_object(EsValue &result);
+    /**
+     * Returns the property key for a string, looking it up in the key cache
+     * if possible.
+     * @param [in] start Start position of the string body in the source text.
+     * @param [in] len Length of the string body.
+     * @return Property key.
+     */
+    EsPropertyKey lookup_key(const uni_char *start, size_t len);
+
+    bool parse_object(EsValue &result, size_t num_props_hint);
     bool parse_array(EsValue &result);
+    bool parse_key(EsPropertyKey &result);
     bool parse_string(EsValue &result);
+    bool parse_string_body(EsValue &result);
     bool parse_number(EsValue &result);
-    bool parse_value(EsValue &result);
+    bool parse_value(EsValue &result, size_t num_props_hint = 0);
 
 public:
     /**
      * Constructs a JSON parser for parsing JSON code.
-     * @param [in] stream Source input stream.
+     * @param [in] text Source text.
      */
-    JsonParser(UnicodeStream &stream);
+    JsonParser(const EsString *text);
 
     bool parse(EsValue &result);
 };
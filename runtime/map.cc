@@ -19,31 +19,103 @@
 #include <cassert>
 #include <gc_cpp.h>
 #include "map.hh"
+#include "property.hh"
 #include "shape.hh"
 
 EsMap::EsMap(EsObject *base)
     : base_(base)
-    , last_shape_(EsShape::root())
-    , map_(NULL)
+    , shape_(EsShape::root())
+    , dict_(NULL)
 {
 }
 
+EsMap::Id EsMap::next_dictionary_id()
+{
+    static Id counter = 0;
+    return (++counter << 4) | 1;
+}
+
+void EsMap::make_dictionary()
+{
+    assert(!dict_);
+
+    dict_ = new (GC)Dictionary();
+    dict_->id_ = next_dictionary_id();
+
+    size_t count = shape_->depth();
+    dict_->slots_.reserve(count);
+    dict_->keys_.resize(count);
+
+    for (EsShape *shape = shape_; shape != EsShape::root(); shape = shape->parent())
+    {
+        assert(shape->slot() < count);
+        dict_->slots_.insert(std::make_pair(shape->key(), shape->slot()));
+        dict_->keys_[shape->slot()] = shape->key();
+    }
+
+    // The shape may be shared with other maps, don't touch it.
+    shape_ = EsShape::root();
+}
+
+void EsMap::compact_dictionary()
+{
+    assert(dict_);
+
+    size_t dst = 0;
+    for (size_t src = 0; src < dict_->keys_.size(); src++)
+    {
+        EsKeySlotMap::iterator it = dict_->slots_.find(dict_->keys_[src]);
+        if (it == dict_->slots_.end() || it->second != src)
+            continue;
+
+        if (dst != src)
+        {
+            props_[dst] = props_[src];
+            dict_->keys_[dst] = dict_->keys_[src];
+            it->second = dst;
+        }
+
+        dst++;
+    }
+
+    props_.erase(props_.begin() + dst, props_.end());
+    dict_->keys_.resize(dst);
+    dict_->num_dead_ = 0;
+}
+
 EsMap::Id EsMap::id() const
 {
-    return reinterpret_cast<EsMap::Id>(last_shape_);
+    return dict_ ? dict_->id_ : reinterpret_cast<EsMap::Id>(shape_);
 }
 
 size_t EsMap::size() const
 {
-    return last_shape_->depth();
+    return dict_ ? dict_->slots_.size() : shape_->depth();
 }
 
 std::vector<EsPropertyKey> EsMap::keys() const
 {
-    size_t prop_count = last_shape_->depth();
+    if (dict_)
+    {
+        std::vector<EsPropertyKey> prop_keys;
+        prop_keys.reserve(dict_->slots_.size());
+
+        // Slots are allocated in increasing order so the slot order is the
+        // order in which the properties were added.
+        for (size_t i = 0; i < dict_->keys_.size(); i++)
+        {
+            EsKeySlotMap::const_iterator it = dict_->slots_.find(dict_->keys_[i]);
+            if (it != dict_->slots_.end() && it->second == i)
+                prop_keys.push_back(dict_->keys_[i]);
+        }
+
+        return prop_keys;
+    }
+
+    size_t prop_count = shape_->depth();
     std::vector<EsPropertyKey> prop_keys(prop_count);
 
-    EsShape *shape = last_shape_;
+    EsShape *shape = shape_;
     for (size_t i = prop_count - 1; shape != EsShape::root(); shape = shape->parent(), i--)
         prop_keys[i] = shape->key();
 
@@ -52,65 +124,96 @@ std::vector<EsPropertyKey> EsMap::keys() const
 
 void EsMap::add(const EsPropertyKey &key, const EsProperty &prop)
 {
-    size_t slot = EsShape::INVALID_SLOT;
-    if (free_slots_.empty())
-    {
-        slot = props_.size();
-        props_.push_back(prop);
-    }
-    else
+    if (!dict_ && shape_->depth() >= MAX_NUM_SHAPED)
+        make_dictionary();
+
+    size_t slot = props_.size();
+    props_.push_back(prop);
+
+    if (dict_)
     {
-        slot = free_slots_.back();
-        free_slots_.pop_back();
-        props_[slot] = prop;
+        dict_->slots_.insert(std::make_pair(key, slot));
+        dict_->keys_.push_back(key);
+        dict_->id_ = next_dictionary_id();
+        return;
     }
 
-    last_shape_ = last_shape_->add(key, slot);
+    assert(slot == shape_->depth());
+    shape_ = shape_->add(key, slot);
+}
 
-    // If the property chain grows too large, allocate a hash map for fast
-    // property lookup.
-    if (!map_ && last_shape_->depth() > MAX_NUM_NON_MAPPED)
-    {
-        map_ = new (GC)EsKeySlotMap();
+void EsMap::assign(EsShape *shape, const EsValue vals[])
+{
+    assert(shape_ == EsShape::root());
+    assert(props_.empty() && !dict_);
 
-        // Add all existing properties.
-        EsShape *shape = last_shape_->parent();
-        for (; shape != EsShape::root(); shape = shape->parent())
-            map_->insert(std::make_pair(shape->key(), shape->slot()));
-    }
+    size_t count = shape->depth();
+
+    props_.reserve(count);
+    for (size_t i = 0; i < count; i++)
+        props_.push_back(EsProperty(true, true, true, vals[i]));
+
+    shape_ = shape;
+}
 
-    if (map_)
-        map_->insert(std::make_pair(key, slot));
+void EsMap::reserve(size_t count)
+{
+    props_.reserve(count);
 }
 
 void EsMap::remove(const EsPropertyKey &key)
 {
-    const EsShape *to_remove = last_shape_->lookup(key);
-    if (!to_remove)
+    if (!dict_)
+    {
+        // Removing the last added property takes us back to the parent shape.
+        if (shape_ != EsShape::root() && shape_->key() == key)
+        {
+            assert(shape_->slot() == props_.size() - 1);
+
+            shape_ = shape_->remove(key);
+            props_.pop_back();
+            return;
+        }
+
+        if (!shape_->lookup(key))
+            return;
+
+        // Removing any other property would require re-numbering the slots,
+        // leave the shape tree.
+        make_dictionary();
+    }
+
+    EsKeySlotMap::iterator it = dict_->slots_.find(key);
+    if (it == dict_->slots_.end())
         return;
 
-    last_shape_ = last_shape_->remove(key);
-    assert(last_shape_);
+    // Clear the value so that it can be garbage collected.
+    props_[it->second] = EsProperty(false, false, false, Maybe<EsValue>());
 
-    free_slots_.push_back(to_remove->slot());
+    dict_->slots_.erase(it);
+    dict_->num_dead_++;
+    dict_->id_ = next_dictionary_id();
 
-    if (map_)
-        map_->erase(key);
+    if (dict_->num_dead_ >= MIN_NUM_DEAD_COMPACT &&
+        dict_->num_dead_ > dict_->slots_.size())
+    {
+        compact_dictionary();
+    }
 }
 
 EsPropertyReference EsMap::lookup(const EsPropertyKey &key)
 {
-    if (map_)
+    if (dict_)
     {
-        EsKeySlotMap::iterator it = map_->find(key);
-        if (it == map_->end())
+        EsKeySlotMap::iterator it = dict_->slots_.find(key);
+        if (it == dict_->slots_.end())
             return EsPropertyReference();
 
         assert(it->second < props_.size());
         return EsPropertyReference(base_, &props_, it->second);
     }
 
-    const EsShape *shape = last_shape_->lookup(key);
+    const EsShape *shape = shape_->lookup(key);
     if (shape)
     {
         assert(shape->slot() < props_.size());
@@ -125,11 +228,17 @@ EsPropertyReference EsMap::from_cached(const EsPropertyReference &cached)
     return cached.rebase(base_, &props_);
 }
 
+EsPropertyReference EsMap::from_slot(size_t slot)
+{
+    assert(slot < props_.size());
+    return EsPropertyReference(base_, &props_, slot);
+}
+
 bool EsMap::operator==(const EsMap &rhs) const
 {
     // If the last shape pointers refers to the same shape we know that they
-    // have followed the same transitions.
-    return last_shape_ == rhs.last_shape_;
+    // have followed the same transitions. Dictionaries are never shared.
+    return id() == rhs.id();
 }
 
 bool EsMap::operator!=(const EsMap &rhs) const
@@ -137,6 +246,11 @@ bool EsMap::operator!=(const EsMap &rhs) const
     return !(*this == rhs);
 }
 
+bool EsMap::is_dictionary() const
+{
+    return dict_ != NULL;
+}
+
 #ifdef DEBUG
 size_t EsMap::capacity() const
 {
@@ -145,16 +259,16 @@ size_t EsMap::capacity() const
 
 size_t EsMap::slot(const EsPropertyKey &key) const
 {
-    if (map_)
+    if (dict_)
     {
-        EsKeySlotMap::iterator it = map_->find(key);
-        if (it == map_->end())
+        EsKeySlotMap::const_iterator it = dict_->slots_.find(key);
+        if (it == dict_->slots_.end())
             return EsShape::INVALID_SLOT;
 
         return it->second;
     }
 
-    const EsShape *shape = last_shape_->lookup(key);
+    const EsShape *shape = shape_->lookup(key);
     if (shape)
         return shape->slot();
 
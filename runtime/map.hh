@@ -28,6 +28,7 @@
 class EsObject;
 class EsProperty;
 class EsShape;
+class EsValue;
 
 /**
  * @brief Maps property names to properties.
@@ -42,31 +43,73 @@ public:
     typedef uintptr_t Id;
 
 private:
-    /** Maximum number of properties to maintain before creating a hash map. */
-    static const size_t MAX_NUM_NON_MAPPED = 10;
+    /** Maximum number of properties to maintain in shaped mode. Maps growing
+     * beyond this are switched to dictionary mode to avoid building very long
+     * shape chains. */
+    static const size_t MAX_NUM_SHAPED = 128;
+
+    /** Minimum number of removed properties before a dictionary is
+     * compacted. */
+    static const size_t MIN_NUM_DEAD_COMPACT = 8;
 
 private:
-    typedef std::unordered_map<EsPropertyKey, size_t, EsPropertyKey::Hash> EsKeySlotMap;
+    typedef std::unordered_map<EsPropertyKey, size_t, EsPropertyKey::Hash,
+                               std::equal_to<EsPropertyKey>,
+                               gc_allocator<std::pair<EsPropertyKey, size_t> > > EsKeySlotMap;
+    typedef std::vector<EsPropertyKey,
+                        gc_allocator<EsPropertyKey> > EsPropertyKeyVector;
+
+    /**
+     * @brief Property table of a map in dictionary mode.
+     *
+     * Maps which have properties removed from anywhere but the end, or which
+     * grow very large, no longer share structure with other maps. Such maps
+     * keep a private table instead of a shape.
+     */
+    struct Dictionary
+    {
+        Id id_;                     ///< Identifier of the current structure.
+        size_t num_dead_;           ///< Number of slots of removed properties.
+        EsKeySlotMap slots_;        ///< Property slot of each key.
+        EsPropertyKeyVector keys_;  ///< Property key of each slot.
+
+        Dictionary()
+            : id_(0)
+            , num_dead_(0) {}
+    };
+
+    /**
+     * Generates a new dictionary identifier. Dictionary identifiers are odd
+     * and can therefore never collide with the identifier of a shaped map.
+     * @return Unique map identifier.
+     */
+    static Id next_dictionary_id();
+
+    /**
+     * Switches the map to dictionary mode.
+     */
+    void make_dictionary();
+
+    /**
+     * Removes the slots of removed properties from a dictionary, moving the
+     * remaining properties to the front of the property array.
+     */
+    void compact_dictionary();
 
 private:
     /** Base object owning the map. */
     EsObject *base_;
 
-    /** Previously allocated slots that have been freed up by removing
-     * properties. These slots should be re-used before allocating new
-     * slots. */
-    std::vector<size_t> free_slots_;
-
-    /** Last added shape, or EsShape::root() if the map is empty. */
-    EsShape *last_shape_;
+    /** Last added shape, or EsShape::root() if the map is empty. In shaped
+     * mode the property in slot n is the n:th property added to the shape
+     * chain. In dictionary mode the shape is unused. */
+    EsShape *shape_;
 
     /** Property array. */
     EsPropertyVector props_;
 
-    /** When the number of properties becomes too large we'll create a hash map
-     * for faster property lookup.
-     * @see MAX_NUM_NON_MAPPED */
-    EsKeySlotMap *map_;
+    /** Property table, only allocated in dictionary mode. */
+    Dictionary *dict_;
 
 public:
     explicit EsMap(EsObject *base);
@@ -94,6 +137,24 @@ public:
      */
     void add(const EsPropertyKey &p, const EsProperty &prop);
 
+    /**
+     * Initializes an empty map with all properties of a shape at once. The
+     * properties of the shape must occupy the slots 0 to n - 1 in the order
+     * they were added to the shape.
+     * @param [in] shape Final shape of the map.
+     * @param [in] vals Values of the properties in slot order. All
+     *                  properties are created as writable, enumerable and
+     *                  configurable data properties.
+     * @pre The map is empty.
+     */
+    void assign(EsShape *shape, const EsValue vals[]);
+
+    /**
+     * Allocates storage for a number of properties up front.
+     * @param [in] count Number of properties to allocate storage for.
+     */
+    void reserve(size_t count);
+
     /**
      * Removes a property from the map.
      * @param [in] key Property key.
@@ -110,6 +171,14 @@ public:
 
     EsPropertyReference from_cached(const EsPropertyReference &cached);
 
+    /**
+     * Creates a reference to the property in a given slot.
+     * @param [in] slot Property slot, must have been obtained from a map
+     *                  with the same identifier as this map.
+     * @return Reference to property object.
+     */
+    EsPropertyReference from_slot(size_t slot);
+
     /**
      * Compares two maps for equality.
      * @param [in] rhs Right-hand-side map to compare against.
@@ -124,6 +193,11 @@ public:
      */
     bool operator!=(const EsMap &rhs) const;
 
+    /**
+     * @return true if the map is in dictionary mode.
+     */
+    bool is_dictionary() const;
+
 #ifdef DEBUG
     size_t capacity() const;
     size_t slot(const EsPropertyKey &key) const;
@@ -30,6 +30,7 @@ static const char *es_messages_[] =
     "the number of fractional digits must be a value between 0 and 20.",
     "date number must be a finite number.",
     "precision must be a value between 1 and and 21",
+    "maximum call stack size exceeded.",
     
     // ReferenceError.
     "'%s' is not defined.",
@@ -28,6 +28,7 @@ enum EsMessage
     ES_MSG_RANGE_FRAC_DIGITS,
     ES_MSG_RANGE_INFINITE_DATE,
     ES_MSG_RANGE_PRECISION,
+    ES_MSG_RANGE_CALL_STACK,
 
     // ReferenceError.
     ES_MSG_REF_NOT_DEFINED,
@@ -16,6 +16,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <limits>
@@ -42,7 +43,9 @@
 #include "operation.h"
 #include "platform.hh"
 #include "property.hh"
+#include "program_cache.hh"
 #include "prototype.hh"
+#include "resolver.hh"
 #include "standard.hh"
 #include "utility.hh"
 #include "unique.hh"
@@ -72,6 +75,7 @@ EsFunction *EsObject::default_constr_ = NULL;
 
 EsObject::EsObject()
     : prototype_(NULL)
+    , class_(CLASS_OBJECT)
     , extensible_(true)
     , map_(this)
 {
@@ -84,14 +88,14 @@ EsObject::~EsObject()
 void EsObject::make_inst()
 {
     prototype_ = es_proto_obj();
-    class_ = _USTR("Object");
+    class_ = CLASS_OBJECT;
     extensible_ = true;
 }
 
 void EsObject::make_proto()
 {
     prototype_ = NULL;
-    class_ = _USTR("Object");
+    class_ = CLASS_OBJECT;
     extensible_ = true;
 
     // 15.2.4
@@ -116,11 +120,11 @@ EsObject *EsObject::create_inst()
     return o;
 }
 
-EsObject *EsObject::create_inst_with_class(const String &class_name)
+EsObject *EsObject::create_inst_with_class(Class class_id)
 {
     EsObject *o = new (GC)EsObject();
     o->make_inst();
-    o->class_ = class_name;
+    o->class_ = class_id;
     return o;
 }
 
@@ -132,6 +136,37 @@ EsObject *EsObject::create_inst_with_prototype(EsObject *prototype)
     return o;
 }
 
+EsObject *EsObject::create_inst_from_shape(EsShape *shape, const EsValue vals[])
+{
+    EsObject *o = new (GC)EsObject();
+    o->make_inst();
+    o->map_.assign(shape, vals);
+    return o;
+}
+
+const String &EsObject::class_name() const
+{
+    // Must be kept in sync with the Class enumeration.
+    static const String names[] =
+    {
+        _USTR("Arguments"),
+        _USTR("Array"),
+        _USTR("Boolean"),
+        _USTR("Date"),
+        _USTR("Error"),
+        _USTR("Function"),
+        _USTR("JSON"),
+        _USTR("Math"),
+        _USTR("Number"),
+        _USTR("Object"),
+        _USTR("RegExp"),
+        _USTR("String")
+    };
+
+    assert(class_ < sizeof(names) / sizeof(names[0]));
+    return names[class_];
+}
+
 EsFunction *EsObject::default_constr()
 {
     if (default_constr_ == NULL)
@@ -193,7 +228,16 @@ EsPropertyReference EsObject::get_own_property(EsPropertyKey p)
 {
     if (p.is_index())
     {
-        EsProperty *prop = indexed_properties_.get(p.as_index());
+        uint32_t index = p.as_index();
+        if (!indexed_properties_.is_generic())
+        {
+            if (indexed_properties_.contains(index))
+                return EsPropertyReference(this, &indexed_properties_, index);
+
+            return EsPropertyReference();
+        }
+
+        EsProperty *prop = indexed_properties_.get(index);
         if (prop)
             return EsPropertyReference(this, prop);
 
@@ -225,6 +269,12 @@ bool EsObject::get_resolveT(const EsPropertyReference &prop, EsValue &v)
         v = EsValue::undefined;
         return true;
     }
+
+    if (prop.is_element())
+    {
+        v = prop.element_value();
+        return true;
+    }
     
     if (prop->is_data())
     {
@@ -258,6 +308,9 @@ bool EsObject::can_put(EsPropertyKey p, EsPropertyReference &prop)
     prop = get_own_property(p);
     if (prop)
     {
+        if (prop.is_element())
+            return true;
+
         if (prop->is_accessor())
             return !prop->setter_or_undefined().is_undefined(); // FIXME: has_setter()?
         else
@@ -268,7 +321,7 @@ bool EsObject::can_put(EsPropertyKey p, EsPropertyReference &prop)
         return extensible_;
     
     prop = prototype_->get_property(p);
-    if (!prop)
+    if (!prop || prop.is_element())
         return extensible_;
     
     if (prop->is_accessor())
@@ -284,6 +337,9 @@ bool EsObject::can_put_own(const EsPropertyReference &current)
 {
     assert(current);
 
+    if (current.is_element())
+        return true;
+
     if (current->is_accessor())
         return !current->setter_or_undefined().is_undefined();  // FIXME: has_setter()?
     else
@@ -304,10 +360,10 @@ bool EsObject::putT(EsPropertyKey p, const EsValue &v, bool throws)
         return true;
     }
 
-    if (prop && prop->is_data() && prop.base() == this)
+    if (prop && prop.base() == this && (prop.is_element() || prop->is_data()))
         return update_own_propertyT(p, prop, v, throws);
 
-    if (prop && prop->is_accessor())
+    if (prop && !prop.is_element() && prop->is_accessor())
     {
         EsValue setter = prop->setter_or_undefined();
         if (setter.is_undefined())
@@ -353,7 +409,7 @@ bool EsObject::put_ownT(EsPropertyKey p, EsPropertyReference &current,
         return true;
     }
 
-    if (current->is_data())
+    if (current.is_element() || current->is_data())
         return update_own_propertyT(p, current, v, throws);
 
     if (current->is_accessor())
@@ -398,7 +454,7 @@ bool EsObject::removeT(EsPropertyKey p, bool throws, bool &removed)
         return true;
     }
     
-    if (prop->is_configurable())
+    if (prop.is_element() || prop->is_configurable())
     {
         if (p.is_index())
             indexed_properties_.remove(p.as_index());
@@ -544,6 +600,21 @@ bool EsObject::define_own_propertyT(EsPropertyKey p, const EsPropertyDescriptor
         return true;
     }
 
+    // Elements in packed storage are writable, enumerable and configurable
+    // data properties, descriptors that don't change that only need to
+    // update the value.
+    if (current.is_element() && !desc.is_accessor() &&
+        (!desc.has_writable() || desc.is_writable()) &&
+        (!desc.has_enumerable() || desc.is_enumerable()) &&
+        (!desc.has_configurable() || desc.is_configurable()))
+    {
+        if (desc.value())
+            current.set_element_value(*desc.value());
+
+        defined = true;
+        return true;
+    }
+
     if (desc.empty() || current->described_by(desc))
     {
         defined = true;
@@ -644,6 +715,12 @@ bool EsObject::update_own_propertyT(EsPropertyKey p, EsPropertyReference &curren
 {
     assert(current);
 
+    if (current.is_element())
+    {
+        current.set_element_value(v);
+        return true;
+    }
+
     if (!current->is_data())
     {
         assert(current->is_accessor());
@@ -739,7 +816,7 @@ EsArguments *EsArguments::create_inst(EsFunction *callee,
     EsArguments *a = new (GC)EsArguments();
 
     a->prototype_ = es_proto_obj();
-    a->class_ = _USTR("Arguments");
+    a->class_ = CLASS_ARGUMENTS;
     a->extensible_ = true;
 
     a->param_map_ = EsObject::create_inst();
@@ -786,7 +863,7 @@ EsArguments *EsArguments::create_inst(EsFunction *callee,
     EsArguments *a = new (GC)EsArguments();
     
     a->prototype_ = es_proto_obj();
-    a->class_ = _USTR("Arguments");
+    a->class_ = CLASS_ARGUMENTS;
     a->extensible_ = true;
 
     a->param_map_ = EsObject::create_inst();
@@ -868,7 +945,10 @@ EsPropertyReference EsArguments::get_own_property(EsPropertyKey p)
         EsValue v;
         param_map_->get_resolveT(map_prop, v); // This should never throw, no need to catch anything.
 
-        prop->set_value(v);
+        if (prop.is_element())
+            prop.set_element_value(v);
+        else
+            prop->set_value(v);
     }
     
     return prop;
@@ -994,14 +1074,14 @@ EsArray::~EsArray()
 void EsArray::make_inst()
 {
     prototype_ = es_proto_arr();
-    class_ = _USTR("Array");
+    class_ = CLASS_ARRAY;
     extensible_ = true;
 }
 
 void EsArray::make_proto()
 {
     prototype_ = es_proto_obj();
-    class_ = _USTR("Array");
+    class_ = CLASS_ARRAY;
     extensible_ = true;
 
     // 15.4.4
@@ -1232,6 +1312,48 @@ bool EsArray::define_own_propertyT(EsPropertyKey p, const EsPropertyDescriptor &
     return EsObject::define_own_propertyT(p, desc, throws, defined);
 }
 
+bool EsArray::put_element(uint32_t index, const EsValue &v)
+{
+    if (indexed_properties_.is_generic())
+        return false;
+
+    // Existing elements in packed storage are writable data properties.
+    if (indexed_properties_.contains(index))
+    {
+        indexed_properties_.set_value(index, v);
+        return true;
+    }
+
+    // 15.4: 2^32 - 1 is not an array index.
+    if (index == 0xffffffff || !extensible_)
+        return false;
+
+    // New elements may be intercepted by the prototype chain.
+    if (prototype_ != es_proto_arr())
+        return false;
+
+    for (EsObject *proto = prototype_; proto; proto = proto->prototype())
+    {
+        if (proto->has_indexed_properties())
+            return false;
+    }
+
+    EsPropertyReference len_prop = map_.lookup(property_keys.length);
+    assert(len_prop);
+
+    uint32_t len = len_prop->value_or_undefined().primitive_to_uint32();
+    if (index >= len)
+    {
+        if (!len_prop->is_writable())
+            return false;
+
+        len_prop->set_value(EsValue::from_u32(index + 1));
+    }
+
+    indexed_properties_.set_value(index, v);
+    return true;
+}
+
 bool EsArray::update_own_propertyT(EsPropertyKey p, EsPropertyReference &current,
                                    const EsValue &v, bool throws)
 {
@@ -1322,14 +1444,14 @@ EsBooleanObject::~EsBooleanObject()
 void EsBooleanObject::make_inst()
 {
     prototype_ = es_proto_bool();
-    class_ = _USTR("Boolean");
+    class_ = CLASS_BOOLEAN;
     extensible_ = true;
 }
 
 void EsBooleanObject::make_proto()
 {
     prototype_ = es_proto_obj();    // VERIFIED: 15.6.4
-    class_ = _USTR("Boolean");      // VERIFIED: 15.6.4
+    class_ = CLASS_BOOLEAN;         // VERIFIED: 15.6.4
     extensible_ = true;
     primitive_value_ = false;       // VERIFIED: 15.6.4
     
@@ -1379,14 +1501,14 @@ EsDate::~EsDate()
 void EsDate::make_inst()
 {
     prototype_ = es_proto_date();   // VERIFIED: 15.9.3.3
-    class_ = _USTR("Date");         // VERIFIED: 15.9.3.3
+    class_ = CLASS_DATE;            // VERIFIED: 15.9.3.3
     extensible_ = true;             // VERIFIED: 15.9.3.3
 }
 
 void EsDate::make_proto()
 {
     prototype_ = es_proto_obj();    // VERIFIED: 15.9.5
-    class_ = _USTR("Date");         // VERIFIED: 15.9.5
+    class_ = CLASS_DATE;            // VERIFIED: 15.9.5
     extensible_ = true;
     primitive_value_ = 0;
 
@@ -1563,14 +1685,14 @@ EsNumberObject::~EsNumberObject()
 void EsNumberObject::make_inst()
 {
     prototype_ = es_proto_num();
-    class_ = _USTR("Number");
+    class_ = CLASS_NUMBER;
     extensible_ = true;
 }
 
 void EsNumberObject::make_proto()
 {
     prototype_ = es_proto_obj();    // VERIFIED: 15.7.4
-    class_ = _USTR("Number");       // VERIFIED: 15.7.4
+    class_ = CLASS_NUMBER;          // VERIFIED: 15.7.4
     extensible_ = true;
     primitive_value_ = 0.0;         // VERIFIED: 15.7.4
 
@@ -1628,14 +1750,14 @@ EsStringObject::~EsStringObject()
 void EsStringObject::make_inst()
 {
     prototype_ = es_proto_str();
-    class_ = _USTR("String");
+    class_ = CLASS_STRING;
     extensible_ = true;
 }
 
 void EsStringObject::make_proto()
 {
     prototype_ = es_proto_obj();
-    class_ = _USTR("String");
+    class_ = CLASS_STRING;
     extensible_ = true;
 
     // 15.5.4
@@ -1728,6 +1850,7 @@ EsFunction::EsFunction(EsLexicalEnvironment *scope,
     , scope_(scope)
     , needs_args_obj_(false)
     , needs_this_binding_(needs_this_binding)
+    , needs_env_(true)
 {
 }
 
@@ -1741,6 +1864,7 @@ EsFunction::EsFunction(EsLexicalEnvironment *scope,
     , scope_(scope)
     , needs_args_obj_(false)
     , needs_this_binding_(needs_this_binding)
+    , needs_env_(true)
 {
 }
 
@@ -1751,7 +1875,7 @@ EsFunction::~EsFunction()
 void EsFunction::make_inst(bool has_prototype)
 {
     prototype_ = es_proto_fun();
-    class_ = _USTR("Function");
+    class_ = CLASS_FUNCTION;
     extensible_ = true;
     
     // 13.2 Creating Function Objects
@@ -1787,7 +1911,7 @@ void EsFunction::make_inst(bool has_prototype)
 void EsFunction::make_proto()
 {
     prototype_ = es_proto_obj();
-    class_ = _USTR("Function");
+    class_ = CLASS_FUNCTION;
     extensible_ = true;
 
     // 15.3.3.1
@@ -1807,9 +1931,10 @@ EsFunction *EsFunction::create_raw(bool strict)
 
 EsFunction *EsFunction::create_inst(EsLexicalEnvironment *scope,
                                     NativeFunction fun, bool strict,
-                                    uint32_t len)
+                                    uint32_t len, bool needs_env)
 {
     EsFunction *f = new (GC)EsFunction(scope, fun, strict, len, true);
+    f->needs_env_ = needs_env;
     f->make_inst(true);
     
     return f;
@@ -1833,8 +1958,11 @@ EsFunction *EsFunction::default_constr()
 
 bool EsFunction::callT(EsCallFrame &frame, int flags)
 {
+    if (!g_call_stack.checkT())
+        return false;
+
     // FIXME: What about fast calls, where this step is not needed?
-    EsFunctionContext ctx(strict_, scope_);
+    EsFunctionContext ctx(strict_, scope_, needs_env_);
 
     // Invoke the function code.
     if (fun_)
@@ -1954,7 +2082,8 @@ EsBuiltinFunction *EsBuiltinFunction::create_inst(
 
 bool EsBuiltinFunction::callT(EsCallFrame &frame, int flags)
 {
-    EsFunctionContext ctx(strict_, scope_);
+    // Built-in functions never declare bindings in their environment.
+    EsFunctionContext ctx(strict_, scope_, false);
 
     // Invoke the function code.
     assert(fun_);
@@ -2000,30 +2129,41 @@ bool EsEvalFunction::callT(EsCallFrame &frame, int flags)
 
     if (prog_arg.is_string())
     {
-        try
-        {
-            StringStream str(prog_arg.as_string()->str());
-            Lexer lexer(str);
-            Parser parser(lexer, Parser::CODE_EVAL, direct_eval_call && EsContextStack::instance().top()->is_strict());
+        const EsString *prog_str = prog_arg.as_string();
+        bool strict = direct_eval_call && EsContextStack::instance().top()->is_strict();
 
-            prog = parser.parse();
-        }
-        catch (ParseException &e)
+        prog = EsProgramCache::instance().lookup(Parser::CODE_EVAL, strict, prog_str);
+        if (!prog)
         {
-            switch (e.kind())
+            try
             {
-                case ParseException::KIND_REFERENCE:
-                    ES_THROW(EsReferenceError,
-                            EsString::create_from_utf8(e.what().c_str()));
-                    return false;
+                StringStream str(prog_str->str());
+                Lexer lexer(str);
+                Parser parser(lexer, Parser::CODE_EVAL, strict);
 
-                case ParseException::KIND_SYNTAX:
-                    ES_THROW(EsSyntaxError,
-                            EsString::create_from_utf8(e.what().c_str()));
-                    return false;
+                prog = parser.parse();
+
+                Resolver().resolve(prog, false);
+
+                EsProgramCache::instance().insert(Parser::CODE_EVAL, strict, prog_str, NULL, prog);
             }
+            catch (ParseException &e)
+            {
+                switch (e.kind())
+                {
+                    case ParseException::KIND_REFERENCE:
+                        ES_THROW(EsReferenceError,
+                                EsString::create_from_utf8(e.what().c_str()));
+                        return false;
 
-            assert(false);
+                    case ParseException::KIND_SYNTAX:
+                        ES_THROW(EsSyntaxError,
+                                EsString::create_from_utf8(e.what().c_str()));
+                        return false;
+                }
+
+                assert(false);
+            }
         }
     }
 
@@ -2083,10 +2223,10 @@ EsFunctionBind *EsFunctionBind::create_inst(EsFunction *target, const EsValue &b
     EsFunctionBind *f = new (GC)EsFunctionBind(bound_this, target, args);
     
     f->prototype_ = es_proto_fun();
-    f->class_ = _USTR("Function");
+    f->class_ = CLASS_FUNCTION;
     f->extensible_ = true;
 
-    if (target->class_name() == _USTR("Function"))
+    if (target->class_id() == EsObject::CLASS_FUNCTION)
     {
         // FIXME: Use .length().
         EsValue target_len;
@@ -2170,7 +2310,8 @@ bool EsFunctionBind::has_instanceT(const EsValue &v, bool &result)
     return target_fun_->has_instanceT(v, result);
 }
 
-EsRegExp::MatchResult::MatchResult(const char *subject, int *ptr, int count)
+EsRegExp::MatchResult::MatchResult(const EsString *subject, const int *ptr,
+                                   int count)
     : end_index_(0)
 {
     for (int i = 0; i < count; i++)
@@ -2184,18 +2325,64 @@ EsRegExp::MatchResult::MatchResult(const char *subject, int *ptr, int count)
         }
         else
         {
-            const char *substr_start = subject + start;
             int substr_length = end - start;
 
             end_index_ = std::max(end_index_, end);
             matches_.push_back(MatchState(
-                    start, substr_length, EsString::create_from_utf8(
-                            substr_start, substr_length)));
+                    start, substr_length, subject->substr(start, substr_length)));
         }
     }
 }
 
+void EsRegExp::Subject::assign(const EsString *str)
+{
+    if (str == str_)
+        return;
+
+    str_ = str;
+    utf8_ = str->utf8();
+    offs_.clear();
+
+    // Only build the offset map if the encoding is not one-to-one.
+    if (utf8_.size() == str->length())
+        return;
+
+    offs_.reserve(str->length() + 1);
+    for (size_t i = 0; i < utf8_.size(); i++)
+    {
+        if ((utf8_[i] & 0xc0) != 0x80)
+            offs_.push_back(static_cast<int>(i));
+    }
+    offs_.push_back(static_cast<int>(utf8_.size()));
+}
+
+int EsRegExp::Subject::byte_offset(int index) const
+{
+    if (offs_.empty())
+        return index;
+
+    // Offsets beyond the end are passed through relative to the end.
+    int len = static_cast<int>(offs_.size()) - 1;
+    if (index >= len)
+        return size() + index - len;
+
+    return offs_[index];
+}
+
+int EsRegExp::Subject::char_offset(int off) const
+{
+    if (offs_.empty())
+        return off;
+
+    std::vector<int>::const_iterator it =
+            std::lower_bound(offs_.begin(), offs_.end(), off);
+    assert(it != offs_.end() && *it == off);
+    return static_cast<int>(it - offs_.begin());
+}
+
 EsFunction *EsRegExp::default_constr_ = NULL;
+EsRegExp::ProgramCache EsRegExp::programs_;
+EsRegExp::Subject EsRegExp::subject_;
 
 EsRegExp::EsRegExp(const EsString *pattern, bool global, bool ignore_case,
                    bool multiline)
@@ -2203,10 +2390,9 @@ EsRegExp::EsRegExp(const EsString *pattern, bool global, bool ignore_case,
     , global_(global)
     , ignore_case_(ignore_case)
     , multiline_(multiline)
-    , re_(NULL)
+    , prog_(NULL)
     , re_out_ptr_(NULL)
     , re_out_len_(0)
-    , re_capt_cnt_(0)
 {
 }
 
@@ -2216,11 +2402,7 @@ EsRegExp::~EsRegExp()
 
 bool EsRegExp::compile()
 {
-    assert(!re_);
-
-    // Compile expression.
-    const char *err = NULL;
-    int err_off = 0;
+    assert(!prog_);
 
     int flags = PCRE_JAVASCRIPT_COMPAT | PCRE_UTF8 | PCRE_NO_UTF8_CHECK;
     if (ignore_case_)
@@ -2233,46 +2415,72 @@ bool EsRegExp::compile()
     // without being tied to the way it's written in ECMA-262.
     flags |= PCRE_ANCHORED;
 
-    re_ = pcre_compile(pattern_->utf8().c_str(), flags, &err, &err_off, NULL);
-    if (re_ == NULL)
+    ProgramKey key(pattern_, flags);
+    ProgramCache::const_iterator it = programs_.find(key);
+    if (it != programs_.end())
     {
-        ES_THROW(EsSyntaxError, es_fmt_msg(
-                ES_MSG_SYNTAX_REGEXP_COMPILE, err_off, err));
-        return false;
+        prog_ = it->second;
     }
-
-    // Find out how many capturing sub-patterns there are.
-    re_capt_cnt_ = 0;
-    if (pcre_fullinfo(re_, NULL, PCRE_INFO_CAPTURECOUNT, &re_capt_cnt_) != 0)
+    else
     {
-        ES_THROW(EsSyntaxError, es_fmt_msg(
-                ES_MSG_SYNTAX_REGEXP_EXAMINE, pattern_->utf8().c_str()));
-        return false;
+        // Compile expression.
+        const char *err = NULL;
+        int err_off = 0;
+
+        pcre *re = pcre_compile(pattern_->utf8().c_str(), flags, &err, &err_off, NULL);
+        if (re == NULL)
+        {
+            ES_THROW(EsSyntaxError, es_fmt_msg(
+                    ES_MSG_SYNTAX_REGEXP_COMPILE, err_off, err));
+            return false;
+        }
+
+        // Study the expression, failing to do so is not an error since it's
+        // only an optimization.
+#ifdef PCRE_STUDY_JIT_COMPILE
+        pcre_extra *extra = pcre_study(re, PCRE_STUDY_JIT_COMPILE, &err);
+#else
+        pcre_extra *extra = pcre_study(re, 0, &err);
+#endif
+
+        // Find out how many capturing sub-patterns there are.
+        int capt_cnt = 0;
+        if (pcre_fullinfo(re, extra, PCRE_INFO_CAPTURECOUNT, &capt_cnt) != 0)
+        {
+            ES_THROW(EsSyntaxError, es_fmt_msg(
+                    ES_MSG_SYNTAX_REGEXP_EXAMINE, pattern_->utf8().c_str()));
+            return false;
+        }
+
+        Program *prog = new (GC)Program();
+        prog->re_ = re;
+        prog->extra_ = extra;
+        prog->capt_cnt_ = capt_cnt;
+        prog_ = prog;
+
+        if (programs_.size() < PROGRAM_CACHE_MAX)
+            programs_.insert(std::make_pair(key, prog_));
     }
 
-    re_out_len_ = (re_capt_cnt_ + 1) * 3;
+    re_out_len_ = (prog_->capt_cnt_ + 1) * 3;
     re_out_ptr_ = static_cast<int *>(GC_MALLOC_ATOMIC(re_out_len_ * sizeof(int)));
     if (!re_out_ptr_)
         THROW(MemoryException);
 
-    // PCRE seems to not always initialize the output buffer.
-    for (int i = 0; i < re_out_len_; i++)
-        re_out_ptr_[i] = -1;
-
     return true;
 }
 
 void EsRegExp::make_inst()
 {
     prototype_ = es_proto_reg_exp();
-    class_ = _USTR("RegExp");       // VERIFIED: 15.10.7
+    class_ = CLASS_REGEXP;          // VERIFIED: 15.10.7
     extensible_ = true;
 }
 
 void EsRegExp::make_proto()
 {
     prototype_ = es_proto_obj();    // VERIFIED: 15.10.6
-    class_ = _USTR("RegExp");       // VERIFIED: 15.10.6
+    class_ = CLASS_REGEXP;          // VERIFIED: 15.10.6
     extensible_ = true;
 
     // NOTE: The RegExp prototype is a RegExp instance in contrast to most
@@ -2392,15 +2600,19 @@ const EsString *EsRegExp::flags() const
 
 EsRegExp::MatchResult *EsRegExp::match(const EsString *subject, int offset)
 {
-    assert(re_);
-    if (re_ == NULL)
+    assert(prog_);
+    if (prog_ == NULL)
         return NULL;
 
-    std::string utf8_subject = subject->utf8();
-    size_t utf8_offset = utf8_off(reinterpret_cast<const byte *>(utf8_subject.c_str()),
-                                  utf8_subject.size(), offset);
+    subject_.assign(subject);
+
+    // PCRE does not always initialize the output buffer.
+    for (int i = 0; i < re_out_len_; i++)
+        re_out_ptr_[i] = -1;
 
-    int rc = pcre_exec(re_, NULL, utf8_subject.c_str(), utf8_subject.size(), utf8_offset, PCRE_NO_UTF8_CHECK, re_out_ptr_, re_out_len_);
+    int rc = pcre_exec(prog_->re_, prog_->extra_, subject_.data(),
+                       subject_.size(), subject_.byte_offset(offset),
+                       PCRE_NO_UTF8_CHECK, re_out_ptr_, re_out_len_);
     assert(rc != 0);    // re_out_ptr_ should be big enough.
 
     if (rc == PCRE_ERROR_NOMATCH)
@@ -2412,7 +2624,15 @@ EsRegExp::MatchResult *EsRegExp::match(const EsString *subject, int offset)
         return NULL;
     }
 
-    return new (GC)MatchResult(utf8_subject.c_str(), re_out_ptr_, re_capt_cnt_ + 1);
+    // Translate byte offsets into character offsets.
+    int count = prog_->capt_cnt_ + 1;
+    for (int i = 0; i < count * 2; i++)
+    {
+        if (re_out_ptr_[i] != -1)
+            re_out_ptr_[i] = subject_.char_offset(re_out_ptr_[i]);
+    }
+
+    return new (GC)MatchResult(subject, re_out_ptr_, count);
 }
 
 EsFunction *EsRegExp::default_constr()
@@ -2434,7 +2654,7 @@ EsFunction *EsArrayConstructor::create_inst()
     EsArrayConstructor *f = new (GC)EsArrayConstructor(es_global_env(), es_std_arr, false);
     
     f->prototype_ = es_proto_fun();    // VERIFIED: 15.4.3
-    f->class_ = _USTR("Function");
+    f->class_ = CLASS_FUNCTION;
     f->extensible_ = true;
     
     // 15.4.3
@@ -2512,7 +2732,7 @@ EsFunction *EsBooleanConstructor::create_inst()
     EsBooleanConstructor *f = new (GC)EsBooleanConstructor(es_global_env(), es_std_bool, false);
     
     f->prototype_ = es_proto_fun();    // VERIFIED: 15.6.3
-    f->class_ = _USTR("Boolean");
+    f->class_ = CLASS_BOOLEAN;
     f->extensible_ = true;
     
     // 15.6.3
@@ -2545,7 +2765,7 @@ EsFunction *EsDateConstructor::create_inst()
     EsDateConstructor *f = new (GC)EsDateConstructor(es_global_env(), es_std_date, false);
     
     f->prototype_ = es_proto_fun();     // VERIFIED: 15.9.4
-    f->class_ = _USTR("Date");
+    f->class_ = CLASS_DATE;
     f->extensible_ = true;
     
     // 15.9.4
@@ -2613,7 +2833,7 @@ EsFunction *EsNumberConstructor::create_inst()
     EsNumberConstructor *f = new (GC)EsNumberConstructor(es_global_env(), es_std_num, false);
     
     f->prototype_ = es_proto_fun();     // VERIFIED: 15.3.4
-    f->class_ = _USTR("Number");
+    f->class_ = CLASS_NUMBER;
     f->extensible_ = true;
     
     // 15.7.3
@@ -2660,7 +2880,7 @@ EsFunction *EsFunctionConstructor::create_inst()
     EsFunctionConstructor *f = new (GC)EsFunctionConstructor(es_global_env(), es_std_fun, false);
     
     f->prototype_ = es_proto_fun();
-    f->class_ = _USTR("Function");
+    f->class_ = CLASS_FUNCTION;
     f->extensible_ = true;
     
     // 15.3.3
@@ -2706,8 +2926,18 @@ bool EsFunctionConstructor::constructT(EsCallFrame &frame)
     if (!body_str)
         return false;
 
+    const EsString *params_str = argc > 1 ? p.string() : NULL;
+
+    FunctionLiteral *prog = EsProgramCache::instance().lookup(
+        Parser::CODE_FUNCTION, false, body_str, params_str);
+    if (prog)
+    {
+        frame.set_result(EsValue::from_obj(EsFunction::create_inst(
+            EsContextStack::instance().top()->var_env(), prog)));
+        return true;
+    }
+
     // Parse the body.
-    FunctionLiteral *prog = NULL;
     try
     {
         StringStream str(body_str->str());
@@ -2727,7 +2957,7 @@ bool EsFunctionConstructor::constructT(EsCallFrame &frame)
     {
         // The way we parse the formal parameter list is by putting it into a
         // function declaration and then parse it using the standard parser.
-        StringStream str(p.string()->str());
+        StringStream str(params_str->str());
         Lexer lexer(str);
         Parser parser(lexer, Parser::CODE_PROGRAM, prog->is_strict_mode());
 
@@ -2760,6 +2990,11 @@ bool EsFunctionConstructor::constructT(EsCallFrame &frame)
         }
     }
 
+    Resolver().resolve(prog, true);
+
+    EsProgramCache::instance().insert(Parser::CODE_FUNCTION, false,
+                                      body_str, params_str, prog);
+
     frame.set_result(EsValue::from_obj(EsFunction::create_inst(
         EsContextStack::instance().top()->var_env(), prog)));
     return true;
@@ -2776,7 +3011,7 @@ EsFunction *EsObjectConstructor::create_inst()
     EsObjectConstructor *f = new (GC)EsObjectConstructor(es_global_env(), es_std_obj, false);
     
     f->prototype_ = es_proto_fun();
-    f->class_ = _USTR("Object");
+    f->class_ = CLASS_OBJECT;
     f->extensible_ = true;
     
     // 15.2.3
@@ -2877,7 +3112,7 @@ EsFunction *EsStringConstructor::create_inst()
     EsStringConstructor *f = new (GC)EsStringConstructor(es_global_env(), es_std_str, false);
     
     f->prototype_ = es_proto_fun();     // VERIFIED: 15.5.3
-    f->class_ = _USTR("String");
+    f->class_ = CLASS_STRING;
     f->extensible_ = true;
     
     f->define_new_own_property(property_keys.prototype,
@@ -2918,7 +3153,7 @@ EsFunction *EsRegExpConstructor::create_inst()
     EsRegExpConstructor *f = new (GC)EsRegExpConstructor(es_global_env(), es_std_reg_exp, false);
     
     f->prototype_ = es_proto_fun();     // VERIFIED: 15.10.5.1
-    f->class_ = _USTR("RegExp");
+    f->class_ = CLASS_REGEXP;
     f->extensible_ = true;
     
     f->define_new_own_property(property_keys.prototype,
@@ -2943,7 +3178,7 @@ bool EsRegExpConstructor::constructT(EsCallFrame &frame)
     if (pattern_arg.is_object())
     {
         EsObject *o = pattern_arg.as_object();
-        if (o->class_name() == _USTR("RegExp"))
+        if (o->class_id() == EsObject::CLASS_REGEXP)
         {
             if (flags_arg.is_undefined())
             {
@@ -19,6 +19,8 @@
 #pragma once
 #include <cassert>
 #include <map>
+#include <string>
+#include <unordered_map>
 #include <vector>
 #include <gc/gc_allocator.h>    // NOTE: 3rd party.
 #define PCRE_STATIC
@@ -88,6 +90,26 @@ public:
     friend class EsFunction;
 
 public:
+    /**
+     * @brief Object class identifiers.
+     * @see ECMA-262: [[Class]].
+     */
+    enum Class : uint8_t
+    {
+        CLASS_ARGUMENTS,
+        CLASS_ARRAY,
+        CLASS_BOOLEAN,
+        CLASS_DATE,
+        CLASS_ERROR,
+        CLASS_FUNCTION,
+        CLASS_JSON,
+        CLASS_MATH,
+        CLASS_NUMBER,
+        CLASS_OBJECT,
+        CLASS_REGEXP,
+        CLASS_STRING
+    };
+
     /**
      * @brief Object property iterator.
      */
@@ -180,7 +202,7 @@ private:
 
 protected:
     EsObject *prototype_;   ///< [[Prototype]]
-    String class_;          ///< [[Class]]
+    Class class_;           ///< [[Class]]
     bool extensible_;       ///< [[Extensible]]
     
     EsMap map_;
@@ -205,9 +227,18 @@ public:
 
     static EsObject *create_raw();
     static EsObject *create_inst();
-    static EsObject *create_inst_with_class(const String &class_name);
+    static EsObject *create_inst_with_class(Class class_id);
     static EsObject *create_inst_with_prototype(EsObject *prototype);
 
+    /**
+     * Creates a new object with all properties of a shape, used for creating
+     * object literals.
+     * @param [in] shape Shape describing the properties of the object.
+     * @param [in] vals Property values in slot order.
+     * @see EsMap::assign
+     */
+    static EsObject *create_inst_from_shape(EsShape *shape, const EsValue vals[]);
+
     /**
      * @return Default object constructor.
      */
@@ -279,11 +310,17 @@ public:
      */
     EsObject *prototype() { return prototype_; }
 
+    /**
+     * @return Object class identifier.
+     * @see ECMA-262: [[Class]].
+     */
+    Class class_id() const { return class_; }
+
     /**
      * @return Object class name.
      * @see ECMA-262: [[Class]].
      */
-    const String &class_name() const { return class_; }
+    const String &class_name() const;
 
     /**
      * @return true if the object is extensible and false otherwise.
@@ -296,6 +333,11 @@ public:
      * @see ECMA-262: [[Extensible]].
      */
     void set_extensible(bool extensible) { extensible_ = extensible; }
+
+    /**
+     * @return true if the object has any own properties with index keys.
+     */
+    bool has_indexed_properties() const { return !indexed_properties_.empty(); }
     
     /**
      * Retrieves a property hosted in this object matching the specified
@@ -586,6 +628,31 @@ public:
      */
     virtual bool update_own_propertyT(EsPropertyKey p, EsPropertyReference &current,
                                       const EsValue &v, bool throws) override;
+
+    /**
+     * Reads an element directly from packed or holey element storage.
+     * @param [in] index Element index.
+     * @param [out] v Element value.
+     * @return true if the element was read, false if the element must be
+     *         read using [[Get]].
+     */
+    inline bool get_element(uint32_t index, EsValue &v) const
+    {
+        return !indexed_properties_.is_generic() &&
+               indexed_properties_.get_value(index, v);
+    }
+
+    /**
+     * Writes an element directly to packed or holey element storage,
+     * updating the array length if necessary. This is only possible if
+     * writing the element can't have any side effects besides updating the
+     * length.
+     * @param [in] index Element index.
+     * @param [in] v Element value.
+     * @return true if the element was written, false if the element must be
+     *         written using [[Put]].
+     */
+    bool put_element(uint32_t index, const EsValue &v);
 };
 
 /**
@@ -827,6 +894,11 @@ protected:
      * as well as any code evaluated by eval. */
     bool needs_this_binding_;
 
+    /** true if calling this function requires creating a new declarative
+     * environment. Functions that never access their environment by name
+     * execute directly in their [[Scope]]. */
+    bool needs_env_;
+
 protected:
     EsFunction(EsLexicalEnvironment *scope, NativeFunction func,
                bool strict, uint32_t len, bool needs_this_binding);
@@ -853,7 +925,7 @@ public:
     static EsFunction *create_raw(bool strict = false);
     static EsFunction *create_inst(EsLexicalEnvironment *scope,
                                    NativeFunction func, bool strict,
-                                   uint32_t len);
+                                   uint32_t len, bool needs_env = true);
     static EsFunction *create_inst(EsLexicalEnvironment *scope,
                                    FunctionLiteral *code);
 
@@ -1012,7 +1084,14 @@ public:
         MatchStateVector matches_;  ///< Matched substrings.
 
     public:
-        MatchResult(const char *subject, int *out_ptr, int out_len);
+        /**
+         * Creates a new match result.
+         * @param [in] subject Matched subject string.
+         * @param [in] ptr Pairs of start and end character offsets for each
+         *                 captured substring, -1 if not captured.
+         * @param [in] count Number of offset pairs in @a ptr.
+         */
+        MatchResult(const EsString *subject, const int *ptr, int count);
 
         int end_index() const { return end_index_; }
 
@@ -1031,20 +1110,124 @@ public:
     };
 
 private:
+    /**
+     * @brief Compiled regular expression.
+     *
+     * Programs are immutable once compiled and are shared among all RegExp
+     * objects with the same pattern and flags.
+     */
+    struct Program
+    {
+        pcre *re_;              ///< Compiled expression.
+        pcre_extra *extra_;     ///< Study data, NULL if not available.
+        int capt_cnt_;          ///< Number of subexpressions to capture.
+    };
+
+    /**
+     * @brief Key identifying a compiled program in the program cache.
+     */
+    struct ProgramKey
+    {
+        const EsString *pattern_;
+        int flags_;             ///< PCRE compile flags.
+
+        ProgramKey(const EsString *pattern, int flags)
+            : pattern_(pattern), flags_(flags) {}
+
+        struct Hash
+        {
+            inline size_t operator()(const ProgramKey &key) const
+            {
+                return key.pattern_->hash() ^ static_cast<size_t>(key.flags_);
+            }
+        };
+
+        struct EqualTo
+        {
+            inline bool operator()(const ProgramKey &x, const ProgramKey &y) const
+            {
+                return x.flags_ == y.flags_ && x.pattern_->equals(y.pattern_);
+            }
+        };
+    };
+
+    typedef std::unordered_map<ProgramKey, const Program *,
+                               ProgramKey::Hash, ProgramKey::EqualTo,
+                               gc_allocator<std::pair<const ProgramKey,
+                                                      const Program *> > > ProgramCache;
+
+    /**
+     * Maximum number of programs kept in the program cache. Programs compiled
+     * after the cache is full are not shared.
+     */
+    static const size_t PROGRAM_CACHE_MAX = 256;
+
+    /**
+     * @brief UTF-8 transcoding of a subject string.
+     *
+     * PCRE operates on UTF-8 data while strings are stored as Unicode code
+     * points. The transcoding of the most recently matched subject is cached
+     * so that repeated matching over the same subject, as done by global
+     * replace and split, does not transcode the subject over and over again.
+     */
+    class Subject
+    {
+    private:
+        const EsString *str_;   ///< Transcoded string, NULL if none.
+        std::string utf8_;      ///< UTF-8 encoded string data.
+        std::vector<int> offs_; ///< Byte offset of each character followed by the total size, empty if all characters are ASCII.
+
+    public:
+        Subject()
+            : str_(NULL) {}
+
+        /**
+         * Transcodes a new subject string unless it's already transcoded.
+         * @param [in] str Subject string.
+         */
+        void assign(const EsString *str);
+
+        /**
+         * @return UTF-8 encoded subject data.
+         */
+        const char *data() const { return utf8_.c_str(); }
+
+        /**
+         * @return Size of UTF-8 encoded subject data in bytes.
+         */
+        int size() const { return static_cast<int>(utf8_.size()); }
+
+        /**
+         * Converts a character offset into a byte offset.
+         * @param [in] index Character offset.
+         * @return Byte offset in UTF-8 data.
+         */
+        int byte_offset(int index) const;
+
+        /**
+         * Converts a byte offset into a character offset.
+         * @param [in] off Byte offset in UTF-8 data.
+         * @return Character offset.
+         */
+        int char_offset(int off) const;
+    };
+
     static EsFunction *default_constr_;     // Points to the default constructor, initialized lazily.
+    static ProgramCache programs_;          ///< Compiled programs shared among objects.
+    static Subject subject_;                ///< Most recently matched subject.
 
     const EsString *pattern_;
     bool global_;
     bool ignore_case_;
     bool multiline_;
 
-    pcre *re_;          ///< Compiled expression, NULL if not compiled.
-    int *re_out_ptr_;   ///< Output vector for pcre_exec function, must be a multiple of three in size.
-    int re_out_len_;    ///< Length of re_out_ptr_.
-    int re_capt_cnt_;   ///< Number of subexpressions to capture.
+    const Program *prog_;   ///< Compiled expression, NULL if not compiled.
+    int *re_out_ptr_;       ///< Output vector for pcre_exec function, must be a multiple of three in size.
+    int re_out_len_;        ///< Length of re_out_ptr_.
 
     /**
-     * Compiles the regular expression.
+     * Compiles the regular expression, or fetches it from the program cache
+     * if an equal expression has been compiled before.
      * @return true on normal return, false if an exception was thrown.
      */
     bool compile();
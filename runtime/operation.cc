@@ -18,6 +18,7 @@
 
 #include <cassert>
 #include <cstdarg>
+#include <limits>
 #include <sstream>
 #include <string.h>
 #include <gc_cpp.h>
@@ -37,6 +38,7 @@
 #include "native.hh"
 #include "operation.h"
 #include "property.hh"
+#include "shape.hh"
 #include "standard.hh"
 #include "utility.hh"
 #include "value.hh"
@@ -68,7 +70,7 @@ public:
             EsPropertyKey key = *it_cur_;
 
             EsPropertyReference prop = obj_->get_property(key);
-            if (!prop || !prop->is_enumerable())    // The property might have been deleted.
+            if (!prop || (!prop.is_element() && !prop->is_enumerable()))  // The property might have been deleted.
                 continue;
 
             it_cur_++;
@@ -227,186 +229,166 @@ EsValueData *esa_bnd_extra_ptr(uint32_t argc, EsValueData *fp_data,
         env->env_rec())->storage();
 }
 
-#ifdef FEATURE_CONTEXT_CACHE
-struct ContextLookupCacheEntry
-{
-    EsMap::Id id;
-    EsPropertyKey key;
-    EsPropertyReference prop;
-
-    ContextLookupCacheEntry()
-        : id()
-    {
-    }
-};
-
-ContextLookupCacheEntry context_cache[FEATURE_CONTEXT_CACHE_SIZE];
-#endif  // FEATURE_CONTEXT_CACHE
-
-bool ctx_cached_getT(EsObject *obj, EsPropertyKey key,
-                     EsPropertyReference &prop, uint16_t cid)
+/**
+ * Finds the environment record described by a context cache.
+ * @param [in] cache Site cache, may be NULL.
+ * @param [in] lex Lexical environment to start the lookup from.
+ * @return Environment record holding the cached binding, or NULL if the
+ *         cache does not describe the environment chain.
+ */
+static EsEnvironmentRecord *ctx_cache_lookup(EsContextCache *cache,
+                                             EsLexicalEnvironment *lex)
 {
 #ifdef FEATURE_CONTEXT_CACHE
-    assert(cid < FEATURE_CONTEXT_CACHE_SIZE);
-
 #ifdef PROFILE
     profiler::stats.ctx_access_cnt_++;
 #endif  // PROFILE
 
-    ContextLookupCacheEntry &cache_entry = context_cache[cid];
-
-    // We only allow caching of the global object because this implementation
-    // is not capable of caching an object hierarchy which might be the case
-    // with "with" objects.
-    if (obj == es_global_obj())
+    if (cache && cache->state != ESA_CTX_CACHE_EMPTY &&
+        cache->epoch == EsDeclarativeEnvironmentRecord::removable_epoch())
     {
-        if (cache_entry.id == obj->map().id() &&
-            cache_entry.key == key)
+        // All skipped environments were declarative when the cache was
+        // filled. Unless the removable binding epoch has changed, none of them
+        // can have obtained a binding that shadows the cached one.
+        for (uint16_t i = 0; i < cache->depth && lex; i++)
         {
-#ifdef PROFILE
-            profiler::stats.ctx_cache_hits_++;
-#endif  // PROFILE
+            if (!lex->env_rec()->is_decl_env())
+            {
+                lex = NULL;
+                break;
+            }
 
-            prop = obj->map().from_cached(cache_entry.prop);
-            return true;
+            lex = lex->outer();
         }
-    }
-
-#ifdef PROFILE
-    profiler::stats.ctx_cache_misses_++;
-#endif  // PROFILE
-#endif  // FEATURE_CONTEXT_CACHE
-
-    if (!obj->getT(key, prop))
-        return false;
-
-#ifdef FEATURE_CONTEXT_CACHE
-    if (!prop || !prop.is_cachable())
-    {
-        cache_entry.id = EsMap::Id();
-        return true;
-    }
-
-    cache_entry.id = obj->map().id();
-    cache_entry.key = key;
-    cache_entry.prop = prop;
-#endif  // FEATURE_CONTEXT_CACHE
-
-    return true;
-}
 
-EsPropertyReference ctx_cached_get_property(EsObject *obj,
-                                            EsPropertyKey key,
-                                            uint16_t cid)
-{
-#ifdef FEATURE_CONTEXT_CACHE
-    assert(cid < FEATURE_CONTEXT_CACHE_SIZE);
-
-#ifdef PROFILE
-    profiler::stats.ctx_access_cnt_++;
-#endif  // PROFILE
-
-    ContextLookupCacheEntry &cache_entry = context_cache[cid];
+        EsEnvironmentRecord *env_rec = lex ? lex->env_rec() : NULL;
+        if (env_rec && cache->state == ESA_CTX_CACHE_OBJ &&
+            env_rec->is_obj_env())
+        {
+            EsObjectEnvironmentRecord *env =
+                static_cast<EsObjectEnvironmentRecord *>(env_rec);
+            if (env->binding_object()->map().id() != cache->id)
+                env_rec = NULL;
+        }
+        else if (env_rec && !(cache->state == ESA_CTX_CACHE_DECL &&
+                              env_rec->is_decl_env()))
+        {
+            env_rec = NULL;
+        }
 
-    // We only allow caching of the global object because this implementation
-    // is not capable of caching an object hierarchy which might be the case
-    // with "with" objects.
-    if (obj == es_global_obj())
-    {
-        if (cache_entry.id == obj->map().id() &&
-            cache_entry.key == key)
+        if (env_rec)
         {
 #ifdef PROFILE
             profiler::stats.ctx_cache_hits_++;
+            cache->hits++;
 #endif  // PROFILE
 
-            return obj->map().from_cached(cache_entry.prop);
+            return env_rec;
         }
     }
 
 #ifdef PROFILE
     profiler::stats.ctx_cache_misses_++;
-#endif  // PROFILE
-#endif  // FEATURE_CONTEXT_CACHE
-
-    EsPropertyReference prop = obj->get_property(key);
-
-#ifdef FEATURE_CONTEXT_CACHE
-    if (!prop || !prop.is_cachable())
+    if (cache)
     {
-        cache_entry.id = EsMap::Id();
-        return prop;
+        cache->misses++;
+        if (!cache->profiled)
+        {
+            cache->profiled = 1;
+            profiler::register_ctx_cache(cache);
+        }
     }
-
-    cache_entry.id = obj->map().id();
-    cache_entry.key = key;
-    cache_entry.prop = prop;
+#endif  // PROFILE
 #endif  // FEATURE_CONTEXT_CACHE
 
-    return prop;
+    return NULL;
 }
 
-EsPropertyReference ctx_cached_get_own_property(EsObject *obj,
-                                                EsPropertyKey key,
-                                                uint16_t cid)
+/**
+ * Updates a context cache after a cache miss.
+ * @param [in] cache Site cache, may be NULL.
+ * @param [in] raw_key Raw identifier key.
+ * @param [in] depth Number of declarative environments that were skipped.
+ * @param [in] env_rec Environment record the identifier was resolved in.
+ * @param [in] prop Property found in the binding object if @p env_rec is an
+ *                  object environment record.
+ */
+static void ctx_cache_update(EsContextCache *cache, uint64_t raw_key,
+                             size_t depth, EsEnvironmentRecord *env_rec,
+                             const EsPropertyReference &prop)
 {
 #ifdef FEATURE_CONTEXT_CACHE
-    assert(cid < FEATURE_CONTEXT_CACHE_SIZE);
+    if (!cache)
+        return;
 
-#ifdef PROFILE
-    profiler::stats.ctx_access_cnt_++;
-#endif  // PROFILE
+    cache->state = ESA_CTX_CACHE_EMPTY;
+    if (depth > std::numeric_limits<uint16_t>::max())
+        return;
 
-    ContextLookupCacheEntry &cache_entry = context_cache[cid];
+    if (env_rec->is_obj_env())
+    {
+        EsObject *obj = static_cast<EsObjectEnvironmentRecord *>(
+            env_rec)->binding_object();
 
-    // We only allow caching of the global object because this implementation
-    // is not capable of caching an object hierarchy which might be the case
-    // with "with" objects.
-    if (obj == es_global_obj())
+        // Properties inherited by the binding object cannot be described by
+        // the map of the binding object alone.
+        if (!prop || !prop.is_cachable() || prop.base() != obj)
+            return;
+
+        cache->id = obj->map().id();
+        cache->slot = static_cast<uint32_t>(prop.slot());
+        cache->state = ESA_CTX_CACHE_OBJ;
+    }
+    else
     {
-        if (cache_entry.id == obj->map().id() &&
-            cache_entry.key == key)
+        // Removable bindings are created by eval code and are therefore not
+        // guaranteed to exist in the next activation of the same scope.
+        if (static_cast<EsDeclarativeEnvironmentRecord *>(
+                env_rec)->has_removable_binding(EsPropertyKey::from_raw(raw_key)))
         {
-#ifdef PROFILE
-            profiler::stats.ctx_cache_hits_++;
-#endif  // PROFILE
-
-            return obj->map().from_cached(cache_entry.prop);
+            return;
         }
-    }
-
-#ifdef PROFILE
-    profiler::stats.ctx_cache_misses_++;
-#endif  // PROFILE
-#endif  // FEATURE_CONTEXT_CACHE
-
-    EsPropertyReference prop = obj->get_own_property(key);
 
-#ifdef FEATURE_CONTEXT_CACHE
-    if (!prop || !prop.is_cachable())
-    {
-        cache_entry.id = EsMap::Id();
-        return prop;
+        cache->state = ESA_CTX_CACHE_DECL;
     }
 
-    cache_entry.id = obj->map().id();
-    cache_entry.key = key;
-    cache_entry.prop = prop;
+    cache->key = raw_key;
+    cache->epoch = EsDeclarativeEnvironmentRecord::removable_epoch();
+    cache->depth = static_cast<uint16_t>(depth);
 #endif  // FEATURE_CONTEXT_CACHE
-
-    return prop;
 }
 
-bool esa_ctx_get(EsContext *ctx, uint64_t raw_key, EsValueData *result_data,
-                 uint16_t cid)
+/**
+ * Resolves an identifier and gets its value, utilizing a context cache.
+ * @param [in] ctx Current context.
+ * @param [in] key Identifier key.
+ * @param [in] cache Site cache, may be NULL.
+ * @param [out] result Value of identifier.
+ * @param [out] env_rec Environment record the identifier was resolved in.
+ * @return true on normal return, false if an exception was thrown.
+ */
+static bool ctx_getT(EsContext *ctx, EsPropertyKey key, EsContextCache *cache,
+                     EsValue &result, EsEnvironmentRecord *&env_rec)
 {
-    EsValue &result = reinterpret_cast<EsValue &>(*result_data);
+    env_rec = ctx_cache_lookup(cache, ctx->lex_env());
+    if (env_rec)
+    {
+        if (env_rec->is_obj_env())
+        {
+            EsObject *obj = static_cast<EsObjectEnvironmentRecord *>(
+                env_rec)->binding_object();
+            return obj->get_resolveT(obj->map().from_slot(cache->slot), result);
+        }
 
-    EsPropertyKey key = EsPropertyKey::from_raw(raw_key);
+        return static_cast<EsDeclarativeEnvironmentRecord *>(
+            env_rec)->get_binding_valueT(key, ctx->is_strict(), result);
+    }
 
-    for (auto lex = ctx->lex_env(); lex; lex = lex->outer())
+    size_t depth = 0;
+    bool cachable = true;   // Only declarative environments skipped so far.
+    for (auto lex = ctx->lex_env(); lex; lex = lex->outer(), depth++)
     {
-        EsEnvironmentRecord *env_rec = lex->env_rec();
+        env_rec = lex->env_rec();
         if (env_rec->is_obj_env())
         {
             EsObjectEnvironmentRecord *env =
@@ -415,7 +397,7 @@ bool esa_ctx_get(EsContext *ctx, uint64_t raw_key, EsValueData *result_data,
             EsObject *obj = env->binding_object();
 
             EsPropertyReference prop;
-            if (!ctx_cached_getT(obj, key, prop, cid))
+            if (!obj->getT(key, prop))
             {
                 assert(false);
                 esa_ex_clear(ctx);
@@ -423,7 +405,13 @@ bool esa_ctx_get(EsContext *ctx, uint64_t raw_key, EsValueData *result_data,
             }
 
             if (!prop)
+            {
+                cachable = false;
                 continue;
+            }
+
+            if (cachable)
+                ctx_cache_update(cache, key.as_raw(), depth, env_rec, prop);
 
             return obj->get_resolveT(prop, result);
         }
@@ -434,7 +422,15 @@ bool esa_ctx_get(EsContext *ctx, uint64_t raw_key, EsValueData *result_data,
 
             // FIXME: These two calls should be combined somehow.
             if (env->has_binding(key))
+            {
+                if (cachable)
+                {
+                    ctx_cache_update(cache, key.as_raw(), depth, env_rec,
+                                     EsPropertyReference());
+                }
+
                 return env->get_binding_valueT(key, ctx->is_strict(), result);
+            }
         }
     }
 
@@ -444,14 +440,41 @@ bool esa_ctx_get(EsContext *ctx, uint64_t raw_key, EsValueData *result_data,
     return false;
 }
 
+bool esa_ctx_get(EsContext *ctx, uint64_t raw_key, EsValueData *result_data,
+                 EsContextCache *cache)
+{
+    EsValue &result = reinterpret_cast<EsValue &>(*result_data);
+
+    EsEnvironmentRecord *env_rec = NULL;
+    return ctx_getT(ctx, EsPropertyKey::from_raw(raw_key), cache, result,
+                    env_rec);
+}
+
 bool esa_ctx_put(EsContext *ctx, uint64_t raw_key, EsValueData val_data,
-                 uint16_t cid)
+                 EsContextCache *cache)
 {
     EsPropertyKey key = EsPropertyKey::from_raw(raw_key);
 
-    for (auto lex = ctx->lex_env(); lex; lex = lex->outer())
+    EsEnvironmentRecord *env_rec = ctx_cache_lookup(cache, ctx->lex_env());
+    if (env_rec)
     {
-        EsEnvironmentRecord *env_rec = lex->env_rec();
+        if (env_rec->is_obj_env())
+        {
+            EsObject *obj = static_cast<EsObjectEnvironmentRecord *>(
+                env_rec)->binding_object();
+            EsPropertyReference prop = obj->map().from_slot(cache->slot);
+            return obj->put_ownT(key, prop, val_data, ctx->is_strict());
+        }
+
+        return static_cast<EsDeclarativeEnvironmentRecord *>(
+            env_rec)->set_mutable_bindingT(key, val_data, ctx->is_strict());
+    }
+
+    size_t depth = 0;
+    bool cachable = true;   // Only declarative environments skipped so far.
+    for (auto lex = ctx->lex_env(); lex; lex = lex->outer(), depth++)
+    {
+        env_rec = lex->env_rec();
         if (env_rec->is_obj_env())
         {
             EsObjectEnvironmentRecord *env =
@@ -459,13 +482,19 @@ bool esa_ctx_put(EsContext *ctx, uint64_t raw_key, EsValueData val_data,
 
             EsObject *obj = env->binding_object();
 
-            EsPropertyReference prop = ctx_cached_get_own_property(
-                    obj, key, cid);
+            EsPropertyReference prop = obj->get_own_property(key);
             if (prop)
+            {
+                if (cachable)
+                    ctx_cache_update(cache, raw_key, depth, env_rec, prop);
+
                 return obj->put_ownT(key, prop, val_data, ctx->is_strict());
+            }
 
             if (obj->has_property(key))
                 return obj->putT(key, val_data, ctx->is_strict());
+
+            cachable = false;
         }
         else
         {
@@ -473,8 +502,16 @@ bool esa_ctx_put(EsContext *ctx, uint64_t raw_key, EsValueData val_data,
                 safe_cast<EsDeclarativeEnvironmentRecord *>(env_rec);
 
             if (env->has_binding(key))
+            {
+                if (cachable)
+                {
+                    ctx_cache_update(cache, raw_key, depth, env_rec,
+                                     EsPropertyReference());
+                }
+
                 return env->set_mutable_bindingT(key, val_data,
                         ctx->is_strict());
+            }
         }
     }
 
@@ -795,14 +832,6 @@ bool esa_prp_def_data(EsValueData obj_data, EsValueData key_data,
     if (!name)
         return false;
 
-    uint32_t index = 0;
-    if (es_str_to_index(name->str(), index))
-    {
-        return obj.as_object()->define_own_propertyT(
-                EsPropertyKey::from_u32(index),
-                EsPropertyDescriptor(true, true, true, val), false);
-    }
-
     return obj.as_object()->define_own_propertyT(
             EsPropertyKey::from_str(name),
             EsPropertyDescriptor(true, true, true, val), false);
@@ -826,172 +855,282 @@ bool esa_prp_def_accessor(EsValueData obj_data, uint64_t raw_key,
 }
 
 #ifdef FEATURE_PROPERTY_CACHE
-struct PropertyLookupCacheEntry
-{
-    static const size_t max_obj_hierarchy_depth = 8;
-
-    EsMap::Id hierarchy[max_obj_hierarchy_depth] = {};
-    uint8_t hierarchy_depth = 0;
-    EsPropertyKey key;
-    EsPropertyReference prop;
-};
+/**
+ * Global property cache used by megamorphic sites. Entries are indexed by the
+ * map identifier of the object the lookup is performed on, combined with the
+ * property key.
+ */
+EsPropertyCacheEntry megamorphic_cache[FEATURE_PROPERTY_CACHE_SIZE];
 
-PropertyLookupCacheEntry property_cache[FEATURE_PROPERTY_CACHE_SIZE];
-#endif  // FEATURE_PROPERTY_CACHE
+static EsPropertyCacheEntry &prp_megamorphic_entry(EsObject *obj,
+                                                   uint64_t raw_key)
+{
+    // Map identifiers are pointers so the lowest bits carry no information.
+    uint64_t hash = ((obj->map().id() >> 4) ^ raw_key) * 0x9e3779b97f4a7c15ull;
+    return megamorphic_cache[(hash >> 32) % FEATURE_PROPERTY_CACHE_SIZE];
+}
 
-bool esa_prp_get_slow(EsValueData src_data, EsValueData key_data,
-                      EsValueData *result_data, uint16_t cid)
+/**
+ * Tests if a cache entry describes the object hierarchy of an object.
+ * @param [in] entry Cache entry.
+ * @param [in] obj Object the lookup is performed on.
+ * @param [in] raw_key Raw property key.
+ * @param [in] own true if only own properties should be considered.
+ * @return Object owning the cached property, or NULL if the entry does not
+ *         match.
+ */
+static inline EsObject *prp_cache_probe(const EsPropertyCacheEntry &entry,
+                                        EsObject *obj, uint64_t raw_key,
+                                        bool own)
 {
-    EsValue &src = static_cast<EsValue &>(src_data);
-    EsValue &key = static_cast<EsValue &>(key_data);
+    if (entry.depth == 0 || entry.key != raw_key || (own && entry.depth != 1))
+        return NULL;
 
-    uint32_t key_idx = 0;
-    if (key.is_number() && es_num_to_index(key.as_number(), key_idx))
+    uint8_t last = entry.depth - 1;
+    for (uint8_t i = 0; i < last; i++)
     {
-        return esa_prp_get(src, EsPropertyKey::from_u32(key_idx).as_raw(),
-                          result_data, cid);
-    }
+        if (entry.ids[i] != obj->map().id())
+            return NULL;
 
-    const EsString *key_str = key.to_stringT();
-    if (!key_str)
-        return false;
+        obj = obj->prototype();
+        if (!obj)
+            return NULL;
+    }
 
-    return esa_prp_get(src, EsPropertyKey::from_str(key_str).as_raw(),
-                      result_data, cid);
+    return entry.ids[last] == obj->map().id() ? obj : NULL;
 }
 
-bool esa_prp_get(EsValueData src_data, uint64_t raw_key,
-                 EsValueData *result_data, uint16_t cid)
+/**
+ * Records where a property was found in a cache entry.
+ * @return true if the entry was updated, false if the property cannot be
+ *         described by a cache entry.
+ */
+static bool prp_cache_fill(EsPropertyCacheEntry &entry, EsObject *obj,
+                           uint64_t raw_key, const EsPropertyReference &prop)
 {
-    EsValue &src = static_cast<EsValue &>(src_data);
-    EsValue &result = static_cast<EsValue &>(*result_data);
+    EsPropertyCacheEntry tmp;
+    tmp.key = raw_key;
+    tmp.slot = static_cast<uint32_t>(prop.slot());
+    tmp.depth = 0;
 
-    EsObject *obj = src.to_objectT();
-    if (!obj)
-        return false;
+    for (EsObject *base_obj = obj; base_obj; base_obj = base_obj->prototype())
+    {
+        if (tmp.depth >= ESA_PRP_CACHE_MAX_DEPTH)
+            return false;
 
-    EsPropertyKey key = EsPropertyKey::from_raw(raw_key);
+        tmp.ids[tmp.depth++] = base_obj->map().id();
+        if (base_obj == prop.base())
+        {
+            entry = tmp;
+            return true;
+        }
+    }
 
-#ifdef FEATURE_PROPERTY_CACHE
-    assert(cid < FEATURE_PROPERTY_CACHE_SIZE);
+    return false;
+}
+#endif  // FEATURE_PROPERTY_CACHE
 
+/**
+ * Searches a property cache for a property.
+ * @param [in] cache Site cache, may be NULL.
+ * @param [in] obj Object to perform the lookup on.
+ * @param [in] raw_key Raw property key.
+ * @param [in] own true if only own properties should be considered.
+ * @return Reference to the property if found in the cache, an invalid
+ *         reference otherwise.
+ */
+static EsPropertyReference prp_cache_lookup(EsPropertyCache *cache,
+                                            EsObject *obj, uint64_t raw_key,
+                                            bool own)
+{
+#ifdef FEATURE_PROPERTY_CACHE
 #ifdef PROFILE
     profiler::stats.prp_access_cnt_++;
 #endif  // PROFILE
 
-    PropertyLookupCacheEntry &cache_entry = property_cache[cid];
-    if (cache_entry.hierarchy_depth > 0 &&
-        cache_entry.key == key)
-    {
-        EsObject *base_obj = obj;
+    EsObject *owner = NULL;
+    uint32_t slot = 0;
 
-        uint8_t last = cache_entry.hierarchy_depth - 1;
-        for (uint8_t i = 0; i < last; i++)
+    if (cache && !cache->megamorphic)
+    {
+        for (uint8_t i = 0; i < cache->num_entries; i++)
         {
-            if (cache_entry.hierarchy[i] != base_obj->map().id())
-                goto cache_miss;
-
-            base_obj = base_obj->prototype();
-            if (!base_obj)
-                goto cache_miss;
+            const EsPropertyCacheEntry &entry = cache->entries[i];
+            if ((owner = prp_cache_probe(entry, obj, raw_key, own)))
+            {
+                slot = entry.slot;
+                break;
+            }
         }
+    }
+    else
+    {
+        const EsPropertyCacheEntry &entry = prp_megamorphic_entry(obj, raw_key);
+        if ((owner = prp_cache_probe(entry, obj, raw_key, own)))
+            slot = entry.slot;
+    }
 
-        if (cache_entry.hierarchy[last] == base_obj->map().id())
-        {
+    if (owner)
+    {
 #ifdef PROFILE
-            profiler::stats.prp_cache_hits_++;
+        profiler::stats.prp_cache_hits_++;
+        if (cache)
+            cache->hits++;
 #endif  // PROFILE
 
-            EsPropertyReference prop =
-                base_obj->map().from_cached(cache_entry.prop);
-
-            return obj->get_resolveT(prop, reinterpret_cast<EsValue &>(result));
-        }
+        return owner->map().from_slot(slot);
     }
 
-cache_miss:
 #ifdef PROFILE
     profiler::stats.prp_cache_misses_++;
+    if (cache)
+    {
+        cache->misses++;
+        if (!cache->profiled)
+        {
+            cache->profiled = 1;
+            profiler::register_prp_cache(cache);
+        }
+    }
 #endif  // PROFILE
 #endif  // FEATURE_PROPERTY_CACHE
 
-    EsPropertyReference prop;
-    if (!obj->getT(key, prop))
-        return false;
+    return EsPropertyReference();
+}
 
+/**
+ * Updates a property cache after a cache miss.
+ * @param [in] cache Site cache, may be NULL.
+ * @param [in] obj Object the lookup was performed on.
+ * @param [in] raw_key Raw property key.
+ * @param [in] prop Property found by the lookup.
+ */
+static void prp_cache_update(EsPropertyCache *cache, EsObject *obj,
+                             uint64_t raw_key, const EsPropertyReference &prop)
+{
 #ifdef FEATURE_PROPERTY_CACHE
     if (!prop || !prop.is_cachable())
-        return obj->get_resolveT(prop, reinterpret_cast<EsValue &>(result));
+        return;
 
-    cache_entry.hierarchy_depth = 0;
-    cache_entry.key = key;
-    cache_entry.prop = prop;
-
-    uint8_t i = 0;
-    for (EsObject *base_obj = obj; base_obj; base_obj = base_obj->prototype())
+    if (cache && !cache->megamorphic)
     {
-        cache_entry.hierarchy[i++] = base_obj->map().id();
-        if (base_obj == prop.base())
-            break;
+        if (cache->num_entries < ESA_PRP_CACHE_NUM_ENTRIES)
+        {
+            if (prp_cache_fill(cache->entries[cache->num_entries], obj,
+                               raw_key, prop))
+            {
+                cache->num_entries++;
+            }
+
+            return;
+        }
 
-        if (i >= PropertyLookupCacheEntry::max_obj_hierarchy_depth)
-            return obj->get_resolveT(prop, reinterpret_cast<EsValue &>(result));
+        cache->megamorphic = 1;
     }
 
-    cache_entry.hierarchy_depth = i;
+    prp_cache_fill(prp_megamorphic_entry(obj, raw_key), obj, raw_key, prop);
 #endif  // FEATURE_PROPERTY_CACHE
+}
+
+/**
+ * Looks up a property, utilizing a property cache.
+ * @param [in] obj Object to perform the lookup on.
+ * @param [in] raw_key Raw property key.
+ * @param [in] cache Site cache, may be NULL.
+ * @param [out] prop Reference to the property, or an invalid reference if
+ *                   the property doesn't exist.
+ * @return true on normal return, false if an exception was thrown.
+ */
+static bool prp_cached_getT(EsObject *obj, uint64_t raw_key,
+                            EsPropertyCache *cache, EsPropertyReference &prop)
+{
+    prop = prp_cache_lookup(cache, obj, raw_key, false);
+    if (prop)
+        return true;
+
+    if (!obj->getT(EsPropertyKey::from_raw(raw_key), prop))
+        return false;
 
-    return obj->get_resolveT(prop, reinterpret_cast<EsValue &>(result));
+    prp_cache_update(cache, obj, raw_key, prop);
+    return true;
 }
 
-EsPropertyReference prp_cached_get_own_property(EsObject *obj,
-                                                EsPropertyKey key,
-                                                uint16_t cid)
+bool esa_prp_get_slow(EsValueData src_data, EsValueData key_data,
+                      EsValueData *result_data, EsPropertyCache *cache)
 {
-#ifdef FEATURE_PROPERTY_CACHE
-    assert(cid < FEATURE_PROPERTY_CACHE_SIZE);
+    EsValue &src = static_cast<EsValue &>(src_data);
+    EsValue &key = static_cast<EsValue &>(key_data);
 
-#ifdef PROFILE
-    profiler::stats.prp_access_cnt_++;
-#endif  // PROFILE
+    uint32_t key_idx = 0;
+    if (key.is_number() && es_num_to_index(key.as_number(), key_idx))
+    {
+        return esa_prp_get(src, EsPropertyKey::from_u32(key_idx).as_raw(),
+                          result_data, cache);
+    }
+
+    const EsString *key_str = key.to_stringT();
+    if (!key_str)
+        return false;
 
-    PropertyLookupCacheEntry &cache_entry = property_cache[cid];
-    if (cache_entry.hierarchy_depth > 0 &&
-        cache_entry.key == key)
+    return esa_prp_get(src, EsPropertyKey::from_str(key_str).as_raw(),
+                      result_data, cache);
+}
+
+bool esa_prp_get_elm(EsValueData src_data, EsValueData key_data,
+                     EsValueData *result_data, EsPropertyCache *cache)
+{
+    EsValue &src = static_cast<EsValue &>(src_data);
+    EsValue &key = static_cast<EsValue &>(key_data);
+
+    uint32_t key_idx = 0;
+    if (src.is_object() && key.is_number() &&
+        es_num_to_index(key.as_number(), key_idx))
     {
-        size_t last = cache_entry.hierarchy_depth - 1;
-        if (cache_entry.hierarchy[last] == obj->map().id())
+        EsObject *obj = src.as_object();
+        if (obj->class_id() == EsObject::CLASS_ARRAY)
         {
-#ifdef PROFILE
-            profiler::stats.prp_cache_hits_++;
-#endif  // PROFILE
-
-            return obj->map().from_cached(cache_entry.prop);
+            EsValue &result = static_cast<EsValue &>(*result_data);
+            if (safe_cast<EsArray *>(obj)->get_element(key_idx, result))
+                return true;
         }
     }
 
-#ifdef PROFILE
-    profiler::stats.prp_cache_misses_++;
-#endif  // PROFILE
-#endif  // FEATURE_PROPERTY_CACHE
+    return esa_prp_get_slow(src_data, key_data, result_data, cache);
+}
 
-    EsPropertyReference prop = obj->get_own_property(key);
+bool esa_prp_get(EsValueData src_data, uint64_t raw_key,
+                 EsValueData *result_data, EsPropertyCache *cache)
+{
+    EsValue &src = static_cast<EsValue &>(src_data);
+    EsValue &result = static_cast<EsValue &>(*result_data);
 
-#ifdef FEATURE_PROPERTY_CACHE
-    if (!prop || !prop.is_cachable())
-        return prop;
+    EsObject *obj = src.to_objectT();
+    if (!obj)
+        return false;
 
-    cache_entry.hierarchy_depth = 1;
-    cache_entry.key = key;
-    cache_entry.prop = prop;
-    cache_entry.hierarchy[0] = obj->map().id();
-#endif  // FEATURE_PROPERTY_CACHE
+    EsPropertyReference prop;
+    if (!prp_cached_getT(obj, raw_key, cache, prop))
+        return false;
 
+    return obj->get_resolveT(prop, result);
+}
+
+EsPropertyReference prp_cached_get_own_property(EsObject *obj,
+                                                EsPropertyKey key,
+                                                EsPropertyCache *cache)
+{
+    EsPropertyReference prop = prp_cache_lookup(cache, obj, key.as_raw(), true);
+    if (prop)
+        return prop;
+
+    prop = obj->get_own_property(key);
+    prp_cache_update(cache, obj, key.as_raw(), prop);
     return prop;
 }
 
 bool esa_prp_put_slow(EsContext *ctx, EsValueData dst_data,
-                      EsValueData key_data, EsValueData val_data, uint16_t cid)
+                      EsValueData key_data, EsValueData val_data,
+                      EsPropertyCache *cache)
 {
     EsValue &dst = static_cast<EsValue &>(dst_data);
     EsValue &key = static_cast<EsValue &>(key_data);
@@ -1001,7 +1140,7 @@ bool esa_prp_put_slow(EsContext *ctx, EsValueData dst_data,
     if (key.is_number() && es_num_to_index(key.as_number(), key_idx))
     {
         return esa_prp_put(ctx, dst,
-                          EsPropertyKey::from_u32(key_idx).as_raw(), val, cid);
+                          EsPropertyKey::from_u32(key_idx).as_raw(), val, cache);
     }
 
     const EsString *key_str = key.to_stringT();
@@ -1009,11 +1148,34 @@ bool esa_prp_put_slow(EsContext *ctx, EsValueData dst_data,
         return false;
 
     return esa_prp_put(ctx, dst, EsPropertyKey::from_str(key_str).as_raw(),
-                      val, cid);
+                      val, cache);
+}
+
+bool esa_prp_put_elm(EsContext *ctx, EsValueData dst_data,
+                     EsValueData key_data, EsValueData val_data,
+                     EsPropertyCache *cache)
+{
+    EsValue &dst = static_cast<EsValue &>(dst_data);
+    EsValue &key = static_cast<EsValue &>(key_data);
+
+    uint32_t key_idx = 0;
+    if (dst.is_object() && key.is_number() &&
+        es_num_to_index(key.as_number(), key_idx))
+    {
+        EsObject *obj = dst.as_object();
+        if (obj->class_id() == EsObject::CLASS_ARRAY &&
+            safe_cast<EsArray *>(obj)->put_element(
+                key_idx, static_cast<EsValue &>(val_data)))
+        {
+            return true;
+        }
+    }
+
+    return esa_prp_put_slow(ctx, dst_data, key_data, val_data, cache);
 }
 
 bool esa_prp_put(EsContext *ctx, EsValueData dst_data, uint64_t raw_key,
-                 EsValueData val_data, uint16_t cid)
+                 EsValueData val_data, EsPropertyCache *cache)
 {
     EsValue &dst = static_cast<EsValue &>(dst_data);
     EsValue &val = static_cast<EsValue &>(val_data);
@@ -1024,7 +1186,7 @@ bool esa_prp_put(EsContext *ctx, EsValueData dst_data, uint64_t raw_key,
 
     EsPropertyKey key = EsPropertyKey::from_raw(raw_key);
 
-    EsPropertyReference prop = prp_cached_get_own_property(obj, key, cid);
+    EsPropertyReference prop = prp_cached_get_own_property(obj, key, cache);
     if (prop)
         return obj->put_ownT(key, prop, val, ctx->is_strict());
     return obj->putT(key, val, ctx->is_strict());
@@ -1097,7 +1259,7 @@ bool esa_call(EsValueData fun_data, uint32_t argc, EsValueData *result_data)
 }
 
 bool call_keyed(EsValueData src_data, uint64_t raw_key, uint32_t argc,
-                EsValueData &result_data)
+                EsValueData &result_data, EsPropertyCache *cache)
 {
     EsValue &src = static_cast<EsValue &>(src_data);
     EsValue &result = static_cast<EsValue &>(result_data);
@@ -1110,8 +1272,12 @@ bool call_keyed(EsValueData src_data, uint64_t raw_key, uint32_t argc,
     if (!obj)
         return false;
 
+    EsPropertyReference prop;
+    if (!prp_cached_getT(obj, raw_key, cache, prop))
+        return false;
+
     EsValue fun_val;
-    if (!obj->getT(key, fun_val))
+    if (!obj->get_resolveT(prop, fun_val))
         return false;
 
     if (!fun_val.is_callable())
@@ -1153,7 +1319,7 @@ bool esa_call_keyed_slow(EsValueData src_data, EsValueData key_data,
     {
         guard.release();
         return call_keyed(src, EsPropertyKey::from_u32(key_idx).as_raw(),
-                          argc, result);
+                          argc, result, NULL);
     }
 
     const EsString *key_str = key.to_stringT();
@@ -1162,16 +1328,17 @@ bool esa_call_keyed_slow(EsValueData src_data, EsValueData key_data,
 
     guard.release();
     return call_keyed(src, EsPropertyKey::from_str(key_str).as_raw(),
-                      argc, result);
+                      argc, result, NULL);
 }
 
 bool esa_call_keyed(EsValueData src_data, uint64_t raw_key, uint32_t argc,
-                    EsValueData *result_data)
+                    EsValueData *result_data, EsPropertyCache *cache)
 {
-    return call_keyed(src_data, raw_key, argc, *result_data);
+    return call_keyed(src_data, raw_key, argc, *result_data, cache);
 }
 
-bool esa_call_named(uint64_t raw_key, uint32_t argc, EsValueData *result_data)
+bool esa_call_named(uint64_t raw_key, uint32_t argc, EsValueData *result_data,
+                    EsContextCache *cache)
 {
     EsValue &result = static_cast<EsValue &>(*result_data);
 
@@ -1181,19 +1348,13 @@ bool esa_call_named(uint64_t raw_key, uint32_t argc, EsValueData *result_data)
 
     EsContext *ctx = EsContextStack::instance().top();
 
-    EsValue this_value = es_get_this_value(ctx->lex_env(), key);
-    if (this_value.is_nothing())
-    {
-        ES_THROW(EsReferenceError,
-                 es_fmt_msg(ES_MSG_REF_NOT_DEFINED,
-                            key.to_string()->utf8().c_str()));
-        return false;
-    }
-
     EsValue fun;
-    if (!esa_ctx_get(ctx, key.as_raw(), &fun, 0))
+    EsEnvironmentRecord *env_rec = NULL;
+    if (!ctx_getT(ctx, key, cache, fun, env_rec))
         return false;
 
+    EsValue this_value = env_rec->implicit_this_value();
+
     if (!fun.is_callable())
     {
         ES_THROW(EsTypeError, es_fmt_msg(ES_MSG_TYPE_NO_FUN));
@@ -1263,8 +1424,24 @@ EsValueData esa_new_obj()
     return EsValue::from_obj(EsObject::create_inst());
 }
 
+EsValueData esa_new_obj_lit(EsObjectTemplate *tmpl, EsValueData vals_data[])
+{
+    if (!tmpl->shape)
+    {
+        EsShape *shape = EsShape::root();
+        for (uint32_t i = 0; i < tmpl->num_keys; i++)
+            shape = shape->add(EsPropertyKey::from_raw(tmpl->keys[i]), i);
+
+        tmpl->shape = shape;
+    }
+
+    return EsValue::from_obj(EsObject::create_inst_from_shape(
+            static_cast<EsShape *>(tmpl->shape),
+            static_cast<EsValue *>(vals_data)));
+}
+
 EsValueData esa_new_fun_decl(EsContext *ctx, ESA_FUN_PTR(fun),
-                             bool strict, uint32_t prmc)
+                             bool strict, uint32_t prmc, bool needs_env)
 {
     assert(fun);
 
@@ -1272,7 +1449,8 @@ EsValueData esa_new_fun_decl(EsContext *ctx, ESA_FUN_PTR(fun),
             ctx->var_env(),
             reinterpret_cast<EsFunction::NativeFunction>(fun),
             strict,
-            prmc);
+            prmc,
+            needs_env);
     if (!obj)
         THROW(MemoryException);
 
@@ -1280,7 +1458,7 @@ EsValueData esa_new_fun_decl(EsContext *ctx, ESA_FUN_PTR(fun),
 }
 
 EsValueData esa_new_fun_expr(EsContext *ctx, ESA_FUN_PTR(fun),
-                             bool strict, uint32_t prmc)
+                             bool strict, uint32_t prmc, bool needs_env)
 {
     assert(fun);
 
@@ -1288,7 +1466,8 @@ EsValueData esa_new_fun_expr(EsContext *ctx, ESA_FUN_PTR(fun),
             ctx->lex_env(),
             reinterpret_cast<EsFunction::NativeFunction>(fun),
             strict,
-            prmc);
+            prmc,
+            needs_env);
     if (!obj)
         THROW(MemoryException);
 
@@ -40,6 +40,84 @@ struct EsContext;
 struct EsPropertyIterator;
 struct EsString;
 
+/** Maximum length of an object hierarchy in a property cache entry. */
+#define ESA_PRP_CACHE_MAX_DEPTH     4
+
+/** Maximum number of entries in a property cache. */
+#define ESA_PRP_CACHE_NUM_ENTRIES   4
+
+/**
+ * Property cache entry. Describes where a property was found the last time it
+ * was looked up in a particular object hierarchy. The hierarchy is identified
+ * by the map identifiers of the objects on the prototype chain, starting with
+ * the object the lookup was performed on and ending with the object owning
+ * the property.
+ */
+struct EsPropertyCacheEntry
+{
+    uintptr_t ids[ESA_PRP_CACHE_MAX_DEPTH]; ///< Map identifiers.
+    uint64_t key;                           ///< Raw property key.
+    uint32_t slot;                          ///< Property slot in owner map.
+    uint8_t depth;                          ///< Number of used identifiers.
+};
+
+/**
+ * Polymorphic property cache. The code generator allocates one cache for each
+ * property access site. When a site has seen more object hierarchies than
+ * the cache can hold it's considered megamorphic and will fall back to a
+ * global cache that's shared by all megamorphic sites.
+ */
+struct EsPropertyCache
+{
+    const char *site;       ///< Name of access site, used for profiling.
+    struct EsPropertyCacheEntry entries[ESA_PRP_CACHE_NUM_ENTRIES];
+    uint8_t num_entries;    ///< Number of used entries.
+    uint8_t megamorphic;    ///< Non-zero if the site is megamorphic.
+    uint8_t profiled;       ///< Non-zero if registered with the profiler.
+    uint32_t hits;          ///< Number of cache hits.
+    uint32_t misses;        ///< Number of cache misses.
+};
+
+/**
+ * Initializer for statically allocated property caches.
+ * @param [in] site Name of access site.
+ */
+#define ESA_PRP_CACHE_INIT(site)    { site }
+
+/** Context cache is empty. */
+#define ESA_CTX_CACHE_EMPTY         0
+/** Identifier was resolved in a declarative environment record. */
+#define ESA_CTX_CACHE_DECL          1
+/** Identifier was resolved in an object environment record. */
+#define ESA_CTX_CACHE_OBJ           2
+
+/**
+ * Context cache. The code generator allocates one cache for each context
+ * access site. It describes where the identifier was resolved the last time
+ * as the number of lexical environments that were skipped before reaching
+ * the environment holding the binding, and if that environment is an object
+ * environment, the map identifier and slot of the binding property.
+ */
+struct EsContextCache
+{
+    const char *site;       ///< Name of access site, used for profiling.
+    uintptr_t id;           ///< Map identifier of binding object.
+    uint64_t key;           ///< Raw identifier key.
+    uint32_t slot;          ///< Property slot in binding object map.
+    uint32_t epoch;         ///< Removable binding epoch when cached.
+    uint16_t depth;         ///< Number of skipped lexical environments.
+    uint8_t state;          ///< One of the ESA_CTX_CACHE_* constants.
+    uint8_t profiled;       ///< Non-zero if registered with the profiler.
+    uint32_t hits;          ///< Number of cache hits.
+    uint32_t misses;        ///< Number of cache misses.
+};
+
+/**
+ * Initializer for statically allocated context caches.
+ * @param [in] site Name of access site.
+ */
+#define ESA_CTX_CACHE_INIT(site)    { site }
+
 void esa_str_intern(const struct EsString *str, uint32_t id);
 
 bool esa_val_to_bool(EsValueData val_data);
@@ -116,10 +194,11 @@ void esa_ctx_link_var(struct EsContext *ctx, uint64_t vn,
                       EsValueData *vo_data);    // May not be called from eval context.
 void esa_ctx_link_prm(struct EsContext *ctx, uint64_t vn,
                       EsValueData *po_data);    // May not be called from eval context.
+// NOTE: Context caches may be NULL, in which case the lookup is uncached.
 bool esa_ctx_get(struct EsContext *ctx, uint64_t raw_key,
-                 EsValueData *result_data, uint16_t cid);
+                 EsValueData *result_data, struct EsContextCache *cache);
 bool esa_ctx_put(struct EsContext *ctx, uint64_t raw_key,
-                 EsValueData val_data, uint16_t cid);
+                 EsValueData val_data, struct EsContextCache *cache);
 bool esa_ctx_del(struct EsContext *ctx, uint64_t raw_key,
                  EsValueData *result_data);
 void esa_ctx_set_strict(struct EsContext *ctx, bool strict);
@@ -141,15 +220,46 @@ bool esa_prp_def_data(EsValueData obj_data, EsValueData key_data,
                       EsValueData val_data);
 bool esa_prp_def_accessor(EsValueData obj_data, uint64_t raw_key,
                           EsValueData fun_data, bool is_setter);
+
+// NOTE: Property caches may be NULL, in which case only the global
+//       megamorphic cache will be used.
 bool esa_prp_get_slow(EsValueData src_data, EsValueData key_data,
-                      EsValueData *result_data, uint16_t cid);
+                      EsValueData *result_data, struct EsPropertyCache *cache);
+// NOTE: The element functions try to access packed array elements directly
+//       and fall back to the corresponding slow functions.
+bool esa_prp_get_elm(EsValueData src_data, EsValueData key_data,
+                     EsValueData *result_data, struct EsPropertyCache *cache);
 bool esa_prp_get(EsValueData src_data, uint64_t raw_key,
-                 EsValueData *result_data, uint16_t cid);
+                 EsValueData *result_data, struct EsPropertyCache *cache);
 bool esa_prp_put_slow(struct EsContext *ctx, EsValueData dst_data,
                       EsValueData key_data, EsValueData val_data,
-                      uint16_t cid);
+                      struct EsPropertyCache *cache);
+bool esa_prp_put_elm(struct EsContext *ctx, EsValueData dst_data,
+                     EsValueData key_data, EsValueData val_data,
+                     struct EsPropertyCache *cache);
+/**
+ * Object literal template. The code generator allocates one template for each
+ * object literal site where all properties are data properties with constant,
+ * non-index keys. The shape holding all properties of the literal is created
+ * the first time the site is evaluated, after which objects are created
+ * directly with that shape instead of adding the properties one by one.
+ */
+struct EsObjectTemplate
+{
+    const uint64_t *keys;   ///< Raw property keys in definition order.
+    uint32_t num_keys;      ///< Number of property keys.
+    void *shape;            ///< Shape of created objects, NULL until resolved.
+};
+
+/**
+ * Initializer for statically allocated object literal templates.
+ * @param [in] keys Array of raw property keys.
+ * @param [in] num_keys Number of property keys.
+ */
+#define ESA_OBJ_TEMPLATE_INIT(keys, num_keys)   { keys, num_keys, NULL }
+
 bool esa_prp_put(struct EsContext *ctx, EsValueData dst_data, uint64_t raw_key,
-                 EsValueData val_data, uint16_t cid);
+                 EsValueData val_data, struct EsPropertyCache *cache);
 bool esa_prp_del_slow(struct EsContext *ctx, EsValueData src_data,
                       EsValueData key_data, EsValueData *result_data);
 bool esa_prp_del(struct EsContext *ctx, EsValueData src_data, uint64_t raw_key,
@@ -159,8 +269,9 @@ bool esa_call(EsValueData fun_data, uint32_t argc, EsValueData *result_data);
 bool esa_call_keyed_slow(EsValueData src_data, EsValueData key_data,
                          uint32_t argc, EsValueData *result_data);
 bool esa_call_keyed(EsValueData src_data, uint64_t raw_key, uint32_t argc,
-                    EsValueData *result_data);
-bool esa_call_named(uint64_t raw_key, uint32_t argc, EsValueData *result_data);
+                    EsValueData *result_data, struct EsPropertyCache *cache);
+bool esa_call_named(uint64_t raw_key, uint32_t argc, EsValueData *result_data,
+                    struct EsContextCache *cache);
 bool esa_call_new(EsValueData fun_data, uint32_t argc,
                   EsValueData *result_data);
 
@@ -168,12 +279,14 @@ bool esa_call_new(EsValueData fun_data, uint32_t argc,
 const struct EsString *esa_new_str(const void *str, uint32_t len);
 EsValueData esa_new_arr(uint32_t count, EsValueData items_data[]);
 EsValueData esa_new_obj();
+EsValueData esa_new_obj_lit(struct EsObjectTemplate *tmpl,
+                            EsValueData vals_data[]);
 EsValueData esa_new_reg_exp(const struct EsString *pattern,
                             const struct EsString *flags);
 EsValueData esa_new_fun_decl(struct EsContext *ctx, ESA_FUN_PTR(fun),
-                             bool strict, uint32_t prmc);
+                             bool strict, uint32_t prmc, bool needs_env);
 EsValueData esa_new_fun_expr(struct EsContext *ctx, ESA_FUN_PTR(fun),
-                             bool strict, uint32_t prmc);
+                             bool strict, uint32_t prmc, bool needs_env);
 
 // Unary functions.
 bool esa_u_typeof(EsValueData val_data, EsValueData *result_data);
@@ -16,13 +16,110 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <iostream>
+#include <vector>
+#include "operation.h"
 #include "profiler.hh"
+#include "property_key.hh"
+#include "string.hh"
+
+/** Maximum number of context cache sites to include in the results. */
+#define MAX_NUM_REPORTED_CTX_SITES  20
+
+/** Maximum number of property cache sites to include in the results. */
+#define MAX_NUM_REPORTED_PRP_SITES  20
 
 namespace profiler
 {
     Statistics stats;
 
+    /** Context caches that have missed at least once. */
+    std::vector<const EsContextCache *> ctx_caches;
+
+    /** Property caches that have been accessed at least once. */
+    std::vector<const EsPropertyCache *> prp_caches;
+
+    void register_ctx_cache(const EsContextCache *cache)
+    {
+        ctx_caches.push_back(cache);
+    }
+
+    void register_prp_cache(const EsPropertyCache *cache)
+    {
+        prp_caches.push_back(cache);
+    }
+
+    void print_ctx_cache_sites()
+    {
+        // Report the sites with the most misses first.
+        std::sort(ctx_caches.begin(), ctx_caches.end(),
+                  [](const EsContextCache *a, const EsContextCache *b)
+        {
+            return a->misses > b->misses;
+        });
+
+        size_t num_sites = std::min(ctx_caches.size(),
+                                    static_cast<size_t>(MAX_NUM_REPORTED_CTX_SITES));
+        for (size_t i = 0; i < num_sites; i++)
+        {
+            const EsContextCache *cache = ctx_caches[i];
+
+            uint64_t access_cnt = static_cast<uint64_t>(cache->hits) +
+                                  cache->misses;
+
+            std::cout << "  " << (cache->site ? cache->site : "<unknown>");
+            if (cache->state != ESA_CTX_CACHE_EMPTY)
+            {
+                std::cout << " ("
+                          << EsPropertyKey::from_raw(
+                                cache->key).to_string()->utf8()
+                          << ")";
+            }
+
+            std::cout << ": " << ((100 * cache->hits) / access_cnt)
+                      << "% (" << cache->hits << " / " << access_cnt << ")";
+            if (cache->state != ESA_CTX_CACHE_EMPTY)
+                std::cout << ", depth " << cache->depth;
+            std::cout << std::endl;
+        }
+    }
+
+    void print_prp_cache_sites()
+    {
+        // Report the sites with the most misses first.
+        std::sort(prp_caches.begin(), prp_caches.end(),
+                  [](const EsPropertyCache *a, const EsPropertyCache *b)
+        {
+            return a->misses > b->misses;
+        });
+
+        size_t num_sites = std::min(prp_caches.size(),
+                                    static_cast<size_t>(MAX_NUM_REPORTED_PRP_SITES));
+        for (size_t i = 0; i < num_sites; i++)
+        {
+            const EsPropertyCache *cache = prp_caches[i];
+
+            uint64_t access_cnt = static_cast<uint64_t>(cache->hits) +
+                                  cache->misses;
+
+            std::cout << "  " << (cache->site ? cache->site : "<unknown>");
+            if (cache->num_entries > 0)
+            {
+                std::cout << " ("
+                          << EsPropertyKey::from_raw(
+                                cache->entries[0].key).to_string()->utf8()
+                          << ")";
+            }
+
+            std::cout << ": " << ((100 * cache->hits) / access_cnt)
+                      << "% (" << cache->hits << " / " << access_cnt << "), "
+                      << static_cast<int>(cache->num_entries) << " map(s)"
+                      << (cache->megamorphic ? ", megamorphic" : "")
+                      << std::endl;
+        }
+    }
+
     void print_results()
     {
         if (stats.ctx_access_cnt_ > 0)
@@ -48,5 +145,31 @@ namespace profiler
                       << "% (" << stats.prp_cache_misses_
                       << " / " << stats.prp_access_cnt_ << ")" << std::endl;
         }
+
+        uint64_t prog_access_cnt = stats.prog_cache_hits_ +
+                                   stats.prog_cache_misses_;
+        if (prog_access_cnt > 0)
+        {
+            std::cout << "program cache hits: "
+                      << ((100 * stats.prog_cache_hits_) / prog_access_cnt)
+                      << "% (" << stats.prog_cache_hits_
+                      << " / " << prog_access_cnt << ")" << std::endl;
+            std::cout << "program cache misses: "
+                      << ((100 * stats.prog_cache_misses_) / prog_access_cnt)
+                      << "% (" << stats.prog_cache_misses_
+                      << " / " << prog_access_cnt << ")" << std::endl;
+        }
+
+        if (!ctx_caches.empty())
+        {
+            std::cout << "context cache sites:" << std::endl;
+            print_ctx_cache_sites();
+        }
+
+        if (!prp_caches.empty())
+        {
+            std::cout << "property cache sites:" << std::endl;
+            print_prp_cache_sites();
+        }
     }
 }
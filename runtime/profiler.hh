@@ -18,6 +18,9 @@
 
 #pragma once
 
+struct EsContextCache;
+struct EsPropertyCache;
+
 namespace profiler
 {
 
@@ -29,6 +32,8 @@ struct Statistics
     uint64_t prp_access_cnt_;       ///< Number of property accesses.
     uint64_t prp_cache_hits_;       ///< Number of hits in property cache.
     uint64_t prp_cache_misses_;     ///< Number of misses in property cache.
+    uint64_t prog_cache_hits_;      ///< Number of hits in program cache.
+    uint64_t prog_cache_misses_;    ///< Number of misses in program cache.
 
     Statistics()
         : ctx_access_cnt_(0)
@@ -36,11 +41,25 @@ struct Statistics
         , ctx_cache_misses_(0)
         , prp_access_cnt_(0)
         , prp_cache_hits_(0)
-        , prp_cache_misses_(0) {}
+        , prp_cache_misses_(0)
+        , prog_cache_hits_(0)
+        , prog_cache_misses_(0) {}
 };
 
 extern Statistics stats;
 
+/**
+ * Registers a context cache for per-site reporting.
+ * @param [in] cache Context cache of an access site.
+ */
+void register_ctx_cache(const EsContextCache *cache);
+
+/**
+ * Registers a property cache for per-site reporting.
+ * @param [in] cache Property cache of an access site.
+ */
+void register_prp_cache(const EsPropertyCache *cache);
+
 void print_results();
 
 }
@@ -0,0 +1,112 @@
+/*
+ * descripten - ECMAScript to native compiler
+ * Copyright (C) 2011-2014 Christian Kindahl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cassert>
+#include "program_cache.hh"
+#ifdef PROFILE
+#include "profiler.hh"
+#endif  // PROFILE
+
+using parser::FunctionLiteral;
+using parser::Parser;
+
+size_t EsProgramCache::Key::Hash::operator()(const Key &key) const
+{
+    size_t hash = key.src_->hash();
+    if (key.params_)
+        hash = hash * 31 + key.params_->hash();
+
+    return (hash << 3) ^ (static_cast<size_t>(key.code_) << 1) ^
+        static_cast<size_t>(key.strict_);
+}
+
+bool EsProgramCache::Key::EqualTo::operator()(const Key &x, const Key &y) const
+{
+    if (x.code_ != y.code_ || x.strict_ != y.strict_)
+        return false;
+
+    if ((x.params_ == NULL) != (y.params_ == NULL))
+        return false;
+    if (x.params_ && !x.params_->equals(y.params_))
+        return false;
+
+    return x.src_->equals(y.src_);
+}
+
+EsProgramCache::EsProgramCache()
+{
+}
+
+EsProgramCache &EsProgramCache::instance()
+{
+    static EsProgramCache cache;
+    return cache;
+}
+
+FunctionLiteral *EsProgramCache::lookup(Parser::Code code, bool strict,
+                                        const EsString *src,
+                                        const EsString *params)
+{
+    EntryMap::iterator it = map_.find(Key(code, strict, src, params));
+    if (it == map_.end())
+    {
+#ifdef PROFILE
+        profiler::stats.prog_cache_misses_++;
+#endif  // PROFILE
+        return NULL;
+    }
+
+#ifdef PROFILE
+    profiler::stats.prog_cache_hits_++;
+#endif  // PROFILE
+
+    // Move the program to the front of the list.
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->second;
+}
+
+void EsProgramCache::insert(Parser::Code code, bool strict,
+                            const EsString *src, const EsString *params,
+                            FunctionLiteral *prog)
+{
+    assert(prog);
+
+    Key key(code, strict, src, params);
+    if (map_.count(key) > 0)
+        return;
+
+    if (entries_.size() >= MAX_NUM_ENTRIES)
+    {
+        map_.erase(entries_.back().first);
+        entries_.pop_back();
+    }
+
+    entries_.push_front(std::make_pair(key, prog));
+    map_.insert(std::make_pair(key, entries_.begin()));
+}
+
+size_t EsProgramCache::size() const
+{
+    return entries_.size();
+}
+
+void EsProgramCache::clear()
+{
+    map_.clear();
+    entries_.clear();
+}
@@ -0,0 +1,131 @@
+/*
+ * descripten - ECMAScript to native compiler
+ * Copyright (C) 2011-2014 Christian Kindahl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <list>
+#include <unordered_map>
+#include <gc/gc_allocator.h>    // NOTE: 3rd party.
+#include "parser/parser.hh"
+#include "string.hh"
+
+/**
+ * @brief Cache of programs parsed at runtime.
+ *
+ * Code passed to eval() and the Function constructor is parsed into an AST
+ * which is shared by every context evaluating the same source code. The
+ * cache keeps the most recently used ASTs so that evaluating the same source
+ * code again only requires a hash lookup.
+ *
+ * Everything attached to a cached AST must therefore hold in any scope. The
+ * Resolver only binds identifiers to slots of functions within the program
+ * itself, and bytecode and property caches don't refer to any context. The
+ * context caches of identifier sites do depend on the scope they were filled
+ * in and are flushed when reached from another scope, see EsIdentifierSite.
+ */
+class EsProgramCache
+{
+#ifdef UNITTEST
+public:
+    friend class ProgramCacheTestSuite;
+#endif
+
+private:
+    /** Maximum number of programs to keep in the cache. */
+    static const size_t MAX_NUM_ENTRIES = 128;
+
+    /**
+     * @brief Identifies a parsed program.
+     */
+    struct Key
+    {
+        parser::Parser::Code code_; ///< Type of parsed code.
+        bool strict_;               ///< Parsed in strict mode.
+        const EsString *src_;       ///< Program source.
+        const EsString *params_;    ///< Formal parameter list source, may be NULL.
+
+        Key(parser::Parser::Code code, bool strict,
+            const EsString *src, const EsString *params)
+            : code_(code)
+            , strict_(strict)
+            , src_(src)
+            , params_(params) {}
+
+        struct Hash
+        {
+            size_t operator()(const Key &key) const;
+        };
+
+        struct EqualTo
+        {
+            bool operator()(const Key &x, const Key &y) const;
+        };
+    };
+
+    typedef std::pair<Key, parser::FunctionLiteral *> Entry;
+    typedef std::list<Entry, gc_allocator<Entry> > EntryList;
+    typedef std::unordered_map<Key, EntryList::iterator, Key::Hash, Key::EqualTo,
+                               gc_allocator<std::pair<Key, EntryList::iterator> > > EntryMap;
+
+    EntryList entries_;     ///< Cached programs, most recently used first.
+    EntryMap map_;          ///< Maps keys to cached programs.
+
+    EsProgramCache();
+
+public:
+    /**
+     * @return Program cache instance.
+     */
+    static EsProgramCache &instance();
+
+    /**
+     * Looks up a previously parsed program.
+     * @param [in] code Type of code.
+     * @param [in] strict true if the code was parsed in strict mode.
+     * @param [in] src Program source.
+     * @param [in] params Formal parameter list source, or NULL if the program
+     *                    has no separately parsed parameters.
+     * @return Parsed program, or NULL if it's not in the cache.
+     */
+    parser::FunctionLiteral *lookup(parser::Parser::Code code, bool strict,
+                                    const EsString *src,
+                                    const EsString *params = NULL);
+
+    /**
+     * Adds a parsed program to the cache, evicting the least recently used
+     * program if the cache is full.
+     * @param [in] code Type of code.
+     * @param [in] strict true if the code was parsed in strict mode.
+     * @param [in] src Program source.
+     * @param [in] params Formal parameter list source, or NULL if the program
+     *                    has no separately parsed parameters.
+     * @param [in] prog Parsed program.
+     */
+    void insert(parser::Parser::Code code, bool strict,
+                const EsString *src, const EsString *params,
+                parser::FunctionLiteral *prog);
+
+    /**
+     * @return Number of programs in the cache.
+     */
+    size_t size() const;
+
+    /**
+     * Removes all programs from the cache.
+     */
+    void clear();
+};
@@ -16,22 +16,128 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <string.h>
+#include "common/exception.hh"
 #include "property_array.hh"
 #include "property_storage.hh"
 
+/** Maximum number of element slots to reserve up front. */
+#define ES_ELEMENTS_RESERVE_MAX 65536
+
 EsPropertyArray::EsPropertyArray()
-    : compact_(true)
+    : kind_(KIND_PACKED_DOUBLE)
+    , doubles_(NULL)
+    , size_(0)
+    , capacity_(0)
+    , holes_(0)
+    , compact_(true)
 {
 }
 
 void EsPropertyArray::reserve_compact_storage(uint32_t count)
 {
+    if (kind_ != KIND_GENERIC)
+    {
+        // The array may be given a large length without ever being filled.
+        count = std::min(count, static_cast<uint32_t>(ES_ELEMENTS_RESERVE_MAX));
+        if (count > capacity_)
+            grow(count);
+        return;
+    }
+
     if (!compact_)
         return;
 
     compact_storage_.reserve(count);
 }
 
+void EsPropertyArray::grow(uint32_t min_capacity)
+{
+    assert(kind_ != KIND_GENERIC);
+    assert(min_capacity > capacity_);
+
+    uint32_t capacity = capacity_ < 8 ? 8 : capacity_;
+    while (capacity < min_capacity)
+        capacity = capacity > 0x7fffffff ? min_capacity : capacity * 2;
+
+    if (kind_ == KIND_PACKED_DOUBLE)
+    {
+        // Doubles contain no pointers, the garbage collector doesn't need to
+        // scan them.
+        double *doubles = static_cast<double *>(
+                GC_MALLOC_ATOMIC(capacity * sizeof(double)));
+        if (!doubles)
+            THROW(MemoryException);
+
+        if (size_ > 0)
+            memcpy(doubles, doubles_, size_ * sizeof(double));
+        doubles_ = doubles;
+    }
+    else
+    {
+        EsValue *values = static_cast<EsValue *>(
+                GC_MALLOC(capacity * sizeof(EsValue)));
+        if (!values)
+            THROW(MemoryException);
+
+        if (size_ > 0)
+            memcpy(values, values_, size_ * sizeof(EsValue));
+        values_ = values;
+    }
+
+    capacity_ = capacity;
+}
+
+void EsPropertyArray::switch_to_values()
+{
+    assert(kind_ == KIND_PACKED_DOUBLE);
+
+    EsValue *values = NULL;
+    if (capacity_ > 0)
+    {
+        values = static_cast<EsValue *>(
+                GC_MALLOC(capacity_ * sizeof(EsValue)));
+        if (!values)
+            THROW(MemoryException);
+
+        for (uint32_t i = 0; i < size_; i++)
+            values[i] = EsValue::from_num(doubles_[i]);
+    }
+
+    values_ = values;
+    kind_ = KIND_PACKED;
+}
+
+void EsPropertyArray::switch_to_holey()
+{
+    if (kind_ == KIND_PACKED_DOUBLE)
+        switch_to_values();
+
+    assert(kind_ == KIND_PACKED || kind_ == KIND_HOLEY);
+    kind_ = KIND_HOLEY;
+}
+
+void EsPropertyArray::switch_to_generic_storage()
+{
+    if (kind_ == KIND_GENERIC)
+        return;
+
+    assert(compact_ && compact_storage_.empty());
+    compact_storage_.reserve(size_);
+
+    EsValue v;
+    for (uint32_t i = 0; i < size_; i++)
+    {
+        if (get_value(i, v))
+            compact_storage_.set(i, EsProperty(true, true, true, v));
+    }
+
+    doubles_ = NULL;
+    size_ = capacity_ = holes_ = 0;
+    kind_ = KIND_GENERIC;
+}
+
 void EsPropertyArray::switch_to_sparse_storage()
 {
     if (!compact_)
@@ -46,8 +152,72 @@ void EsPropertyArray::switch_to_sparse_storage()
     compact_ = false;
 }
 
+void EsPropertyArray::set_value_slow(uint32_t index, const EsValue &v)
+{
+    assert(kind_ != KIND_GENERIC);
+    assert(!v.is_nothing());
+
+    if (kind_ == KIND_PACKED_DOUBLE && !v.is_number())
+        switch_to_values();
+
+    if (index > size_)
+    {
+        // Use the same heuristics as for compact storage to determine when
+        // the array has become too sparse.
+        uint32_t approx_holes = holes_ + (index - size_);
+        if (approx_holes > 16 &&
+            (count() == 0 ||
+             (static_cast<double>(approx_holes) / count()) > 0.1f))
+        {
+            switch_to_generic_storage();
+            set(index, EsProperty(true, true, true, v));
+            return;
+        }
+
+        switch_to_holey();
+    }
+
+    if (index >= size_)
+    {
+        if (index >= capacity_)
+            grow(index + 1);
+
+        if (kind_ == KIND_HOLEY)
+        {
+            for (uint32_t i = size_; i < index; i++)
+                values_[i] = EsValue::nothing;
+            holes_ += index - size_;
+        }
+
+        size_ = index + 1;
+    }
+    else if (kind_ == KIND_HOLEY && values_[index].is_nothing())
+    {
+        // The array is dense again once the last hole has been filled.
+        if (--holes_ == 0)
+            kind_ = KIND_PACKED;
+    }
+
+    if (kind_ == KIND_PACKED_DOUBLE)
+        doubles_[index] = v.as_number();
+    else
+        values_[index] = v;
+}
+
 void EsPropertyArray::set(uint32_t index, const EsProperty &prop)
 {
+    if (kind_ != KIND_GENERIC)
+    {
+        if (prop.is_data() && prop.is_writable() &&
+            prop.is_enumerable() && prop.is_configurable())
+        {
+            set_value(index, prop.value_or_undefined());
+            return;
+        }
+
+        switch_to_generic_storage();
+    }
+
     if (compact_)
     {
         // If we'll get more than 10% holes in the compact array switch to a
@@ -72,3 +242,43 @@ void EsPropertyArray::set(uint32_t index, const EsProperty &prop)
         sparse_storage_.set(index, prop);
     }
 }
+
+void EsPropertyArray::remove(uint32_t index)
+{
+    if (kind_ == KIND_GENERIC)
+    {
+        if (compact_)
+            compact_storage_.remove(index);
+        else
+            sparse_storage_.remove(index);
+        return;
+    }
+
+    if (!contains(index))
+        return;
+
+    if (index + 1 < size_)
+    {
+        switch_to_holey();
+
+        values_[index] = EsValue::nothing;
+        holes_++;
+        return;
+    }
+
+    // Removing the last element, also trim any trailing holes so that the
+    // last used slot always holds an element.
+    uint32_t old_size = size_--;
+    if (kind_ == KIND_PACKED_DOUBLE)
+        return;
+
+    while (size_ > 0 && values_[size_ - 1].is_nothing())
+    {
+        size_--;
+        holes_--;
+    }
+
+    // Don't keep removed values reachable.
+    for (uint32_t i = size_; i < old_size; i++)
+        values_[i] = EsValue::nothing;
+}
@@ -17,27 +17,88 @@
  */
 
 #pragma once
+#include <cassert>
 #include "property_storage.hh"
 
 class EsPropertyStorage;
 
 /**
  * @brief Property array.
+ *
+ * Elements are initially kept in packed storage holding nothing but the
+ * element values, as unboxed doubles for as long as all elements are
+ * numbers. Elements in packed storage are implicitly writable, enumerable
+ * and configurable data properties. The array switches to generic
+ * EsProperty storage the first time an element with other attributes is
+ * defined, or when an element is accessed through get().
  */
 class EsPropertyArray
 {
+public:
+    /**
+     * @brief Element kinds.
+     */
+    enum Kind
+    {
+        KIND_PACKED_DOUBLE, ///< Dense numbers stored as raw doubles.
+        KIND_PACKED,        ///< Dense values.
+        KIND_HOLEY,         ///< Values with holes, holes are nothing.
+        KIND_GENERIC        ///< Compact or sparse property storage.
+    };
+
 private:
+    Kind kind_;
+
+    union
+    {
+        double *doubles_;   ///< Elements of KIND_PACKED_DOUBLE.
+        EsValue *values_;   ///< Elements of KIND_PACKED and KIND_HOLEY.
+    };
+    uint32_t size_;         ///< Number of used element slots.
+    uint32_t capacity_;     ///< Number of allocated element slots.
+    uint32_t holes_;        ///< Number of holes among the used slots.
+
     EsCompactPropertyStorage compact_storage_;
     EsSparsePropertyStorage sparse_storage_;
 
     bool compact_;  ///< true when using compact storage.
 
+    /**
+     * Grows the element storage.
+     * @param [in] min_capacity Minimum number of element slots.
+     * @pre Array is not in generic mode.
+     */
+    void grow(uint32_t min_capacity);
+
+    /**
+     * Switches from unboxed doubles to value storage.
+     */
+    void switch_to_values();
+
+    /**
+     * Switches from packed storage to holey storage.
+     */
+    void switch_to_holey();
+
+    /**
+     * Switches from packed or holey storage to generic compact storage.
+     */
+    void switch_to_generic_storage();
+
     /**
      * Switches the property array storage model from compact mode to sparse
      * mode.
      */
     void switch_to_sparse_storage();
 
+    /**
+     * Sets an element value in packed or holey storage, changing element
+     * kind if necessary.
+     * @param [in] index Element index.
+     * @param [in] v Element value.
+     */
+    void set_value_slow(uint32_t index, const EsValue &v);
+
 public:
     /**
      * @brief Array iterator.
@@ -45,19 +106,35 @@ public:
     class Iterator
     {
     private:
+        const EsPropertyArray *array_;  ///< Array in packed or holey mode.
+        uint32_t pos_;
         Maybe<EsCompactPropertyStorage::Iterator> compact_it_;
         Maybe<EsSparsePropertyStorage::ConstIterator> sparse_it_;
         bool compact_;
         
     public:
+        Iterator(const EsPropertyArray *array, uint32_t pos)
+            : array_(array), pos_(pos), compact_(true)
+        {
+            while (pos_ < array_->size_ && !array_->contains(pos_))
+                ++pos_;
+        }
+
         Iterator(EsCompactPropertyStorage::Iterator compact_it)
-            : compact_it_(compact_it), compact_(true) {}
+            : array_(NULL), pos_(0), compact_it_(compact_it), compact_(true) {}
 
         Iterator(EsSparsePropertyStorage::ConstIterator sparse_it)
-            : sparse_it_(sparse_it), compact_(false) {}
+            : array_(NULL), pos_(0), sparse_it_(sparse_it), compact_(false) {}
 
         const std::pair<uint32_t, EsProperty> operator*() const
         {
+            if (array_)
+            {
+                EsValue v;
+                array_->get_value(pos_, v);
+                return std::make_pair(pos_, EsProperty(true, true, true, v));
+            }
+
             if (compact_)
                 return **compact_it_;
             else
@@ -66,19 +143,32 @@ public:
 
         const Iterator &operator++()
         {
-            if (compact_)
+            if (array_)
+            {
+                do
+                    ++pos_;
+                while (pos_ < array_->size_ && !array_->contains(pos_));
+            }
+            else if (compact_)
+            {
                 ++(*compact_it_);
+            }
             else if (sparse_it_)
+            {
                 ++(*sparse_it_);
+            }
 
             return *this;
         }
 
         bool operator!=(const Iterator &rhs) const
         {
-            if (compact_ != rhs.compact_)
+            if (array_ != rhs.array_ || compact_ != rhs.compact_)
                 return true;
 
+            if (array_)
+                return pos_ != rhs.pos_;
+
             if (compact_)
                 return *compact_it_ != *rhs.compact_it_;
             else
@@ -91,12 +181,29 @@ public:
 
     void reserve_compact_storage(uint32_t count);
 
+    /**
+     * @return Element kind.
+     */
+    inline Kind kind() const
+    {
+        return kind_;
+    }
+
+    /**
+     * @return true if the array is in generic storage mode, false if the
+     *         elements are kept in packed or holey storage.
+     */
+    inline bool is_generic() const
+    {
+        return kind_ == KIND_GENERIC;
+    }
+
     /**
      * @return true if the array is in compact storage mode.
      */
     inline bool is_compact() const
     {
-        return compact_;
+        return kind_ != KIND_GENERIC || compact_;
     }
 
     /**
@@ -104,6 +211,9 @@ public:
      */
     inline bool empty() const
     {
+        if (kind_ != KIND_GENERIC)
+            return size_ == 0;
+
         return compact_ ? compact_storage_.empty() : sparse_storage_.empty();
     }
 
@@ -112,16 +222,101 @@ public:
      */
     inline uint32_t count() const
     {
+        if (kind_ != KIND_GENERIC)
+            return size_ - holes_;
+
         return compact_ ? compact_storage_.count() : sparse_storage_.count();
     }
 
     /**
-     * Gets a property at a given index.
+     * Checks if an element exists in packed or holey storage.
+     * @param [in] index Element index.
+     * @return true if there is an element at index.
+     * @pre Array is not in generic mode.
+     */
+    inline bool contains(uint32_t index) const
+    {
+        assert(kind_ != KIND_GENERIC);
+        if (index >= size_)
+            return false;
+
+        return kind_ != KIND_HOLEY || !values_[index].is_nothing();
+    }
+
+    /**
+     * Gets an element value from packed or holey storage.
+     * @param [in] index Element index.
+     * @param [out] v Element value.
+     * @return true if there is an element at index, false otherwise.
+     * @pre Array is not in generic mode.
+     */
+    inline bool get_value(uint32_t index, EsValue &v) const
+    {
+        assert(kind_ != KIND_GENERIC);
+        if (index >= size_)
+            return false;
+
+        if (kind_ == KIND_PACKED_DOUBLE)
+        {
+            v = EsValue::from_num(doubles_[index]);
+            return true;
+        }
+
+        if (values_[index].is_nothing())
+            return false;
+
+        v = values_[index];
+        return true;
+    }
+
+    /**
+     * Sets an element value in packed or holey storage. The element becomes
+     * a writable, enumerable and configurable data property. This might
+     * switch the array into generic storage mode if the array becomes too
+     * sparse.
+     * @param [in] index Element index.
+     * @param [in] v Element value.
+     * @pre Array is not in generic mode.
+     */
+    inline void set_value(uint32_t index, const EsValue &v)
+    {
+        assert(kind_ != KIND_GENERIC);
+        if (index < size_)
+        {
+            if (kind_ == KIND_PACKED_DOUBLE)
+            {
+                if (v.is_number())
+                {
+                    doubles_[index] = v.as_number();
+                    return;
+                }
+            }
+            else if (kind_ == KIND_PACKED || !values_[index].is_nothing())
+            {
+                values_[index] = v;
+                return;
+            }
+        }
+
+        set_value_slow(index, v);
+    }
+
+    /**
+     * Gets a property at a given index. If the array is in packed or holey
+     * mode and the element exists, the array is switched to generic storage.
      * @param [in] index Property index.
      * @return Property at index, or NULL if no property exist at index.
      */
     inline EsProperty *get(uint32_t index)
     {
+        if (kind_ != KIND_GENERIC)
+        {
+            if (!contains(index))
+                return NULL;
+
+            switch_to_generic_storage();
+        }
+
         return compact_ ? compact_storage_.get(index) : sparse_storage_.get(index);
     }
 
@@ -136,10 +331,7 @@ public:
      * Removes a property at the given index.
      * @param [in] index Property index.
      */
-    inline void remove(uint32_t index)
-    {
-        return compact_ ? compact_storage_.remove(index) : sparse_storage_.remove(index);
-    }
+    void remove(uint32_t index);
 
     inline EsProperty *operator[](size_t index)
     {
@@ -148,6 +340,8 @@ public:
 
     inline Iterator begin()
     {
+        if (kind_ != KIND_GENERIC)
+            return Iterator(this, 0);
         if (compact_)
             return Iterator(compact_storage_.begin());
         else
@@ -156,6 +350,8 @@ public:
 
     inline Iterator end()
     {
+        if (kind_ != KIND_GENERIC)
+            return Iterator(this, size_);
         if (compact_)
             return Iterator(compact_storage_.end());
         else
@@ -164,6 +360,8 @@ public:
 
     inline const Iterator begin() const
     {
+        if (kind_ != KIND_GENERIC)
+            return Iterator(this, 0);
         if (compact_)
             return Iterator(compact_storage_.begin());
         else
@@ -172,6 +370,8 @@ public:
 
     inline const Iterator end() const
     {
+        if (kind_ != KIND_GENERIC)
+            return Iterator(this, size_);
         if (compact_)
             return Iterator(compact_storage_.end());
         else
@@ -24,11 +24,18 @@ EsPropertyKeySet property_keys;
 
 EsPropertyKey EsPropertyKey::from_str(const EsString *str)
 {
+    uint64_t key = str->cached_key();
+    if (key != EsString::NO_KEY)
+        return EsPropertyKey(key);
+
     uint32_t index = 0;
-    if (es_str_to_index(str->str(), index))
-        return from_u32(index);
+    if (es_str_to_index(str->data(), str->length(), index))
+        key = index;
+    else
+        key = static_cast<uint64_t>(IS_STRING) | strings().intern(str);
 
-    return EsPropertyKey(static_cast<uint64_t>(IS_STRING) | strings().intern(str));
+    str->cache_key(key);
+    return EsPropertyKey(key);
 }
 
 EsPropertyKey EsPropertyKey::from_u32(uint32_t i)
@@ -41,7 +48,7 @@ const EsString *EsPropertyKey::to_string() const
     if (is_string())
         return as_string();
 
-    return EsString::create_from_utf8(std::to_string(as_index()));
+    return es_uint_to_str(as_index());
 }
 
 void EsPropertyKeySet::initialize()
@@ -20,6 +20,7 @@
 #include <cassert>
 #include "common/string.hh"
 #include "container.hh"
+#include "property_array.hh"
 
 class EsObject;
 class EsProperty;
@@ -42,7 +43,10 @@ private:
         SLOTTED,
 
         /** Property is owned by the reference. */
-        IMMEDIATE
+        IMMEDIATE,
+
+        /** Property is an element in a property array. */
+        ELEMENT
     } kind_;
 
     union
@@ -57,6 +61,12 @@ private:
         {
             EsProperty *property_;
         } immediate;
+
+        struct
+        {
+            EsPropertyArray *array_;
+            uint32_t index_;
+        } element;
     };
 
     EsObject *base_;    ///< Base object.
@@ -100,6 +110,21 @@ public:
         immediate.property_ = property;
     }
 
+    /**
+     * Constructs a new element reference.
+     * @param [in] base Base object.
+     * @param [in] array Property array.
+     * @param [in] index Element index.
+     */
+    inline EsPropertyReference(EsObject *base, EsPropertyArray *array,
+                               uint32_t index)
+        : kind_(ELEMENT)
+        , base_(base)
+    {
+        element.array_ = array;
+        element.index_ = index;
+    }
+
     /**
      * @return true if the property reference can be cached and false if it
      *         cannot be cached.
@@ -119,6 +144,47 @@ public:
         return slotted.slot_;
     }
 
+    /**
+     * Checks if the reference refers to an element in packed or holey
+     * storage. Such elements are always writable, enumerable and
+     * configurable data properties and can be accessed through
+     * element_value() and set_element_value() without switching the array
+     * into generic storage, which accessing the property through the
+     * reference operators does.
+     * @return true if the reference refers to an element in packed or holey
+     *         storage.
+     */
+    inline bool is_element() const
+    {
+        return kind_ == ELEMENT && !element.array_->is_generic();
+    }
+
+    /**
+     * @return Element value, undefined if the element has been removed.
+     * @pre is_element() returns true.
+     */
+    inline EsValue element_value() const
+    {
+        assert(is_element());
+
+        EsValue v;
+        if (!element.array_->get_value(element.index_, v))
+            return EsValue::undefined;
+
+        return v;
+    }
+
+    /**
+     * Updates the element value.
+     * @param [in] v New element value.
+     * @pre is_element() returns true.
+     */
+    inline void set_element_value(const EsValue &v)
+    {
+        assert(is_element());
+        element.array_->set_value(element.index_, v);
+    }
+
     /**
      * @return Reference base object.
      */
@@ -141,6 +207,8 @@ public:
                 return EsPropertyReference(base, storage, slotted.slot_);
             case IMMEDIATE:
                 return EsPropertyReference(base, immediate.property_);
+            case ELEMENT:
+                return EsPropertyReference(base, element.array_, element.index_);
             default:
                 return *this;
         }
@@ -159,6 +227,8 @@ public:
                 return &(*slotted.storage_)[slotted.slot_];
             case IMMEDIATE:
                 return immediate.property_;
+            case ELEMENT:
+                return element.array_->get(element.index_);
             default:
                 assert(false);
                 return NULL;
@@ -176,6 +246,8 @@ public:
                 return &(*slotted.storage_)[slotted.slot_];
             case IMMEDIATE:
                 return immediate.property_;
+            case ELEMENT:
+                return element.array_->get(element.index_);
             default:
                 assert(false);
                 return NULL;
@@ -193,6 +265,8 @@ public:
                 return (*slotted.storage_)[slotted.slot_];
             case IMMEDIATE:
                 return *immediate.property_;
+            case ELEMENT:
+                return *element.array_->get(element.index_);
             default:
                 assert(false);
                 return *immediate.property_;
@@ -210,6 +284,8 @@ public:
                 return (*slotted.storage_)[slotted.slot_];
             case IMMEDIATE:
                 return *immediate.property_;
+            case ELEMENT:
+                return *element.array_->get(element.index_);
             default:
                 assert(false);
                 return *immediate.property_;
@@ -243,6 +319,9 @@ public:
                        slotted.slot_ == rhs.slotted.slot_;
             case IMMEDIATE:
                 return immediate.property_ == rhs.immediate.property_;
+            case ELEMENT:
+                return element.array_ == rhs.element.array_ &&
+                       element.index_ == rhs.element.index_;
             default:
                 assert(false);
                 return false;
@@ -0,0 +1,439 @@
+/*
+ * descripten - ECMAScript to native compiler
+ * Copyright (C) 2011-2014 Christian Kindahl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cassert>
+#include <gc_cpp.h>
+#include "property_key.hh"
+#include "resolver.hh"
+#include "string.hh"
+
+Resolver::ResolvedFunction::ResolvedFunction(parser::FunctionLiteral *fun)
+    : fun_(fun)
+    , tainted_by_eval_(false)
+{
+    StringVector::const_iterator it_prm;
+    for (it_prm = fun->parameters().begin(); it_prm != fun->parameters().end(); ++it_prm)
+        names_.insert(*it_prm);
+
+    parser::DeclarationVector::const_iterator it_decl;
+    for (it_decl = fun->declarations().begin(); it_decl != fun->declarations().end(); ++it_decl)
+        names_.insert((*it_decl)->name());
+}
+
+int Resolver::ResolvedFunction::slot(const String &name)
+{
+    assert(has_binding(name));
+
+    SlotMap::iterator it = slots_.find(name);
+    if (it != slots_.end())
+        return it->second;
+
+    int slot = fun_->push_slot(name);
+    slots_.insert(std::make_pair(name, slot));
+    return slot;
+}
+
+Resolver::Resolver()
+    : root_(NULL)
+    , static_root_(false)
+    , resolve_(false)
+{
+}
+
+Resolver::ResolvedFunction *Resolver::lookup(parser::FunctionLiteral *fun)
+{
+    ResolvedFunctionMap::iterator it = functions_.find(fun);
+    if (it == functions_.end())
+        return NULL;
+
+    return &it->second;
+}
+
+void Resolver::resolve_ident(parser::IdentifierLiteral *lit)
+{
+    EsIdentifierSite *site = new (GC)EsIdentifierSite();
+    site->key = EsPropertyKey::from_str(EsString::create(lit->value())).as_raw();
+    lit->set_site(site);
+
+    // The arguments binding is created on demand and eval must always be
+    // resolved by name to detect direct calls.
+    if (lit->value() == _USTR("arguments") || lit->value() == _USTR("eval"))
+        return;
+
+    // Function scopes are reached at run time by following the scope of the
+    // callee, so once we have left the innermost function only function
+    // scopes may be passed.
+    int depth = 0;
+
+    LexicalEnvironmentVector::reverse_iterator it = lex_envs_.rbegin();
+    for (; it != lex_envs_.rend(); ++it)
+    {
+        const LexicalEnvironment &env = *it;
+        switch (env.type())
+        {
+            case LexicalEnvironment::TYPE_FUNCTION:
+            {
+                parser::FunctionLiteral *fun = env.function();
+                if (fun == root_ && !static_root_)
+                    return;
+
+                ResolvedFunction *res = lookup(fun);
+                assert(res);
+
+                if (res->tainted_by_eval())
+                    return;
+
+                if (res->has_binding(lit->value()))
+                {
+                    lit->resolve(depth, res->slot(lit->value()));
+                    return;
+                }
+
+                depth++;
+                break;
+            }
+
+            case LexicalEnvironment::TYPE_WITH:
+                return;
+
+            case LexicalEnvironment::TYPE_CATCH:
+                if (depth > 0 || env.name() == lit->value())
+                    return;
+                break;
+
+            case LexicalEnvironment::TYPE_CALLEE:
+                return;
+        }
+    }
+}
+
+void Resolver::visit_fun(parser::FunctionLiteral *lit)
+{
+    if (!resolve_)
+        functions_.insert(std::make_pair(lit, ResolvedFunction(lit)));
+
+    lex_envs_.push_back(LexicalEnvironment(LexicalEnvironment::TYPE_FUNCTION, lit));
+
+    // Variable declarations are dealt with in ResolvedFunction.
+    parser::DeclarationVector::const_iterator it_decl;
+    for (it_decl = lit->declarations().begin(); it_decl != lit->declarations().end(); ++it_decl)
+    {
+        const parser::Declaration *decl = *it_decl;
+        if (decl->is_function())
+            visit(decl->as_function());
+    }
+
+    parser::StatementVector::const_iterator it_stmt;
+    for (it_stmt = lit->body().begin(); it_stmt != lit->body().end(); ++it_stmt)
+        visit(*it_stmt);
+
+    lex_envs_.pop_back();
+}
+
+void Resolver::visit_binary_expr(parser::BinaryExpression *expr)
+{
+    visit(expr->left());
+    visit(expr->right());
+}
+
+void Resolver::visit_unary_expr(parser::UnaryExpression *expr)
+{
+    visit(expr->expression());
+}
+
+void Resolver::visit_assign_expr(parser::AssignmentExpression *expr)
+{
+    visit(expr->lhs());
+    visit(expr->rhs());
+}
+
+void Resolver::visit_cond_expr(parser::ConditionalExpression *expr)
+{
+    visit(expr->condition());
+    visit(expr->left());
+    visit(expr->right());
+}
+
+void Resolver::visit_prop_expr(parser::PropertyExpression *expr)
+{
+    visit(expr->key());
+    visit(expr->object());
+}
+
+void Resolver::visit_call_expr(parser::CallExpression *expr)
+{
+    parser::ExpressionVector::const_iterator it;
+    for (it = expr->arguments().begin(); it != expr->arguments().end(); ++it)
+        visit(*it);
+
+    visit(expr->expression());
+}
+
+void Resolver::visit_call_new_expr(parser::CallNewExpression *expr)
+{
+    parser::ExpressionVector::const_iterator it;
+    for (it = expr->arguments().begin(); it != expr->arguments().end(); ++it)
+        visit(*it);
+
+    visit(expr->expression());
+}
+
+void Resolver::visit_regular_expr(parser::RegularExpression *expr)
+{
+}
+
+void Resolver::visit_fun_expr(parser::FunctionExpression *expr)
+{
+    visit(const_cast<parser::FunctionLiteral *>(expr->function()));
+}
+
+void Resolver::visit_this_lit(parser::ThisLiteral *lit)
+{
+}
+
+void Resolver::visit_ident_lit(parser::IdentifierLiteral *lit)
+{
+    assert(!lex_envs_.empty());
+
+    if (resolve_)
+    {
+        resolve_ident(lit);
+        return;
+    }
+
+    // A call to eval may declare new variables in the scope of the innermost
+    // function.
+    if (lit->value() == _USTR("eval"))
+    {
+        LexicalEnvironmentVector::reverse_iterator it = lex_envs_.rbegin();
+        for (; it != lex_envs_.rend(); ++it)
+        {
+            if (it->type() == LexicalEnvironment::TYPE_FUNCTION)
+            {
+                lookup(it->function())->set_tainted_by_eval();
+                break;
+            }
+        }
+    }
+}
+
+void Resolver::visit_null_lit(parser::NullLiteral *lit)
+{
+}
+
+void Resolver::visit_bool_lit(parser::BoolLiteral *lit)
+{
+}
+
+void Resolver::visit_num_lit(parser::NumberLiteral *lit)
+{
+}
+
+void Resolver::visit_str_lit(parser::StringLiteral *lit)
+{
+}
+
+void Resolver::visit_fun_lit(parser::FunctionLiteral *lit)
+{
+    // Named function expressions bind their name in a scope of their own,
+    // between the function scope and the scope the function was created in.
+    bool has_callee_env = lit->type() == parser::FunctionLiteral::TYPE_EXPRESSION &&
+                          !lit->name().empty();
+    if (has_callee_env)
+        lex_envs_.push_back(LexicalEnvironment(LexicalEnvironment::TYPE_CALLEE, lit->name()));
+
+    visit_fun(lit);
+
+    if (has_callee_env)
+        lex_envs_.pop_back();
+}
+
+void Resolver::visit_var_lit(parser::VariableLiteral *lit)
+{
+    // Dealt with in ResolvedFunction.
+}
+
+void Resolver::visit_array_lit(parser::ArrayLiteral *lit)
+{
+    parser::ExpressionVector::const_iterator it;
+    for (it = lit->values().begin(); it != lit->values().end(); ++it)
+        visit(*it);
+}
+
+void Resolver::visit_obj_lit(parser::ObjectLiteral *lit)
+{
+    parser::ObjectLiteral::PropertyVector::const_iterator it;
+    for (it = lit->properties().begin(); it != lit->properties().end(); ++it)
+    {
+        const parser::ObjectLiteral::Property *prop = *it;
+
+        if (prop->type() == parser::ObjectLiteral::Property::DATA)
+            visit(prop->key());
+
+        visit(prop->value());
+    }
+}
+
+void Resolver::visit_nothing_lit(parser::NothingLiteral *lit)
+{
+}
+
+void Resolver::visit_empty_stmt(parser::EmptyStatement *stmt)
+{
+}
+
+void Resolver::visit_expr_stmt(parser::ExpressionStatement *stmt)
+{
+    visit(stmt->expression());
+}
+
+void Resolver::visit_block_stmt(parser::BlockStatement *stmt)
+{
+    parser::StatementVector::const_iterator it_stmt;
+    for (it_stmt = stmt->body().begin(); it_stmt != stmt->body().end(); ++it_stmt)
+        visit(*it_stmt);
+}
+
+void Resolver::visit_if_stmt(parser::IfStatement *stmt)
+{
+    visit(stmt->condition());
+    visit(stmt->if_statement());
+
+    if (stmt->has_else())
+        visit(stmt->else_statement());
+}
+
+void Resolver::visit_do_while_stmt(parser::DoWhileStatement *stmt)
+{
+    visit(stmt->body());
+
+    if (stmt->has_condition())
+        visit(stmt->condition());
+}
+
+void Resolver::visit_while_stmt(parser::WhileStatement *stmt)
+{
+    visit(stmt->condition());
+    visit(stmt->body());
+}
+
+void Resolver::visit_for_in_stmt(parser::ForInStatement *stmt)
+{
+    visit(stmt->enumerable());
+    visit(stmt->declaration());
+    visit(stmt->body());
+}
+
+void Resolver::visit_for_stmt(parser::ForStatement *stmt)
+{
+    if (stmt->has_initializer())
+        visit(stmt->initializer());
+
+    if (stmt->has_condition())
+        visit(stmt->condition());
+
+    visit(stmt->body());
+
+    if (stmt->has_next())
+        visit(stmt->next());
+}
+
+void Resolver::visit_cont_stmt(parser::ContinueStatement *stmt)
+{
+}
+
+void Resolver::visit_break_stmt(parser::BreakStatement *stmt)
+{
+}
+
+void Resolver::visit_ret_stmt(parser::ReturnStatement *stmt)
+{
+    if (stmt->has_expression())
+        visit(stmt->expression());
+}
+
+void Resolver::visit_with_stmt(parser::WithStatement *stmt)
+{
+    visit(stmt->expression());
+
+    lex_envs_.push_back(LexicalEnvironment(LexicalEnvironment::TYPE_WITH, String()));
+    visit(stmt->body());
+    lex_envs_.pop_back();
+}
+
+void Resolver::visit_switch_stmt(parser::SwitchStatement *stmt)
+{
+    visit(stmt->expression());
+
+    parser::SwitchStatement::CaseClauseVector::const_iterator it;
+    for (it = stmt->cases().begin(); it != stmt->cases().end(); ++it)
+    {
+        const parser::SwitchStatement::CaseClause *clause = *it;
+
+        if (!clause->is_default())
+            visit(clause->label());
+
+        parser::StatementVector::const_iterator it_stmt;
+        for (it_stmt = clause->body().begin(); it_stmt != clause->body().end(); ++it_stmt)
+            visit(*it_stmt);
+    }
+}
+
+void Resolver::visit_throw_stmt(parser::ThrowStatement *stmt)
+{
+    visit(stmt->expression());
+}
+
+void Resolver::visit_try_stmt(parser::TryStatement *stmt)
+{
+    visit(stmt->try_block());
+
+    if (stmt->has_catch_block())
+    {
+        lex_envs_.push_back(LexicalEnvironment(LexicalEnvironment::TYPE_CATCH,
+                                               stmt->catch_identifier()));
+        visit(stmt->catch_block());
+        lex_envs_.pop_back();
+    }
+
+    if (stmt->has_finally_block())
+        visit(stmt->finally_block());
+}
+
+void Resolver::visit_dbg_stmt(parser::DebuggerStatement *stmt)
+{
+}
+
+void Resolver::resolve(parser::FunctionLiteral *root, bool static_root)
+{
+    assert(root);
+    assert(lex_envs_.empty());
+
+    functions_.clear();
+
+    root_ = root;
+    static_root_ = static_root;
+
+    // The first pass finds the functions that call eval, the second pass
+    // resolves the identifiers.
+    resolve_ = false;
+    visit_fun(root);
+
+    resolve_ = true;
+    visit_fun(root);
+}
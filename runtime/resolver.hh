@@ -0,0 +1,211 @@
+/*
+ * descripten - ECMAScript to native compiler
+ * Copyright (C) 2011-2014 Christian Kindahl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <map>
+#include <set>
+#include <vector>
+#include <gc/gc_allocator.h>    // NOTE: 3rd party.
+#include "common/string.hh"
+#include "parser/ast.hh"
+#include "parser/visitor.hh"
+#include "operation.h"
+
+class EsLexicalEnvironment;
+
+/**
+ * @brief Run-time data of an identifier access site in evaluated code.
+ *
+ * Parsed code may be shared by several scopes, see EsProgramCache. The
+ * context cache only holds for the scope it was filled in, so it's tagged
+ * with the environment the code was entered from and flushed when the site
+ * is reached from another one.
+ */
+struct EsIdentifierSite
+{
+    uint64_t key;           ///< Raw property key of the identifier.
+    EsContextCache cache;   ///< Context cache used when the identifier isn't statically resolved.
+    EsLexicalEnvironment *scope;    ///< Environment the context cache was filled from.
+};
+
+/**
+ * @brief Resolves identifiers in code parsed at runtime.
+ *
+ * Every identifier literal is given an access site holding its property key
+ * and a context cache. Identifiers referring to parameters or declarations
+ * of an enclosing function are in addition resolved to a (depth, slot) pair,
+ * as long as no with statement, catch clause, callee binding or call to
+ * eval can come between the reference and the binding at run time.
+ */
+class Resolver : public parser::Visitor
+{
+private:
+    /**
+     * @brief Data collected on functions.
+     */
+    class ResolvedFunction
+    {
+    public:
+        typedef std::set<String, std::less<String>,
+                         gc_allocator<String> > NameSet;
+        typedef std::map<String, int, std::less<String>,
+                         gc_allocator<std::pair<const String, int> > > SlotMap;
+
+    private:
+        parser::FunctionLiteral *fun_;
+        NameSet names_;     ///< Names of parameters and declarations.
+        SlotMap slots_;     ///< Allocated slots.
+
+        /** true if the function body calls eval, which might introduce new
+         * bindings in the function scope. */
+        bool tainted_by_eval_;
+
+    public:
+        ResolvedFunction(parser::FunctionLiteral *fun);
+
+        bool tainted_by_eval() const
+        {
+            return tainted_by_eval_;
+        }
+
+        void set_tainted_by_eval()
+        {
+            tainted_by_eval_ = true;
+        }
+
+        bool has_binding(const String &name) const
+        {
+            return names_.count(name) > 0;
+        }
+
+        /**
+         * Returns the slot of a binding, allocating one if necessary.
+         * @param [in] name Name of parameter or declaration.
+         * @return Slot index.
+         */
+        int slot(const String &name);
+    };
+
+    typedef std::map<parser::FunctionLiteral *, ResolvedFunction,
+                     std::less<parser::FunctionLiteral *>,
+                     gc_allocator<std::pair<parser::FunctionLiteral * const,
+                                            ResolvedFunction> > > ResolvedFunctionMap;
+
+    /**
+     * @brief Object representing a lexical environment.
+     */
+    class LexicalEnvironment
+    {
+    public:
+        enum Type
+        {
+            TYPE_FUNCTION,  ///< Function scope.
+            TYPE_WITH,      ///< With statement scope.
+            TYPE_CATCH,     ///< Catch clause scope.
+            TYPE_CALLEE     ///< Scope binding the name of a function expression.
+        };
+
+    private:
+        Type type_;
+        parser::FunctionLiteral *fun_;  ///< Function literal, only valid for function scopes.
+        String name_;                   ///< Bound name, only valid for catch and callee scopes.
+
+    public:
+        LexicalEnvironment(Type type, parser::FunctionLiteral *fun)
+            : type_(type)
+            , fun_(fun) {}
+
+        LexicalEnvironment(Type type, const String &name)
+            : type_(type)
+            , fun_(NULL)
+            , name_(name) {}
+
+        Type type() const { return type_; }
+        parser::FunctionLiteral *function() const { return fun_; }
+        const String &name() const { return name_; }
+    };
+
+    typedef std::vector<LexicalEnvironment, gc_allocator<LexicalEnvironment> > LexicalEnvironmentVector;
+    LexicalEnvironmentVector lex_envs_;
+
+private:
+    ResolvedFunctionMap functions_;
+
+    parser::FunctionLiteral *root_; ///< Root function of the program.
+    bool static_root_;              ///< true if the root function scope is static.
+    bool resolve_;                  ///< false while looking for eval taints.
+
+    ResolvedFunction *lookup(parser::FunctionLiteral *fun);
+
+    void resolve_ident(parser::IdentifierLiteral *lit);
+
+private:
+    void visit_fun(parser::FunctionLiteral *lit);
+
+    virtual void visit_binary_expr(parser::BinaryExpression *expr) override;
+    virtual void visit_unary_expr(parser::UnaryExpression *expr) override;
+    virtual void visit_assign_expr(parser::AssignmentExpression *expr) override;
+    virtual void visit_cond_expr(parser::ConditionalExpression *expr) override;
+    virtual void visit_prop_expr(parser::PropertyExpression *expr) override;
+    virtual void visit_call_expr(parser::CallExpression *expr) override;
+    virtual void visit_call_new_expr(parser::CallNewExpression *expr) override;
+    virtual void visit_regular_expr(parser::RegularExpression *expr) override;
+    virtual void visit_fun_expr(parser::FunctionExpression *expr) override;
+
+    virtual void visit_this_lit(parser::ThisLiteral *lit) override;
+    virtual void visit_ident_lit(parser::IdentifierLiteral *lit) override;
+    virtual void visit_null_lit(parser::NullLiteral *lit) override;
+    virtual void visit_bool_lit(parser::BoolLiteral *lit) override;
+    virtual void visit_num_lit(parser::NumberLiteral *lit) override;
+    virtual void visit_str_lit(parser::StringLiteral *lit) override;
+    virtual void visit_fun_lit(parser::FunctionLiteral *lit) override;
+    virtual void visit_var_lit(parser::VariableLiteral *lit) override;
+    virtual void visit_array_lit(parser::ArrayLiteral *lit) override;
+    virtual void visit_obj_lit(parser::ObjectLiteral *lit) override;
+    virtual void visit_nothing_lit(parser::NothingLiteral *lit) override;
+
+    virtual void visit_empty_stmt(parser::EmptyStatement *stmt) override;
+    virtual void visit_expr_stmt(parser::ExpressionStatement *stmt) override;
+    virtual void visit_block_stmt(parser::BlockStatement *stmt) override;
+    virtual void visit_if_stmt(parser::IfStatement *stmt) override;
+    virtual void visit_do_while_stmt(parser::DoWhileStatement *stmt) override;
+    virtual void visit_while_stmt(parser::WhileStatement *stmt) override;
+    virtual void visit_for_in_stmt(parser::ForInStatement *stmt) override;
+    virtual void visit_for_stmt(parser::ForStatement *stmt) override;
+    virtual void visit_cont_stmt(parser::ContinueStatement *stmt) override;
+    virtual void visit_break_stmt(parser::BreakStatement *stmt) override;
+    virtual void visit_ret_stmt(parser::ReturnStatement *stmt) override;
+    virtual void visit_with_stmt(parser::WithStatement *stmt) override;
+    virtual void visit_switch_stmt(parser::SwitchStatement *stmt) override;
+    virtual void visit_throw_stmt(parser::ThrowStatement *stmt) override;
+    virtual void visit_try_stmt(parser::TryStatement *stmt) override;
+    virtual void visit_dbg_stmt(parser::DebuggerStatement *stmt) override;
+
+public:
+    Resolver();
+
+    /**
+     * Resolves all identifiers in a program.
+     * @param [in] root Root function of the program.
+     * @param [in] static_root true if the root function is executed in a
+     *                         function scope of its own, false for eval code
+     *                         which shares the variable environment of its
+     *                         caller.
+     */
+    void resolve(parser::FunctionLiteral *root, bool static_root);
+};
@@ -28,6 +28,7 @@ EsShape::EsShape()
     , slot_(INVALID_SLOT)
     , depth_(0)
     , transitions_(DEFAULT_TRANSITION_MAP_SIZE)
+    , table_(NULL)
 {
 }
 
@@ -37,6 +38,7 @@ EsShape::EsShape(EsShape *parent, const EsPropertyKey &key, size_t slot)
     , slot_(slot)
     , depth_(parent->depth() + 1)
     , transitions_(DEFAULT_TRANSITION_MAP_SIZE)
+    , table_(NULL)
 {
 }
 
@@ -92,6 +94,28 @@ void EsShape::clear_transitions()
     transitions_.clear();
 }
 
+void EsShape::create_table() const
+{
+    assert(!table_);
+    LookupTable *table = new (GC)LookupTable();
+    table->reserve(depth_);
+
+    const EsShape *shape = this;
+    for (; shape != EsShape::root(); shape = shape->parent_)
+    {
+        // Copy the remaining keys from the closest ancestor having a table.
+        if (shape->table_)
+        {
+            table->insert(shape->table_->begin(), shape->table_->end());
+            break;
+        }
+
+        table->insert(std::make_pair(shape->key_, shape));
+    }
+
+    table_ = table;
+}
+
 EsShape *EsShape::add(const EsPropertyKey &key, size_t slot)
 {
     TransitionMap::iterator it = transitions_.find(key);
@@ -152,11 +176,28 @@ EsShape *EsShape::remove(const EsPropertyKey &key)
 
 const EsShape *EsShape::lookup(const EsPropertyKey &key) const
 {
+    size_t num_searched = 0;
     for (const EsShape *shape = this; shape && shape != EsShape::root();
         shape = shape->parent_)
     {
+        if (shape->table_)
+        {
+            LookupTable::const_iterator it = shape->table_->find(key);
+            return it != shape->table_->end() ? it->second : NULL;
+        }
+
         if (shape->key_ == key)
             return shape;
+
+        // Searching long shape chains is expensive, create a table that
+        // will be shared by all objects with this shape.
+        if (++num_searched == MAX_NUM_LINEAR_LOOKUP)
+        {
+            create_table();
+
+            LookupTable::const_iterator it = table_->find(key);
+            return it != table_->end() ? it->second : NULL;
+        }
     }
 
     return NULL;
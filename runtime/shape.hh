@@ -31,12 +31,17 @@ class EsShape
 #ifdef UNITTEST
 public:
     friend class ShapeTestSuite;
+    friend class MapTestSuite;
 #endif
 
 public:
     /** Unallocated slot, or used to signal that a lookup failed. */
     static const size_t INVALID_SLOT = -1;
 
+    /** Maximum number of shapes to search linearly when looking up a key
+     * before creating a lookup table. */
+    static const size_t MAX_NUM_LINEAR_LOOKUP = 10;
+
 private:
     /**
      * @brief Class transition.
@@ -59,6 +64,16 @@ private:
     void remove_transition(const EsPropertyKey &key);
     void clear_transitions();
 
+    typedef std::unordered_map<EsPropertyKey, const EsShape *, EsPropertyKey::Hash,
+                               std::equal_to<EsPropertyKey>,
+                               gc_allocator<std::pair<EsPropertyKey, const EsShape *> > > LookupTable;
+
+    /**
+     * Creates a lookup table containing all keys from this shape up to the
+     * root.
+     */
+    void create_table() const;
+
 private:
     typedef std::vector<EsShape *, gc_allocator<EsShape *> > EsShapeVector;
 
@@ -71,6 +86,11 @@ private:
 
     TransitionMap transitions_; ///< List of property transitions.
 
+    /** Lookup table mapping each key in the shape chain to its shape, shared
+     * by all objects having this shape. Only created for deep shapes.
+     * @see MAX_NUM_LINEAR_LOOKUP */
+    mutable LookupTable *table_;
+
     /**
      * Constructs a new root shape.
      */
@@ -45,8 +45,6 @@
 #include "unique.hh"
 #include "uri.hh"
 
-using parser::StringStream;
-
 ES_API_FUN(es_std_print)
 {
     EsCallFrame frame = EsCallFrame::wrap(argc, fp, vp);
@@ -409,7 +407,7 @@ ES_API_FUN(es_std_parse_float)
     if (!input_str)
         return false;
 
-    const uni_char *input_str_ptr = input_str->data();  // WARNING: May return NULL for empty strings.
+    const uni_char *input_str_ptr = input_str->c_str();
     es_str_skip_white_spaces(input_str_ptr);
 
     if (!input_str_ptr || !*input_str_ptr)
@@ -436,7 +434,7 @@ ES_API_FUN(es_std_parse_int)
     if (!input_str)
         return false;
 
-    const uni_char *input_ptr = input_str->data();  // WARNING: May return NULL for empty strings.
+    const uni_char *input_ptr = input_str->c_str();
     es_str_skip_white_spaces(input_ptr);
 
     if (!input_ptr || !*input_ptr)
@@ -661,7 +659,7 @@ ES_API_FUN(es_std_arr_proto_to_locale_str)
 static bool es_std_arr_proto_concat_value(EsArray *a, const EsValue &v, uint32_t &n)
 {
     EsObject *v_obj = NULL;
-    if (es_as_object(v, v_obj, "Array"))
+    if (es_as_object(v, v_obj, EsObject::CLASS_ARRAY))
     {
         EsValue len_val;
         if (!v_obj->getT(property_keys.length, len_val))
@@ -1858,7 +1856,7 @@ ES_API_FUN(es_std_arr_constr_is_arr)
 
     EsObject *o = arg.as_object();
     
-    frame.set_result(EsValue::from_bool(o->class_name() == _USTR("Array")));
+    frame.set_result(EsValue::from_bool(o->class_id() == EsObject::CLASS_ARRAY));
     return true;
 }
 
@@ -2625,8 +2623,7 @@ ES_API_FUN(es_std_json_parse)
     if (!text_str)
         return false;
 
-    StringStream jtext(text_str->str());
-    JsonParser parser(jtext);
+    JsonParser parser(text_str);
 
     EsValue unfiltered;
     if (!parser.parse(unfiltered))
@@ -2668,7 +2665,7 @@ ES_API_FUN(es_std_json_stringify)
 
         state.replacer_fun = dynamic_cast<EsFunction *>(replacer_obj);
 
-        if (!state.replacer_fun && replacer_obj->class_name() == _USTR("Array"))
+        if (!state.replacer_fun && replacer_obj->class_id() == EsObject::CLASS_ARRAY)
         {
             std::vector<uint32_t> indexes;
 
@@ -2699,8 +2696,8 @@ ES_API_FUN(es_std_json_stringify)
                     state.prop_list.push_back(v.primitive_to_string());
                 else if (v.is_object())
                 {
-                    String class_name = v.as_object()->class_name();
-                    if (class_name == _USTR("String") || class_name == _USTR("Number"))
+                    EsObject::Class class_id = v.as_object()->class_id();
+                    if (class_id == EsObject::CLASS_STRING || class_id == EsObject::CLASS_NUMBER)
                     {
                         const EsString *v_str = v.to_stringT();
                         if (!v_str)
@@ -3553,7 +3550,7 @@ ES_API_FUN(es_std_obj_proto_prop_is_enum)
         return false;
     
     EsPropertyReference prop = o->get_own_property(EsPropertyKey::from_str(p));
-    frame.set_result(EsValue::from_bool(prop && prop->is_enumerable()));
+    frame.set_result(EsValue::from_bool(prop && (prop.is_element() || prop->is_enumerable())));
     return true;
 }
 
@@ -3750,7 +3747,7 @@ ES_API_FUN(es_std_obj_def_props)
 
         EsPropertyReference it_prop = properties_obj->get_property(key);
         assert(it_prop);
-        if (!it_prop->is_enumerable())
+        if (!it_prop.is_element() && !it_prop->is_enumerable())
             continue;
 
         // FIXME: Double get!?
@@ -3958,7 +3955,7 @@ ES_API_FUN(es_std_obj_keys)
         EsPropertyKey key = *it;
 
         EsPropertyReference prop = o_obj->get_property(key);
-        if (!prop->is_enumerable())
+        if (!prop.is_element() && !prop->is_enumerable())
             continue;
 
         n++;
@@ -5129,7 +5126,7 @@ ES_API_FUN(es_std_reg_exp)
     if (flags.is_undefined() && pattern.is_object())
     {
         EsObject *o = pattern.as_object();
-        if (o->class_name() == _USTR("RegExp"))
+        if (o->class_id() == EsObject::CLASS_REGEXP)
         {
             frame.set_result(EsValue::from_obj(o));
             return true;
@@ -16,6 +16,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <gc.h>
@@ -25,7 +26,7 @@
 #include "string.hh"
 
 EsString::EsString(const uni_char *data, size_t len)
-    : data_(data), len_(len), hash_(0)
+    : data_(data), len_(len), hash_(0), key_(NO_KEY)
 {
 }
 
@@ -43,6 +44,103 @@ EsString *EsString::alloc(size_t len)
     return str;
 }
 
+EsString *EsString::alloc_rope(const EsString *left, const EsString *right)
+{
+    // Rope strings refer to other strings and must be scanned by the garbage
+    // collector.
+    EsString *str = static_cast<EsString *>(
+            GC_MALLOC(sizeof(EsString) + sizeof(Rope)));
+    if (!str)
+        THROW(MemoryException);
+
+    new (str) EsString(NULL, left->len_ + right->len_);
+
+    Rope *rope = str->rope();
+    rope->left_ = left;
+    rope->right_ = right;
+    rope->depth_ = std::max(left->depth(), right->depth() + 1);
+
+    return str;
+}
+
+void EsString::flatten() const
+{
+    assert(!data_);
+
+    uni_char *data = static_cast<uni_char *>(
+            GC_MALLOC_ATOMIC((len_ + 1) * sizeof(uni_char)));
+    if (!data)
+        THROW(MemoryException);
+
+    data[len_] = 0;
+
+    // Copy the strings back to front. Left strings are pushed on the stack
+    // while descending into the right strings, which means that ropes built
+    // by appending need no more than a single stack entry.
+    std::vector<const EsString *> stack;
+    stack.reserve(depth());
+
+    size_t end = len_;
+    const EsString *cur = this;
+    while (true)
+    {
+        if (cur->data_)
+        {
+            end -= cur->len_;
+            memcpy(data + end, cur->data_, cur->len_ * sizeof(uni_char));
+
+            if (stack.empty())
+                break;
+
+            cur = stack.back();
+            stack.pop_back();
+        }
+        else
+        {
+            const Rope *rope = cur->rope();
+            stack.push_back(rope->left_);
+            cur = rope->right_;
+        }
+    }
+
+    assert(end == 0);
+
+    // Release the concatenated strings.
+    Rope *rope = this->rope();
+    rope->left_ = NULL;
+    rope->right_ = NULL;
+
+    data_ = data;
+}
+
+const EsString *EsString::slice(size_t start, size_t len) const
+{
+    assert(start + len <= len_);
+
+    const uni_char *ptr = data();
+    if (len == len_)
+        return this;
+
+    if (len < SLICE_MIN_LENGTH)
+        return create(ptr + start, len);
+
+    // Avoid keeping large strings alive through small slices. The slice will
+    // refer to the same memory as this string so the memory to keep alive
+    // is the full allocation containing the character data.
+    void *base = GC_base(const_cast<uni_char *>(ptr));
+    if (base && GC_size(base) > len * sizeof(uni_char) * SLICE_PIN_FACTOR)
+        return create(ptr + start, len);
+
+    // Slices refer to other memory and must be scanned by the garbage
+    // collector.
+    EsString *str = static_cast<EsString *>(GC_MALLOC(sizeof(EsString)));
+    if (!str)
+        THROW(MemoryException);
+
+    new (str) EsString(ptr + start, len);
+    return str;
+}
+
 const EsString *EsString::create()
 {
     static const EsString *str = create_from_utf8("", 0);
@@ -119,23 +217,45 @@ bool EsString::empty() const
 
 bool EsString::contains(uni_char c) const
 {
+    const uni_char *ptr = data();
     for (size_t i = 0; i < len_; i++)
-        if (data_[i] == c)
+        if (ptr[i] == c)
             return true;
 
     return false;
 }
 
+const uni_char *EsString::c_str() const
+{
+    const uni_char *ptr = data();
+
+    // All strings except slices are NULL-terminated. Slices extending to
+    // the end of their parent string are NULL-terminated as well.
+    if (ptr[len_] == 0)
+        return ptr;
+
+    uni_char *data = static_cast<uni_char *>(
+            GC_MALLOC_ATOMIC((len_ + 1) * sizeof(uni_char)));
+    if (!data)
+        THROW(MemoryException);
+
+    memcpy(data, ptr, len_ * sizeof(uni_char));
+    data[len_] = 0;
+
+    data_ = data;
+    return data_;
+}
+
 String EsString::str() const
 {
-    return String::wrap(data_, len_);
+    return String::wrap(c_str(), len_);
 }
 
 const EsString *EsString::take(size_t num) const
 {
     size_t len = num > len_ ? len_ : num;
     if (len > 0)
-        return EsString::create(data_, len);
+        return slice(0, len);
 
     return create();
 }
@@ -146,7 +266,7 @@ const EsString *EsString::skip(size_t num) const
         return create();
 
     size_t len = len_ - num;
-    return EsString::create(data_ + num, len);
+    return slice(num, len);
 }
 
 const EsString *EsString::substr(size_t start, size_t num) const
@@ -158,16 +278,21 @@ const EsString *EsString::substr(size_t start, size_t num) const
     if (len > num)
         len = num;
 
-    return EsString::create(data_ + start, len);
+    if (len == 0)
+        return create();
+
+    return slice(start, len);
 }
 
 const EsString *EsString::lower() const
 {
+    const uni_char *src = data();
+
     EsString *str = alloc(len_);
 
-    uni_char *data = const_cast<uni_char *>(str->data());
+    uni_char *data = const_cast<uni_char *>(str->data_);
     for (size_t i = 0; i < len_; i++)
-        data[i] = tolower(data_[i]);
+        data[i] = tolower(src[i]);
     data[len_] = 0;
 
     return str;
@@ -175,11 +300,13 @@ const EsString *EsString::lower() const
 
 const EsString *EsString::upper() const
 {
+    const uni_char *src = data();
+
     EsString *str = alloc(len_);
 
-    uni_char *data = const_cast<uni_char *>(str->data());
+    uni_char *data = const_cast<uni_char *>(str->data_);
     for (size_t i = 0; i < len_; i++)
-        data[i] = toupper(data_[i]);
+        data[i] = toupper(src[i]);
     data[len_] = 0;
 
     return str;
@@ -190,11 +317,13 @@ const EsString *EsString::trim(bool (*filter)(uni_char c)) const
     if (len_ == 0)
         return create();
 
+    const uni_char *ptr = data();
+
     // Find start of trimmed string.
     size_t start = 0;
     for (; start < len_; start++)
     {
-        if (!filter(data_[start]))
+        if (!filter(ptr[start]))
             break;
     }
 
@@ -202,7 +331,7 @@ const EsString *EsString::trim(bool (*filter)(uni_char c)) const
     size_t end = len_;
     for (; end-- > 0;)
     {
-        if (!filter(data_[end]))
+        if (!filter(ptr[end]))
             break;
     }
 
@@ -219,11 +348,21 @@ const EsString *EsString::concat(const EsString *other) const
         return other;
     
     size_t len = len_ + other->len_;
+    if (len >= ROPE_MIN_LENGTH)
+    {
+        // Flatten deep right operands to bound the flattening stack depth
+        // of the resulting rope.
+        if (other->depth() >= ROPE_DEPTH_MAX)
+            other->flatten();
+
+        return alloc_rope(this, other);
+    }
+
     EsString *str = alloc(len);
 
     uni_char *data = const_cast<uni_char *>(str->data_);
-    memcpy(data, data_, len_ * sizeof(uni_char));
-    memcpy(data + len_, other->data_, other->len_ * sizeof(uni_char));
+    memcpy(data, this->data(), len_ * sizeof(uni_char));
+    memcpy(data + len_, other->data(), other->len_ * sizeof(uni_char));
     data[len] = 0;
 
     return str;
@@ -237,24 +376,26 @@ ssize_t EsString::index_of(const EsString *str, size_t start) const
     if (start + str->length() > len_)
         return -1;
 
-    const uni_char *cur_ptr = data_ + start;
-    const uni_char *end_ptr = data_ + len_;
+    // The data is not necessarily NULL-terminated so the search must not
+    // start comparing past the last possible match.
+    const uni_char *cur_ptr = data() + start;
+    const uni_char *end_ptr = data() + len_ - str->len_ + 1;
 
     while (cur_ptr != end_ptr)
     {
         const uni_char *cmp_ptr = cur_ptr;
-        const uni_char *str_cur = str->data_;
-        const uni_char *str_end = str->data_ + str->len_;
+        const uni_char *str_cur = str->data();
+        const uni_char *str_end = str->data() + str->len_;
 
-        while (*cmp_ptr == *str_cur &&
-               str_cur != str_end)
+        while (str_cur != str_end &&
+               *cmp_ptr == *str_cur)
         {
             cmp_ptr++;
             str_cur++;
         }
 
         if (str_cur == str_end)
-            return cur_ptr - data_;
+            return cur_ptr - data();
 
         cur_ptr++;
     }
@@ -270,25 +411,27 @@ ssize_t EsString::last_index_of(const EsString *str, size_t start) const
     if (start + str->length() > len_)
         return -1;
 
-    const uni_char *cur_ptr = data_ + start;
-    const uni_char *end_ptr = data_ + len_;
+    // The data is not necessarily NULL-terminated so the search must not
+    // start comparing past the last possible match.
+    const uni_char *cur_ptr = data() + start;
+    const uni_char *end_ptr = data() + len_ - str->len_ + 1;
 
     ssize_t res = -1;
     while (cur_ptr != end_ptr)
     {
         const uni_char *cmp_ptr = cur_ptr;
-        const uni_char *str_cur = str->data_;
-        const uni_char *str_end = str->data_ + str->len_;
+        const uni_char *str_cur = str->data();
+        const uni_char *str_end = str->data() + str->len_;
 
-        while (*cmp_ptr == *str_cur &&
-               str_cur != str_end)
+        while (str_cur != str_end &&
+               *cmp_ptr == *str_cur)
         {
             cmp_ptr++;
             str_cur++;
         }
 
         if (str_cur == str_end)
-            res = cur_ptr - data_;
+            res = cur_ptr - data();
 
         cur_ptr++;
     }
@@ -315,16 +458,18 @@ bool EsString::less(const EsString *other) const
 {
     size_t min = std::min(length(), other->length());
 
-    /*int res = memcmp(data_, other->data_, min * sizeof(uni_char));
+    /*int res = memcmp(data(), other->data(), min * sizeof(uni_char));
     if (res != 0)
         return res < 0;
     
     return length() < other->length();*/
 
+    const uni_char *lptr = data();
+    const uni_char *rptr = other->data();
     for (size_t i = 0; i < min; ++i)
     {
-        uni_char l = data_[i];
-        uni_char r = other->data_[i];
+        uni_char l = lptr[i];
+        uni_char r = rptr[i];
         if (l != r)
             return l < r;
     }
@@ -335,20 +480,21 @@ bool EsString::less(const EsString *other) const
 int EsString::compare(const EsString *other) const
 {
     size_t min = std::min(length(), other->length());
-    return memcmp(data_, other->data_, min * sizeof(uni_char));
+    return memcmp(data(), other->data(), min * sizeof(uni_char));
 }
 
 const std::string EsString::utf8() const
 {
     byte buffer[6];
     
+    const uni_char *src = data();
     std::string res(len_ * 6,' ');
     
     size_t j = 0;
     for (size_t i = 0; i < len_; i++)
     {
         byte *ptr = buffer;
-        size_t bytes = utf8_enc(ptr, data_[i]);
+        size_t bytes = utf8_enc(ptr, src[i]);
         
         for (size_t k = 0; k < bytes; k++)
             res[j++] = static_cast<char>(buffer[k]);
@@ -365,13 +511,9 @@ size_t EsString::hash() const
     {
         hash_ = 5381;
 
-        uni_char c = 0;
-        const uni_char *ptr = data_;
-        if (!ptr)
-            return hash_;
-
-        while ((c = *ptr++))
-            hash_ = ((hash_ << 5) + hash_) + c; // hash_ * 33 + c.
+        const uni_char *ptr = data();
+        for (size_t i = 0; i < len_; i++)
+            hash_ = ((hash_ << 5) + hash_) + ptr[i];    // hash_ * 33 + c.
     }
 
     return hash_;
@@ -40,6 +40,15 @@ class String;
  * reasons we want to allocate all object members in the same memory area like
  * this:
  *  | EsString | data_ |
+ *
+ * Substrings may instead refer to the character data of the string they were
+ * taken from, in which case their data is not necessarily NULL-terminated:
+ *  | EsString | -> | EsString | data_ |
+ *
+ * Strings created through concatenation may instead be represented as ropes,
+ * referring to the two concatenated strings. Such strings have no character
+ * data until it's first requested, at which point the rope is flattened:
+ *  | EsString | Rope |
  */
 class EsString
 {
@@ -78,17 +87,93 @@ public:
     };
 
 private:
-    const uni_char *data_;
+    /**
+     * @brief Rope data, stored after the string object in rope strings.
+     */
+    struct Rope
+    {
+        const EsString *left_;  ///< Left string, NULL once flattened.
+        const EsString *right_; ///< Right string, NULL once flattened.
+        size_t depth_;          ///< Stack depth needed to flatten the rope.
+    };
+
+    /**
+     * Concatenations resulting in strings shorter than this are copied
+     * rather than represented as ropes.
+     */
+    static const size_t ROPE_MIN_LENGTH = 16;
+
+    /**
+     * Maximum flattening stack depth of a rope. Concatenations exceeding this
+     * depth will flatten their operands first. Ropes created by repeatedly
+     * appending to a string do not grow in depth.
+     */
+    static const size_t ROPE_DEPTH_MAX = 1024;
+
+    /**
+     * Substrings shorter than this are copied rather than represented as
+     * slices.
+     */
+    static const size_t SLICE_MIN_LENGTH = 16;
+
+    /**
+     * Maximum size of the memory a slice may keep alive, relative to the size
+     * of the slice itself. Larger strings are copied rather than sliced.
+     */
+    static const size_t SLICE_PIN_FACTOR = 16;
+
+    mutable const uni_char *data_;  ///< Character data, NULL for unflattened ropes.
     size_t len_;
     mutable size_t hash_;   ///< String hash value, computed lazilly by hash().
+    mutable uint64_t key_;  ///< Cached raw property key, see cached_key().
 
     EsString(const uni_char *data, size_t len);
     EsString(const EsString &rhs);
     EsString &operator=(const EsString &rhs);
 
     static EsString *alloc(size_t len);
+    static EsString *alloc_rope(const EsString *left, const EsString *right);
+
+    /**
+     * @return Rope data of a rope string.
+     */
+    inline Rope *rope() const
+    {
+        return reinterpret_cast<Rope *>(const_cast<EsString *>(this) + 1);
+    }
+
+    /**
+     * @return Stack depth needed to flatten the string, 0 if the string
+     *         is flat.
+     */
+    inline size_t depth() const
+    {
+        return data_ ? 0 : rope()->depth_;
+    }
+
+    /**
+     * Creates a substring, either by copying the characters or by creating a
+     * slice referring to the characters of this string.
+     * @param [in] start Zero based start index.
+     * @param [in] len Number of characters, start + len must not exceed the
+     *                 string length.
+     * @return Specified substring.
+     */
+    const EsString *slice(size_t start, size_t len) const;
+
+    /**
+     * Flattens a rope string by copying all of its characters into a single
+     * buffer.
+     */
+    void flatten() const;
 
 public:
+    /**
+     * Value of the cached property key when no key has been cached. No valid
+     * property key has all bits set.
+     */
+    static const uint64_t NO_KEY = 0xffffffffffffffffULL;
+
     static const EsString *create();
     static const EsString *create(uni_char c);
     static const EsString *create(const uni_char *ptr);
@@ -116,9 +201,21 @@ public:
     inline size_t length() const { return len_; }
     
     /**
-     * @return Pointer to character data.
+     * @return Pointer to character data. The data is not necessarily
+     *         NULL-terminated. Rope strings are flattened on first access.
+     */
+    inline const uni_char *data() const
+    {
+        if (!data_)
+            flatten();
+        return data_;
+    }
+
+    /**
+     * @return Pointer to NULL-terminated character data. Slices that are not
+     *         NULL-terminated are copied on first access.
      */
-    inline const uni_char *data() const { return data_; }
+    const uni_char *c_str() const;
 
     /**
      * @return String in non-ECMAScript representation.
@@ -131,7 +228,7 @@ public:
     inline uni_char at(size_t index) const
     {
         assert(index < len_);
-        return data_[index];
+        return data()[index];
     }
 
     /**
@@ -231,6 +328,21 @@ public:
      * @return String hash value.
      */
     size_t hash() const;
+
+    /**
+     * Returns the raw property key previously associated with this string
+     * using cache_key(). This allows strings used repeatedly as property
+     * names to skip index parsing and the intern table lookup.
+     * @return Raw property key, or NO_KEY if no key has been cached.
+     */
+    inline uint64_t cached_key() const { return key_; }
+
+    /**
+     * Associates a raw property key with this string. Since the string is
+     * immutable the key will remain valid for the lifetime of the string.
+     * @param [in] key Raw property key.
+     */
+    inline void cache_key(uint64_t key) const { key_ = key; }
 };
 
 /**
@@ -16,15 +16,36 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <algorithm>
 #include <cassert>
+#include <limits>
 #include "strings.hh"
 
+/** Identifiers generated by the compiler start at the maximum identifier and
+ * count down. Identifiers above this threshold are considered to be compiler
+ * generated. */
+static const StringId STATIC_ID_THRESHOLD = 0x80000000;
+
 EsStrings::EsStrings()
     : next_id_(0)
 {
 }
 
+void EsStrings::map_id(const EsString *str, StringId id)
+{
+    StringVector *strs = &runtime_strs_;
+    size_t index = id;
+    if (id >= STATIC_ID_THRESHOLD)
+    {
+        strs = &static_strs_;
+        index = std::numeric_limits<StringId>::max() - id;
+    }
+
+    if (index >= strs->size())
+        strs->resize(index + 1, NULL);
+
+    (*strs)[index] = str;
+}
+
 bool EsStrings::is_interned(const EsString *str)
 {
     return interns_.find(str) != interns_.end();
@@ -37,6 +58,7 @@ StringId EsStrings::intern(const EsString *str)
         return it->second;
 
     interns_.insert(std::make_pair(str, next_id_));
+    map_id(str, next_id_);
     return next_id_++;
 }
 
@@ -48,17 +70,19 @@ void EsStrings::unsafe_intern(const EsString *str, StringId id)
 #endif
 
     // FIXME: Limit next_id_ depending on id.
-    interns_.insert(std::make_pair(str, id));
+    if (interns_.insert(std::make_pair(str, id)).second)
+        map_id(str, id);
 }
 
 const EsString *EsStrings::lookup(StringId id) const
 {
-    StringInternMap::const_iterator it;
-    it = std::find_if(interns_.begin(), interns_.end(),
-                      [&id](const StringInternMap::value_type &v)
-        {
-            return v.second == id;
-        });
-    assert(it != interns_.end());
-    return it->first;
+    if (id >= STATIC_ID_THRESHOLD)
+    {
+        size_t index = std::numeric_limits<StringId>::max() - id;
+        assert(index < static_strs_.size() && static_strs_[index]);
+        return static_strs_[index];
+    }
+
+    assert(id < runtime_strs_.size() && runtime_strs_[id]);
+    return runtime_strs_[id];
 }
@@ -18,6 +18,7 @@
 
 #pragma once
 #include <unordered_map>
+#include <vector>
 #include "string.hh"
 
 typedef uint32_t StringId;
@@ -35,6 +36,23 @@ private:
     StringInternMap interns_;
     StringId next_id_;
 
+    typedef std::vector<const EsString *,
+                        gc_allocator<const EsString *> > StringVector;
+
+    /** Strings indexed by runtime generated identifiers, counting up from
+     * zero. */
+    StringVector runtime_strs_;
+    /** Strings indexed by compiler generated identifiers, counting down from
+     * the maximum identifier. */
+    StringVector static_strs_;
+
+    /**
+     * Records the reverse mapping from an identifier to its string.
+     * @param [in] str Interned string.
+     * @param [in] id String identifier.
+     */
+    void map_id(const EsString *str, StringId id);
+
 public:
     EsStrings();
 
@@ -64,9 +82,8 @@ public:
     void unsafe_intern(const EsString *str, StringId id);
 
     /**
-     * Looks up the value of string through its identifier. The lookup is
-     * performed using a linear search so care should be taken when using this
-     * function.
+     * Looks up the value of string through its identifier. The lookup is a
+     * constant time operation.
      * @param [in] id Identifier of string to lookup.
      * @return String with identifier id.
      */
@@ -87,16 +87,23 @@ bool es_as_string(const EsValue &val, const EsString *&str)
     return false;
 }
 
-bool es_as_object(const EsValue &val, EsObject *&object, const char *class_name)
+bool es_as_object(const EsValue &val, EsObject *&object)
 {
     if (val.is_object())
     {
-        EsObject *obj = val.as_object();
-        if (class_name == NULL || !strcmp(class_name, obj->class_name().utf8().c_str()))
-        {
-            object = obj;
-            return true;
-        }
+        object = val.as_object();
+        return true;
+    }
+
+    return false;
+}
+
+bool es_as_object(const EsValue &val, EsObject *&object, EsObject::Class class_id)
+{
+    if (val.is_object() && val.as_object()->class_id() == class_id)
+    {
+        object = val.as_object();
+        return true;
     }
 
     return false;
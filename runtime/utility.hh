@@ -18,6 +18,7 @@
 
 #pragma once
 #include "container.hh"
+#include "object.hh"
 
 class EsDate;
 class EsValue;
@@ -67,12 +68,22 @@ bool es_as_string(const EsValue &val, const EsString *&str);
  * object.
  * @param [in] val Value to interpret.
  * @param [out] object Will be updated to point to the object on success.
- * @param [in] class_name Non-NULL to specify object class name condition. If
- *                        NULL any object will be accepted.
+ * @return true if the value could be interpreted as an object and false
+ *         otherwise.
+ */
+bool es_as_object(const EsValue &val, EsObject *&object);
+
+/**
+ * Tries to interpret a value as an object of a specific class. If the value
+ * is an object of the specified class, it will be written to object.
+ * Otherwise the function will return false without updating object.
+ * @param [in] val Value to interpret.
+ * @param [out] object Will be updated to point to the object on success.
+ * @param [in] class_id Object class condition.
  * @return true if the value could be interpreted as an object of the
  *         specified class and false otherwise.
  */
-bool es_as_object(const EsValue &val, EsObject *&object, const char *class_name = NULL);
+bool es_as_object(const EsValue &val, EsObject *&object, EsObject::Class class_id);
 
 /**
  * Tries to interpret a value as a date object. If the value is a date
@@ -253,6 +253,18 @@ inline int es_value_is_number(const EsValueData value)
             (value.data.bits & ES_VALUE_MASK_NO_TAG) != ES_VALUE_TAG_NAN) ? 1 : 0;  /* Any other number. */
 }
 
+/**
+ * @return 1 if value is a number in the range of a signed 32-bit integer, 0
+ *         otherwise. Such numbers are converted to 32-bit integers by
+ *         truncation.
+ */
+inline int es_value_is_i32_range(const EsValueData value)
+{
+    /* Non-number values are NaNs and will fail both comparisons. */
+    return (value.data.num >= -2147483648.0 &&
+            value.data.num <= 2147483647.0) ? 1 : 0;
+}
+
 /**
  * @return 1 if value is a string, 0 otherwise.
  */
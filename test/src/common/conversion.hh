@@ -0,0 +1,47 @@
+/*
+ * descripten - ECMAScript to native compiler
+ * Copyright (C) 2011-2014 Christian Kindahl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include <string.h>
+#include "common/conversion.hh"
+
+class ConversionTestSuite : public CxxTest::TestSuite
+{
+private:
+    void check_shortest(double num, const char *expected, int expected_point)
+    {
+        char digits[32];
+        int length = 0, point = 0;
+        TS_ASSERT(es_num_to_shortest(num, digits, length, point));
+        TS_ASSERT_EQUALS(length, static_cast<int>(strlen(expected)));
+        TS_ASSERT_SAME_DATA(digits, expected, strlen(expected));
+        TS_ASSERT_EQUALS(point, expected_point);
+    }
+
+public:
+    void test_num_to_shortest()
+    {
+        check_shortest(2.0, "2", 1);
+        check_shortest(0.1, "1", 0);
+        check_shortest(123.456, "123456", 3);
+        check_shortest(1.0 / 3.0, "3333333333333333", 0);
+        check_shortest(1e21, "1", 22);
+        check_shortest(5e-324, "5", -323);
+        check_shortest(1.7976931348623157e308, "17976931348623157", 309);
+    }
+};
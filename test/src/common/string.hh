@@ -217,6 +217,58 @@ public:
         TS_ASSERT_EQUALS(end - ptr, 12);
     }
 
+    void test_es_strtod_decimal()
+    {
+        Gc::instance().init();
+
+        String str00("0.1");
+        String str01("-0");
+        String str02("1.5e3x");
+        String str03("1e");
+        String str04("25e-2");
+        String str05("1e23");
+        String str06("12345678901234567890");
+        String str07("9007199254740993");
+        String str08("0.000000000000000000000000001");
+
+        const uni_char * ptr = str00.data(), * end = str00.data();
+        TS_ASSERT_EQUALS(es_strtod(ptr, &end), 0.1);
+        TS_ASSERT_EQUALS(end - ptr, 3);
+
+        ptr = str01.data(); end = str01.data();
+        TS_ASSERT_EQUALS(es_strtod(ptr, &end), 0.0);
+        TS_ASSERT(std::signbit(es_strtod(ptr, NULL)));
+        TS_ASSERT_EQUALS(end - ptr, 2);
+
+        ptr = str02.data(); end = str02.data();
+        TS_ASSERT_EQUALS(es_strtod(ptr, &end), 1500.0);
+        TS_ASSERT_EQUALS(end - ptr, 5);
+
+        ptr = str03.data(); end = str03.data();
+        TS_ASSERT_EQUALS(es_strtod(ptr, &end), 1.0);
+        TS_ASSERT_EQUALS(end - ptr, 1);
+
+        ptr = str04.data(); end = str04.data();
+        TS_ASSERT_EQUALS(es_strtod(ptr, &end), 0.25);
+        TS_ASSERT_EQUALS(end - ptr, 5);
+
+        ptr = str05.data(); end = str05.data();
+        TS_ASSERT_EQUALS(es_strtod(ptr, &end), 1e23);
+        TS_ASSERT_EQUALS(end - ptr, 4);
+
+        ptr = str06.data(); end = str06.data();
+        TS_ASSERT_EQUALS(es_strtod(ptr, &end), 12345678901234567890.0);
+        TS_ASSERT_EQUALS(end - ptr, 20);
+
+        ptr = str07.data(); end = str07.data();
+        TS_ASSERT_EQUALS(es_strtod(ptr, &end), 9007199254740992.0);
+        TS_ASSERT_EQUALS(end - ptr, 16);
+
+        ptr = str08.data(); end = str08.data();
+        TS_ASSERT_EQUALS(es_strtod(ptr, &end), 1e-27);
+        TS_ASSERT_EQUALS(end - ptr, 29);
+    }
+
     void test_string_contains()
     {
         Gc::instance().init();
@@ -0,0 +1,167 @@
+/*
+ * descripten - ECMAScript to native compiler
+ * Copyright (C) 2011-2014 Christian Kindahl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include "parser/lexer.hh"
+#include "parser/stream.hh"
+#include "../gc.hh"
+
+using parser::Lexer;
+using parser::StringStream;
+using parser::Token;
+
+class LexerTestSuite : public CxxTest::TestSuite
+{
+private:
+    Token lex(const String &src)
+    {
+        StringStream str(src);
+        Lexer lexer(str);
+        return lexer.next();
+    }
+
+public:
+    void test_reserved_words()
+    {
+        Gc::instance().init();
+
+        struct
+        {
+            const char *word;
+            Token::Type type;
+        } words[] =
+        {
+            { "break", Token::BREAK },
+            { "case", Token::CASE },
+            { "catch", Token::CATCH },
+            { "continue", Token::CONTINUE },
+            { "debugger", Token::DEBUGGER },
+            { "default", Token::DEFAULT },
+            { "delete", Token::DELETE },
+            { "do", Token::DO },
+            { "else", Token::ELSE },
+            { "finally", Token::FINALLY },
+            { "for", Token::FOR },
+            { "function", Token::FUNCTION },
+            { "if", Token::IF },
+            { "in", Token::IN },
+            { "instanceof", Token::INSTANCEOF },
+            { "new", Token::NEW },
+            { "return", Token::RETURN },
+            { "switch", Token::SWITCH },
+            { "this", Token::THIS },
+            { "throw", Token::THROW },
+            { "try", Token::TRY },
+            { "typeof", Token::TYPEOF },
+            { "var", Token::VAR },
+            { "void", Token::VOID },
+            { "while", Token::WHILE },
+            { "with", Token::WITH },
+            { "class", Token::FUTURE_RESERVED_WORD },
+            { "const", Token::FUTURE_RESERVED_WORD },
+            { "enum", Token::FUTURE_RESERVED_WORD },
+            { "export", Token::FUTURE_RESERVED_WORD },
+            { "extends", Token::FUTURE_RESERVED_WORD },
+            { "import", Token::FUTURE_RESERVED_WORD },
+            { "super", Token::FUTURE_RESERVED_WORD },
+            { "implements", Token::FUTURE_STRICT_RESERVED_WORD },
+            { "interface", Token::FUTURE_STRICT_RESERVED_WORD },
+            { "let", Token::FUTURE_STRICT_RESERVED_WORD },
+            { "package", Token::FUTURE_STRICT_RESERVED_WORD },
+            { "private", Token::FUTURE_STRICT_RESERVED_WORD },
+            { "protected", Token::FUTURE_STRICT_RESERVED_WORD },
+            { "public", Token::FUTURE_STRICT_RESERVED_WORD },
+            { "static", Token::FUTURE_STRICT_RESERVED_WORD },
+            { "yield", Token::FUTURE_STRICT_RESERVED_WORD },
+            { "null", Token::LIT_NULL },
+            { "true", Token::LIT_TRUE },
+            { "false", Token::LIT_FALSE }
+        };
+
+        for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++)
+        {
+            Token tok = lex(String(words[i].word));
+            TS_ASSERT_EQUALS(tok.type(), words[i].type);
+            TS_ASSERT_EQUALS(tok.string(), String(words[i].word));
+        }
+    }
+
+    void test_identifiers()
+    {
+        Gc::instance().init();
+
+        // Prefixes, extensions and words hashing to the same slot as a
+        // reserved word must lex as identifiers.
+        const char *idents[] =
+        {
+            "a", "_", "$", "$_a1", "b", "br", "brea", "breaks", "Break",
+            "iff", "inn", "doo", "od", "fi", "ni", "nulls", "truee", "fals",
+            "instanceOf", "instanceofs", "interfaces", "yields", "lett",
+            "undefined", "arguments", "eval"
+        };
+
+        for (size_t i = 0; i < sizeof(idents) / sizeof(idents[0]); i++)
+        {
+            Token tok = lex(String(idents[i]));
+            TS_ASSERT_EQUALS(tok.type(), Token::LIT_IDENTIFIER);
+            TS_ASSERT_EQUALS(tok.string(), String(idents[i]));
+        }
+
+        // Identifiers outside of the ASCII range.
+        const uni_char ident[] = { 0xe5, 'b', 0x00c4 };
+        Token tok = lex(String(ident, 3));
+        TS_ASSERT_EQUALS(tok.type(), Token::LIT_IDENTIFIER);
+        TS_ASSERT_EQUALS(tok.string(), String(ident, 3));
+
+        // Unicode escape sequences.
+        tok = lex(String("\\u0061b"));
+        TS_ASSERT_EQUALS(tok.type(), Token::LIT_IDENTIFIER);
+        TS_ASSERT_EQUALS(tok.string(), String("ab"));
+
+        // Characters that can't start an identifier, 7.8.3 doesn't allow
+        // numeric literals to be directly followed by one either.
+        TS_ASSERT_EQUALS(lex(String("#a")).type(), Token::ILLEGAL);
+        TS_ASSERT_EQUALS(lex(String("1a")).type(), Token::ILLEGAL);
+    }
+
+    void test_interning()
+    {
+        Gc::instance().init();
+
+        StringStream str(String("foo bar foo \\u0066oo if bar"));
+        Lexer lexer(str);
+
+        Token foo1 = lexer.next();
+        Token bar1 = lexer.next();
+        Token foo2 = lexer.next();
+        Token foo3 = lexer.next();
+        Token if1 = lexer.next();
+        Token bar2 = lexer.next();
+        TS_ASSERT_EQUALS(lexer.next().type(), Token::EOI);
+
+        TS_ASSERT_EQUALS(foo1.string(), String("foo"));
+        TS_ASSERT_EQUALS(bar1.string(), String("bar"));
+        TS_ASSERT_EQUALS(if1.type(), Token::IF);
+
+        // Identical names share the same string data.
+        TS_ASSERT_EQUALS(foo1.string().data(), foo2.string().data());
+        TS_ASSERT_EQUALS(foo1.string().data(), foo3.string().data());
+        TS_ASSERT_EQUALS(bar1.string().data(), bar2.string().data());
+        TS_ASSERT_DIFFERS(foo1.string().data(), bar1.string().data());
+    }
+};
@@ -0,0 +1,84 @@
+/*
+ * descripten - ECMAScript to native compiler
+ * Copyright (C) 2011-2014 Christian Kindahl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include "parser/ast.hh"
+#include "parser/lexer.hh"
+#include "parser/parser.hh"
+#include "parser/stream.hh"
+#include "../gc.hh"
+
+using parser::Declaration;
+using parser::DeclarationVector;
+using parser::FunctionLiteral;
+using parser::Lexer;
+using parser::Parser;
+using parser::StringStream;
+
+class ParserTestSuite : public CxxTest::TestSuite
+{
+private:
+    FunctionLiteral *parse(const char *src)
+    {
+        String src_str(src);
+        StringStream str(src_str);
+        Lexer lexer(str);
+        Parser parser(lexer, Parser::CODE_PROGRAM);
+        return parser.parse();
+    }
+
+    String name(const Declaration *decl)
+    {
+        return decl->is_function() ?
+            decl->as_function()->name() : decl->as_variable()->name();
+    }
+
+public:
+    void test_declarations()
+    {
+        Gc::instance().init();
+
+        FunctionLiteral *prog = parse(
+            "var a, b = 1;"
+            "function f(x) { var y; var x; }"
+            "for (var c in o) { var a; }"
+            "if (a) { function g() {} }");
+
+        // Declarations are kept in source order, including redeclarations,
+        // and nested function declarations belong to their own function.
+        const DeclarationVector &decls = prog->declarations();
+        TS_ASSERT_EQUALS(decls.size(), 6U);
+        TS_ASSERT_EQUALS(name(decls[0]), String("a"));
+        TS_ASSERT_EQUALS(name(decls[1]), String("b"));
+        TS_ASSERT_EQUALS(name(decls[2]), String("f"));
+        TS_ASSERT(decls[2]->is_function());
+        TS_ASSERT_EQUALS(name(decls[3]), String("c"));
+        TS_ASSERT_EQUALS(name(decls[4]), String("a"));
+        TS_ASSERT_EQUALS(name(decls[5]), String("g"));
+
+        const DeclarationVector &fun_decls = decls[2]->as_function()->declarations();
+        TS_ASSERT_EQUALS(fun_decls.size(), 2U);
+        TS_ASSERT_EQUALS(name(fun_decls[0]), String("y"));
+        TS_ASSERT_EQUALS(name(fun_decls[1]), String("x"));
+
+        // Declared names are interned by the lexer.
+        TS_ASSERT_EQUALS(name(decls[0]).data(), name(decls[4]).data());
+        TS_ASSERT_EQUALS(name(fun_decls[1]).data(),
+                         decls[2]->as_function()->parameters()[0].data());
+    }
+};
@@ -25,6 +25,7 @@
 
 // FIXME: Move to common library.
 
+using parser::AsciiStream;
 using parser::UnicodeStream;
 using parser::Utf8Stream;
 
@@ -171,4 +172,50 @@ public:
         skip_words(str, 6);
         TS_ASSERT_EQUALS(get_word(str), to_unicode(7, '"', 0x03BA, 0x1F79, 0x03C3, 0x03BC, 0x03B5, '"'));
     }
+
+    void test_ascii_stream()
+    {
+        const char *data = "ASCII decoder capability and stress test\n"
+                           "Long enough to span more than one SIMD chunk.\n";
+        TS_ASSERT(AsciiStream::is_ascii(reinterpret_cast<const byte *>(data), strlen(data)));
+        TS_ASSERT(!AsciiStream::is_ascii(reinterpret_cast<const byte *>("Bl\xc3\xa5" "b\xc3\xa4r"), 8));
+        TS_ASSERT(!AsciiStream::is_ascii(reinterpret_cast<const byte *>("0123456789abcdef0123456789abcde\xff"), 32));
+
+        AsciiStream str(reinterpret_cast<const byte *>(data), strlen(data));
+
+        TS_ASSERT_EQUALS(str.position(), 0);
+        TS_ASSERT_EQUALS(get_word(str), to_unicode("ASCII"));
+        TS_ASSERT_EQUALS(str.position(), 5);
+        TS_ASSERT_EQUALS(get_word(str), to_unicode("decoder"));
+        TS_ASSERT_EQUALS(str.position(), 13);
+        TS_ASSERT_EQUALS(str.skip(11), 11);
+        TS_ASSERT_EQUALS(get_word(str), to_unicode("and"));
+        TS_ASSERT_EQUALS(str.position(), 28);
+        str.push('a'); str.push('n'); str.push('d');
+        TS_ASSERT_EQUALS(str.position(), 25);
+        TS_ASSERT_EQUALS(get_word(str), to_unicode("dna"));
+        TS_ASSERT_EQUALS(str.position(), 28);
+        skip_lines(str, 1);
+        TS_ASSERT_EQUALS(get_word(str), to_unicode("Long"));
+        skip_words(str, 7);
+        TS_ASSERT_EQUALS(get_word(str), to_unicode("chunk."));
+        TS_ASSERT_EQUALS(str.next(), static_cast<uni_char>('\n'));
+        TS_ASSERT_EQUALS(str.next(), static_cast<uni_char>(-1));
+        TS_ASSERT_EQUALS(str.skip(10), 0);
+
+        // Characters pushed in front of the input.
+        AsciiStream str2(reinterpret_cast<const byte *>("bc d"), 4);
+        str2.push('a');
+        TS_ASSERT_EQUALS(str2.position(), 0);
+        TS_ASSERT_EQUALS(str2.next(), static_cast<uni_char>('a'));
+        TS_ASSERT_EQUALS(str2.next(), static_cast<uni_char>('b'));
+        str2.push('b');
+        str2.push('a');
+        str2.push('_');
+        TS_ASSERT_EQUALS(get_word(str2), to_unicode("_abc"));
+        TS_ASSERT_EQUALS(str2.position(), 4);
+        TS_ASSERT_EQUALS(str2.next(), static_cast<uni_char>(' '));
+        TS_ASSERT_EQUALS(str2.next(), static_cast<uni_char>('d'));
+        TS_ASSERT_EQUALS(str2.next(), static_cast<uni_char>(-1));
+    }
 };
@@ -0,0 +1,120 @@
+/*
+ * descripten - ECMAScript to native compiler
+ * Copyright (C) 2011-2014 Christian Kindahl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include "runtime/object.hh"
+#include "runtime/operation.h"
+#include "runtime/value.hh"
+#include "fixture.hh"
+
+class ArrayTestSuite : public CxxTest::TestSuite
+{
+public:
+    void test_element_get()
+    {
+        Runtime &rt = Runtime::instance();
+
+        TS_ASSERT_EQUALS(rt.eval_str("var a = [1, 2, 3]; a[0] + a[2]"), "4");
+        TS_ASSERT_EQUALS(rt.eval_str("var a = [1, 2, 3]; String(a[3])"), "undefined");
+        TS_ASSERT_EQUALS(rt.eval_str("var a = [1, 2, 3]; a[-0]"), "1");
+
+        // Keys that aren't array indices are ordinary properties.
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var a = [1, 2]; a[1.5] = 'f'; a[-1] = 'n'; a[4294967295] = 'm';"
+            "a[1.5] + a[-1] + a[4294967295] + a.length"), "fnm2");
+
+        // Holes are looked up on the prototype chain.
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var a = [1, , 3]; Array.prototype[1] = 'p';"
+            "var r = a[1]; delete Array.prototype[1]; r"), "p");
+
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var o = { 0: 'x', length: 1 }; o[0]"), "x");
+    }
+
+    void test_element_put()
+    {
+        Runtime &rt = Runtime::instance();
+
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var a = [1, 2, 3]; a[1] = 5; a.join()"), "1,5,3");
+
+        // Appending and writing past the end update the length.
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var a = []; for (var i = 0; i < 100; i++) a[i] = i;"
+            "a.length + ',' + a[99]"), "100,99");
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var a = [1]; a[5] = 6; a.length + ',' + (2 in a)"), "6,false");
+    }
+
+    void test_element_put_fallback()
+    {
+        Runtime &rt = Runtime::instance();
+
+        // Setters and read-only elements on the prototype chain are honored.
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var log = [];"
+            "Object.defineProperty(Array.prototype, '3',"
+            "  { set: function (v) { log.push(v); }, configurable: true });"
+            "var a = [0, 1, 2]; a[3] = 'x';"
+            "delete Array.prototype[3];"
+            "log.join() + ',' + a.length"), "x,3");
+
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "Object.defineProperty(Array.prototype, '0',"
+            "  { value: 'r', configurable: true });"
+            "var a = []; a[0] = 'w'; var r = a[0] + a.length;"
+            "delete Array.prototype[0]; r"), "r0");
+
+        // Non-extensible and frozen arrays.
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var a = [1]; Object.preventExtensions(a); a[0] = 2; a[1] = 3;"
+            "a.join() + ',' + a.length"), "2,1");
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var a = [1]; Object.freeze(a); a[0] = 2; a[0]"), "1");
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "'use strict'; var a = [1]; Object.freeze(a);"
+            "try { a[0] = 2; 'none' } catch (e) { e instanceof TypeError }"), "true");
+    }
+
+    void test_element_operations()
+    {
+        Runtime::instance().init();
+
+        EsArray *arr = EsArray::create_inst();
+        EsValue src = EsValue::from_obj(arr);
+        EsValue val = EsValue::from_i32(42);
+
+        // Number keys use the element storage, other keys fall back to the
+        // generic property lookup.
+        TS_ASSERT(esa_prp_put_elm(EsContextStack::instance().top(), src,
+                                  EsValue::from_num(0), val, NULL));
+
+        EsValueData res;
+        TS_ASSERT(esa_prp_get_elm(src, EsValue::from_num(0), &res, NULL));
+        TS_ASSERT(static_cast<EsValue &>(res) == val);
+
+        TS_ASSERT(esa_prp_get_elm(
+            src, EsValue::from_str(EsString::create_from_utf8("0")), &res, NULL));
+        TS_ASSERT(static_cast<EsValue &>(res) == val);
+
+        TS_ASSERT(esa_prp_get_elm(
+            src, EsValue::from_str(EsString::create_from_utf8("length")), &res, NULL));
+        TS_ASSERT(static_cast<EsValue &>(res) == EsValue::from_u32(1));
+    }
+};
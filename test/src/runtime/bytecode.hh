@@ -0,0 +1,298 @@
+/*
+ * descripten - ECMAScript to native compiler
+ * Copyright (C) 2011-2014 Christian Kindahl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include <gc_cpp.h>
+#include "parser/lexer.hh"
+#include "parser/parser.hh"
+#include "parser/stream.hh"
+#include "runtime/bytecode.hh"
+#include "runtime/resolver.hh"
+#include "../gc.hh"
+#include "fixture.hh"
+
+using parser::FunctionLiteral;
+using parser::Lexer;
+using parser::Parser;
+using parser::StringStream;
+
+class BytecodeTestSuite : public CxxTest::TestSuite
+{
+private:
+    EsBytecode *compile(const char *src)
+    {
+        String src_str(src);
+        StringStream str(src_str);
+        Lexer lexer(str);
+        Parser parser(lexer, Parser::CODE_EVAL);
+
+        FunctionLiteral *prog = parser.parse();
+        Resolver().resolve(prog, false);
+        return BytecodeCompiler().compile(prog, true);
+    }
+
+    /**
+     * @return Offsets of all instructions in @a code.
+     */
+    std::vector<uint32_t> instructions(const EsBytecode *code)
+    {
+        std::vector<uint32_t> res;
+        for (uint32_t pc = 0; pc < code->code().size();)
+        {
+            res.push_back(pc);
+
+            EsBytecode::Opcode op =
+                static_cast<EsBytecode::Opcode>(code->code()[pc]);
+            TS_ASSERT(op < EsBytecode::NUM_OPCODES);
+            pc += 1 + EsBytecode::num_operands(op);
+        }
+        return res;
+    }
+
+    /**
+     * @return Offset of the first instruction with opcode @a op, or -1.
+     */
+    int64_t find(const EsBytecode *code, EsBytecode::Opcode op)
+    {
+        std::vector<uint32_t> insts = instructions(code);
+        for (uint32_t pc : insts)
+        {
+            if (code->code()[pc] == static_cast<uint32_t>(op))
+                return pc;
+        }
+        return -1;
+    }
+
+public:
+    void test_instruction_stream()
+    {
+        Gc::instance().init();
+
+        EsBytecode *code = compile("var a = 1; a = a + 2; a;");
+
+        // The instruction stream must decode exactly and end with a return.
+        std::vector<uint32_t> insts = instructions(code);
+        TS_ASSERT(!insts.empty());
+        TS_ASSERT_EQUALS(code->code()[insts.back()],
+                         static_cast<uint32_t>(EsBytecode::OP_RET));
+
+        TS_ASSERT(find(code, EsBytecode::OP_ST_NAME) != -1);
+        TS_ASSERT(find(code, EsBytecode::OP_LD_NAME) != -1);
+        TS_ASSERT(find(code, EsBytecode::OP_ADD) != -1);
+
+        // Constant registers follow the temporaries.
+        TS_ASSERT_EQUALS(code->num_registers(),
+                         code->num_temporaries() + code->constants().size());
+    }
+
+    void test_constants()
+    {
+        Gc::instance().init();
+
+        EsBytecode *code = compile("a = 1; b = 1; c = 'x'; d = 'x';");
+        TS_ASSERT_EQUALS(code->constants().size(), 2U);
+    }
+
+    void test_handlers()
+    {
+        Gc::instance().init();
+
+        EsBytecode *code = compile("try { f(); } catch (e) { g(); }");
+
+        int64_t call = find(code, EsBytecode::OP_CALL_NAME);
+        int64_t enter = find(code, EsBytecode::OP_ENTER_CATCH);
+        TS_ASSERT(call != -1);
+        TS_ASSERT(enter != -1);
+
+        // Exceptions thrown by the try block transfer control to the catch
+        // block, exceptions thrown elsewhere propagate to the caller.
+        TS_ASSERT_EQUALS(code->handler(static_cast<uint32_t>(call)), enter);
+        TS_ASSERT_EQUALS(code->handler(
+            static_cast<uint32_t>(instructions(code).back())), -1);
+    }
+
+    void test_finally()
+    {
+        Gc::instance().init();
+
+        EsBytecode *code = compile(
+            "while (x) { try { f(); if (y) break; } finally { g(); } }");
+
+        int64_t call = find(code, EsBytecode::OP_CALL_NAME);
+        int64_t save = find(code, EsBytecode::OP_EX_SAVE);
+        TS_ASSERT(call != -1);
+        TS_ASSERT(save != -1);
+        TS_ASSERT_EQUALS(code->handler(static_cast<uint32_t>(call)), save);
+        TS_ASSERT(find(code, EsBytecode::OP_RETHROW) != -1);
+
+        // The finally block is inlined when breaking out of the loop, on the
+        // normal path and on the exceptional path.
+        std::vector<uint32_t> insts = instructions(code);
+        TS_ASSERT_EQUALS(std::count_if(insts.begin(), insts.end(),
+                                       [code](uint32_t pc)
+                                       {
+                                           return code->code()[pc] ==
+                                               static_cast<uint32_t>(EsBytecode::OP_CALL_NAME);
+                                       }), 4);
+    }
+
+    void test_exec_finally()
+    {
+        Runtime &rt = Runtime::instance();
+
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var log = [];"
+            "for (var i = 0; i < 3; i++) {"
+            "  try { if (i == 1) continue; if (i == 2) break; log.push('t' + i); }"
+            "  finally { log.push('f' + i); }"
+            "}"
+            "log.join()"), "t0,f0,f1,f2");
+
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var log = [];"
+            "function f() {"
+            "  try { try { return 'r'; } finally { log.push('a'); } }"
+            "  finally { log.push('b'); }"
+            "}"
+            "f() + log.join()"), "ra,b");
+
+        // A return in the finally block overrides the pending one.
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "function g() { try { return 1; } finally { return 2; } } g()"),
+            "2");
+
+        // Jumps out of a finally block discard pending exceptions.
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var n = 0;"
+            "while (true) { try { throw 1; } finally { n++; break; } }"
+            "n"), "1");
+
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var log = [];"
+            "try { try { throw 'e'; } finally { log.push('f'); } }"
+            "catch (e) { log.push(e); }"
+            "log.join()"), "f,e");
+    }
+
+    void test_exec_exceptions()
+    {
+        Runtime &rt = Runtime::instance();
+
+        // Leaving a with or catch block by an exception restores the
+        // environment of the enclosing code.
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var x = 'outer';"
+            "try { with ({ x: 'with' }) { throw x; } }"
+            "catch (e) { e + ',' + x }"), "with,outer");
+
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var e = 'outer', r;"
+            "try { try { throw 'a'; } catch (e) { throw e + 'b'; } }"
+            "catch (f) { r = f; }"
+            "r + ',' + e"), "ab,outer");
+
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "function f() { with ({}) { undefined_name; } }"
+            "try { f(); 'none' } catch (e) { e instanceof ReferenceError }"),
+            "true");
+
+        TS_ASSERT_EQUALS(rt.eval_str("throw 42;"), "throw: 42");
+    }
+
+    void test_exec_switch()
+    {
+        Runtime &rt = Runtime::instance();
+
+        const char *src =
+            "function f(v) {"
+            "  var log = [];"
+            "  switch (v) {"
+            "    case 1: log.push(1);"
+            "    case 2: log.push(2); break;"
+            "    default: log.push('d');"
+            "    case 3: log.push(3);"
+            "  }"
+            "  return log.join();"
+            "}";
+
+        TS_ASSERT_EQUALS(rt.eval_str((std::string(src) + "f(1)").c_str()), "1,2");
+        TS_ASSERT_EQUALS(rt.eval_str((std::string(src) + "f(2)").c_str()), "2");
+        TS_ASSERT_EQUALS(rt.eval_str((std::string(src) + "f(3)").c_str()), "3");
+        TS_ASSERT_EQUALS(rt.eval_str((std::string(src) + "f(4)").c_str()), "d,3");
+        TS_ASSERT_EQUALS(rt.eval_str((std::string(src) + "f('1')").c_str()), "d,3");
+    }
+
+    void test_exec_for_in()
+    {
+        Runtime &rt = Runtime::instance();
+
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var keys = [];"
+            "for (var k in { a: 1, b: 2, c: 3 }) keys.push(k);"
+            "keys.sort().join()"), "a,b,c");
+
+        // Properties deleted during enumeration aren't visited.
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var o = { a: 1, b: 2 }, keys = [];"
+            "for (var k in o) { keys.push(k); delete o[k == 'a' ? 'b' : 'a']; }"
+            "keys.length"), "1");
+
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var n = 0; for (var k in null) n++; for (var k in undefined) n++; n"),
+            "0");
+
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "function f(o) { var s = ''; for (var k in o) { if (k == 'c') break; s += k; } return s; }"
+            "f({ a: 0, b: 0, c: 0, d: 0 })"), "ab");
+    }
+
+    void test_exec_slots()
+    {
+        Runtime &rt = Runtime::instance();
+
+        // Stores to resolved bindings are visible to closures and to code
+        // accessing the binding by name.
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "function f() {"
+            "  var x = 1;"
+            "  function get() { return x; }"
+            "  function set(v) { x = v; }"
+            "  set(2); var a = get(); x = 3;"
+            "  return a + ',' + get() + ',' + eval('x');"
+            "}"
+            "f()"), "2,3,3");
+
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "function f(a) { arguments[0] = 2; var b = a; a = 3; return b + ',' + arguments[0]; }"
+            "f(1)"), "2,3");
+
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "function f() { var x = 1; eval('x = 2'); return x; } f()"), "2");
+
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "function f() { var x = 1; with ({ x: 2 }) { x = 3; } return x; } f()"),
+            "1");
+
+        // Nested object literals each use their own template.
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var o = { a: { b: 1 }, c: 2 }; Object.keys(o).join() + Object.keys(o.a).join()"),
+            "a,cb");
+    }
+};
@@ -0,0 +1,111 @@
+/*
+ * descripten - ECMAScript to native compiler
+ * Copyright (C) 2011-2014 Christian Kindahl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <limits>
+#include <cxxtest/TestSuite.h>
+#include "runtime/conversion.hh"
+#include "runtime/property_key.hh"
+#include "runtime/string.hh"
+#include "fixture.hh"
+
+class ConversionTestSuite : public CxxTest::TestSuite
+{
+private:
+    static std::string num_to_str(double m)
+    {
+        return es_num_to_str(m)->utf8();
+    }
+
+public:
+    void test_num_to_str_special()
+    {
+        Runtime::instance().init();
+
+        TS_ASSERT_EQUALS(num_to_str(0.0), "0");
+        TS_ASSERT_EQUALS(num_to_str(-0.0), "0");
+        TS_ASSERT_EQUALS(num_to_str(std::numeric_limits<double>::quiet_NaN()), "NaN");
+        TS_ASSERT_EQUALS(num_to_str(std::numeric_limits<double>::infinity()), "Infinity");
+        TS_ASSERT_EQUALS(num_to_str(-std::numeric_limits<double>::infinity()), "-Infinity");
+    }
+
+    void test_num_to_str_integer()
+    {
+        Runtime::instance().init();
+
+        TS_ASSERT_EQUALS(num_to_str(1.0), "1");
+        TS_ASSERT_EQUALS(num_to_str(9.0), "9");
+        TS_ASSERT_EQUALS(num_to_str(10.0), "10");
+        TS_ASSERT_EQUALS(num_to_str(99.0), "99");
+        TS_ASSERT_EQUALS(num_to_str(100.0), "100");
+        TS_ASSERT_EQUALS(num_to_str(1023.0), "1023");
+        TS_ASSERT_EQUALS(num_to_str(1024.0), "1024");
+        TS_ASSERT_EQUALS(num_to_str(4294967295.0), "4294967295");
+        TS_ASSERT_EQUALS(num_to_str(4294967296.0), "4294967296");
+        TS_ASSERT_EQUALS(num_to_str(123456789012.0), "123456789012");
+
+        TS_ASSERT_EQUALS(num_to_str(-1.0), "-1");
+        TS_ASSERT_EQUALS(num_to_str(-10.0), "-10");
+        TS_ASSERT_EQUALS(num_to_str(-4294967295.0), "-4294967295");
+        TS_ASSERT_EQUALS(num_to_str(-4294967296.0), "-4294967296");
+
+        // The bounds of the integer path, |m| <= 2^53.
+        TS_ASSERT_EQUALS(num_to_str(9007199254740991.0), "9007199254740991");
+        TS_ASSERT_EQUALS(num_to_str(9007199254740992.0), "9007199254740992");
+        TS_ASSERT_EQUALS(num_to_str(-9007199254740992.0), "-9007199254740992");
+    }
+
+    void test_num_to_str_other()
+    {
+        Runtime::instance().init();
+
+        // Integers beyond 2^53 take the general path.
+        TS_ASSERT_EQUALS(num_to_str(9007199254740994.0), "9007199254740994");
+        TS_ASSERT_EQUALS(num_to_str(-9007199254740994.0), "-9007199254740994");
+        TS_ASSERT_EQUALS(num_to_str(1e20), "100000000000000000000");
+        TS_ASSERT_EQUALS(num_to_str(1e21), "1e+21");
+        TS_ASSERT_EQUALS(num_to_str(-1e21), "-1e+21");
+
+        TS_ASSERT_EQUALS(num_to_str(0.5), "0.5");
+        TS_ASSERT_EQUALS(num_to_str(-1.5), "-1.5");
+        TS_ASSERT_EQUALS(num_to_str(1e-7), "1e-7");
+        TS_ASSERT_EQUALS(num_to_str(4294967295.5), "4294967295.5");
+    }
+
+    void test_uint_to_str()
+    {
+        Runtime::instance().init();
+
+        TS_ASSERT_EQUALS(es_uint_to_str(0)->utf8(), "0");
+        TS_ASSERT_EQUALS(es_uint_to_str(7)->utf8(), "7");
+        TS_ASSERT_EQUALS(es_uint_to_str(ES_UINT_STR_CACHE_SIZE - 1)->utf8(), "1023");
+        TS_ASSERT_EQUALS(es_uint_to_str(ES_UINT_STR_CACHE_SIZE)->utf8(), "1024");
+        TS_ASSERT_EQUALS(es_uint_to_str(UINT32_MAX)->utf8(), "4294967295");
+
+        // Strings of small integers are shared.
+        TS_ASSERT_EQUALS(es_uint_to_str(7), es_uint_to_str(7));
+        TS_ASSERT_EQUALS(es_uint_to_str(ES_UINT_STR_CACHE_SIZE - 1),
+                         es_uint_to_str(ES_UINT_STR_CACHE_SIZE - 1));
+        TS_ASSERT_EQUALS(es_num_to_str(42.0), es_uint_to_str(42));
+        TS_ASSERT_EQUALS(EsPropertyKey::from_u32(42).to_string(), es_uint_to_str(42));
+
+        // Larger ones are not cached.
+        TS_ASSERT(es_uint_to_str(ES_UINT_STR_CACHE_SIZE)->equals(
+                es_uint_to_str(ES_UINT_STR_CACHE_SIZE)));
+    }
+};
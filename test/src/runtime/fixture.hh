@@ -0,0 +1,124 @@
+/*
+ * descripten - ECMAScript to native compiler
+ * Copyright (C) 2011-2014 Christian Kindahl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include "parser/lexer.hh"
+#include "parser/parser.hh"
+#include "parser/stream.hh"
+#include "runtime/context.hh"
+#include "runtime/eval.hh"
+#include "runtime/frame.hh"
+#include "runtime/resolver.hh"
+#include "runtime/runtime.h"
+#include "runtime/value.hh"
+#include "../gc.hh"
+
+/**
+ * @brief Initializes the runtime and evaluates code for tests that need the
+ *        global object and the standard library.
+ */
+class Runtime
+{
+private:
+    bool initialized_;
+
+    Runtime() : initialized_(false) {}
+    Runtime(const Runtime & rhs);
+    ~Runtime() {}
+    Runtime & operator=(const Runtime & rhs);
+
+    static void data()
+    {
+    }
+
+public:
+    static Runtime & instance()
+    {
+        static Runtime inst;
+        return inst;
+    }
+
+    void init()
+    {
+        if (!initialized_)
+        {
+            Gc::instance().init();
+            esr_init(data);
+
+            EsContextStack::instance().push_global(false);
+            initialized_ = true;
+        }
+    }
+
+    /**
+     * Evaluates code in the global scope, like an indirect call to eval.
+     * @param [in] src Source code.
+     * @param [out] result Completion value of the code, or the exception if
+     *                     one was thrown.
+     * @return true on normal completion, false if an exception was thrown.
+     */
+    bool eval(const char *src, EsValue &result)
+    {
+        init();
+
+        String src_str(src);
+        parser::StringStream str(src_str);
+        parser::Lexer lexer(str);
+        parser::Parser parser(lexer, parser::Parser::CODE_EVAL);
+
+        parser::FunctionLiteral *prog = parser.parse();
+        Resolver().resolve(prog, false);
+
+        bool success = false;
+        {
+            EsGlobalContext ctx(prog->is_strict_mode());
+            EsCallFrame frame = EsCallFrame::push_global();
+
+            Evaluator eval(prog, Evaluator::TYPE_EVAL, frame);
+            success = eval.exec(ctx);
+            if (success)
+                result = frame.result();
+        }
+
+        if (!success)
+        {
+            EsContext *ctx = EsContextStack::instance().top();
+            result = ctx->get_pending_exception();
+            ctx->clear_pending_exception();
+        }
+
+        return success;
+    }
+
+    /**
+     * Evaluates code in the global scope and converts the completion value to
+     * a string.
+     * @param [in] src Source code.
+     * @return Completion value converted to a string, or "throw: " followed
+     *         by the exception converted to a string if one was thrown.
+     */
+    std::string eval_str(const char *src)
+    {
+        EsValue result;
+        bool success = eval(src, result);
+
+        const EsString *str = result.to_stringT();
+        std::string res = str ? str->utf8() : "<error>";
+        return success ? res : "throw: " + res;
+    }
+};
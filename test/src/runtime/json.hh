@@ -0,0 +1,226 @@
+/*
+ * descripten - ECMAScript to native compiler
+ * Copyright (C) 2011-2014 Christian Kindahl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include "runtime/algorithm.hh"
+#include "runtime/json.hh"
+#include "runtime/object.hh"
+#include "runtime/property_key.hh"
+#include "runtime/value.hh"
+#include "fixture.hh"
+
+class JsonTestSuite : public CxxTest::TestSuite
+{
+public:
+    void test_parse()
+    {
+        Runtime &rt = Runtime::instance();
+
+        TS_ASSERT_EQUALS(rt.eval_str(R"(
+            var o = JSON.parse(' \t\r\n {  \n "a"  : [1, -2, 3.5e1, true, false, null],' +
+                               '                "b": {"c": "d"}}           ');
+            o.a.join() + ',' + o.b.c
+        )"), "1,-2,35,true,false,,d");
+
+        // Numbers on and off the short integer path.
+        TS_ASSERT_EQUALS(rt.eval_str(R"(
+            JSON.parse('[0, 7, -7, 123456789, 12345678901234567890, 0.5, 1e-7, -1.5E+3]').join()
+        )"), "0,7,-7,123456789,12345678901234567000,0.5,1e-7,-1500");
+        TS_ASSERT_EQUALS(rt.eval_str("1 / JSON.parse('-0')"), "-Infinity");
+
+        // Strings with and without escapes, shorter and longer than the
+        // scanning width.
+        TS_ASSERT_EQUALS(rt.eval_str(R"(
+            JSON.parse('["", "a", "abcdefghijklmnop", "ab\\ncd", "abcdefgh\\u0041",' +
+                       ' "\\"\\\\\\/\\b\\f\\r\\t"]').map(function (s) {
+                return s.length + ':' + encodeURIComponent(s);
+            }).join()
+        )"), "0:,1:a,16:abcdefghijklmnop,5:ab%0Acd,9:abcdefghA,7:%22%5C%2F%08%0C%0D%09");
+
+        TS_ASSERT_EQUALS(rt.eval_str(R"(
+            JSON.parse('"\\u00e5\\u00E4 åb"') === 'åä åb'
+        )"), "true");
+
+        // Duplicate member names keep the last value and the first position.
+        TS_ASSERT_EQUALS(rt.eval_str(R"(
+            var o = JSON.parse('{"a": 1, "b": 2, "a": 3}');
+            Object.keys(o).join() + ',' + o.a
+        )"), "a,b,3");
+
+        // Objects in arrays with differing members.
+        TS_ASSERT_EQUALS(rt.eval_str(R"(
+            JSON.parse('[{"a": 1, "b": 2}, {"a": 3}, {}, {"c": 4, "a": 5, "b": 6}]').map(function (o) {
+                return Object.keys(o).join('') + '=' +
+                    Object.keys(o).map(function (k) { return o[k]; }).join('');
+            }).join()
+        )"), "ab=12,a=3,=,cab=456");
+
+        // More distinct and longer keys than the key cache holds.
+        TS_ASSERT_EQUALS(rt.eval_str(R"(
+            var src = [], long = new Array(40).join('k');
+            for (var i = 0; i < 300; i++)
+                src.push('"' + long + i + '": ' + i);
+            var o = JSON.parse('{' + src.join() + '}'), sum = 0, n = 0;
+            for (var k in o) { sum += o[k]; n++; }
+            n + ',' + sum + ',' + o[long + 299]
+        )"), "300,44850,299");
+
+        TS_ASSERT_EQUALS(rt.eval_str(R"(
+            JSON.parse('{"a": [1, {"b": 2}]}', function (k, v) {
+                return typeof v === 'number' ? v * 10 : v;
+            }).a[1].b
+        )"), "20");
+    }
+
+    void test_parse_errors()
+    {
+        Runtime &rt = Runtime::instance();
+
+        // JSON texts as JavaScript string literals.
+        const char *invalid[] =
+        {
+            R"('')", R"(' ')", R"('.5')", R"('+1')", R"('1e')", R"('1e+')",
+            R"('{a:1}')", R"("'a'")", R"('"a')", R"('"\\x"')", R"('"\\u12"')",
+            R"('"\t"')", R"('[1] 2')", R"('[1')", R"('{"a" 1}')", R"('tru')",
+            R"('nul')", R"('undefined')", R"('NaN')"
+        };
+
+        for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+        {
+            std::string src = std::string("try { JSON.parse(") + invalid[i] +
+                "); 'none' } catch (e) { e instanceof SyntaxError }";
+            TS_ASSERT_EQUALS(rt.eval_str(src.c_str()), "true");
+        }
+    }
+
+    void test_parser()
+    {
+        Runtime::instance().init();
+
+        // Strings without escapes are parsed without copying.
+        const EsString *text = EsString::create_from_utf8("[\"abc\", \"d\\ne\"]");
+
+        EsValue result;
+        JsonParser parser(text);
+        TS_ASSERT(parser.parse(result));
+        TS_ASSERT(result.is_object());
+
+        EsValue elem;
+        TS_ASSERT(result.as_object()->getT(EsPropertyKey::from_u32(0), elem));
+        TS_ASSERT(elem.is_string());
+        TS_ASSERT(elem.as_string()->equals(EsString::create_from_utf8("abc")));
+
+        TS_ASSERT(result.as_object()->getT(EsPropertyKey::from_u32(1), elem));
+        TS_ASSERT(elem.as_string()->equals(EsString::create_from_utf8("d\ne")));
+    }
+
+    void test_stringify()
+    {
+        Runtime &rt = Runtime::instance();
+
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "JSON.stringify({ a: [1, 'b', true, null], c: { d: -0.5 } })"),
+            "{\"a\":[1,\"b\",true,null],\"c\":{\"d\":-0.5}}");
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "JSON.stringify('\"\\\\\\n\\u0001')"), "\"\\\"\\\\\\n\\u0001\"");
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "JSON.stringify([undefined, function () {}, NaN, Infinity])"),
+            "[null,null,null,null]");
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "JSON.stringify({ a: undefined, b: function () {} })"), "{}");
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "String(JSON.stringify(undefined))"), "undefined");
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "JSON.stringify([new Number(1), new String('s'), new Boolean(false)])"),
+            "[1,\"s\",false]");
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "JSON.stringify({ a: [1, { b: 2 }] }, null, 2)"),
+            "{\n  \"a\": [\n    1,\n    {\n      \"b\": 2\n    }\n  ]\n}");
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "JSON.stringify({ a: 1, b: 2, c: 3 }, ['c', 'a'])"),
+            "{\"c\":3,\"a\":1}");
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "JSON.stringify({ a: 1, b: 'x' },"
+            "  function (k, v) { return typeof v === 'number' ? v * 2 : v; })"),
+            "{\"a\":2,\"b\":\"x\"}");
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var o = {}; o.o = o; try { JSON.stringify(o); } catch (e) { e instanceof TypeError }"),
+            "true");
+    }
+
+    void test_stringify_to_json()
+    {
+        Runtime &rt = Runtime::instance();
+
+        // Objects sharing the structure of an object without toJSON, followed
+        // by objects with an own and an inherited toJSON.
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "function P() {} P.prototype.toJSON = function (k) { return 'p' + k; };"
+            "var a = [{ x: 1 }, { x: 2 }, { x: 3, toJSON: function (k) { return 't' + k; } },"
+            "         { x: 4 }, new P(), { x: 5 }];"
+            "JSON.stringify(a)"),
+            "[{\"x\":1},{\"x\":2},\"t2\",{\"x\":4},\"p4\",{\"x\":5}]");
+
+        // toJSON added to a prototype while serializing.
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var o = { a: { x: 1 }, b: { get x() {"
+            "  Object.prototype.toJSON = function () { return 'added'; }; return 2; } },"
+            "  c: { x: 3 } };"
+            "var r = JSON.stringify(o); delete Object.prototype.toJSON; r"),
+            "{\"a\":{\"x\":1},\"b\":{\"x\":2},\"c\":\"added\"}");
+
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var o = { a: [1], b: [2] }; Array.prototype.toJSON = function () { return 'arr'; };"
+            "var r = JSON.stringify(o); delete Array.prototype.toJSON; r"),
+            "{\"a\":\"arr\",\"b\":\"arr\"}");
+
+        // Non-callable toJSON properties are ignored.
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "JSON.stringify([{ toJSON: 1 }, { toJSON: 1 }])"),
+            "[{\"toJSON\":1},{\"toJSON\":1}]");
+    }
+
+    void test_prepare_to_json()
+    {
+        Runtime &rt = Runtime::instance();
+
+        EsValue plain, other, with;
+        rt.eval("({ x: 1 })", plain);
+        rt.eval("({ x: 2 })", other);
+        rt.eval("({ x: 3, toJSON: function () { return 't'; } })", with);
+
+        EsObject *holder = EsObject::create_inst();
+        EsPropertyKey key = EsPropertyKey::from_str(EsString::create_from_utf8("k"));
+
+        algorithm::JsonState state;
+        TS_ASSERT(algorithm::json_prepareT(key, holder, state, plain));
+        TS_ASSERT(plain.is_object());
+
+        // The object and Object.prototype are remembered.
+        TS_ASSERT_EQUALS(state.num_no_to_json_ids, 2U);
+        TS_ASSERT_EQUALS(state.no_to_json_ids[0],
+                         other.as_object()->map().id());
+
+        TS_ASSERT(algorithm::json_prepareT(key, holder, state, other));
+        TS_ASSERT(other.is_object());
+
+        TS_ASSERT(algorithm::json_prepareT(key, holder, state, with));
+        TS_ASSERT(with.is_string());
+        TS_ASSERT_EQUALS(state.num_no_to_json_ids, 2U);
+    }
+};
@@ -20,6 +20,7 @@
 #include <gc_cpp.h>
 #include "runtime/map.hh"
 #include "runtime/property.hh"
+#include "runtime/shape.hh"
 #include "../gc.hh"
 
 class MapTestSuite : public CxxTest::TestSuite
@@ -56,49 +57,102 @@ public:
         TS_ASSERT_EQUALS(map0.props_.size(), 3);
     }
 
-    void test_add_mapped()
+    void test_add_shared_table()
     {
         Gc::instance().init();
 
-        EsMap map0(NULL);
-        TS_ASSERT(!map0.map_);
-        for (size_t i = 0; i < EsMap::MAX_NUM_NON_MAPPED; i++)
+        EsMap map0(NULL), map1(NULL);
+        for (size_t i = 0; i < EsShape::MAX_NUM_LINEAR_LOOKUP * 2; i++)
         {
-            TS_ASSERT(!map0.map_);
             map0.add(EsPropertyKey::from_str(EsString::create_from_utf8(std::to_string(i))), EsProperty(false, false, false, Maybe<EsValue>()));
+            map1.add(EsPropertyKey::from_str(EsString::create_from_utf8(std::to_string(i))), EsProperty(false, false, false, Maybe<EsValue>()));
+        }
+        TS_ASSERT(!map0.is_dictionary());
+        TS_ASSERT_EQUALS(map0, map1);
+        TS_ASSERT_EQUALS(map0.size(), EsShape::MAX_NUM_LINEAR_LOOKUP * 2);
+        TS_ASSERT_EQUALS(map0.props_.size(), EsShape::MAX_NUM_LINEAR_LOOKUP * 2);
+
+        // The lookup table is created on the shape and shared by both maps.
+        TS_ASSERT(!map0.shape_->table_);
+        TS_ASSERT(map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("0"))));
+        TS_ASSERT(map0.shape_->table_);
+        TS_ASSERT_EQUALS(map0.shape_, map1.shape_);
+
+        for (size_t i = 0; i < EsShape::MAX_NUM_LINEAR_LOOKUP * 2; i++)
+        {
+            TS_ASSERT_EQUALS(map0.slot(EsPropertyKey::from_str(EsString::create_from_utf8(std::to_string(i)))), i);
+            TS_ASSERT_EQUALS(map1.slot(EsPropertyKey::from_str(EsString::create_from_utf8(std::to_string(i)))), i);
         }
-        TS_ASSERT_EQUALS(map0.size(), EsMap::MAX_NUM_NON_MAPPED);
-        TS_ASSERT_EQUALS(map0.props_.size(), EsMap::MAX_NUM_NON_MAPPED);
+        TS_ASSERT(!map1.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("_0"))));
+    }
+
+    void test_add_dictionary()
+    {
+        Gc::instance().init();
+
+        EsMap map0(NULL);
+        for (size_t i = 0; i < EsMap::MAX_NUM_SHAPED; i++)
+            map0.add(EsPropertyKey::from_str(EsString::create_from_utf8(std::to_string(i))), EsProperty(false, false, false, Maybe<EsValue>()));
+        TS_ASSERT(!map0.is_dictionary());
 
         map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("_0")), EsProperty(false, false, false, Maybe<EsValue>()));
-        TS_ASSERT(map0.map_);
-        EsPropertyReference prop0 = map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("_0")));
-        TS_ASSERT(prop0);
-        TS_ASSERT_EQUALS(map0.size(), EsMap::MAX_NUM_NON_MAPPED + 1);
-        TS_ASSERT_EQUALS(map0.props_.size(), EsMap::MAX_NUM_NON_MAPPED + 1);
+        TS_ASSERT(map0.is_dictionary());
+        TS_ASSERT_EQUALS(map0.size(), EsMap::MAX_NUM_SHAPED + 1);
+        TS_ASSERT_EQUALS(map0.props_.size(), EsMap::MAX_NUM_SHAPED + 1);
+        TS_ASSERT_EQUALS(map0.slot(EsPropertyKey::from_str(EsString::create_from_utf8("_0"))), EsMap::MAX_NUM_SHAPED);
+
+        for (size_t i = 0; i < EsMap::MAX_NUM_SHAPED; i++)
+            TS_ASSERT_EQUALS(map0.slot(EsPropertyKey::from_str(EsString::create_from_utf8(std::to_string(i)))), i);
+
+        std::vector<EsPropertyKey> keys = map0.keys();
+        TS_ASSERT_EQUALS(keys.size(), EsMap::MAX_NUM_SHAPED + 1);
+        TS_ASSERT_EQUALS(keys.front(), EsPropertyKey::from_str(EsString::create_from_utf8("0")));
+        TS_ASSERT_EQUALS(keys.back(), EsPropertyKey::from_str(EsString::create_from_utf8("_0")));
+    }
 
-        map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("_1")), EsProperty(false, false, false, Maybe<EsValue>()));
-        EsPropertyReference prop1 = map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("_1")));
-        TS_ASSERT(prop1);
-        TS_ASSERT(prop1 != prop0);
-        TS_ASSERT_EQUALS(map0.size(), EsMap::MAX_NUM_NON_MAPPED + 2);
-        TS_ASSERT_EQUALS(map0.props_.size(), EsMap::MAX_NUM_NON_MAPPED + 2);
+    void test_reserve()
+    {
+        Gc::instance().init();
 
-        map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("_2")), EsProperty(false, false, false, Maybe<EsValue>()));
-        EsPropertyReference prop2 = map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("_2")));
-        TS_ASSERT(prop2);
-        TS_ASSERT(prop2 != prop0);
-        TS_ASSERT(prop2 != prop1);
-        TS_ASSERT_EQUALS(map0.size(), EsMap::MAX_NUM_NON_MAPPED + 3);
-        TS_ASSERT_EQUALS(map0.props_.size(), EsMap::MAX_NUM_NON_MAPPED + 3);
+        EsMap map0(NULL);
+        map0.reserve(3);
+        TS_ASSERT_EQUALS(map0.size(), 0);
+        TS_ASSERT_EQUALS(map0.props_.size(), 0);
+        TS_ASSERT(map0.props_.capacity() >= 3);
 
-        for (size_t i = 0; i < EsMap::MAX_NUM_NON_MAPPED; i++)
-        {
-            TS_ASSERT(map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8(std::to_string(i)))));
-        }
+        map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("0")), EsProperty(false, false, false, Maybe<EsValue>()));
+        map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("1")), EsProperty(false, false, false, Maybe<EsValue>()));
+        map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("2")), EsProperty(false, false, false, Maybe<EsValue>()));
+        TS_ASSERT(map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("0"))));
+        TS_ASSERT(map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("2"))));
+        TS_ASSERT_EQUALS(map0.size(), 3);
+        TS_ASSERT_EQUALS(map0.props_.size(), 3);
     }
 
-    void test_remove_non_mapped()
+    void test_remove_last()
+    {
+        Gc::instance().init();
+
+        EsMap map0(NULL);
+        map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("0")), EsProperty(false, false, false, Maybe<EsValue>()));
+        map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("1")), EsProperty(false, false, false, Maybe<EsValue>()));
+
+        map0.remove(EsPropertyKey::from_str(EsString::create_from_utf8("1")));
+        TS_ASSERT(!map0.is_dictionary());
+        TS_ASSERT(!map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("1"))));
+        TS_ASSERT(map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("0"))));
+        TS_ASSERT_EQUALS(map0.size(), 1);
+        TS_ASSERT_EQUALS(map0.props_.size(), 1);
+
+        // Re-add "1".
+        map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("1")), EsProperty(false, false, false, Maybe<EsValue>()));
+        TS_ASSERT(!map0.is_dictionary());
+        TS_ASSERT_EQUALS(map0.slot(EsPropertyKey::from_str(EsString::create_from_utf8("1"))), 1);
+        TS_ASSERT_EQUALS(map0.size(), 2);
+        TS_ASSERT_EQUALS(map0.props_.size(), 2);
+    }
+
+    void test_remove_middle()
     {
         Gc::instance().init();
 
@@ -113,6 +167,7 @@ public:
         TS_ASSERT_EQUALS(map0.props_.size(), 3);
 
         map0.remove(EsPropertyKey::from_str(EsString::create_from_utf8("1")));
+        TS_ASSERT(map0.is_dictionary());
         TS_ASSERT(!map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("1"))));
         TS_ASSERT_EQUALS(map0.size(), 2);
         TS_ASSERT_EQUALS(map0.props_.size(), 3);
@@ -120,70 +175,47 @@ public:
         // Add new property "3".
         map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("3")), EsProperty(false, false, false, Maybe<EsValue>()));
         TS_ASSERT(!map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("1"))));
-        EsPropertyReference prop3 = map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("3")));
-        TS_ASSERT(prop3);
-        TS_ASSERT_EQUALS(map0.size(), 3);       // Re-using slot.
-        TS_ASSERT_EQUALS(map0.props_.size(), 3);
-        TS_ASSERT_EQUALS(prop1, prop3);         // Re-using slot.
+        TS_ASSERT_EQUALS(map0.slot(EsPropertyKey::from_str(EsString::create_from_utf8("3"))), 3);
+        TS_ASSERT_EQUALS(map0.size(), 3);
+        TS_ASSERT_EQUALS(map0.props_.size(), 4);
 
-        // Re-add "1".
+        // Re-add "1", it should be enumerated last.
         map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("1")), EsProperty(false, false, false, Maybe<EsValue>()));
-        EsPropertyReference prop1_ = map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("1")));
-        TS_ASSERT(prop1);
+        TS_ASSERT_EQUALS(map0.slot(EsPropertyKey::from_str(EsString::create_from_utf8("1"))), 4);
         TS_ASSERT_EQUALS(map0.size(), 4);
-        TS_ASSERT_EQUALS(map0.props_.size(), 4);
-        TS_ASSERT_EQUALS(prop1, prop3);         // Re-used slot.
-        TS_ASSERT(prop1_ != prop1);
-        TS_ASSERT(prop1_ != prop3);
+
+        std::vector<EsPropertyKey> keys = map0.keys();
+        TS_ASSERT_EQUALS(keys.size(), 4);
+        TS_ASSERT_EQUALS(keys[0], EsPropertyKey::from_str(EsString::create_from_utf8("0")));
+        TS_ASSERT_EQUALS(keys[1], EsPropertyKey::from_str(EsString::create_from_utf8("2")));
+        TS_ASSERT_EQUALS(keys[2], EsPropertyKey::from_str(EsString::create_from_utf8("3")));
+        TS_ASSERT_EQUALS(keys[3], EsPropertyKey::from_str(EsString::create_from_utf8("1")));
     }
 
-    void test_remove_mapped()
+    void test_remove_compact()
     {
         Gc::instance().init();
 
         EsMap map0(NULL);
-        TS_ASSERT(!map0.map_);
-        for (size_t i = 0; i < EsMap::MAX_NUM_NON_MAPPED; i++)
+        for (size_t i = 0; i < EsMap::MIN_NUM_DEAD_COMPACT * 2; i++)
+            map0.add(EsPropertyKey::from_str(EsString::create_from_utf8(std::to_string(i))), EsProperty(false, false, false, Maybe<EsValue>()));
+
+        // Remove all but the last property, starting from the front.
+        for (size_t i = 0; i < EsMap::MIN_NUM_DEAD_COMPACT * 2 - 1; i++)
         {
-            TS_ASSERT(!map0.map_);
-            map0.add(EsPropertyKey::from_str(EsString::create_from_utf8(std::to_string(i))),
-                     EsProperty(false, false, false, Maybe<EsValue>()));
+            EsMap::Id id = map0.id();
+            map0.remove(EsPropertyKey::from_str(EsString::create_from_utf8(std::to_string(i))));
+            TS_ASSERT(map0.is_dictionary());
+            TS_ASSERT(map0.id() != id);
         }
-        TS_ASSERT_EQUALS(map0.size(), EsMap::MAX_NUM_NON_MAPPED);
-        TS_ASSERT_EQUALS(map0.props_.size(), EsMap::MAX_NUM_NON_MAPPED);
-
-        map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("_0")), EsProperty(false, false, false, Maybe<EsValue>()));
-        map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("_1")), EsProperty(false, false, false, Maybe<EsValue>()));
-        map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("_2")), EsProperty(false, false, false, Maybe<EsValue>()));
 
-        EsPropertyReference prop1 = map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("_1")));
-        TS_ASSERT(prop1);
-        TS_ASSERT_EQUALS(map0.size(), EsMap::MAX_NUM_NON_MAPPED + 3);
-        TS_ASSERT_EQUALS(map0.props_.size(), EsMap::MAX_NUM_NON_MAPPED + 3);
-
-        map0.remove(EsPropertyKey::from_str(EsString::create_from_utf8("_1")));
-        TS_ASSERT(!map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("_1"))));
-        TS_ASSERT_EQUALS(map0.size(), EsMap::MAX_NUM_NON_MAPPED + 2);
-        TS_ASSERT_EQUALS(map0.props_.size(), EsMap::MAX_NUM_NON_MAPPED + 3);
+        TS_ASSERT_EQUALS(map0.size(), 1);
+        TS_ASSERT(map0.props_.size() < EsMap::MIN_NUM_DEAD_COMPACT * 2);
 
-        // Add new property "_3".
-        map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("_3")), EsProperty(false, false, false, Maybe<EsValue>()));
-        TS_ASSERT(!map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("_1"))));
-        EsPropertyReference prop3 = map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("_3")));
-        TS_ASSERT(prop3);
-        TS_ASSERT_EQUALS(map0.size(), EsMap::MAX_NUM_NON_MAPPED + 3);   // Re-using slot.
-        TS_ASSERT_EQUALS(map0.props_.size(), EsMap::MAX_NUM_NON_MAPPED + 3);
-        TS_ASSERT_EQUALS(prop1, prop3);         // Re-using slot.
-
-        // Re-add "_1".
-        map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("_1")), EsProperty(false, false, false, Maybe<EsValue>()));
-        EsPropertyReference prop1_ = map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("_1")));
-        TS_ASSERT(prop1);
-        TS_ASSERT_EQUALS(map0.size(), EsMap::MAX_NUM_NON_MAPPED + 4);
-        TS_ASSERT_EQUALS(map0.props_.size(), EsMap::MAX_NUM_NON_MAPPED + 4);
-        TS_ASSERT_EQUALS(prop1, prop3);         // Re-used slot.
-        TS_ASSERT(prop1_ != prop1);
-        TS_ASSERT(prop1_ != prop3);
+        std::string last = std::to_string(EsMap::MIN_NUM_DEAD_COMPACT * 2 - 1);
+        EsPropertyReference prop = map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8(last)));
+        TS_ASSERT(prop);
+        TS_ASSERT(map0.slot(EsPropertyKey::from_str(EsString::create_from_utf8(last))) < map0.props_.size());
     }
 
     void test_compare_ordered()
@@ -430,15 +462,13 @@ public:
         Gc::instance().init();
 
         EsMap map0(NULL);
-        TS_ASSERT(!map0.map_);
-        for (size_t i = 0; i < EsMap::MAX_NUM_NON_MAPPED; i++)
+        for (size_t i = 0; i < EsShape::MAX_NUM_LINEAR_LOOKUP; i++)
         {
-            TS_ASSERT(!map0.map_);
             map0.add(EsPropertyKey::from_str(EsString::create_from_utf8(std::to_string(i))),
                      EsProperty(false, false, false, Maybe<EsValue>()));
         }
-        TS_ASSERT_EQUALS(map0.size(), EsMap::MAX_NUM_NON_MAPPED);
-        TS_ASSERT_EQUALS(map0.props_.size(), EsMap::MAX_NUM_NON_MAPPED);
+        TS_ASSERT_EQUALS(map0.size(), EsShape::MAX_NUM_LINEAR_LOOKUP);
+        TS_ASSERT_EQUALS(map0.props_.size(), EsShape::MAX_NUM_LINEAR_LOOKUP);
 
         map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("_0")), EsProperty(false, false, false, Maybe<EsValue>()));
         map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("_1")), EsProperty(false, false, false, Maybe<EsValue>()));
@@ -446,14 +476,14 @@ public:
 
         EsPropertyReference prop1 = map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("_1")));
         TS_ASSERT(prop1);
-        TS_ASSERT_EQUALS(map0.slot(EsPropertyKey::from_str(EsString::create_from_utf8("_1"))), EsMap::MAX_NUM_NON_MAPPED + 1);
+        TS_ASSERT_EQUALS(map0.slot(EsPropertyKey::from_str(EsString::create_from_utf8("_1"))), EsShape::MAX_NUM_LINEAR_LOOKUP + 1);
         TS_ASSERT_EQUALS(prop1->is_enumerable(), false);
         prop1->set_enumerable(true);
         TS_ASSERT_EQUALS(prop1->is_enumerable(), true);
 
         EsPropertyReference prop1_ = map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("_1")));
         TS_ASSERT(prop1_);
-        TS_ASSERT_EQUALS(map0.slot(EsPropertyKey::from_str(EsString::create_from_utf8("_1"))), EsMap::MAX_NUM_NON_MAPPED + 1);
+        TS_ASSERT_EQUALS(map0.slot(EsPropertyKey::from_str(EsString::create_from_utf8("_1"))), EsShape::MAX_NUM_LINEAR_LOOKUP + 1);
         TS_ASSERT_EQUALS(prop1_->is_enumerable(), true);
 
         map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("_3")), EsProperty(false, false, false, Maybe<EsValue>()));
@@ -461,14 +491,37 @@ public:
 
         prop1_ = map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("_1")));
         TS_ASSERT(prop1_);
-        TS_ASSERT_EQUALS(map0.slot(EsPropertyKey::from_str(EsString::create_from_utf8("_1"))), EsMap::MAX_NUM_NON_MAPPED + 1);
+        TS_ASSERT_EQUALS(map0.slot(EsPropertyKey::from_str(EsString::create_from_utf8("_1"))), EsShape::MAX_NUM_LINEAR_LOOKUP + 1);
         TS_ASSERT_EQUALS(prop1_->is_enumerable(), true);
 
         map0.remove(EsPropertyKey::from_str(EsString::create_from_utf8("_0")));
 
         prop1_ = map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("_1")));
         TS_ASSERT(prop1_);
-        TS_ASSERT_EQUALS(map0.slot(EsPropertyKey::from_str(EsString::create_from_utf8("_1"))), EsMap::MAX_NUM_NON_MAPPED + 1);
+        TS_ASSERT_EQUALS(map0.slot(EsPropertyKey::from_str(EsString::create_from_utf8("_1"))), EsShape::MAX_NUM_LINEAR_LOOKUP + 1);
         TS_ASSERT_EQUALS(prop1_->is_enumerable(), true);
     }
+
+    void test_from_slot()
+    {
+        Gc::instance().init();
+
+        EsMap map0(NULL);
+        map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("0")), EsProperty(false, false, false, Maybe<EsValue>()));
+        map0.add(EsPropertyKey::from_str(EsString::create_from_utf8("1")), EsProperty(false, false, false, Maybe<EsValue>()));
+
+        EsMap map1(NULL);
+        map1.add(EsPropertyKey::from_str(EsString::create_from_utf8("0")), EsProperty(false, false, false, Maybe<EsValue>()));
+        map1.add(EsPropertyKey::from_str(EsString::create_from_utf8("1")), EsProperty(false, false, false, Maybe<EsValue>()));
+        TS_ASSERT_EQUALS(map0.id(), map1.id());
+
+        EsPropertyReference prop0 = map0.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("1")));
+        TS_ASSERT(prop0);
+        TS_ASSERT(prop0.is_slotted());
+
+        EsPropertyReference prop1 = map1.from_slot(prop0.slot());
+        TS_ASSERT(prop1);
+        TS_ASSERT(prop1 == map1.lookup(EsPropertyKey::from_str(EsString::create_from_utf8("1"))));
+        TS_ASSERT(prop1 != prop0);
+    }
 };
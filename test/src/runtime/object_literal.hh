@@ -0,0 +1,152 @@
+/*
+ * descripten - ECMAScript to native compiler
+ * Copyright (C) 2011-2014 Christian Kindahl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include "runtime/global.hh"
+#include "runtime/object.hh"
+#include "runtime/operation.h"
+#include "runtime/property_key.hh"
+#include "runtime/string.hh"
+#include "runtime/value.hh"
+#include "fixture.hh"
+
+class ObjectLiteralTestSuite : public CxxTest::TestSuite
+{
+public:
+    void test_template()
+    {
+        Runtime &rt = Runtime::instance();
+        rt.init();
+
+        EsPropertyKey a = EsPropertyKey::from_str(EsString::create_from_utf8("a"));
+        EsPropertyKey b = EsPropertyKey::from_str(EsString::create_from_utf8("b"));
+
+        uint64_t keys[] = { b.as_raw(), a.as_raw() };
+        EsObjectTemplate tmpl = ESA_OBJ_TEMPLATE_INIT(keys, 2);
+
+        EsValue vals0[] = { EsValue::from_i32(1), EsValue::from_i32(2) };
+        EsValue obj0 = esa_new_obj_lit(&tmpl, vals0);
+        TS_ASSERT(obj0.is_object());
+        TS_ASSERT(tmpl.shape != NULL);
+
+        // The shape is resolved once and shared by later objects.
+        void *shape = tmpl.shape;
+        EsValue vals1[] = { EsValue::from_i32(3), EsValue::from_i32(4) };
+        EsValue obj1 = esa_new_obj_lit(&tmpl, vals1);
+        TS_ASSERT_EQUALS(tmpl.shape, shape);
+        TS_ASSERT_EQUALS(obj0.as_object()->map().id(),
+                         obj1.as_object()->map().id());
+
+        EsValue v;
+        TS_ASSERT(obj1.as_object()->getT(b, v));
+        TS_ASSERT(v.is_number() && v.as_number() == 3);
+        TS_ASSERT(obj1.as_object()->getT(a, v));
+        TS_ASSERT(v.is_number() && v.as_number() == 4);
+
+        // Objects built property by property end up with the same shape.
+        EsObject *obj2 = EsObject::create_inst();
+        TS_ASSERT(obj2->putT(b, EsValue::from_i32(5), true));
+        TS_ASSERT(obj2->putT(a, EsValue::from_i32(6), true));
+        TS_ASSERT_EQUALS(obj2->map().id(), obj0.as_object()->map().id());
+
+        es_global_obj()->putT(
+                EsPropertyKey::from_str(EsString::create_from_utf8("tmpl0")),
+                obj0, true);
+        es_global_obj()->putT(
+                EsPropertyKey::from_str(EsString::create_from_utf8("tmpl1")),
+                obj1, true);
+
+        TS_ASSERT_EQUALS(rt.eval_str(R"(
+            Object.keys(tmpl0).join() + ',' + tmpl0.b + ',' + tmpl0.a
+        )"), "b,a,1,2");
+
+        // Properties are ordinary data properties.
+        TS_ASSERT_EQUALS(rt.eval_str(R"(
+            var d = Object.getOwnPropertyDescriptor(tmpl0, 'a');
+            d.value + ',' + d.writable + ',' + d.enumerable + ',' + d.configurable
+        )"), "2,true,true,true");
+
+        // Changing one object leaves the other alone.
+        TS_ASSERT_EQUALS(rt.eval_str(R"(
+            tmpl0.a = 7;
+            tmpl0.c = 8;
+            delete tmpl0.b;
+            Object.keys(tmpl0).join() + ',' + tmpl0.a + ',' +
+                Object.keys(tmpl1).join() + ',' + tmpl1.a + ',' + tmpl1.b
+        )"), "a,c,7,b,a,4,3");
+    }
+
+    void test_literals()
+    {
+        Runtime &rt = Runtime::instance();
+
+        TS_ASSERT_EQUALS(rt.eval_str(R"(
+            var o = { z: 1, y: 'two', x: null, w: undefined };
+            var s = [];
+            for (var k in o) s.push(k + '=' + o[k]);
+            s.join()
+        )"), "z=1,y=two,x=null,w=undefined");
+
+        // The same literal evaluated repeatedly creates distinct objects.
+        TS_ASSERT_EQUALS(rt.eval_str(R"(
+            var objs = [];
+            for (var i = 0; i < 3; i++)
+                objs.push({ p: i, q: i * 2 });
+            objs[1].r = 'r';
+            delete objs[2].p;
+            objs.map(function (o) {
+                return Object.keys(o).map(function (k) { return k + o[k]; }).join('');
+            }).join()
+        )"), "p0q0,p1q2rr,q4");
+
+        TS_ASSERT_EQUALS(rt.eval_str(R"(
+            var o = { a: { b: { c: 1 }, d: 2 }, e: 3 };
+            Object.keys(o).join('') + Object.keys(o.a).join('') + o.a.b.c + o.a.d + o.e
+        )"), "aebd123");
+
+        TS_ASSERT_EQUALS(rt.eval_str("Object.keys({}).length"), "0");
+    }
+
+    void test_literals_without_template()
+    {
+        Runtime &rt = Runtime::instance();
+
+        // Duplicate keys keep the last value and the first position.
+        TS_ASSERT_EQUALS(rt.eval_str(R"(
+            var o = { a: 1, b: 2, a: 3 };
+            Object.keys(o).join() + ',' + o.a + ',' + o.b
+        )"), "a,b,3,2");
+
+        // Index keys are enumerated before other keys.
+        TS_ASSERT_EQUALS(rt.eval_str(R"(
+            var o = { x: 'x', 1: 'one', 0: 'zero', '': 'empty' };
+            var s = [];
+            for (var k in o) s.push(k + '=' + o[k]);
+            s.join()
+        )"), "0=zero,1=one,x=x,=empty");
+
+        TS_ASSERT_EQUALS(rt.eval_str(R"(
+            var n = 0;
+            var o = { a: 1, get b() { return ++n; }, set c(v) { n = v; } };
+            o.b; o.b;
+            var d = Object.getOwnPropertyDescriptor(o, 'c');
+            o.c = 10;
+            Object.keys(o).join() + ',' + o.b + ',' + typeof d.set
+        )"), "a,b,c,11,function");
+    }
+};
@@ -0,0 +1,96 @@
+/*
+ * descripten - ECMAScript to native compiler
+ * Copyright (C) 2011-2014 Christian Kindahl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include <gc_cpp.h>
+#include "runtime/program_cache.hh"
+#include "../gc.hh"
+
+using parser::FunctionLiteral;
+using parser::Location;
+using parser::Parser;
+
+class ProgramCacheTestSuite : public CxxTest::TestSuite
+{
+public:
+    void test_lookup()
+    {
+        Gc::instance().init();
+
+        EsProgramCache &cache = EsProgramCache::instance();
+        cache.clear();
+
+        const EsString *src = EsString::create_from_utf8("x + 1");
+        const EsString *params = EsString::create_from_utf8("function $(x) {}");
+        FunctionLiteral *prog0 = new (GC)FunctionLiteral(Location(), String());
+        FunctionLiteral *prog1 = new (GC)FunctionLiteral(Location(), String());
+
+        TS_ASSERT(!cache.lookup(Parser::CODE_EVAL, false, src));
+        cache.insert(Parser::CODE_EVAL, false, src, NULL, prog0);
+        TS_ASSERT_EQUALS(cache.size(), 1);
+
+        // Equal source strings should hit.
+        TS_ASSERT_EQUALS(cache.lookup(Parser::CODE_EVAL, false, src), prog0);
+        TS_ASSERT_EQUALS(cache.lookup(Parser::CODE_EVAL, false,
+                                      EsString::create_from_utf8("x + 1")), prog0);
+
+        // Programs parsed differently should miss.
+        TS_ASSERT(!cache.lookup(Parser::CODE_EVAL, true, src));
+        TS_ASSERT(!cache.lookup(Parser::CODE_FUNCTION, false, src));
+        TS_ASSERT(!cache.lookup(Parser::CODE_FUNCTION, false, src, params));
+
+        cache.insert(Parser::CODE_FUNCTION, false, src, params, prog1);
+        TS_ASSERT_EQUALS(cache.size(), 2);
+        TS_ASSERT_EQUALS(cache.lookup(Parser::CODE_FUNCTION, false, src, params), prog1);
+        TS_ASSERT(!cache.lookup(Parser::CODE_FUNCTION, false, src));
+
+        cache.clear();
+        TS_ASSERT_EQUALS(cache.size(), 0);
+        TS_ASSERT(!cache.lookup(Parser::CODE_EVAL, false, src));
+    }
+
+    void test_evict()
+    {
+        Gc::instance().init();
+
+        EsProgramCache &cache = EsProgramCache::instance();
+        cache.clear();
+
+        std::vector<const EsString *> srcs;
+        for (size_t i = 0; i <= EsProgramCache::MAX_NUM_ENTRIES; i++)
+            srcs.push_back(EsString::create_from_utf8(std::to_string(i)));
+
+        FunctionLiteral *prog = new (GC)FunctionLiteral(Location(), String());
+        for (size_t i = 0; i < EsProgramCache::MAX_NUM_ENTRIES; i++)
+            cache.insert(Parser::CODE_EVAL, false, srcs[i], NULL, prog);
+        TS_ASSERT_EQUALS(cache.size(), EsProgramCache::MAX_NUM_ENTRIES);
+
+        // Use the oldest program, making the second oldest program the least
+        // recently used one.
+        TS_ASSERT(cache.lookup(Parser::CODE_EVAL, false, srcs[0]));
+
+        cache.insert(Parser::CODE_EVAL, false, srcs[EsProgramCache::MAX_NUM_ENTRIES], NULL, prog);
+        TS_ASSERT_EQUALS(cache.size(), EsProgramCache::MAX_NUM_ENTRIES);
+        TS_ASSERT(cache.lookup(Parser::CODE_EVAL, false, srcs[0]));
+        TS_ASSERT(!cache.lookup(Parser::CODE_EVAL, false, srcs[1]));
+        TS_ASSERT(cache.lookup(Parser::CODE_EVAL, false, srcs[2]));
+        TS_ASSERT(cache.lookup(Parser::CODE_EVAL, false, srcs[EsProgramCache::MAX_NUM_ENTRIES]));
+
+        cache.clear();
+    }
+};
@@ -352,4 +352,123 @@ public:
         TS_ASSERT(array.get(64));
         TS_ASSERT(algorithm::same_value(array.get(64)->value_or_undefined(), EsValue::from_num(64.0)));
     }
+
+    void test_packed()
+    {
+        Gc::instance().init();
+
+        EsPropertyArray array;
+        TS_ASSERT_EQUALS(array.kind(), EsPropertyArray::KIND_PACKED_DOUBLE);
+
+        for (uint32_t i = 0; i < 32; i++)
+        {
+            array.set_value(i, EsValue::from_num(static_cast<double>(i)));
+            TS_ASSERT_EQUALS(array.kind(), EsPropertyArray::KIND_PACKED_DOUBLE);
+            TS_ASSERT_EQUALS(array.count(), i + 1);
+        }
+
+        EsValue v;
+        TS_ASSERT(array.get_value(31, v));
+        TS_ASSERT(algorithm::same_value(v, EsValue::from_num(31.0)));
+        TS_ASSERT(!array.get_value(32, v));
+
+        // Storing a non-number converts the doubles into values.
+        array.set_value(1, EsValue::null);
+        TS_ASSERT_EQUALS(array.kind(), EsPropertyArray::KIND_PACKED);
+        TS_ASSERT(array.get_value(1, v));
+        TS_ASSERT(algorithm::same_value(v, EsValue::null));
+        TS_ASSERT(array.get_value(2, v));
+        TS_ASSERT(algorithm::same_value(v, EsValue::from_num(2.0)));
+
+        // Removing the last element keeps the array packed.
+        array.remove(31);
+        TS_ASSERT_EQUALS(array.kind(), EsPropertyArray::KIND_PACKED);
+        TS_ASSERT_EQUALS(array.count(), 31);
+
+        for (const std::pair<int64_t, EsProperty> &entry : array)
+        {
+            TS_ASSERT(entry.second.is_writable());
+            TS_ASSERT(entry.second.is_enumerable());
+            TS_ASSERT(entry.second.is_configurable());
+            if (entry.first != 1)
+                TS_ASSERT(algorithm::same_value(entry.second.value_or_undefined(), EsValue::from_num(static_cast<double>(entry.first))));
+        }
+    }
+
+    void test_packed_holey()
+    {
+        Gc::instance().init();
+
+        EsPropertyArray array;
+        array.set_value(0, EsValue::from_num(0.0));
+        array.set_value(3, EsValue::from_num(3.0));
+        TS_ASSERT_EQUALS(array.kind(), EsPropertyArray::KIND_HOLEY);
+        TS_ASSERT_EQUALS(array.count(), 2);
+        TS_ASSERT(array.contains(0));
+        TS_ASSERT(!array.contains(1));
+        TS_ASSERT(!array.contains(2));
+        TS_ASSERT(array.contains(3));
+
+        int64_t expected[] = { 0, 3 };
+        size_t i = 0;
+        for (const std::pair<int64_t, EsProperty> &entry : array)
+        {
+            TS_ASSERT(i < 2);
+            TS_ASSERT_EQUALS(entry.first, expected[i++]);
+        }
+        TS_ASSERT_EQUALS(i, 2);
+
+        // Filling the holes makes the array packed again.
+        array.set_value(1, EsValue::from_num(1.0));
+        array.set_value(2, EsValue::from_num(2.0));
+        TS_ASSERT_EQUALS(array.kind(), EsPropertyArray::KIND_PACKED);
+        TS_ASSERT_EQUALS(array.count(), 4);
+
+        array.remove(1);
+        TS_ASSERT_EQUALS(array.kind(), EsPropertyArray::KIND_HOLEY);
+        TS_ASSERT_EQUALS(array.count(), 3);
+
+        // Removing the last element trims trailing holes.
+        array.remove(3);
+        array.remove(2);
+        TS_ASSERT_EQUALS(array.count(), 1);
+        TS_ASSERT(!array.empty());
+        array.remove(0);
+        TS_ASSERT(array.empty());
+    }
+
+    void test_packed_to_generic()
+    {
+        Gc::instance().init();
+
+        EsPropertyArray array;
+        for (uint32_t i = 0; i < 4; i++)
+            array.set(i, EsProperty(true, true, true, Maybe<EsValue>(EsValue::from_num(static_cast<double>(i)))));
+        TS_ASSERT_EQUALS(array.kind(), EsPropertyArray::KIND_PACKED_DOUBLE);
+
+        // Properties with non-default attributes require generic storage.
+        array.set(4, EsProperty(true, true, false, Maybe<EsValue>(EsValue::from_num(4.0))));
+        TS_ASSERT(array.is_generic());
+        TS_ASSERT(array.is_compact());
+        TS_ASSERT_EQUALS(array.count(), 5);
+        TS_ASSERT(array.get(0)->is_writable());
+        TS_ASSERT(!array.get(4)->is_writable());
+        TS_ASSERT(algorithm::same_value(array.get(3)->value_or_undefined(), EsValue::from_num(3.0)));
+
+        // So does accessing an element as a property.
+        EsPropertyArray array2;
+        array2.set_value(0, EsValue::from_num(0.0));
+        TS_ASSERT(array2.get(1) == NULL);
+        TS_ASSERT(!array2.is_generic());
+        TS_ASSERT(array2.get(0) != NULL);
+        TS_ASSERT(array2.is_generic());
+
+        // Arrays that become too sparse switch to sparse storage.
+        EsPropertyArray array3;
+        array3.set_value(0, EsValue::from_num(0.0));
+        array3.set_value(1024, EsValue::from_num(1024.0));
+        TS_ASSERT(array3.is_generic());
+        TS_ASSERT(!array3.is_compact());
+        TS_ASSERT_EQUALS(array3.count(), 2);
+    }
 };
@@ -0,0 +1,179 @@
+/*
+ * descripten - ECMAScript to native compiler
+ * Copyright (C) 2011-2014 Christian Kindahl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include <gc_cpp.h>
+#include "parser/lexer.hh"
+#include "parser/parser.hh"
+#include "parser/stream.hh"
+#include "runtime/resolver.hh"
+#include "../gc.hh"
+#include "fixture.hh"
+
+using parser::BinaryExpression;
+using parser::BlockStatement;
+using parser::Expression;
+using parser::FunctionExpression;
+using parser::FunctionLiteral;
+using parser::IdentifierLiteral;
+using parser::Lexer;
+using parser::Parser;
+using parser::ReturnStatement;
+using parser::Statement;
+using parser::StringStream;
+using parser::TryStatement;
+using parser::WithStatement;
+
+class ResolverTestSuite : public CxxTest::TestSuite
+{
+private:
+    FunctionLiteral *parse(const char *src, bool static_root)
+    {
+        String src_str(src);
+        StringStream str(src_str);
+        Lexer lexer(str);
+        Parser parser(lexer, static_root ? Parser::CODE_FUNCTION
+                                         : Parser::CODE_EVAL);
+
+        FunctionLiteral *prog = parser.parse();
+        Resolver().resolve(prog, static_root);
+        return prog;
+    }
+
+    FunctionLiteral *function(FunctionLiteral *fun, size_t i)
+    {
+        return fun->declarations()[i]->as_function();
+    }
+
+    Expression *returned(Statement *stmt)
+    {
+        return static_cast<ReturnStatement *>(stmt)->expression();
+    }
+
+    IdentifierLiteral *ident(Expression *expr)
+    {
+        IdentifierLiteral *lit = dynamic_cast<IdentifierLiteral *>(expr);
+        TS_ASSERT(lit);
+        TS_ASSERT(lit->site());
+        return lit;
+    }
+
+public:
+    void test_function_scopes()
+    {
+        Gc::instance().init();
+
+        FunctionLiteral *prog = parse(
+            "var a = 1;"
+            "function f(b) { return a + b; }", true);
+        FunctionLiteral *f = function(prog, 1);
+
+        BinaryExpression *expr = static_cast<BinaryExpression *>(returned(f->body()[0]));
+        IdentifierLiteral *a = ident(expr->left());
+        IdentifierLiteral *b = ident(expr->right());
+
+        TS_ASSERT(a->is_resolved());
+        TS_ASSERT_EQUALS(a->depth(), 1);
+        TS_ASSERT_EQUALS(a->slot(), 0);
+        TS_ASSERT(b->is_resolved());
+        TS_ASSERT_EQUALS(b->depth(), 0);
+        TS_ASSERT_EQUALS(b->slot(), 0);
+
+        TS_ASSERT_EQUALS(prog->slots().size(), 1);
+        TS_ASSERT(prog->slots()[0] == _USTR("a"));
+        TS_ASSERT_EQUALS(f->slots().size(), 1);
+        TS_ASSERT(f->slots()[0] == _USTR("b"));
+    }
+
+    void test_eval_code()
+    {
+        Gc::instance().init();
+
+        // Eval code shares its variable environment with the caller.
+        FunctionLiteral *prog = parse(
+            "var a = 1;"
+            "function f(b) { return a + b; }", false);
+        FunctionLiteral *f = function(prog, 1);
+
+        BinaryExpression *expr = static_cast<BinaryExpression *>(returned(f->body()[0]));
+        TS_ASSERT(!ident(expr->left())->is_resolved());
+        TS_ASSERT(ident(expr->right())->is_resolved());
+        TS_ASSERT(prog->slots().empty());
+    }
+
+    void test_dynamic_scopes()
+    {
+        Gc::instance().init();
+
+        FunctionLiteral *prog = parse(
+            "function f(a) { eval(''); return a; }"
+            "function g(a) { with (a) { return a; } }"
+            "function h(a) { try {} catch (a) { return a; } }"
+            "function k(a) { return function j() { return a + j; }; }", true);
+
+        // Calls to eval may introduce new bindings.
+        FunctionLiteral *f = function(prog, 0);
+        TS_ASSERT(!ident(returned(f->body()[1]))->is_resolved());
+
+        FunctionLiteral *g = function(prog, 1);
+        WithStatement *with = static_cast<WithStatement *>(g->body()[0]);
+        TS_ASSERT(ident(with->expression())->is_resolved());
+        BlockStatement *with_body = static_cast<BlockStatement *>(with->body());
+        TS_ASSERT(!ident(returned(with_body->body()[0]))->is_resolved());
+
+        FunctionLiteral *h = function(prog, 2);
+        TryStatement *stmt = static_cast<TryStatement *>(h->body()[0]);
+        BlockStatement *catch_body = static_cast<BlockStatement *>(stmt->catch_block());
+        TS_ASSERT(!ident(returned(catch_body->body()[0]))->is_resolved());
+
+        // The callee binding of a named function expression lives in a scope
+        // of its own, between the function scope and the enclosing scope.
+        FunctionLiteral *k = function(prog, 3);
+        FunctionExpression *j = static_cast<FunctionExpression *>(returned(k->body()[0]));
+        BinaryExpression *expr = static_cast<BinaryExpression *>(
+            returned(j->function()->body()[0]));
+        TS_ASSERT(!ident(expr->left())->is_resolved());
+        TS_ASSERT(!ident(expr->right())->is_resolved());
+    }
+
+    void test_shared_eval_sites()
+    {
+        Runtime &rt = Runtime::instance();
+
+        // Eval code is parsed once and shared by every scope evaluating the
+        // same source. Unresolved identifiers must not reuse a binding found
+        // in another scope.
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var x = 1;"
+            "function a() { return eval('x'); }"
+            "function b() { var x = 2; return eval('x'); }"
+            "a() + ',' + b() + ',' + a()"), "1,2,1");
+
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var y = 1;"
+            "function c() { eval('y = 10'); return y; }"
+            "function d() { var y = 2; eval('y = 20'); return y; }"
+            "c() + ',' + d() + ',' + y"), "10,20,10");
+
+        TS_ASSERT_EQUALS(rt.eval_str(
+            "var z = 1;"
+            "var f = eval('(function () { return z; })');"
+            "function g() { var z = 3; return eval('(function () { return z; })')(); }"
+            "f() + ',' + g() + ',' + f()"), "1,3,1");
+    }
+};
@@ -18,6 +18,7 @@
 
 #include <cxxtest/TestSuite.h>
 #include <limits>
+#include "runtime/property_key.hh"
 #include "runtime/string.hh"
 #include "../gc.hh"
 
@@ -93,6 +94,72 @@ public:
         TS_ASSERT(str2->substr(25, 1)->equals(EsString::create_from_utf8("z")));
     }
 
+    void test_string_slice()
+    {
+        Gc::instance().init();
+
+        const EsString *str1 = EsString::create_from_utf8("abcdefghijklmnopqrstuvwxyz0123456789");
+        const EsString *str2 = str1->substr(4, 20);
+        const EsString *str3 = EsString::create_from_utf8("efghijklmnopqrstuvwx");
+
+        TS_ASSERT(str2->equals(str3));
+        TS_ASSERT_EQUALS(str2->hash(), str3->hash());
+        TS_ASSERT_EQUALS(str2->at(19), 'x');
+
+        // Searching must not match characters past the end of the slice.
+        TS_ASSERT_EQUALS(str2->index_of(EsString::create_from_utf8("xy")), -1);
+        TS_ASSERT_EQUALS(str2->last_index_of(EsString::create_from_utf8("xy")), -1);
+        TS_ASSERT_EQUALS(str2->index_of(EsString::create_from_utf8("wx")), 18);
+
+        // Slices of slices.
+        TS_ASSERT(str2->skip(2)->take(16)->equals(EsString::create_from_utf8("ghijklmnopqrstuv")));
+        TS_ASSERT(str1->take(36) == str1);
+
+        const uni_char *ptr = str2->c_str();
+        TS_ASSERT_EQUALS(ptr[19], 'x');
+        TS_ASSERT_EQUALS(ptr[20], 0);
+        TS_ASSERT(str2->equals(str3));
+        TS_ASSERT(str2->str() == str3->str());
+    }
+
+    void test_string_concat()
+    {
+        Gc::instance().init();
+
+        const EsString *str1 = EsString::create();
+        const EsString *str2 = EsString::create_from_utf8("abc");
+        const EsString *str3 = EsString::create_from_utf8("defghijklmnopqrstuvwxyz");
+
+        TS_ASSERT(str1->concat(str1)->equals(EsString::create()));
+        TS_ASSERT(str1->concat(str2)->equals(str2));
+        TS_ASSERT(str2->concat(str1)->equals(str2));
+        TS_ASSERT(str2->concat(str2)->equals(EsString::create_from_utf8("abcabc")));
+        TS_ASSERT(str2->concat(str3)->equals(EsString::create_from_utf8("abcdefghijklmnopqrstuvwxyz")));
+
+        // Appending.
+        const EsString *res1 = EsString::create();
+        for (int i = 0; i < 4096; i++)
+            res1 = res1->concat(str2);
+        TS_ASSERT_EQUALS(res1->length(), 3 * 4096);
+        TS_ASSERT_EQUALS(res1->at(0), 'a');
+        TS_ASSERT_EQUALS(res1->at(3 * 4096 - 1), 'c');
+        TS_ASSERT_EQUALS(res1->index_of(EsString::create_from_utf8("cab")), 2);
+
+        // Prepending, exceeding the maximum rope depth.
+        const EsString *res2 = EsString::create();
+        for (int i = 0; i < 4096; i++)
+            res2 = str3->concat(res2);
+        TS_ASSERT_EQUALS(res2->length(), 23 * 4096);
+        TS_ASSERT(res2->take(23)->equals(str3));
+        TS_ASSERT(res2->skip(23 * 4095)->equals(str3));
+
+        // Nested ropes.
+        const EsString *res3 = res1->concat(res2)->concat(res1->concat(res2));
+        TS_ASSERT_EQUALS(res3->length(), 2 * (res1->length() + res2->length()));
+        TS_ASSERT(res3->substr(res1->length(), 23)->equals(str3));
+        TS_ASSERT_EQUALS(res3->hash(), res1->concat(res2)->concat(res1)->concat(res2)->hash());
+    }
+
     void test_string_index_of()
     {
         Gc::instance().init();
@@ -158,4 +225,33 @@ public:
         TS_ASSERT_EQUALS(str3->last_index_of(EsString::create_from_utf8("abc"),12), 12);
         TS_ASSERT_EQUALS(str3->last_index_of(EsString::create_from_utf8("abc"),13), -1);
     }
+
+    void test_string_cached_key()
+    {
+        Gc::instance().init();
+
+        const EsString *str1 = EsString::create_from_utf8("42");
+        const EsString *str2 = EsString::create_from_utf8("foo");
+        const EsString *str3 = EsString::create_from_utf8("042");
+        const EsString *str4 = EsString::create_from_utf8("4294967296");
+        TS_ASSERT_EQUALS(str1->cached_key(), EsString::NO_KEY);
+        TS_ASSERT_EQUALS(str2->cached_key(), EsString::NO_KEY);
+
+        EsPropertyKey key1 = EsPropertyKey::from_str(str1);
+        TS_ASSERT(key1.is_index());
+        TS_ASSERT_EQUALS(key1.as_index(), 42);
+        TS_ASSERT_EQUALS(str1->cached_key(), key1.as_raw());
+        TS_ASSERT(EsPropertyKey::from_str(str1) == key1);
+
+        EsPropertyKey key2 = EsPropertyKey::from_str(str2);
+        TS_ASSERT(key2.is_string());
+        TS_ASSERT_EQUALS(str2->cached_key(), key2.as_raw());
+        TS_ASSERT(EsPropertyKey::from_str(str2) == key2);
+        TS_ASSERT(EsPropertyKey::from_str(EsString::create_from_utf8("foo")) == key2);
+
+        TS_ASSERT(EsPropertyKey::from_str(str3).is_string());
+        TS_ASSERT(EsPropertyKey::from_str(str4).is_string());
+        TS_ASSERT(EsPropertyKey::from_str(EsString::create_from_utf8("0")).is_index());
+        TS_ASSERT(EsPropertyKey::from_str(EsString::create()).is_string());
+    }
 };
@@ -0,0 +1,88 @@
+/*
+ * descripten - ECMAScript to native compiler
+ * Copyright (C) 2011-2014 Christian Kindahl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxtest/TestSuite.h>
+#include <limits>
+#include "runtime/strings.hh"
+#include "../gc.hh"
+
+class StringsTestSuite : public CxxTest::TestSuite
+{
+public:
+    void test_strings_intern()
+    {
+        Gc::instance().init();
+
+        EsStrings strings;
+
+        const EsString *str1 = EsString::create_from_utf8("foo");
+        const EsString *str2 = EsString::create_from_utf8("bar");
+
+        TS_ASSERT(!strings.is_interned(str1));
+
+        StringId id1 = strings.intern(str1);
+        StringId id2 = strings.intern(str2);
+        TS_ASSERT(strings.is_interned(str1));
+        TS_ASSERT(strings.is_interned(str2));
+        TS_ASSERT(id1 != id2);
+
+        // Equal strings share identifier.
+        TS_ASSERT_EQUALS(strings.intern(EsString::create_from_utf8("foo")), id1);
+
+        TS_ASSERT(strings.lookup(id1)->equals(str1));
+        TS_ASSERT(strings.lookup(id2)->equals(str2));
+    }
+
+    void test_strings_unsafe_intern()
+    {
+        Gc::instance().init();
+
+        EsStrings strings;
+
+        const StringId max_id = std::numeric_limits<StringId>::max();
+
+        const EsString *str1 = EsString::create_from_utf8("foo");
+        const EsString *str2 = EsString::create_from_utf8("bar");
+        const EsString *str3 = EsString::create_from_utf8("baz");
+
+        strings.unsafe_intern(str1, max_id);
+        strings.unsafe_intern(str2, max_id - 2);
+        StringId id3 = strings.intern(str3);
+
+        TS_ASSERT_EQUALS(strings.intern(str1), max_id);
+        TS_ASSERT_EQUALS(strings.intern(str2), max_id - 2);
+
+        TS_ASSERT(strings.lookup(max_id)->equals(str1));
+        TS_ASSERT(strings.lookup(max_id - 2)->equals(str2));
+        TS_ASSERT(strings.lookup(id3)->equals(str3));
+    }
+
+    void test_strings_lookup_many()
+    {
+        Gc::instance().init();
+
+        EsStrings strings;
+
+        std::vector<StringId> ids;
+        for (int i = 0; i < 10000; i++)
+            ids.push_back(strings.intern(EsString::create_from_utf8(std::to_string(i).c_str())));
+
+        for (int i = 0; i < 10000; i++)
+            TS_ASSERT(strings.lookup(ids[i])->equals(EsString::create_from_utf8(std::to_string(i).c_str())));
+    }
+};
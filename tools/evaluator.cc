@@ -27,6 +27,7 @@
 #include "runtime/eval.hh"
 #include "runtime/global.hh"
 #include "runtime/frame.hh"
+#include "runtime/resolver.hh"
 #include "runtime/runtime.h"
 
 using parser::FunctionLiteral;
@@ -108,6 +109,9 @@ int main (int argc, const char *argv[])
         return 1;
     }
 
+    // Global code shares the variable environment with the global object.
+    Resolver().resolve(prog, false);
+
     EsContextStack::instance().push_global(prog->is_strict_mode());
     EsContext *ctx = EsContextStack::instance().top();
 